@@ -0,0 +1,125 @@
+// Substructure screening throughput over transposed fingerprint blocks.
+//
+// Usage: bingo-nosql-screening-benchmark [pack_count] [query_bits] [bit_density]
+//
+// Every pack holds one 8192-byte block per query bit, like TranspFpStorage.
+// Candidates of a pack are found once with the byte-wise AND and range
+// trimming the substructure matcher used before, and once per instruction
+// set with the tiled PopcountKernels::andNonZero screening, and the screened
+// fingerprints per second are reported.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_c/bitarray.h"
+#include "base_c/nano.h"
+#include "base_cpp/array.h"
+#include "base_cpp/popcount_kernels.h"
+
+using namespace indigo;
+
+namespace
+{
+    const int BLOCK_SIZE = 8192;
+    const int TILE_SIZE = 256;
+
+    unsigned _seed = 42;
+
+    // Xorshift, a linear congruential generator correlates bits at power of two distances
+    unsigned _random()
+    {
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 17;
+        _seed ^= _seed << 5;
+        return _seed & 0xFFFFFF;
+    }
+
+    int _countCandidates(const Array<byte>& fit_bits)
+    {
+        return bitGetOnesCount(fit_bits.ptr(), fit_bits.size());
+    }
+
+    int _screenBytewise(const Array<byte>& blocks, int pack_count, int query_bits)
+    {
+        Array<byte> fit_bits;
+        fit_bits.clear_resize(BLOCK_SIZE);
+        int candidates = 0;
+        for (int pack = 0; pack < pack_count; pack++)
+        {
+            fit_bits.fill(255);
+            int left = 0, right = BLOCK_SIZE - 1;
+            for (int i = 0; i < query_bits; i++)
+            {
+                const byte* block = blocks.ptr() + ((size_t)pack * query_bits + i) * BLOCK_SIZE;
+                bitAnd(fit_bits.ptr() + left, block + left, right - left + 1);
+
+                while (left <= right && fit_bits[left] == 0)
+                    left++;
+                while (left <= right && fit_bits[right] == 0)
+                    right--;
+                if (left > right)
+                    break;
+            }
+            candidates += _countCandidates(fit_bits);
+        }
+        return candidates;
+    }
+
+    int _screenTiled(const Array<byte>& blocks, int pack_count, int query_bits)
+    {
+        Array<byte> fit_bits;
+        fit_bits.clear_resize(BLOCK_SIZE);
+        int candidates = 0;
+        for (int pack = 0; pack < pack_count; pack++)
+        {
+            fit_bits.fill(255);
+            const byte* pack_blocks = blocks.ptr() + (size_t)pack * query_bits * BLOCK_SIZE;
+            for (int tile = 0; tile < BLOCK_SIZE; tile += TILE_SIZE)
+                for (int i = 0; i < query_bits; i++)
+                    if (!PopcountKernels::andNonZero(fit_bits.ptr() + tile, pack_blocks + (size_t)i * BLOCK_SIZE + tile, TILE_SIZE))
+                        break;
+            candidates += _countCandidates(fit_bits);
+        }
+        return candidates;
+    }
+
+    void _report(const char* mode, int pack_count, int candidates, qword start)
+    {
+        float seconds = nanoHowManySeconds(nanoClock() - start);
+        printf("%-18s %10.1f Mfp/s  %8d candidates\n", mode, (double)pack_count * BLOCK_SIZE * 8 / seconds / 1e6, candidates);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int pack_count = (argc > 1 ? atoi(argv[1]) : 200);
+    int query_bits = (argc > 2 ? atoi(argv[2]) : 15);
+    double density = (argc > 3 ? atof(argv[3]) : 0.3);
+
+    // Each block has the given share of bits set, so about density^query_bits fingerprints pass
+    Array<byte> blocks;
+    blocks.clear_resize(pack_count * query_bits * BLOCK_SIZE);
+    blocks.zerofill();
+    int threshold = (int)(density * 0xFFFFFF);
+    for (int i = 0; i < blocks.size() * 8; i++)
+        if ((int)_random() < threshold)
+            bitSetBit(blocks.ptr(), i, 1);
+
+    printf("%d packs of %d fingerprints, %d query bits, density %.2f, detected %s\n\n", pack_count, BLOCK_SIZE * 8, query_bits, density,
+           PopcountKernels::isaName(PopcountKernels::detectIsa()));
+
+    qword start = nanoClock();
+    int candidates = _screenBytewise(blocks, pack_count, query_bits);
+    _report("byte-wise", pack_count, candidates, start);
+
+    for (int isa = PopcountKernels::ISA_SCALAR; isa <= PopcountKernels::detectIsa(); isa++)
+    {
+        PopcountKernels::setIsa((PopcountKernels::Isa)isa);
+        start = nanoClock();
+        candidates = _screenTiled(blocks, pack_count, query_bits);
+        _report(PopcountKernels::isaName((PopcountKernels::Isa)isa), pack_count, candidates, start);
+    }
+
+    return 0;
+}
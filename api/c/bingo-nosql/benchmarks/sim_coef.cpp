@@ -0,0 +1,123 @@
+// Similarity scoring throughput of the Bingo NoSQL coefficient kernels.
+//
+// Usage: bingo-nosql-benchmarks [fp_count] [fp_size] [min_coef]
+//
+// Scores a synthetic set of fingerprints against a query, once with the
+// per-fingerprint SimCoef::calcCoef loop and once per instruction set with the
+// batched SimCoef::calcCoefs, and reports fingerprints scored per second.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+
+#include "base_c/bitarray.h"
+#include "base_c/nano.h"
+#include "base_cpp/array.h"
+#include "base_cpp/popcount_kernels.h"
+
+#include "bingo_euclid_coef.h"
+#include "bingo_tanimoto_coef.h"
+#include "bingo_tversky_coef.h"
+
+using namespace bingo;
+using namespace indigo;
+
+namespace
+{
+    const int BATCH_SIZE = 5000;
+
+    unsigned _seed = 42;
+
+    unsigned _random()
+    {
+        _seed = _seed * 1103515245u + 12345u;
+        return (_seed >> 8) & 0xFFFFFF;
+    }
+
+    // Fingerprints with about a quarter of the bits set, which is typical for similarity fingerprints
+    void _generate(Array<byte>& fingerprints, int fp_count, int fp_size)
+    {
+        fingerprints.clear_resize(fp_count * fp_size);
+        fingerprints.zerofill();
+        for (int i = 0; i < fp_count; i++)
+        {
+            byte* fp = fingerprints.ptr() + i * fp_size;
+            int bits = fp_size * 8 * (16 + _random() % 20) / 100;
+            for (int k = 0; k < bits; k++)
+                bitSetBit(fp, _random() % (fp_size * 8), 1);
+        }
+    }
+
+    int _scoreLegacy(SimCoef& coef, const byte* query, const Array<byte>& fingerprints, int fp_count, int fp_size, double min_coef)
+    {
+        int query_bit_count = bitGetOnesCount(query, fp_size);
+        int hits = 0;
+        for (int i = 0; i < fp_count; i++)
+        {
+            const byte* fp = fingerprints.ptr() + i * fp_size;
+            if (coef.calcCoef(query, fp, query_bit_count, bitGetOnesCount(fp, fp_size)) >= min_coef)
+                hits++;
+        }
+        return hits;
+    }
+
+    int _scoreBatched(SimCoef& coef, const byte* query, const Array<byte>& fingerprints, int fp_count, int fp_size, double min_coef)
+    {
+        int query_bit_count = bitGetOnesCount(query, fp_size);
+        Array<SimResult> results;
+        int hits = 0;
+        for (int first = 0; first < fp_count; first += BATCH_SIZE)
+        {
+            int count = (fp_count - first < BATCH_SIZE ? fp_count - first : BATCH_SIZE);
+            results.clear();
+            coef.calcCoefs(query, query_bit_count, fingerprints.ptr() + first * fp_size, nullptr, count, fp_size, min_coef, true, results);
+            hits += results.size();
+        }
+        return hits;
+    }
+
+    void _report(const char* metric, const char* mode, int fp_count, int hits, qword start)
+    {
+        float seconds = nanoHowManySeconds(nanoClock() - start);
+        printf("%-10s %-18s %10.1f Mfp/s  %8d hits\n", metric, mode, fp_count / seconds / 1e6, hits);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int fp_count = (argc > 1 ? atoi(argv[1]) : 2000000);
+    int fp_size = (argc > 2 ? atoi(argv[2]) : 64);
+    double min_coef = (argc > 3 ? atof(argv[3]) : 0.5);
+
+    Array<byte> fingerprints;
+    _generate(fingerprints, fp_count, fp_size);
+    const byte* query = fingerprints.ptr();
+
+    printf("%d fingerprints of %d bytes, min_coef %.2f, detected %s\n\n", fp_count, fp_size, min_coef,
+           PopcountKernels::isaName(PopcountKernels::detectIsa()));
+
+    const char* metrics[] = {"tanimoto", "tversky", "euclid"};
+    std::unique_ptr<SimCoef> coefs[] = {std::unique_ptr<SimCoef>(new TanimotoCoef(fp_size)),
+                                        std::unique_ptr<SimCoef>(new TverskyCoef(fp_size, 0.7, 0.3)),
+                                        std::unique_ptr<SimCoef>(new EuclidCoef(fp_size))};
+
+    for (int m = 0; m < 3; m++)
+    {
+        qword start = nanoClock();
+        int hits = _scoreLegacy(*coefs[m], query, fingerprints, fp_count, fp_size, min_coef);
+        _report(metrics[m], "per-fingerprint", fp_count, hits, start);
+
+        for (int isa = PopcountKernels::ISA_SCALAR; isa <= PopcountKernels::detectIsa(); isa++)
+        {
+            PopcountKernels::setIsa((PopcountKernels::Isa)isa);
+            start = nanoClock();
+            hits = _scoreBatched(*coefs[m], query, fingerprints, fp_count, fp_size, min_coef);
+            _report(metrics[m], PopcountKernels::isaName((PopcountKernels::Isa)isa), fp_count, hits, start);
+        }
+        PopcountKernels::setIsa(PopcountKernels::detectIsa());
+        printf("\n");
+    }
+
+    return 0;
+}
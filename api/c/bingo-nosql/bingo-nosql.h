@@ -33,6 +33,11 @@ CEXPORT int bingoCloseDatabase(int db);
 //
 CEXPORT int bingoInsertRecordObj(int db, int obj);
 CEXPORT int bingoInsertIteratorObj(int db, int iterator_obj_id);
+// Inserts all objects of the iterator, preparing them on several threads.
+// options = "threads: <count>;report: <records>", threads:0 (default) uses
+// one thread per core, report prints the insertion rate every <records> records.
+// Returns the number of inserted records.
+CEXPORT int bingoInsertBatch(int db, int iterator_obj_id, const char* options);
 CEXPORT int bingoInsertRecordObjWithId(int db, int obj, int id);
 CEXPORT int bingoInsertRecordObjWithExtFP(int db, int obj, int fp);
 CEXPORT int bingoInsertRecordObjWithIdAndExtFP(int db, int obj, int id, int fp);
@@ -19,9 +19,12 @@
 #include "bingo-nosql.h"
 
 #include <cstdio>
+#include <iostream>
 #include <string>
+#include <thread>
 
 #include "bingo_index.h"
+#include "bingo_insert_dispatcher.h"
 #include "bingo_internal.h"
 #include "indigo_internal.h"
 #include "indigo_molecule.h"
@@ -435,6 +438,49 @@ CEXPORT int bingoInsertIteratorObj(int db, int iterator_obj_id)
     BINGO_END(-1);
 }
 
+CEXPORT int bingoInsertBatch(int db, int iterator_obj_id, const char* options)
+{
+    BINGO_BEGIN_DB(db)
+    {
+        IndigoObject& iterator_obj = self.getObject(iterator_obj_id);
+
+        std::map<std::string, std::string> option_map;
+        std::vector<std::string> allowed_props = {"threads", "report"};
+        Properties::parseOptions(options, option_map, &allowed_props);
+
+        int thread_count = 0;
+        if (option_map.find("threads") != option_map.end())
+        {
+            if (!Properties::parseIntOption(option_map["threads"], thread_count) || thread_count < 0)
+                throw BingoException("bingoInsertBatch: incorrect threads parameter");
+        }
+        if (thread_count == 0)
+            thread_count = std::max(1, (int)std::thread::hardware_concurrency());
+
+        int report_interval = 0;
+        if (option_map.find("report") != option_map.end())
+        {
+            if (!Properties::parseIntOption(option_map["report"], report_interval) || report_interval < 0)
+                throw BingoException("bingoInsertBatch: incorrect report parameter");
+        }
+
+        const auto bingo_indexes = sf::slock_safe_ptr(_indexes());
+        auto bingo_index_ptr = sf::xlock_safe_ptr(bingo_indexes->at(db));
+
+        profTimerStart(t, "bingoInsertBatch");
+        InsertDispatcher dispatcher(**bingo_index_ptr, iterator_obj, self.arom_options);
+        dispatcher.setReportInterval(report_interval);
+        dispatcher.run(thread_count);
+
+        if (report_interval > 0)
+            std::cerr << "bingoInsertBatch: " << dispatcher.getInsertedCount() << " records inserted, " << dispatcher.getFailedCount() << " failed, "
+                      << (long)dispatcher.getRate() << " records/sec" << std::endl;
+
+        return dispatcher.getInsertedCount();
+    }
+    BINGO_END(-1);
+}
+
 CEXPORT int bingoInsertRecordObjWithId(int db, int obj, int id)
 {
     BINGO_BEGIN_DB(db)
@@ -30,6 +30,8 @@ static const char* _read_only_prop = "read_only";
 static const char* _max_mmf_size_prop = "max_mmf_size";
 static const char* _min_mmf_size_prop = "min_mmf_size";
 static const char* _mt_size_prop = "mt_size";
+static const char* _mol_cache_size_prop = "mol_cache_size";
+static const char* _exact_hash_prop = "exact_hash";
 static const char* _id_key_prop = "key";
 static const size_t _min_mmf_size = 33554432;  // 32Mb
 static const size_t _max_mmf_size = 536870912; // 512Mb
@@ -68,7 +70,7 @@ namespace
     }
 }
 
-BaseIndex::BaseIndex(IndexType type) : _type(type), _read_only(false)
+BaseIndex::BaseIndex(IndexType type) : _type(type), _read_only(false), _canonical_exact_hash(false)
 {
 }
 
@@ -101,6 +103,8 @@ void BaseIndex::create(const char* location, const MoleculeFingerprintParameters
     _checkOptions(option_map, true);
 
     _read_only = _getAccessType(option_map);
+    _molecule_cache.setMaxSize(_getMolCacheSize(option_map));
+    _canonical_exact_hash = _getCanonicalExactHash(option_map);
 
     size_t min_mmf_size = _getMinMMfSize(option_map);
     size_t max_mmf_size = _getMaxMMfSize(option_map);
@@ -162,6 +166,7 @@ void BaseIndex::load(const char* location, const char* options, int index_id)
     _checkOptions(option_map, false);
 
     _read_only = _getAccessType(option_map);
+    _molecule_cache.setMaxSize(_getMolCacheSize(option_map));
 
     MMFAllocator::load(_mmf_path.c_str(), index_id, _read_only);
 
@@ -187,6 +192,9 @@ void BaseIndex::load(const char* location, const char* options, int index_id)
 
     // unsigned long cf_block_size = _properties->getULong("cf_block_size");
 
+    const char* exact_hash = _properties->getNoThrow(_exact_hash_prop);
+    _canonical_exact_hash = (exact_hash != nullptr && strcmp(exact_hash, "canonical") == 0);
+
     _mappingLoad();
 
     SimStorage::load(_sim_fp_storage, _header.ptr()->sim_offset);
@@ -255,6 +263,7 @@ void BaseIndex::remove(int obj_id)
         throw Exception("There is no object with this id");
 
     _cf_storage->remove(back_id_mapping.get(obj_id));
+    _molecule_cache.remove(back_id_mapping.get(obj_id));
     _mappingRemove(obj_id);
 }
 
@@ -298,6 +307,16 @@ MMFMapping& BaseIndex::getBackIdMapping()
     return _cf_storage.ref();
 }
 
+MoleculeCache& BaseIndex::getMoleculeCache()
+{
+    return _molecule_cache;
+}
+
+bool BaseIndex::hasCanonicalExactHash() const
+{
+    return _canonical_exact_hash;
+}
+
 int BaseIndex::getObjectsCount() const
 {
     return _header->object_count;
@@ -364,10 +383,11 @@ void BaseIndex::_checkOptions(std::map<std::string, std::string>& option_map, bo
         if (is_create)
         {
             if ((it->first.compare(_read_only_prop) != 0) && (it->first.compare(_mt_size_prop) != 0) && (it->first.compare(_min_mmf_size_prop) != 0) &&
-                (it->first.compare(_max_mmf_size_prop) != 0) && (it->first.compare(_id_key_prop) != 0))
+                (it->first.compare(_max_mmf_size_prop) != 0) && (it->first.compare(_id_key_prop) != 0) && (it->first.compare(_mol_cache_size_prop) != 0) &&
+                (it->first.compare(_exact_hash_prop) != 0))
                 throw Exception("Creating index error: incorrect input options");
         }
-        else if ((it->first.compare(_read_only_prop)) != 0 && (it->first.compare(_id_key_prop) != 0))
+        else if ((it->first.compare(_read_only_prop)) != 0 && (it->first.compare(_id_key_prop) != 0) && (it->first.compare(_mol_cache_size_prop) != 0))
             throw Exception("Loading index error: incorrect input options");
     }
 }
@@ -423,6 +443,39 @@ bool BaseIndex::_getAccessType(std::map<std::string, std::string>& option_map)
     return false;
 }
 
+size_t BaseIndex::_getMolCacheSize(std::map<std::string, std::string>& option_map)
+{
+    size_t cache_size = 0;
+
+    if (option_map.find(_mol_cache_size_prop) != option_map.end())
+    {
+        unsigned long u_dec;
+        std::istringstream isstr(option_map[_mol_cache_size_prop]);
+        isstr >> u_dec;
+
+        if (isstr.fail())
+            throw Exception("BaseIndex: incorrect mol_cache_size option");
+
+        cache_size = u_dec * 1048576;
+    }
+
+    return cache_size;
+}
+
+bool BaseIndex::_getCanonicalExactHash(std::map<std::string, std::string>& option_map)
+{
+    if (option_map.find(_exact_hash_prop) == option_map.end())
+        return false;
+
+    const std::string& value = option_map[_exact_hash_prop];
+    if (value.compare("canonical") == 0)
+        return true;
+    if (value.compare("subgraph") == 0)
+        return false;
+
+    throw Exception("BaseIndex: incorrect exact_hash option");
+}
+
 void BaseIndex::_saveProperties(const MoleculeFingerprintParameters& fp_params, int sub_block_size, int sim_block_size, int cf_block_size,
                                 std::map<std::string, std::string>& option_map)
 {
@@ -465,6 +518,8 @@ ObjectIndexData BaseIndex::prepareIndexData(IndexObject& obj) const
     {
         profTimerStart(t, "prepare_hash");
         obj.buildHash(obj_data.hash);
+        if (_canonical_exact_hash)
+            obj.buildCanonicalHash(obj_data.canonical_hash);
     }
 
     return obj_data;
@@ -495,6 +550,8 @@ ObjectIndexData BaseIndex::prepareIndexDataWithExtFP(IndexObject& obj, IndigoObj
     }
 
     obj.buildHash(obj_data.hash);
+    if (_canonical_exact_hash)
+        obj.buildCanonicalHash(obj_data.canonical_hash);
 
     return obj_data;
 }
@@ -505,6 +562,8 @@ void BaseIndex::_insertIndexData(const ObjectIndexData& obj_data)
     _sim_fp_storage.ptr()->add(obj_data.sim_fp.ptr(), _header->object_count);
     _cf_storage.ptr()->add((byte*)obj_data.cf_str.ptr(), obj_data.cf_str.size(), _header->object_count);
     _exact_storage.ptr()->add(obj_data.hash, _header->object_count);
+    if (_canonical_exact_hash)
+        _exact_storage.ptr()->add(obj_data.canonical_hash, _header->object_count);
     _gross_storage.ptr()->add(obj_data.gross_str, _header->object_count);
 }
 
@@ -9,6 +9,7 @@
 #include "bingo_exact_storage.h"
 #include "bingo_fp_storage.h"
 #include "bingo_gross_storage.h"
+#include "bingo_molecule_cache.h"
 #include "bingo_object.h"
 #include "bingo_properties.h"
 #include "bingo_sim_storage.h"
@@ -35,6 +36,7 @@ namespace bingo
         Array<char> cf_str;
         Array<char> gross_str;
         dword hash;
+        dword canonical_hash;
     };
 
     class BaseIndex
@@ -89,6 +91,12 @@ namespace bingo
 
         ByteBufferStorage& getCfStorage();
 
+        MoleculeCache& getMoleculeCache();
+
+        // True if objects are stored in the exact storage under their canonical
+        // graph hash too (exact_hash:canonical option)
+        bool hasCanonicalExactHash() const;
+
         int getObjectsCount() const;
 
         const byte* getObjectCf(int id, int& len);
@@ -120,6 +128,9 @@ namespace bingo
         MMFPtr<ByteBufferStorage> _cf_storage;
         MMFPtr<Properties> _properties;
 
+        MoleculeCache _molecule_cache;
+        bool _canonical_exact_hash;
+
         MoleculeFingerprintParameters _fp_params;
         std::string _location;
         int _lock_fd = -1;
@@ -132,6 +143,10 @@ namespace bingo
 
         static bool _getAccessType(std::map<std::string, std::string>& option_map);
 
+        static size_t _getMolCacheSize(std::map<std::string, std::string>& option_map);
+
+        static bool _getCanonicalExactHash(std::map<std::string, std::string>& option_map);
+
         void _saveProperties(const MoleculeFingerprintParameters& fp_params, int sub_block_size, int sim_block_size, int cf_block_size,
                              std::map<std::string, std::string>& option_map);
 
@@ -186,17 +186,10 @@ int ContainerSet::_findSimilarInc(const byte* query, SimCoef& sim_coef, double m
 
     int query_bit_number = bitGetOnesCount(query, _fp_size);
 
-    for (int i = 0; i < _inc_count; i++)
-    {
-        byte* fp = inc + i * _fp_size;
-        int fp_bit_number = bitGetOnesCount(fp, _fp_size);
+    sim_coef.calcCoefs(query, query_bit_number, inc, nullptr, _inc_count, _fp_size, min_coef, true, sim_indices);
 
-        double coef = sim_coef.calcCoef(fp, query, query_bit_number, fp_bit_number);
-        if (coef < min_coef)
-            continue;
-
-        sim_indices.push(SimResult(indices[i], (float)coef));
-    }
+    for (int i = 0; i < sim_indices.size(); i++)
+        sim_indices[i].id = indices[sim_indices[i].id];
 
     return sim_indices.size();
 }
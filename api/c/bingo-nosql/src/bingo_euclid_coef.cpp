@@ -13,6 +13,11 @@ double EuclidCoef::calcCoef(const byte* target, const byte* query, int target_bi
     if (target_bit_count == -1)
         target_bit_count = bitGetOnesCount(target, _fp_size);
 
+    return calcCoef(common_bits, target_bit_count, query_bit_count);
+}
+
+double EuclidCoef::calcCoef(int common_bits, int target_bit_count, int query_bit_count)
+{
     return (double)common_bits / target_bit_count;
 }
 
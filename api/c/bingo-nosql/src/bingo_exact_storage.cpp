@@ -3,6 +3,7 @@
 #include "base_cpp/profiling.h"
 #include "graph/subgraph_hash.h"
 #include "molecule/elements.h"
+#include "molecule/molecule_canonical_hash.h"
 
 using namespace bingo;
 using namespace indigo;
@@ -103,3 +104,26 @@ dword ExactStorage::calculateRxnHash(Reaction& rxn)
 
     return hash;
 }
+
+dword ExactStorage::calculateMolCanonicalHash(Molecule& mol)
+{
+    MoleculeCanonicalHash canonical_hash;
+    Hash128 hash = canonical_hash.calculate(mol);
+
+    return (dword)(hash.h1 ^ (hash.h1 >> 32));
+}
+
+dword ExactStorage::calculateRxnCanonicalHash(Reaction& rxn)
+{
+    MoleculeCanonicalHash canonical_hash;
+    dword hash = 0;
+
+    // Molecules are summed up to not depend on their order, odd role factors keep reactants and products apart
+    for (int j = rxn.begin(); j != rxn.end(); j = rxn.next(j))
+    {
+        Hash128 mol_hash = canonical_hash.calculate(rxn.getMolecule(j));
+        hash += (dword)(mol_hash.h1 ^ (mol_hash.h1 >> 32)) * (2 * rxn.getSideType(j) + 1);
+    }
+
+    return hash;
+}
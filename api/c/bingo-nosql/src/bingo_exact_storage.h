@@ -28,6 +28,14 @@ namespace bingo
 
         static dword calculateRxnHash(indigo::Reaction& rxn);
 
+        // Canonical graph hashes, stored next to the subgraph hashes in indexes
+        // created with the exact_hash:canonical option. The 128-bit
+        // MoleculeCanonicalHash is folded into the 32-bit key of the storage,
+        // candidates are still verified by the exact matcher.
+        static dword calculateMolCanonicalHash(indigo::Molecule& mol);
+
+        static dword calculateRxnCanonicalHash(indigo::Reaction& rxn);
+
     private:
         MMFMapping _molecule_hashes;
     };
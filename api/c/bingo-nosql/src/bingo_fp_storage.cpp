@@ -101,11 +101,11 @@ void TranspFpStorage::_addIncToStorage()
         for (int fp_idx = 0; fp_idx < _inc_fp_count; fp_idx++)
             bitSetBit(&block_buf[0], fp_idx, bitGetBit(_inc_buffer.ptr() + fp_idx * _fp_size, bit_idx));
 
+        // Update bit usage count, it orders query bits by selectivity in the substructure screening
         if (_pack_count == 0)
-        {
-            // Update bit usage count
             _fp_bit_usage_counts[bit_idx] = bitGetOnesCount(&block_buf[0], _block_size);
-        }
+        else
+            _fp_bit_usage_counts[bit_idx] += bitGetOnesCount(&block_buf[0], _block_size);
 
         int block_idx = (_pack_count * _fp_size * 8) + bit_idx;
         _storage.resize(block_idx + 1);
@@ -0,0 +1,169 @@
+#include "bingo_insert_dispatcher.h"
+
+#include <iostream>
+
+#include "base_c/nano.h"
+#include "base_cpp/profiling.h"
+
+#include "indigo_molecule.h"
+#include "indigo_reaction.h"
+
+using namespace indigo;
+using namespace bingo;
+
+static const int _RECORDS_PER_COMMAND = 32;
+
+InsertDispatcher::InsertDispatcher(BaseIndex& index, IndigoObject& iterator, const AromaticityOptions& arom_options)
+    : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _index(index), _iterator(iterator), _arom_options(arom_options)
+{
+    _id_property_name = _index.getIdPropertyName();
+    _finished = false;
+    _inserted_count = 0;
+    _failed_count = 0;
+    _report_interval = 0;
+    _start_time = nanoClock();
+}
+
+void InsertDispatcher::setReportInterval(int report_interval)
+{
+    _report_interval = report_interval;
+}
+
+int InsertDispatcher::getInsertedCount() const
+{
+    return _inserted_count;
+}
+
+int InsertDispatcher::getFailedCount() const
+{
+    return _failed_count;
+}
+
+double InsertDispatcher::getRate() const
+{
+    float seconds = nanoHowManySeconds(nanoClock() - _start_time);
+    if (seconds <= 0)
+        return 0;
+    return _inserted_count / seconds;
+}
+
+void InsertDispatcher::_Command::clear()
+{
+    objects.clear();
+}
+
+void InsertDispatcher::_Command::execute(OsCommandResult& result)
+{
+    _Result& res = static_cast<_Result&>(result);
+    for (auto& obj : objects)
+        dispatcher->_prepare(*obj, res);
+}
+
+void InsertDispatcher::_Result::clear()
+{
+    data.clear();
+    ids.clear();
+    errors.clear();
+}
+
+OsCommand* InsertDispatcher::_allocateCommand()
+{
+    return new _Command();
+}
+
+OsCommandResult* InsertDispatcher::_allocateResult()
+{
+    return new _Result();
+}
+
+bool InsertDispatcher::_setupCommand(OsCommand& command)
+{
+    if (_finished)
+        return false;
+
+    profTimerStart(t, "insert_batch_read");
+
+    _Command& cmd = static_cast<_Command&>(command);
+    cmd.dispatcher = this;
+
+    while (cmd.objects.size() < _RECORDS_PER_COMMAND)
+    {
+        IndigoObject* obj = _iterator.next();
+        if (obj == nullptr)
+        {
+            _finished = true;
+            break;
+        }
+        cmd.objects.emplace_back(obj);
+    }
+
+    return !cmd.objects.empty();
+}
+
+void InsertDispatcher::_prepare(IndigoObject& obj, _Result& result) const
+{
+    profTimerStart(t, "insert_batch_prepare");
+    try
+    {
+        long obj_id = -1;
+        auto& properties = obj.getProperties();
+        if (_id_property_name != nullptr && properties.contains(_id_property_name))
+            obj_id = strtol(properties.at(_id_property_name), NULL, 10);
+
+        if (_index.getType() == IndexType::MOLECULE)
+        {
+            if (!IndigoMolecule::is(obj))
+                throw Exception("bingoInsertBatch: Only molecule objects can be added to molecule index");
+
+            obj.getMolecule().aromatize(_arom_options);
+            IndexMolecule ind_mol(obj.getMolecule(), _arom_options);
+            result.data.push_back(_index.prepareIndexData(ind_mol));
+        }
+        else
+        {
+            if (!IndigoReaction::is(obj))
+                throw Exception("bingoInsertBatch: Only reaction objects can be added to reaction index");
+
+            obj.getReaction().aromatize(_arom_options);
+            IndexReaction ind_rxn(obj.getReaction(), _arom_options);
+            result.data.push_back(_index.prepareIndexData(ind_rxn));
+        }
+
+        result.ids.push_back(obj_id);
+    }
+    catch (Exception& e)
+    {
+        result.errors.push_back(e.message());
+    }
+}
+
+void InsertDispatcher::_handleResult(OsCommandResult& result)
+{
+    profTimerStart(t, "insert_batch_write");
+
+    _Result& res = static_cast<_Result&>(result);
+
+    for (auto& error : res.errors)
+        std::cerr << error << std::endl;
+    _failed_count += (int)res.errors.size();
+
+    for (size_t i = 0; i < res.data.size(); i++)
+    {
+        try
+        {
+            _index.add(res.ids[i], res.data[i]);
+            _inserted_count++;
+        }
+        catch (Exception& e)
+        {
+            std::cerr << e.message() << std::endl;
+            _failed_count++;
+            continue;
+        }
+
+        if (_report_interval > 0 && _inserted_count % _report_interval == 0)
+            std::cerr << "bingoInsertBatch: " << _inserted_count << " records, " << (long)getRate() << " records/sec" << std::endl;
+    }
+
+    profIncCounter("insert_batch_records", res.data.size());
+}
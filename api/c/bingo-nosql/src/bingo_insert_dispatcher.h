@@ -0,0 +1,77 @@
+#ifndef __bingo_insert_dispatcher__
+#define __bingo_insert_dispatcher__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base_cpp/os_thread_wrapper.h"
+#include "molecule/molecule_arom.h"
+
+#include "bingo_base_index.h"
+
+namespace bingo
+{
+    // Bulk insertion of the objects of an Indigo iterator into an index.
+    // Records are read from the iterator on the calling thread, loaded and
+    // prepared (CF string, gross formula, fingerprints, hash) on worker
+    // threads, and appended to the index by the calling thread in the order
+    // they were read. Records that fail to load are reported to stderr and
+    // skipped, like bingoInsertIteratorObj does.
+    class InsertDispatcher : public indigo::OsCommandDispatcher
+    {
+    public:
+        InsertDispatcher(BaseIndex& index, IndigoObject& iterator, const indigo::AromaticityOptions& arom_options);
+
+        // Prints the insertion rate to stderr every report_interval records, 0 disables reports
+        void setReportInterval(int report_interval);
+
+        int getInsertedCount() const;
+        int getFailedCount() const;
+
+        // Records per second over the whole run
+        double getRate() const;
+
+    private:
+        class _Command : public indigo::OsCommand
+        {
+        public:
+            void clear() override;
+            void execute(indigo::OsCommandResult& result) override;
+
+            std::vector<std::unique_ptr<IndigoObject>> objects;
+            InsertDispatcher* dispatcher;
+        };
+
+        class _Result : public indigo::OsCommandResult
+        {
+        public:
+            void clear() override;
+
+            std::vector<ObjectIndexData> data;
+            std::vector<long> ids;
+            std::vector<std::string> errors;
+        };
+
+        indigo::OsCommand* _allocateCommand() override;
+        indigo::OsCommandResult* _allocateResult() override;
+
+        bool _setupCommand(indigo::OsCommand& command) override;
+        void _handleResult(indigo::OsCommandResult& result) override;
+
+        void _prepare(IndigoObject& obj, _Result& result) const;
+
+        BaseIndex& _index;
+        IndigoObject& _iterator;
+        indigo::AromaticityOptions _arom_options;
+        const char* _id_property_name;
+        bool _finished;
+
+        int _inserted_count;
+        int _failed_count;
+        int _report_interval;
+        qword _start_time;
+    };
+}; // namespace bingo
+
+#endif /* __bingo_insert_dispatcher__ */
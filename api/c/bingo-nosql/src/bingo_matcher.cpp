@@ -1,5 +1,6 @@
 #include "bingo_matcher.h"
 #include "bingo_euclid_coef.h"
+#include "bingo_search_dispatcher.h"
 #include "bingo_tanimoto_coef.h"
 #include "bingo_tversky_coef.h"
 
@@ -7,10 +8,13 @@
 
 #include "base_c/bitarray.h"
 #include "base_c/nano.h"
+#include "base_cpp/popcount_kernels.h"
 #include "base_cpp/profiling.h"
 
 #include <algorithm>
+#include <cstring>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 using namespace indigo;
@@ -18,6 +22,14 @@ using namespace bingo;
 
 static const char* _matcher_params_prop = "";
 static const char* _matcher_part_prop = "part";
+static const char* _matcher_threads_prop = "threads";
+
+// Work items handed to the worker threads at once by a parallel search, per thread
+static const int _PARALLEL_ITEMS_PER_THREAD = 4;
+// Number of the rarest query bits used for the pack screening
+static const int _SCREEN_BITS_LIMIT = 15;
+// Bytes of a transposed block screened at once, 2048 fingerprints
+static const int _SCREEN_TILE_SIZE = 256;
 
 GrossQueryData::GrossQueryData(Array<char>& gross_str) : _obj(gross_str)
 {
@@ -147,6 +159,7 @@ BaseMatcher::BaseMatcher(BaseIndex& index, IndigoObject*& current_obj) : _index(
     _current_id = -1;
     _part_id = -1;
     _part_count = -1;
+    _thread_count = 1;
 }
 
 BaseMatcher::~BaseMatcher()
@@ -222,8 +235,21 @@ void BaseMatcher::setOptions(const char* options)
     std::vector<std::string> allowed_props;
     allowed_props.push_back(_matcher_params_prop);
     allowed_props.push_back(_matcher_part_prop);
+    allowed_props.push_back(_matcher_threads_prop);
     Properties::parseOptions(options, option_map, &allowed_props);
 
+    if (option_map.find(_matcher_threads_prop) != option_map.end())
+    {
+        int thread_count;
+        if (!Properties::parseIntOption(option_map[_matcher_threads_prop], thread_count) || thread_count < 0)
+            throw Exception("BaseMatcher: setOptions: incorrect threads parameter");
+
+        // threads:0 means one thread per core
+        if (thread_count == 0)
+            thread_count = std::max(1, (int)std::thread::hardware_concurrency());
+        _thread_count = thread_count;
+    }
+
     if (option_map.find(_matcher_params_prop) != option_map.end())
         _setParameters(option_map[_matcher_params_prop].c_str());
 
@@ -261,18 +287,32 @@ bool BaseMatcher::_isCurrentObjectExist()
     return true;
 }
 
-bool BaseMatcher::_loadCurrentObject()
+bool BaseMatcher::_loadCurrentObject(bool use_cache)
 {
+    if (_current_obj == nullptr)
+        throw Exception("BaseMatcher: Matcher's current object was destroyed");
+
+    if (IndigoMolecule::is(*_current_obj))
+        return _loadMolecule(_current_id, _current_obj->getMolecule(), use_cache);
+    else if (IndigoReaction::is(*_current_obj))
+        return _loadReaction(_current_id, _current_obj->getReaction());
+    else
+        throw Exception("BaseMatcher::unknown current object type");
+}
+
+bool BaseMatcher::_loadMolecule(int id, Molecule& mol, bool use_cache)
+{
+    MoleculeCache& mol_cache = _index.getMoleculeCache();
+    if (use_cache && mol_cache.get(id, mol))
+        return true;
+
     try
     {
-        if (_current_obj == nullptr)
-            throw Exception("BaseMatcher: Matcher's current object was destroyed");
-
         profTimerStart(t_get_cmf, "loadCurObj_get_cf");
         ByteBufferStorage& cf_storage = _index.getCfStorage();
 
         int cf_len;
-        const char* cf_str = (const char*)cf_storage.get(_current_id, cf_len);
+        const char* cf_str = (const char*)cf_storage.get(id, cf_len);
 
         if (cf_len == -1)
             return false;
@@ -281,32 +321,50 @@ bool BaseMatcher::_loadCurrentObject()
         profTimerStart(t_load_cmf, "loadCurObj_load_cf");
         BufferScanner buf_scn(cf_str, cf_len);
 
-        if (IndigoMolecule::is(*_current_obj))
-        {
-            Molecule& mol = _current_obj->getMolecule();
+        CmfLoader cmf_loader(buf_scn);
 
-            CmfLoader cmf_loader(buf_scn);
+        cmf_loader.loadMolecule(mol);
+        profTimerStop(t_load_cmf);
 
-            cmf_loader.loadMolecule(mol);
-        }
-        else if (IndigoReaction::is(*_current_obj))
-        {
-            Reaction& rxn = _current_obj->getReaction();
+        if (use_cache)
+            mol_cache.put(id, mol);
+        return true;
+    }
+    catch (Exception& ex)
+    {
+        const int db_id = _index.getIdMapping()[id];
+        ex.appendMessage(" on id=%d", db_id);
+        throw;
+    }
+}
 
-            CrfLoader crf_loader(buf_scn);
+bool BaseMatcher::_loadReaction(int id, Reaction& rxn)
+{
+    try
+    {
+        profTimerStart(t_get_cmf, "loadCurObj_get_cf");
+        ByteBufferStorage& cf_storage = _index.getCfStorage();
 
-            crf_loader.loadReaction(rxn);
-        }
-        else
-            throw Exception("BaseMatcher::unknown current object type");
+        int cf_len;
+        const char* cf_str = (const char*)cf_storage.get(id, cf_len);
+
+        if (cf_len == -1)
+            return false;
+        profTimerStop(t_get_cmf);
+
+        profTimerStart(t_load_cmf, "loadCurObj_load_cf");
+        BufferScanner buf_scn(cf_str, cf_len);
+
+        CrfLoader crf_loader(buf_scn);
 
+        crf_loader.loadReaction(rxn);
         profTimerStop(t_load_cmf);
 
         return true;
     }
     catch (Exception& ex)
     {
-        const int db_id = _index.getIdMapping()[_current_id];
+        const int db_id = _index.getIdMapping()[id];
         ex.appendMessage(" on id=%d", db_id);
         throw;
     }
@@ -352,6 +410,21 @@ BaseSubstructureMatcher::BaseSubstructureMatcher(/*const */ BaseIndex& index, In
     _final_pack = _fp_storage.getPackCount() + 1;
 
     _cand_count = 0;
+    _parallel_hit_id = 0;
+}
+
+static void _copyMapping(ObjArray<Array<int>>& dst, const ObjArray<Array<int>>& src)
+{
+    dst.clear();
+    for (int i = 0; i < src.size(); i++)
+        dst.push().copy(src[i]);
+}
+
+void SubstructureHits::clear()
+{
+    ids.clear();
+    mappings.clear();
+    candidates_count = 0;
 }
 
 bool BaseSubstructureMatcher::next()
@@ -359,6 +432,9 @@ bool BaseSubstructureMatcher::next()
     // int fp_size_in_bits = _fp_size * 8;
     // static int sub_cnt = 0;
 
+    if (_thread_count > 1)
+        return _nextParallel();
+
     _current_cand_id++;
     while (!((_current_pack == _final_pack) && (_current_cand_id == _candidates.size())))
     {
@@ -370,7 +446,7 @@ bool BaseSubstructureMatcher::next()
             _current_pack++;
             if (_current_pack < _final_pack)
             {
-                _findPackCandidates(_current_pack);
+                _findPackCandidates(_current_pack, _candidates);
                 _cand_count += _candidates.size();
             }
             else
@@ -431,69 +507,128 @@ void BaseSubstructureMatcher::setQueryData(SubstructureQueryData* query_data)
               [&](int i1, int i2) { return fp_bit_usage[i1] < fp_bit_usage[i2]; });
 }
 
-void BaseSubstructureMatcher::_findPackCandidates(int pack_idx)
+bool BaseSubstructureMatcher::_nextParallel()
+{
+    while (true)
+    {
+        if (_parallel_hit_id < _parallel_hits.ids.size())
+        {
+            _current_id = _parallel_hits.ids[_parallel_hit_id];
+            _setCurrentMapping(_parallel_hits.mappings[_parallel_hit_id]);
+            _parallel_hit_id++;
+
+            if (!_loadCurrentObject(false))
+                continue;
+
+            sub_cnt++;
+            return true;
+        }
+
+        if (_current_pack + 1 >= _final_pack)
+            break;
+
+        // Next window of packs is screened and verified by the workers
+        int first_pack = _current_pack + 1;
+        int pack_count = std::min(_final_pack - first_pack, _thread_count * _PARALLEL_ITEMS_PER_THREAD);
+        _current_pack = first_pack + pack_count - 1;
+
+        _parallel_hits.clear();
+        _parallel_hit_id = 0;
+
+        profTimerStart(tp, "sub_parallel_window");
+        SearchDispatcher<SubstructureHits> dispatcher(
+            pack_count,
+            [this, first_pack](int item, SubstructureHits& hits) {
+                Array<int> candidates;
+                _findPackCandidates(first_pack + item, candidates);
+                hits.candidates_count = candidates.size();
+                _tryCandidates(candidates, hits);
+            },
+            [this](SubstructureHits& hits) {
+                _cand_count += hits.candidates_count;
+                for (int i = 0; i < hits.ids.size(); i++)
+                {
+                    _parallel_hits.ids.push(hits.ids[i]);
+                    _copyMapping(_parallel_hits.mappings.push(), hits.mappings[i]);
+                }
+                for (int i = 0; i < hits.candidates_count; i++)
+                    _match_probability_esimate.addValue(i < hits.ids.size() ? 1.f : 0.f);
+            });
+        dispatcher.run(std::min(_thread_count, pack_count));
+        profIncCounter("sub_found", _parallel_hits.ids.size());
+    }
+
+    profIncCounter("sub_count_cand", _cand_count);
+    return false;
+}
+
+void BaseSubstructureMatcher::_findPackCandidates(int pack_idx, Array<int>& candidates)
 {
     if (pack_idx == _fp_storage.getPackCount())
     {
-        _findIncCandidates();
+        _findIncCandidates(candidates);
         return;
     }
 
     profTimerStart(t, "sub_find_cand_pack");
 
-    _candidates.clear();
+    candidates.clear();
 
     TranspFpStorage& fp_storage = _index.getSubStorage();
 
-    // const byte *query_fp = _query_fp.ptr();
-
-    const byte* block;
-
     int fp_size_in_bits = _fp_size * 8;
+    int block_size = fp_storage.getBlockSize();
+
+    // Blocks of the most selective query bits, rarest first
+    // TODO: collect time infromation about the reading and matching measurements and
+    // and balance between reading new block or check filtered items without reading new block
+    int screen_bits = std::min(_query_fp_bits_used.size(), _SCREEN_BITS_LIMIT);
+    const byte* blocks[_SCREEN_BITS_LIMIT];
+    for (int i = 0; i < screen_bits; i++)
+        blocks[i] = fp_storage.getBlock(pack_idx * fp_size_in_bits + _query_fp_bits_used[i]);
 
     Array<byte> fit_bits;
-    fit_bits.clear_resize(fp_storage.getBlockSize());
+    fit_bits.clear_resize(block_size);
     fit_bits.fill(255);
 
     profTimerStart(tgs, "sub_find_cand_pack_get_search");
-    int left = 0, right = fp_storage.getBlockSize() - 1;
 
-    // Filter only based on the first 10 bits
-    // TODO: collect time infromation about the reading and matching measurements and
-    // and balance between reading new block or check filtered items without reading new block
-    for (int i = 0; i < _query_fp_bits_used.size() && i < 15; i++)
+    // The block is screened tile by tile, so a tile stays in cache while it is
+    // ANDed with all query bits, and the screening of a tile stops as soon as it
+    // has no candidates left
+    for (int tile = 0; tile < block_size; tile += _SCREEN_TILE_SIZE)
     {
-        int j = _query_fp_bits_used[i];
-
-        profTimerStart(tgb, "sub_find_cand_pack_get_block");
-        block = fp_storage.getBlock(pack_idx * fp_size_in_bits + j);
-        profTimerStop(tgb);
-
-        profTimerStart(tgu, "sub_find_cand_pack_fit_update");
-        bitAnd(fit_bits.ptr() + left, &block[0] + left, right - left + 1);
-
-        while (left <= right && fit_bits[left] == 0)
-            left++;
-        while (left <= right && fit_bits[right] == 0)
-            right--;
-
-        if (left > right)
-            // Not more results
-            break;
-
-        profTimerStop(tgu);
+        int tile_size = std::min(_SCREEN_TILE_SIZE, block_size - tile);
+        for (int i = 0; i < screen_bits; i++)
+            if (!PopcountKernels::andNonZero(fit_bits.ptr() + tile, blocks[i] + tile, tile_size))
+                break;
     }
     profTimerStop(tgs);
 
-    for (int k = 0; k < 8 * fp_storage.getBlockSize(); k++)
-        if (bitGetBit(fit_bits.ptr(), k))
-            _candidates.push(k + pack_idx * fp_storage.getBlockSize() * 8);
+    int first_id = pack_idx * block_size * 8;
+    int k = 0;
+    for (; k + 8 <= block_size; k += 8)
+    {
+        qword word;
+        memcpy(&word, fit_bits.ptr() + k, sizeof(word));
+        if (word == 0)
+            continue;
+
+        for (int b = k; b < k + 8; b++)
+            for (int bit = 0; bit < 8; bit++)
+                if (fit_bits[b] & (1 << bit))
+                    candidates.push(first_id + b * 8 + bit);
+    }
+    for (; k < block_size; k++)
+        for (int bit = 0; bit < 8; bit++)
+            if (fit_bits[k] & (1 << bit))
+                candidates.push(first_id + k * 8 + bit);
 }
 
-void BaseSubstructureMatcher::_findIncCandidates()
+void BaseSubstructureMatcher::_findIncCandidates(Array<int>& candidates)
 {
     profTimerStart(t, "sub_find_cand_inc");
-    _candidates.clear();
+    candidates.clear();
 
     const TranspFpStorage& fp_storage = _index.getSubStorage();
 
@@ -503,7 +638,7 @@ void BaseSubstructureMatcher::_findIncCandidates()
     {
         const byte* fp = inc + i * _fp_size;
         if (bitTestOnes(_query_fp.ptr(), fp, _fp_size))
-            _candidates.push(i + inc_block_id_offset);
+            candidates.push(i + inc_block_id_offset);
     }
 }
 
@@ -559,6 +694,44 @@ bool MoleculeSubMatcher::_tryCurrent() // const
 
     Molecule& target_mol = _current_obj->getMolecule();
 
+    return _match(query_mol, target_mol, _mapping);
+}
+
+void MoleculeSubMatcher::_tryCandidates(const Array<int>& candidates, SubstructureHits& hits)
+{
+    if (candidates.size() == 0)
+        return;
+
+    // Every worker matches against its own copy of the query
+    QueryMolecule query_mol;
+    {
+        std::lock_guard<std::mutex> lock(_query_lock);
+        SubstructureMoleculeQuery& query = (SubstructureMoleculeQuery&)(_query_data->getQueryObject());
+        query_mol.clone((QueryMolecule&)(query.getMolecule()), 0, 0);
+    }
+
+    Molecule target_mol;
+    Array<int> mapping;
+    for (int i = 0; i < candidates.size(); i++)
+    {
+        if (!_loadMolecule(candidates[i], target_mol))
+            continue;
+
+        if (_match(query_mol, target_mol, mapping))
+        {
+            hits.ids.push(candidates[i]);
+            hits.mappings.push().push().copy(mapping);
+        }
+    }
+}
+
+void MoleculeSubMatcher::_setCurrentMapping(ObjArray<Array<int>>& mapping)
+{
+    _mapping.copy(mapping[0]);
+}
+
+bool MoleculeSubMatcher::_match(QueryMolecule& query_mol, Molecule& target_mol, Array<int>& mapping)
+{
     profTimerStart(tr_m, "sub_try_matching");
     MoleculeSubstructureMatcher msm(target_mol);
 
@@ -570,11 +743,10 @@ bool MoleculeSubMatcher::_tryCurrent() // const
 
     if (find_res)
     {
-        _mapping.copy(msm.getTargetMapping(), target_mol.vertexCount());
+        mapping.copy(msm.getTargetMapping(), target_mol.vertexCount());
         return true;
     }
 
-    // return true;
     return false;
 }
 
@@ -602,21 +774,59 @@ bool ReactionSubMatcher::_tryCurrent() // const
 
     Reaction& target_rxn = _current_obj->getReaction();
 
+    return _match(query_rxn, target_rxn, _mapping);
+}
+
+void ReactionSubMatcher::_tryCandidates(const Array<int>& candidates, SubstructureHits& hits)
+{
+    if (candidates.size() == 0)
+        return;
+
+    // Every worker matches against its own copy of the query
+    QueryReaction query_rxn;
+    {
+        std::lock_guard<std::mutex> lock(_query_lock);
+        SubstructureReactionQuery& query = (SubstructureReactionQuery&)_query_data->getQueryObject();
+        query_rxn.clone((QueryReaction&)(query.getReaction()), 0, 0, 0);
+    }
+
+    Reaction target_rxn;
+    ObjArray<Array<int>> mapping;
+    for (int i = 0; i < candidates.size(); i++)
+    {
+        if (!_loadReaction(candidates[i], target_rxn))
+            continue;
+
+        if (_match(query_rxn, target_rxn, mapping))
+        {
+            hits.ids.push(candidates[i]);
+            _copyMapping(hits.mappings.push(), mapping);
+        }
+    }
+}
+
+void ReactionSubMatcher::_setCurrentMapping(ObjArray<Array<int>>& mapping)
+{
+    _copyMapping(_mapping, mapping);
+}
+
+bool ReactionSubMatcher::_match(QueryReaction& query_rxn, Reaction& target_rxn, ObjArray<Array<int>>& mapping)
+{
     ReactionSubstructureMatcher rsm(target_rxn);
 
     rsm.setQuery(query_rxn);
 
     if (rsm.find())
     {
-        _mapping.resize(target_rxn.end());
+        mapping.resize(target_rxn.end());
         for (int i = target_rxn.begin(); i != target_rxn.end(); i = target_rxn.next(i))
-            _mapping[i].clear();
+            mapping[i].clear();
 
         for (int i = query_rxn.begin(); i != query_rxn.end(); i = query_rxn.next(i))
         {
             int target_mol_idx = rsm.getTargetMoleculeIndex(i);
 
-            _mapping[target_mol_idx].copy(rsm.getQueryMoleculeMapping(i), query_rxn.getQueryMolecule(i).vertexCount());
+            mapping[target_mol_idx].copy(rsm.getQueryMoleculeMapping(i), query_rxn.getQueryMolecule(i).vertexCount());
         }
 
         return true;
@@ -658,29 +868,25 @@ bool BaseSimilarityMatcher::next()
         if (_current_portion_id >= _current_portion.size())
         {
             _current_portion_id = 0;
-            _current_container++;
 
             if (!sim_storage.isSmallBase())
             {
-                if (_current_container == sim_storage.getCellSize(_current_cell))
+                if (_thread_count > 1)
                 {
-                    _current_cell = sim_storage.nextFitCell(query_bit_count, _first_cell, _min_cell, _max_cell, _current_cell);
-
-                    if (_part_count != -1 && _part_id != -1)
-                        while ((_current_cell % _part_count != _part_id - 1) && (_current_cell != -1))
-                            _current_cell = sim_storage.nextFitCell(query_bit_count, _first_cell, _min_cell, _max_cell, _current_cell);
-
-                    if (_current_cell == -1)
+                    if (!_nextParallel(query_bit_count))
                         return false;
-
-                    _current_container = 0;
+                    continue;
                 }
 
+                if (!_nextContainer(query_bit_count))
+                    return false;
+
                 _current_portion.clear();
                 sim_storage.getSimilar(_query_fp.ptr(), *_sim_coef, _query_data->getMin(), _current_portion, _current_cell, _current_container);
             }
             else
             {
+                _current_container++;
                 if (_current_container > 0)
                     return false;
 
@@ -708,11 +914,75 @@ bool BaseSimilarityMatcher::next()
         }
 
         _match_time_esimate.addValue(profTimerGetTimeSec(tsingle));
-        _loadCurrentObject();
+        _loadCurrentObject(false);
         return true;
     }
 }
 
+bool BaseSimilarityMatcher::_nextContainer(int query_bit_count)
+{
+    SimStorage& sim_storage = _index.getSimStorage();
+
+    _current_container++;
+
+    if (_current_container == sim_storage.getCellSize(_current_cell))
+    {
+        _current_cell = sim_storage.nextFitCell(query_bit_count, _first_cell, _min_cell, _max_cell, _current_cell);
+
+        if (_part_count != -1 && _part_id != -1)
+            while ((_current_cell % _part_count != _part_id - 1) && (_current_cell != -1))
+                _current_cell = sim_storage.nextFitCell(query_bit_count, _first_cell, _min_cell, _max_cell, _current_cell);
+
+        if (_current_cell == -1)
+            return false;
+
+        _current_container = 0;
+    }
+
+    return true;
+}
+
+bool BaseSimilarityMatcher::_nextParallel(int query_bit_count)
+{
+    SimStorage& sim_storage = _index.getSimStorage();
+
+    // Next window of containers, in the same order as the serial walk
+    Array<int> cells, containers;
+    while (cells.size() < _thread_count * _PARALLEL_ITEMS_PER_THREAD && _nextContainer(query_bit_count))
+    {
+        cells.push(_current_cell);
+        containers.push(_current_container);
+    }
+
+    if (cells.size() == 0)
+        return false;
+
+    // The walk may have run past the last cell, but the collected window is still to be reported
+    if (_current_cell == -1)
+    {
+        _current_cell = cells.top();
+        _current_container = containers.top();
+    }
+
+    _current_portion.clear();
+
+    profTimerStart(tp, "sim_parallel_window");
+    SearchDispatcher<Array<SimResult>> dispatcher(
+        cells.size(),
+        [&](int item, Array<SimResult>& portion) {
+            sim_storage.getSimilar(_query_fp.ptr(), *_sim_coef, _query_data->getMin(), portion, cells[item], containers[item]);
+        },
+        [this](Array<SimResult>& portion) {
+            _current_portion.concat(portion);
+            _match_probability_esimate.addValue((float)portion.size());
+        });
+    dispatcher.run(std::min(_thread_count, cells.size()));
+
+    _match_time_esimate.addValue(profTimerGetTimeSec(tp) / cells.size());
+
+    return true;
+}
+
 void BaseSimilarityMatcher::setQueryData(SimilarityQueryData* query_data)
 {
     _query_data.reset(query_data);
@@ -974,7 +1244,7 @@ bool TopNSimMatcher::next()
             return false;
         }
 
-        _loadCurrentObject();
+        _loadCurrentObject(false);
 
         return true;
     }
@@ -1304,8 +1574,21 @@ bool BaseExactMatcher::next()
     ExactStorage& exact_storage = _index.getExactStorage();
 
     if (_candidates.size() == 0)
+    {
         exact_storage.findCandidates(_query_hash, _candidates, _part_id, _part_count);
 
+        // Both hashes of an object share the storage, an object can be found twice only if they are equal
+        if (_index.hasCanonicalExactHash())
+        {
+            _candidates.qsort(_cmpCandidates, 0);
+            int count = 0;
+            for (int i = 0; i < _candidates.size(); i++)
+                if (count == 0 || _candidates[count - 1] != _candidates[i])
+                    _candidates[count++] = _candidates[i];
+            _candidates.resize(count);
+        }
+    }
+
     while (_current_cand_id < _candidates.size())
     {
         profTimerStart(tsingle, "exact_single");
@@ -1331,7 +1614,16 @@ void BaseExactMatcher::setQueryData(ExactQueryData* query_data)
 {
     _query_data.reset(query_data);
 
-    _query_hash = _calcHash();
+    // Relaxed conditions and tautomer searches use the subgraph hash, also stored in the index
+    if (_index.hasCanonicalExactHash() && _allConditions())
+        _query_hash = _calcCanonicalHash();
+    else
+        _query_hash = _calcHash();
+}
+
+int BaseExactMatcher::_cmpCandidates(int id1, int id2, void* context)
+{
+    return id1 - id2;
 }
 
 void BaseExactMatcher::_initPartition()
@@ -1369,6 +1661,19 @@ dword MolExactMatcher::_calcHash()
     return ExactStorage::calculateMolHash(query_mol);
 }
 
+dword MolExactMatcher::_calcCanonicalHash()
+{
+    SimilarityMoleculeQuery& query = (SimilarityMoleculeQuery&)(_query_data->getQueryObject());
+    Molecule& query_mol = (Molecule&)(query.getMolecule());
+
+    return ExactStorage::calculateMolCanonicalHash(query_mol);
+}
+
+bool MolExactMatcher::_allConditions()
+{
+    return !_tautomer && (_flags & MoleculeExactMatcher::CONDITION_ALL) == MoleculeExactMatcher::CONDITION_ALL;
+}
+
 bool MolExactMatcher::_tryCurrent() /* const */
 {
     SimilarityMoleculeQuery& query = (SimilarityMoleculeQuery&)(_query_data->getQueryObject());
@@ -1495,6 +1800,21 @@ dword RxnExactMatcher::_calcHash()
     return ExactStorage::calculateRxnHash(query_rxn);
 }
 
+dword RxnExactMatcher::_calcCanonicalHash()
+{
+    SimilarityReactionQuery& query = (SimilarityReactionQuery&)_query_data->getQueryObject();
+    Reaction& query_rxn = (Reaction&)(query.getReaction());
+
+    return ExactStorage::calculateRxnCanonicalHash(query_rxn);
+}
+
+bool RxnExactMatcher::_allConditions()
+{
+    const int conditions = MoleculeExactMatcher::CONDITION_ELECTRONS | MoleculeExactMatcher::CONDITION_ISOTOPE | MoleculeExactMatcher::CONDITION_STEREO;
+
+    return (_flags & conditions) == conditions;
+}
+
 bool RxnExactMatcher::_tryCurrent() /* const */
 {
     SimilarityReactionQuery& query = (SimilarityReactionQuery&)_query_data->getQueryObject();
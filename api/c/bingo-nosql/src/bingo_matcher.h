@@ -1,6 +1,8 @@
 #ifndef __bingo_matcher__
 #define __bingo_matcher__
 
+#include <mutex>
+
 #include "bingo_base_index.h"
 #include "bingo_object.h"
 
@@ -214,13 +216,20 @@ namespace bingo
         int _current_id;
         int _part_id;
         int _part_count;
+        int _thread_count;
 
         // Variables used for estimation
         MeanEstimator _match_probability_esimate, _match_time_esimate;
 
         bool _isCurrentObjectExist();
 
-        bool _loadCurrentObject();
+        // Results are loaded with use_cache = false, so they do not push
+        // matching targets out of the molecule cache
+        bool _loadCurrentObject(bool use_cache = true);
+
+        // Thread-safe loaders for parallel search workers
+        bool _loadMolecule(int id, Molecule& mol, bool use_cache = true);
+        bool _loadReaction(int id, Reaction& rxn);
 
         virtual void _setParameters(const char* params) = 0;
         virtual void _initPartition() = 0;
@@ -228,6 +237,16 @@ namespace bingo
         ~BaseMatcher() override;
     };
 
+    // Hits found by a parallel substructure search worker in one fingerprint pack
+    struct SubstructureHits
+    {
+        Array<int> ids;
+        ObjArray<ObjArray<Array<int>>> mappings;
+        int candidates_count;
+
+        void clear();
+    };
+
     class BaseSubstructureMatcher : public BaseMatcher
     {
     public:
@@ -243,13 +262,23 @@ namespace bingo
         /*const*/ std::unique_ptr<SubstructureQueryData> _query_data;
         Array<byte> _query_fp;
         Array<int> _query_fp_bits_used;
+        // Guards the query object while workers clone it
+        std::mutex _query_lock;
 
-        void _findPackCandidates(int pack_idx);
+        void _findPackCandidates(int pack_idx, Array<int>& candidates);
 
-        void _findIncCandidates();
+        void _findIncCandidates(Array<int>& candidates);
 
         virtual bool _tryCurrent() /* const */ = 0;
 
+        // Verifies candidates on a worker thread without touching the current object
+        virtual void _tryCandidates(const Array<int>& candidates, SubstructureHits& hits) = 0;
+
+        // Copies the mapping of a hit found by _tryCandidates into the current mapping
+        virtual void _setCurrentMapping(ObjArray<Array<int>>& mapping) = 0;
+
+        bool _nextParallel();
+
         void _setParameters(const char* params) override;
 
         void _initPartition() override;
@@ -261,6 +290,9 @@ namespace bingo
         int _final_pack;
         const TranspFpStorage& _fp_storage;
         int sub_cnt;
+
+        SubstructureHits _parallel_hits;
+        int _parallel_hit_id;
     };
 
     class MoleculeSubMatcher : public BaseSubstructureMatcher
@@ -274,6 +306,10 @@ namespace bingo
         Array<int> _mapping;
 
         bool _tryCurrent() /*const*/ override;
+        void _tryCandidates(const Array<int>& candidates, SubstructureHits& hits) override;
+        void _setCurrentMapping(ObjArray<Array<int>>& mapping) override;
+
+        static bool _match(QueryMolecule& query_mol, Molecule& target_mol, Array<int>& mapping);
 
         IndexCurrentMolecule* _current_mol;
     };
@@ -289,6 +325,10 @@ namespace bingo
         ObjArray<Array<int>> _mapping;
 
         bool _tryCurrent() /*const*/ override;
+        void _tryCandidates(const Array<int>& candidates, SubstructureHits& hits) override;
+        void _setCurrentMapping(ObjArray<Array<int>>& mapping) override;
+
+        static bool _match(QueryReaction& query_rxn, Reaction& target_rxn, ObjArray<Array<int>>& mapping);
 
         IndexCurrentReaction* _current_rxn;
     };
@@ -346,6 +386,10 @@ namespace bingo
         void _setParameters(const char* params) override;
 
         void _initPartition() override;
+
+        bool _nextContainer(int query_bit_count);
+
+        bool _nextParallel(int query_bit_count);
     };
 
     class MoleculeSimMatcher : public BaseSimilarityMatcher
@@ -426,6 +470,13 @@ namespace bingo
         /* const */ std::unique_ptr<ExactQueryData> _query_data;
 
         virtual dword _calcHash() = 0;
+        virtual dword _calcCanonicalHash() = 0;
+
+        // Canonical hashes can be looked up only if the match compares
+        // everything the hash covers
+        virtual bool _allConditions() = 0;
+
+        static int _cmpCandidates(int id1, int id2, void* context);
 
         virtual bool _tryCurrent() /* const */ = 0;
 
@@ -442,6 +493,8 @@ namespace bingo
         float _rms_threshold;
 
         dword _calcHash() override;
+        dword _calcCanonicalHash() override;
+        bool _allConditions() override;
 
         bool _tryCurrent() /* const */ override;
 
@@ -460,6 +513,8 @@ namespace bingo
         IndexCurrentReaction* _current_rxn;
 
         dword _calcHash() override;
+        dword _calcCanonicalHash() override;
+        bool _allConditions() override;
 
         bool _tryCurrent() /* const */ override;
 
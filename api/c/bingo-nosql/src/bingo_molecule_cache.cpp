@@ -0,0 +1,108 @@
+#include "bingo_molecule_cache.h"
+
+#include "base_cpp/profiling.h"
+
+using namespace indigo;
+using namespace bingo;
+
+// Rough memory usage of a decoded molecule
+static const size_t _ATOM_SIZE = 256;
+static const size_t _BOND_SIZE = 128;
+
+MoleculeCache::MoleculeCache(size_t max_size) : _max_size(max_size), _size(0)
+{
+}
+
+void MoleculeCache::setMaxSize(size_t max_size)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _max_size = max_size;
+    _shrink(_max_size);
+}
+
+size_t MoleculeCache::getMaxSize() const
+{
+    return _max_size;
+}
+
+size_t MoleculeCache::getSize()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _size;
+}
+
+bool MoleculeCache::get(int id, Molecule& mol)
+{
+    if (_max_size == 0)
+        return false;
+
+    std::lock_guard<std::mutex> lock(_lock);
+    auto it = _entries.find(id);
+    if (it == _entries.end())
+    {
+        profIncCounter("mol_cache_misses", 1);
+        return false;
+    }
+
+    // Cached molecules are only read while the lock is held
+    _lru.splice(_lru.begin(), _lru, it->second);
+    mol.clone(*it->second->mol, 0, 0);
+    profIncCounter("mol_cache_hits", 1);
+    return true;
+}
+
+void MoleculeCache::put(int id, Molecule& mol)
+{
+    if (_max_size == 0)
+        return;
+
+    size_t size = _estimateSize(mol);
+    if (size > _max_size)
+        return;
+
+    std::unique_ptr<Molecule> copy = std::make_unique<Molecule>();
+    copy->clone(mol, 0, 0);
+
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_entries.find(id) != _entries.end())
+        return;
+
+    _shrink(_max_size - size);
+    _lru.push_front({id, size, std::move(copy)});
+    _entries[id] = _lru.begin();
+    _size += size;
+}
+
+void MoleculeCache::remove(int id)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    auto it = _entries.find(id);
+    if (it == _entries.end())
+        return;
+
+    _size -= it->second->size;
+    _lru.erase(it->second);
+    _entries.erase(it);
+}
+
+void MoleculeCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _shrink(0);
+}
+
+size_t MoleculeCache::_estimateSize(Molecule& mol)
+{
+    return sizeof(Molecule) + mol.vertexCount() * _ATOM_SIZE + mol.edgeCount() * _BOND_SIZE;
+}
+
+void MoleculeCache::_shrink(size_t max_size)
+{
+    while (_size > max_size && !_lru.empty())
+    {
+        _Entry& entry = _lru.back();
+        _size -= entry.size;
+        _entries.erase(entry.id);
+        _lru.pop_back();
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef __bingo_molecule_cache__
+#define __bingo_molecule_cache__
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "molecule/molecule.h"
+
+namespace bingo
+{
+    // Bounded LRU cache of decoded molecules, keyed by the base id of the
+    // record. It is shared by all the matchers of an index, so targets that
+    // pass the screening of repeated queries are not decoded from CMF again.
+    // The memory limit is applied to an estimate of the molecule size.
+    class MoleculeCache
+    {
+    public:
+        explicit MoleculeCache(size_t max_size = 0);
+
+        // Zero max size disables the cache
+        void setMaxSize(size_t max_size);
+        size_t getMaxSize() const;
+        size_t getSize();
+
+        // Copies the cached molecule, returns false if there is no such record
+        bool get(int id, indigo::Molecule& mol);
+        void put(int id, indigo::Molecule& mol);
+        void remove(int id);
+        void clear();
+
+    private:
+        struct _Entry
+        {
+            int id;
+            size_t size;
+            std::unique_ptr<indigo::Molecule> mol;
+        };
+
+        static size_t _estimateSize(indigo::Molecule& mol);
+        void _shrink(size_t max_size);
+
+        std::mutex _lock;
+        std::list<_Entry> _lru;
+        std::unordered_map<int, std::list<_Entry>::iterator> _entries;
+        std::atomic<size_t> _max_size;
+        size_t _size;
+    };
+}; // namespace bingo
+
+#endif /* __bingo_molecule_cache__ */
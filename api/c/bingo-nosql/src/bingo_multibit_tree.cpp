@@ -142,30 +142,16 @@ void MultibitTree::_build()
     _tree_ptr = _buildNode(indices, is_mb, 0);
 }
 
-void MultibitTree::_findLinear(_MultibitNode* node, const byte* query, int query_bit_number, SimCoef& sim_coef, double min_coef, Array<SimResult>& sim_indices,
-                               int fp_bit_number)
+void MultibitTree::_findLinear(_MultibitNode* node, Array<int>& candidates)
 {
-    profTimerStart(tmsl, "multibit_tree_search_linear");
-    byte* fingerprints = _fingerprints_ptr.ptr();
-    int* indices = _indices_ptr.ptr();
-
     int* fp_indices = node->fp_indices_array.ptr();
 
     for (int i = 0; i < node->fp_indices_count; i++)
-    {
-        const byte* fp = fingerprints + fp_indices[i] * _fp_size;
-        int f_bit_number = bitGetOnesCount(fp, _fp_size);
-
-        double coef = sim_coef.calcCoef(query, fp, query_bit_number, f_bit_number);
-        if (coef < min_coef)
-            continue;
-
-        sim_indices.push(SimResult(indices[fp_indices[i]], (float)coef));
-    }
+        candidates.push(fp_indices[i]);
 }
 
 void MultibitTree::_findSimilarInNode(MMFPtr<_MultibitNode> node_ptr, const byte* query, int query_bit_number, SimCoef& sim_coef, double min_coef,
-                                      Array<SimResult>& sim_indices, int m01, int m10)
+                                      Array<int>& candidates, int m01, int m10)
 {
     if (node_ptr.isNull())
         return;
@@ -174,21 +160,12 @@ void MultibitTree::_findSimilarInNode(MMFPtr<_MultibitNode> node_ptr, const byte
 
     if (node->fp_indices_count != 0)
     {
-        if (_min_fp_bit_number == _max_fp_bit_number) // if fingerpint bits_count is fixed
-            _findLinear(node, query, query_bit_number, sim_coef, min_coef, sim_indices, _min_fp_bit_number);
-        else
-            _findLinear(node, query, query_bit_number, sim_coef, min_coef, sim_indices);
-
+        _findLinear(node, candidates);
         return;
     }
 
     _MatchBit* match_bits = node->match_bits_array.ptr();
 
-    QS_DEF(Array<SimResult>, left_indices);
-    left_indices.clear();
-    QS_DEF(Array<SimResult>, right_indices);
-    right_indices.clear();
-
     int right_m01 = m01, right_m10 = m10;
     for (int i = 0; i < node->match_bits_count; i++)
         if (match_bits[i].val == 0)
@@ -202,14 +179,9 @@ void MultibitTree::_findSimilarInNode(MMFPtr<_MultibitNode> node_ptr, const byte
     double right_upper_bound = sim_coef.calcUpperBound(query_bit_number, _min_fp_bit_number, _max_fp_bit_number, right_m10, right_m01);
 
     if (!node->left.isNull())
-        _findSimilarInNode(node->left, query, query_bit_number, sim_coef, min_coef, left_indices, m01, m10);
+        _findSimilarInNode(node->left, query, query_bit_number, sim_coef, min_coef, candidates, m01, m10);
     if ((!node->left.isNull()) && right_upper_bound + EPSILON > min_coef)
-        _findSimilarInNode(node->right, query, query_bit_number, sim_coef, min_coef, right_indices, right_m01, right_m10);
-
-    for (int i = 0; i < left_indices.size(); i++)
-        sim_indices.push(left_indices[i]);
-    for (int i = 0; i < right_indices.size(); i++)
-        sim_indices.push(right_indices[i]);
+        _findSimilarInNode(node->right, query, query_bit_number, sim_coef, min_coef, candidates, right_m01, right_m10);
 }
 
 MultibitTree::MultibitTree(int fp_size) : _fp_size(fp_size)
@@ -239,7 +211,19 @@ int MultibitTree::findSimilar(const byte* query, SimCoef& sim_coef, double min_c
     int query_bit_number = bitGetOnesCount(query, _fp_size);
     sim_fp_indices.clear();
 
-    _findSimilarInNode(_tree_ptr, query, query_bit_number, sim_coef, min_coef, sim_fp_indices, 0, 0);
+    // The tree only prunes subtrees; the surviving leaves are scored in one batch
+    QS_DEF(Array<int>, candidates);
+    candidates.clear();
+    _findSimilarInNode(_tree_ptr, query, query_bit_number, sim_coef, min_coef, candidates, 0, 0);
+
+    {
+        profTimerStart(tmsl, "multibit_tree_search_linear");
+        sim_coef.calcCoefs(query, query_bit_number, _fingerprints_ptr.ptr(), candidates.ptr(), candidates.size(), _fp_size, min_coef, true, sim_fp_indices);
+    }
+
+    int* indices = _indices_ptr.ptr();
+    for (int i = 0; i < sim_fp_indices.size(); i++)
+        sim_fp_indices[i].id = indices[candidates[sim_fp_indices[i].id]];
 
     return sim_fp_indices.size();
 }
@@ -79,11 +79,10 @@ namespace bingo
 
         void _build();
 
-        void _findLinear(_MultibitNode* node, const byte* query, int query_bit_number, SimCoef& sim_coef, double min_coef,
-                         indigo::Array<SimResult>& sim_indices, int fp_bit_number = -1);
+        void _findLinear(_MultibitNode* node, indigo::Array<int>& candidates);
 
         void _findSimilarInNode(MMFPtr<_MultibitNode> node_ptr, const byte* query, int query_bit_number, SimCoef& sim_coef, double min_coef,
-                                indigo::Array<SimResult>& sim_indices, int m01, int m10);
+                                indigo::Array<int>& candidates, int m01, int m10);
     };
 }; // namespace bingo
 
@@ -159,6 +159,13 @@ bool IndexMolecule::buildHash(dword& hash)
     return true;
 }
 
+bool IndexMolecule::buildCanonicalHash(dword& hash)
+{
+    hash = ExactStorage::calculateMolCanonicalHash(_mol);
+
+    return true;
+}
+
 IndexReaction::IndexReaction(/* const */ Reaction& rxn, const AromaticityOptions& arom_options)
 {
     _rxn.clone(rxn);
@@ -205,3 +212,10 @@ bool IndexReaction::buildHash(dword& hash)
 
     return true;
 }
+
+bool IndexReaction::buildCanonicalHash(dword& hash)
+{
+    hash = ExactStorage::calculateRxnCanonicalHash(_rxn);
+
+    return true;
+}
@@ -129,6 +129,8 @@ namespace bingo
 
         virtual bool buildHash(dword& hash) /* const */ = 0;
 
+        virtual bool buildCanonicalHash(dword& hash) /* const */ = 0;
+
         virtual ~IndexObject(){};
     };
 
@@ -148,6 +150,8 @@ namespace bingo
         bool buildCfString(indigo::Array<char>& cf) /*const*/ override;
 
         bool buildHash(dword& hash) /* const */ override;
+
+        bool buildCanonicalHash(dword& hash) /* const */ override;
     };
 
     class IndexReaction : public IndexObject
@@ -166,6 +170,8 @@ namespace bingo
         bool buildCfString(indigo::Array<char>& cf) /*const*/ override;
 
         bool buildHash(dword& hash) /* const */ override;
+
+        bool buildCanonicalHash(dword& hash) /* const */ override;
     };
 }; // namespace bingo
 
@@ -66,6 +66,13 @@ void Properties::parseOptions(const char* options, std::map<std::string, std::st
     }
 }
 
+bool Properties::parseIntOption(const std::string& value, int& result)
+{
+    std::stringstream value_stream(value);
+    value_stream >> result;
+    return !value_stream.fail() && value_stream.eof();
+}
+
 void Properties::add(const char* prop_name, const char* value)
 {
     int prop_id;
@@ -22,6 +22,9 @@ namespace bingo
 
         static void parseOptions(const char* options, std::map<std::string, std::string>& option_map, std::vector<std::string>* allowed_props = 0);
 
+        // Returns false if the option value is not an integer as a whole
+        static bool parseIntOption(const std::string& value, int& result);
+
         void add(const char* prop_name, const char* value);
 
         void add(const char* prop_name, unsigned long value);
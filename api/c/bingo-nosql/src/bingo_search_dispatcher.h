@@ -0,0 +1,93 @@
+#ifndef __bingo_search_dispatcher__
+#define __bingo_search_dispatcher__
+
+#include <functional>
+
+#include "base_cpp/os_thread_wrapper.h"
+
+#include "mmf/mmf_allocator.h"
+
+namespace bingo
+{
+    // Runs independent search work items (similarity containers or substructure
+    // packs) on worker threads. Each item fills its own portion, and portions
+    // are handled on the calling thread in item order, so a parallel search
+    // yields results in the same order as a serial one.
+    // Worker threads share the caller's session ID and database.
+    template <typename Portion>
+    class SearchDispatcher : public indigo::OsCommandDispatcher
+    {
+    public:
+        typedef std::function<void(int item, Portion& portion)> Task;
+        typedef std::function<void(Portion& portion)> Handler;
+
+        SearchDispatcher(int item_count, const Task& task, const Handler& handler)
+            : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _item_count(item_count), _next_item(0), _task(task), _handler(handler),
+              _db_id(MMFAllocator::getDatabaseId())
+        {
+        }
+
+    private:
+        class _Result : public indigo::OsCommandResult
+        {
+        public:
+            void clear() override
+            {
+                portion.clear();
+            }
+
+            Portion portion;
+        };
+
+        class _Command : public indigo::OsCommand
+        {
+        public:
+            void execute(indigo::OsCommandResult& result) override
+            {
+                (*task)(item, static_cast<_Result&>(result).portion);
+            }
+
+            int item;
+            const Task* task;
+        };
+
+        indigo::OsCommand* _allocateCommand() override
+        {
+            return new _Command();
+        }
+
+        indigo::OsCommandResult* _allocateResult() override
+        {
+            return new _Result();
+        }
+
+        bool _setupCommand(indigo::OsCommand& command) override
+        {
+            if (_next_item == _item_count)
+                return false;
+
+            _Command& cmd = static_cast<_Command&>(command);
+            cmd.item = _next_item++;
+            cmd.task = &_task;
+            return true;
+        }
+
+        void _handleResult(indigo::OsCommandResult& result) override
+        {
+            _handler(static_cast<_Result&>(result).portion);
+        }
+
+        void _prepareThread() override
+        {
+            MMFAllocator::setDatabaseId(_db_id);
+        }
+
+        int _item_count;
+        int _next_item;
+        Task _task;
+        Handler _handler;
+        int _db_id;
+    };
+}; // namespace bingo
+
+#endif /* __bingo_search_dispatcher__ */
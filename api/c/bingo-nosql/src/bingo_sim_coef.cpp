@@ -0,0 +1,59 @@
+#include "bingo_sim_coef.h"
+
+#include "base_cpp/popcount_kernels.h"
+#include "base_cpp/tlscont.h"
+
+using namespace bingo;
+using namespace indigo;
+
+void SimCoef::calcCoefs(const byte* query, int query_bit_count, const byte* fingerprints, const int* fp_indices, int fp_count, int fp_size,
+                        double min_coef, bool query_is_target, Array<SimResult>& sim_indices)
+{
+    if (fp_count == 0)
+        return;
+
+    QS_DEF(Array<int>, bit_counts);
+    QS_DEF(Array<int>, fit_indices);
+    QS_DEF(Array<int>, fit_positions);
+    QS_DEF(Array<int>, common_counts);
+
+    bit_counts.clear_resize(fp_count);
+    PopcountKernels::onesCount(fingerprints, fp_indices, fp_count, fp_size, bit_counts.ptr());
+
+    fit_indices.clear();
+    fit_positions.clear();
+
+    int last_bit_count = -1;
+    bool last_fit = true;
+    for (int i = 0; i < fp_count; i++)
+    {
+        int fp_bit_count = bit_counts[i];
+        if (fp_bit_count != last_bit_count)
+        {
+            int max_common = (fp_bit_count < query_bit_count ? fp_bit_count : query_bit_count);
+            double bound = (query_is_target ? calcCoef(max_common, query_bit_count, fp_bit_count) : calcCoef(max_common, fp_bit_count, query_bit_count));
+
+            last_bit_count = fp_bit_count;
+            last_fit = !(bound < min_coef);
+        }
+
+        if (!last_fit)
+            continue;
+
+        fit_indices.push(fp_indices != nullptr ? fp_indices[i] : i);
+        fit_positions.push(i);
+    }
+
+    common_counts.clear_resize(fit_indices.size());
+    PopcountKernels::commonOnes(query, fingerprints, fit_indices.ptr(), fit_indices.size(), fp_size, common_counts.ptr());
+
+    for (int k = 0; k < fit_positions.size(); k++)
+    {
+        int i = fit_positions[k];
+        double coef = (query_is_target ? calcCoef(common_counts[k], query_bit_count, bit_counts[i]) : calcCoef(common_counts[k], bit_counts[i], query_bit_count));
+        if (coef < min_coef)
+            continue;
+
+        sim_indices.push(SimResult(i, (float)coef));
+    }
+}
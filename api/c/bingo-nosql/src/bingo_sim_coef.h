@@ -2,6 +2,7 @@
 #define __sim_coef__
 
 #include "base_c/defs.h"
+#include "base_cpp/array.h"
 
 namespace bingo
 {
@@ -26,6 +27,17 @@ namespace bingo
 
         virtual double calcCoef(const byte* target, const byte* query, int target_bit_count, int query_bit_count) = 0;
 
+        // Coefficient from bit counts only; grows with common_bits for every metric
+        virtual double calcCoef(int common_bits, int target_bit_count, int query_bit_count) = 0;
+
+        // Scores fp_count fingerprints (fingerprints + fp_indices[i] * fp_size, or the i-th one
+        // if fp_indices is null) against the query with the batched popcount kernels and appends
+        // SimResult(i, coef) for each one that reaches min_coef. Fingerprints that cannot reach
+        // min_coef even with all their bits in common are rejected before the AND pass.
+        // With query_is_target the query bit count is passed as the target one to calcCoef.
+        void calcCoefs(const byte* query, int query_bit_count, const byte* fingerprints, const int* fp_indices, int fp_count, int fp_size,
+                       double min_coef, bool query_is_target, indigo::Array<SimResult>& sim_indices);
+
         virtual double calcUpperBound(int query_bit_count, int min_target_bit_count, int max_target_bit_count) = 0;
 
         virtual double calcUpperBound(int query_bit_count, int min_target_bit_count, int max_target_bit_count, int m10, int m01) = 0;
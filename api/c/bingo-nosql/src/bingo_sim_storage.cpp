@@ -111,15 +111,13 @@ bool SimStorage::isSmallBase()
 
 int SimStorage::getIncSimilar(const byte* query, SimCoef& sim_coef, double min_coef, Array<SimResult>& sim_fp_indices)
 {
-    for (int i = 0; i < _inc_fp_count; i++)
-    {
-        double coef = sim_coef.calcCoef(_inc_buffer.ptr() + (i * _fp_size), query, -1, -1);
-        if (coef < min_coef)
-            continue;
-        size_t id = _inc_id_buffer[i];
+    int first = sim_fp_indices.size();
+    int query_bit_count = bitGetOnesCount(query, _fp_size);
 
-        sim_fp_indices.push(SimResult(id, _2FLOAT(coef)));
-    }
+    sim_coef.calcCoefs(query, query_bit_count, _inc_buffer.ptr(), nullptr, _inc_fp_count, _fp_size, min_coef, false, sim_fp_indices);
+
+    for (int i = first; i < sim_fp_indices.size(); i++)
+        sim_fp_indices[i].id = (int)_inc_id_buffer[sim_fp_indices[i].id];
 
     return sim_fp_indices.size();
 }
@@ -14,6 +14,11 @@ double TanimotoCoef::calcCoef(const byte* target, const byte* query, int target_
     return (double)common_bits / (common_bits + unique_bits);
 }
 
+double TanimotoCoef::calcCoef(int common_bits, int target_bit_count, int query_bit_count)
+{
+    return (double)common_bits / (target_bit_count + query_bit_count - common_bits);
+}
+
 double TanimotoCoef::calcUpperBound(int query_bit_count, int min_target_bit_count, int max_target_bit_count)
 {
     int min = (query_bit_count < max_target_bit_count ? query_bit_count : max_target_bit_count);
@@ -23,6 +23,11 @@ double TverskyCoef::calcCoef(const byte* target, const byte* query, int target_b
     if (query_bit_count == -1)
         query_bit_count = bitGetOnesCount(query, _fp_size);
 
+    return calcCoef(common_bits, target_bit_count, query_bit_count);
+}
+
+double TverskyCoef::calcCoef(int common_bits, int target_bit_count, int query_bit_count)
+{
     return (double)common_bits / ((target_bit_count - common_bits) * _alpha + (query_bit_count - common_bits) * _beta + common_bits);
 }
 
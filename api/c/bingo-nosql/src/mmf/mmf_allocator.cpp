@@ -168,6 +168,11 @@ void MMFAllocator::setDatabaseId(int db_id)
     }
 }
 
+int MMFAllocator::getDatabaseId()
+{
+    return _current_db_id;
+}
+
 void MMFAllocator::_addHeader(const char* header)
 {
     const auto header_len = std::strlen(header);
@@ -60,6 +60,7 @@ namespace bingo
         }
 
         static void setDatabaseId(int db_id);
+        static int getDatabaseId();
 
         static constexpr const int MAX_HEADER_LEN = 128;
 
@@ -41,6 +41,13 @@ CEXPORT int indigoRender(int object, int output);
 // output -- see the comment for indigoRender
 CEXPORT int indigoRenderGrid(int objects, int* refAtoms, int nColumns, int output);
 
+// objects is an array of molecules or reactions created with indigoCreateArray
+// outputs holds one output per element of the array, see the comment for
+//         indigoRender; HDC outputs are not supported
+// Every object is rendered into its own output like with indigoRender(), on
+// "render-thread-count" threads. Returns the number of rendered objects.
+CEXPORT int indigoRenderBatch(int objects, const int* outputs);
+
 // Works like indigoRender(), but renders directly to file
 CEXPORT int indigoRenderToFile(int object, const char* filename);
 
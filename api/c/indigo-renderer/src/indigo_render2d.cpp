@@ -529,76 +529,78 @@ CEXPORT int indigoRender(int object, int output)
     INDIGO_END(-1);
 }
 
-CEXPORT int indigoRenderGrid(int objects, int* refAtoms, int nColumns, int output)
+// Clones the molecules or reactions of the array to the render parameters,
+// with their titles and CDXML properties if with_titles is set
+static void _indigoRenderCloneObjects(RenderParams& rp, PtrArray<IndigoObject>& objs, bool with_titles)
 {
-    INDIGO_BEGIN
-    {
-        RenderParams& rp = indigoRendererGetInstance().renderParams;
-        rp.clearArrays();
+    if (rp.rOpt.cdxml_context.get() != NULL)
+        rp.rOpt.cdxml_context->property_data.clear();
 
-        PtrArray<IndigoObject>& objs = IndigoArray::cast(self.getObject(objects)).objects;
-        if (rp.rOpt.cdxml_context.get() != NULL)
-        {
-            RenderCdxmlContext& context = *rp.rOpt.cdxml_context;
-            context.property_data.clear();
-        }
-        if (IndigoBaseMolecule::is(*objs[0]))
+    rp.rmode = RENDER_NONE;
+    for (int i = 0; i < objs.size(); ++i)
+    {
+        if (IndigoBaseMolecule::is(*objs[i]) && rp.rmode != RENDER_RXN)
         {
-            for (int i = 0; i < objs.size(); ++i)
+            if (objs[i]->getBaseMolecule().isQueryMolecule())
+                rp.mols.add(new QueryMolecule());
+            else
+                rp.mols.add(new Molecule());
+            rp.mols.top()->clone_KeepIndices(objs[i]->getBaseMolecule());
+            rp.rmode = RENDER_MOL;
+
+            if (with_titles && rp.rOpt.mode == DINGO_MODE::MODE_CDXML && rp.rOpt.cdxml_context.get() != NULL)
             {
-                if (objs[i]->getBaseMolecule().isQueryMolecule())
-                    rp.mols.add(new QueryMolecule());
-                else
-                    rp.mols.add(new Molecule());
-                Array<char>& title = rp.titles.push();
-                if (objs[i]->getProperties().contains(rp.cnvOpt.titleProp.ptr()))
-                    title.copy(objs[i]->getProperties().valueBuf(rp.cnvOpt.titleProp.ptr()));
-
-                if (rp.rOpt.mode == DINGO_MODE::MODE_CDXML)
-                {
-                    if (rp.rOpt.cdxml_context.get() != NULL)
-                    {
+                RenderCdxmlContext& context = *rp.rOpt.cdxml_context;
+                RenderCdxmlContext::PropertyData& data = context.property_data.push();
 
-                        RenderCdxmlContext& context = *rp.rOpt.cdxml_context;
-                        RenderCdxmlContext::PropertyData& data = context.property_data.push();
-
-                        auto& properties = objs[i]->getProperties();
-                        if (context.propertyNameCaption.size() > 0 && context.propertyValueCaption.size() > 0)
-                            if (properties.contains(context.propertyNameCaption.ptr()))
-                            {
-                                if (properties.contains(context.propertyValueCaption.ptr()))
-                                {
-                                    data.propertyName.readString(properties.at(context.propertyNameCaption.ptr()), true);
-                                    data.propertyValue.readString(properties.at(context.propertyValueCaption.ptr()), true);
-                                }
-                            }
+                auto& properties = objs[i]->getProperties();
+                if (context.propertyNameCaption.size() > 0 && context.propertyValueCaption.size() > 0)
+                    if (properties.contains(context.propertyNameCaption.ptr()))
+                    {
+                        if (properties.contains(context.propertyValueCaption.ptr()))
+                        {
+                            data.propertyName.readString(properties.at(context.propertyNameCaption.ptr()), true);
+                            data.propertyValue.readString(properties.at(context.propertyValueCaption.ptr()), true);
+                        }
                     }
-                }
-
-                rp.mols.top()->clone_KeepIndices(objs[i]->getBaseMolecule());
-                rp.rmode = RENDER_MOL;
             }
         }
-        else if (IndigoBaseReaction::is(*objs[0]))
+        else if (IndigoBaseReaction::is(*objs[i]) && rp.rmode != RENDER_MOL)
         {
-            for (int i = 0; i < objs.size(); ++i)
-            {
-                if (objs[i]->getBaseReaction().isQueryReaction())
-                    rp.rxns.add(new QueryReaction());
-                else
-                    rp.rxns.add(new Reaction());
-                Array<char>& title = rp.titles.push();
-                if (objs[i]->getProperties().contains(rp.cnvOpt.titleProp.ptr()))
-                    title.copy(objs[i]->getProperties().valueBuf(rp.cnvOpt.titleProp.ptr()));
-
-                rp.rxns.top()->clone(objs[i]->getBaseReaction(), 0, 0, 0);
-                rp.rmode = RENDER_RXN;
-            }
+            if (objs[i]->getBaseReaction().isQueryReaction())
+                rp.rxns.add(new QueryReaction());
+            else
+                rp.rxns.add(new Reaction());
+            rp.rxns.top()->clone(objs[i]->getBaseReaction(), 0, 0, 0);
+            rp.rmode = RENDER_RXN;
         }
-        else
+        else if (i == 0)
         {
             throw IndigoError("The array elements should be molecules or reactions");
         }
+        else
+        {
+            throw IndigoError("The array elements should be all molecules or all reactions");
+        }
+
+        if (with_titles)
+        {
+            Array<char>& title = rp.titles.push();
+            if (objs[i]->getProperties().contains(rp.cnvOpt.titleProp.ptr()))
+                title.copy(objs[i]->getProperties().valueBuf(rp.cnvOpt.titleProp.ptr()));
+        }
+    }
+}
+
+CEXPORT int indigoRenderGrid(int objects, int* refAtoms, int nColumns, int output)
+{
+    INDIGO_BEGIN
+    {
+        RenderParams& rp = indigoRendererGetInstance().renderParams;
+        rp.clearArrays();
+
+        PtrArray<IndigoObject>& objs = IndigoArray::cast(self.getObject(objects)).objects;
+        _indigoRenderCloneObjects(rp, objs, true);
 
         if (refAtoms != NULL)
         {
@@ -644,6 +646,37 @@ CEXPORT int indigoRenderGrid(int objects, int* refAtoms, int nColumns, int outpu
     INDIGO_END(-1);
 }
 
+CEXPORT int indigoRenderBatch(int objects, const int* outputs)
+{
+    INDIGO_BEGIN
+    {
+        RenderParams& rp = indigoRendererGetInstance().renderParams;
+        rp.clearArrays();
+        rp.smart_layout = self.smart_layout;
+
+        PtrArray<IndigoObject>& objs = IndigoArray::cast(self.getObject(objects)).objects;
+        _indigoRenderCloneObjects(rp, objs, false);
+
+        Array<Output*> batch_outputs;
+        for (int i = 0; i < objs.size(); ++i)
+        {
+            IndigoObject& out = self.getObject(outputs[i]);
+            if (out.type != IndigoObject::OUTPUT)
+                throw IndigoError("Invalid output object type");
+            batch_outputs.push(&IndigoOutput::get(out));
+        }
+
+        if (objs.size() > 0)
+            RenderParamInterface::renderBatch(rp, batch_outputs);
+
+        // Release memory for arrays with molecules/reactions
+        rp.clearArrays();
+
+        return objs.size();
+    }
+    INDIGO_END(-1);
+}
+
 DINGO_MODE indigoRenderGuessOutputFormat(const char* filename)
 {
     const char* ext = strrchr(filename, '.');
@@ -727,6 +760,7 @@ void IndigoRenderer::setOptionsHandlers()
         mgr->setOptionHandlerInt("render-image-height", SETTER_GETTER_INT_OPTION(rp.cnvOpt.height));
         mgr->setOptionHandlerInt("render-image-max-width", SETTER_GETTER_INT_OPTION(rp.cnvOpt.maxWidth));
         mgr->setOptionHandlerInt("render-image-max-height", SETTER_GETTER_INT_OPTION(rp.cnvOpt.maxHeight));
+        mgr->setOptionHandlerInt("render-thread-count", SETTER_GETTER_INT_OPTION(rp.threadCount));
 
         mgr->setOptionHandlerString("render-output-format", indigoRenderSetOutputFormat, indigoRenderGetOutputFormat);
 
@@ -673,6 +673,18 @@ CEXPORT double indigoMonoisotopicMass(int molecule);
 CEXPORT const char* indigoMassComposition(int molecule);
 
 CEXPORT const char* indigoCanonicalSmiles(int molecule);
+
+// Writes one "<canonical SMILES>\t<hash>" line per molecule or reaction of
+// the given iterator or array to the output, in the input order. Records are
+// canonicalized on worker threads. The hash is the 128-bit MurmurHash3 of the
+// canonical SMILES in hex, or its first 64 bits. Records that can not be
+// canonicalized get empty SMILES and hash fields followed by the error message,
+// with tabs and line breaks in it replaced by spaces.
+// Options are "name:value" pairs separated by semicolons:
+//   "threads:N" - number of worker threads, 0 (default) for one per CPU core
+//   "hash:128" (default), "hash:64", or "hash:0" to write SMILES only
+// Returns the number of written records
+CEXPORT int indigoCanonicalSmilesBatch(int source, int output, const char* options);
 CEXPORT const char* indigoLayeredCode(int molecule);
 
 CEXPORT const int* indigoSymmetryClasses(int molecule, int* count_out);
@@ -712,6 +724,12 @@ CEXPORT int indigoUnfoldHydrogens(int item);
 CEXPORT int indigoLayout(int object);
 CEXPORT int indigoClean2d(int object);
 
+// Macrocycle layouts found by the smart layout are kept in a process-wide
+// cache. Load adds the templates of the file to the cache, save writes the
+// whole cache. Both return the number of templates read or written.
+CEXPORT int indigoLoadMacrocycleLayoutCache(const char* filename);
+CEXPORT int indigoSaveMacrocycleLayoutCache(const char* filename);
+
 CEXPORT const char* indigoSmiles(int item);
 CEXPORT const char* indigoSmarts(int item);
 CEXPORT const char* indigoCanonicalSmarts(int item);
@@ -815,6 +833,33 @@ CEXPORT int indigoLoadFingerprintFromDescriptors(const double* arr, int arr_len,
 // "tversky" without numbers defaults to alpha = beta = 0.5
 CEXPORT float indigoSimilarity(int item1, int item2, const char* metrics);
 
+// Packs fingerprints into a fingerprint matrix object, one row per item, for
+// the batch similarity functions below. Accepts an array or an iterator of
+// fingerprints, molecules and reactions; structures are fingerprinted with
+// 'type' as in indigoFingerprint(). All fingerprints must have the same size.
+// indigoCount() returns the number of rows, indigoToBuffer() the packed bytes.
+CEXPORT int indigoFingerprintMatrix(int source, const char* type);
+
+// Batch similarity between the rows of two fingerprint matrices, which may be
+// the same object. 'metrics' is the same as in indigoSimilarity(). 'options'
+// is a semicolon-separated list; "threads:N" sets the number of worker
+// threads, 0 (default) for one per CPU core.
+
+// Writes the similarity of row i and column j to similarities[i * columns + j],
+// the buffer must hold rows x columns values. Returns the number of rows.
+CEXPORT int indigoSimilarityMatrix(int rows, int columns, const char* metrics, const char* options, float* similarities);
+
+// Finds the pairs with similarity of at least 'threshold', ordered by row and
+// then by column, and writes the first 'capacity' of them. Returns the total
+// number of pairs, so a call with zero capacity only counts them.
+CEXPORT int indigoSimilarityMatrixSparse(int rows, int columns, const char* metrics, const char* options, float threshold, int capacity, int* row_indices,
+                                         int* column_indices, float* similarities);
+
+// Writes the k most similar columns of every row to neighbors[i * k ...] in
+// descending order of similarity, ties go to the lower column. Missing
+// neighbors are -1 with similarity 0. Returns the number of rows.
+CEXPORT int indigoSimilarityTopK(int rows, int columns, const char* metrics, const char* options, int k, int* neighbors, float* similarities);
+
 /* Working with SDF/RDF/SMILES/CML/CDX files  */
 
 CEXPORT int indigoIterateSDF(int reader);
@@ -951,6 +996,9 @@ CEXPORT int indigoAllScaffolds(int extracted);
 // Returns a ``decomposition'' object that can be passed to
 // indigoDecomposedMoleculeScaffold() and
 // indigoIterateDecomposedMolecules()
+// structures is an array or an iterator of molecules. All of them are kept
+// in memory; the decomposition iteration API below handles one molecule at a
+// time. Embeddings are searched on "deco-thread-count" threads.
 CEXPORT int indigoDecomposeMolecules(int scaffold, int structures);
 
 // Returns a scaffold molecule with r-sites marking the place
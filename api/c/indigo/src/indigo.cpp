@@ -20,7 +20,10 @@
 #include "indigo_version.h"
 
 #include <atomic>
+#include <cerrno>
+#include <climits>
 #include <clocale>
+#include <cstdlib>
 
 #include "base_cpp/output.h"
 #include "base_cpp/profiling.h"
@@ -65,10 +68,12 @@ void Indigo::init()
     deconvolution_aromatization = true;
     deco_save_ap_bond_orders = false;
     deco_ignore_errors = true;
+    deco_thread_count = 1;
     molfile_saving_mode = 0;
     molfile_saving_no_chiral = false;
     molfile_saving_chiral_flag = -1;
     filename_encoding = ENCODING_ASCII;
+    mmap_file_scanner = false;
     fp_params.any_qwords = 15;
     fp_params.sim_qwords = 8;
     fp_params.tau_qwords = 10;
@@ -81,6 +86,7 @@ void Indigo::init()
     max_embeddings = 10000;
 
     layout_max_iterations = 0;
+    layout_thread_count = 1;
 
     molfile_saving_skip_date = false;
 
@@ -119,17 +125,12 @@ Indigo::Indigo()
 
 void Indigo::removeAllObjects()
 {
-    auto objects_holder = sf::xlock_safe_ptr(_objects_holder);
-    for (auto i = objects_holder->objects.begin(); i != objects_holder->objects.end(); i = objects_holder->objects.next(i))
-    {
 #ifdef INDIGO_DEBUG
-        std::stringstream ss;
-        ss << "~IndigoObject(" << TL_GET_SESSION_ID() << ", " << objects_holder->objects.key(i) << ")";
-        std::cout << ss.str() << std::endl;
+    std::stringstream ss;
+    ss << "~IndigoObject(" << TL_GET_SESSION_ID() << ", all " << _objects.count() << ")";
+    std::cout << ss.str() << std::endl;
 #endif
-        delete objects_holder->objects.value(i);
-    }
-    objects_holder->objects.clear();
+    _objects.removeAll();
 }
 
 void Indigo::updateCancellationHandler()
@@ -214,6 +215,8 @@ void Indigo::setErrorHandler(INDIGO_ERROR_HANDLER handler, void* context)
 
 Array<char>& Indigo::error_message()
 {
+    // The message outlives any arena scope of the first error on the thread
+    ArenaAllocator::Suspend suspend;
     thread_local static Array<char> _error_message;
     return _error_message;
 }
@@ -339,49 +342,36 @@ CEXPORT void indigoSetErrorMessage(const char* message)
 
 int Indigo::addObject(IndigoObject* obj)
 {
-    auto objects_holder = sf::xlock_safe_ptr(_objects_holder);
-    int id = objects_holder->next_id++;
+    int id = _objects.add(obj);
 #ifdef INDIGO_DEBUG
     std::stringstream ss;
     ss << "IndigoObject(" << TL_GET_SESSION_ID() << ", " << id << ")";
     std::cout << ss.str() << std::endl;
 #endif
-    objects_holder->objects.insert(id, obj);
     return id;
 }
 
 void Indigo::removeObject(int id)
 {
-    auto objects_holder = sf::xlock_safe_ptr(_objects_holder);
 #ifdef INDIGO_DEBUG
     std::stringstream ss;
     ss << "~IndigoObject(" << TL_GET_SESSION_ID() << ", " << id << ")";
     std::cout << ss.str() << std::endl;
 #endif
-    if (objects_holder->objects.at2(id) == 0)
-        return;
-    delete objects_holder->objects.at(id);
-    objects_holder->objects.remove(id);
+    _objects.remove(id);
 }
 
 IndigoObject& Indigo::getObject(int handle)
 {
-    auto objects_holder = sf::slock_safe_ptr(_objects_holder);
-
-    try
-    {
-        return *objects_holder->objects.at(handle);
-    }
-    catch (RedBlackMap<int, IndigoObject*>::Error& e)
-    {
-        throw IndigoError("can not access object #%d: %s", handle, e.message());
-    }
+    IndigoObject* obj = _objects.get(handle);
+    if (obj == nullptr)
+        throw IndigoError("can not access object #%d: no such object or it was freed", handle);
+    return *obj;
 }
 
 int Indigo::countObjects() const
 {
-    auto objects_holder = sf::slock_safe_ptr(_objects_holder);
-    return objects_holder->objects.size();
+    return _objects.count();
 }
 
 void Indigo::TmpData::clear()
@@ -394,6 +384,7 @@ void Indigo::TmpData::clear()
 
 Indigo::TmpData& Indigo::getThreadTmpData()
 {
+    ArenaAllocator::Suspend suspend;
     static thread_local Indigo::TmpData _data;
     _data.clear();
     return _data;
@@ -412,6 +403,41 @@ IndigoError::IndigoError(const char* format, ...) : Exception("core: ")
     va_end(args);
 }
 
+DLLEXPORT void indigoParseIntOptions(const char* options, const char* function, std::vector<std::pair<std::string, int>>& values)
+{
+    values.clear();
+    if (options == nullptr)
+        return;
+
+    std::string str(options);
+    size_t pos = 0;
+    while (pos < str.size())
+    {
+        size_t end = str.find(';', pos);
+        if (end == std::string::npos)
+            end = str.size();
+
+        std::string option = str.substr(pos, end - pos);
+        pos = end + 1;
+        if (option.empty())
+            continue;
+
+        size_t sep = option.find(':');
+        if (sep == std::string::npos)
+            throw IndigoError("%s: option \"%s\" has no value", function, option.c_str());
+
+        std::string name = option.substr(0, sep);
+        const char* text = option.c_str() + sep + 1;
+        char* text_end;
+        errno = 0;
+        long value = strtol(text, &text_end, 10);
+        if (*text == 0 || *text_end != 0 || errno == ERANGE || value < INT_MIN || value > INT_MAX)
+            throw IndigoError("%s: option \"%s\" has incorrect integer value \"%s\"", function, name.c_str(), text);
+
+        values.emplace_back(name, (int)value);
+    }
+}
+
 //
 // IndigoPluginContext
 //
@@ -0,0 +1,227 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base_cpp/hash128.h"
+#include "base_cpp/os_thread_wrapper.h"
+#include "base_cpp/output.h"
+#include "base_cpp/profiling.h"
+
+#include "indigo_array.h"
+#include "indigo_io.h"
+#include "indigo_savers.h"
+
+//
+// Canonical SMILES and canonical hashes of many records
+//
+
+class IndigoCanonicalBatchDispatcher : public OsCommandDispatcher
+{
+public:
+    IndigoCanonicalBatchDispatcher(IndigoObject& source, Output& output, int hash_bits)
+        : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _output(output), _hash_bits(hash_bits), _array(nullptr), _iterator(nullptr), _next_index(0),
+          _finished(false), _record_count(0)
+    {
+        if (IndigoArray::is(source))
+            _array = &IndigoArray::cast(source);
+        else
+            _iterator = &source;
+    }
+
+    int getRecordCount() const
+    {
+        return _record_count;
+    }
+
+private:
+    static const int _RECORDS_PER_COMMAND = 64;
+
+    class _Result : public OsCommandResult
+    {
+    public:
+        void clear() override
+        {
+            // The buffer keeps its memory, so every worker stops allocating after a few commands
+            lines.clear();
+            count = 0;
+        }
+
+        Array<char> lines;
+        Array<char> smiles;
+        int count;
+    };
+
+    class _Command : public OsCommand
+    {
+    public:
+        void clear() override
+        {
+            owned.clear();
+            objects.clear();
+        }
+
+        void execute(OsCommandResult& result) override
+        {
+            _Result& res = static_cast<_Result&>(result);
+            for (auto obj : objects)
+                dispatcher->_canonicalize(*obj, res);
+        }
+
+        std::vector<std::unique_ptr<IndigoObject>> owned;
+        std::vector<IndigoObject*> objects;
+        IndigoCanonicalBatchDispatcher* dispatcher;
+    };
+
+    OsCommand* _allocateCommand() override
+    {
+        return new _Command();
+    }
+
+    OsCommandResult* _allocateResult() override
+    {
+        return new _Result();
+    }
+
+    bool _setupCommand(OsCommand& command) override
+    {
+        if (_finished)
+            return false;
+
+        _Command& cmd = static_cast<_Command&>(command);
+        cmd.dispatcher = this;
+
+        while (cmd.objects.size() < _RECORDS_PER_COMMAND)
+        {
+            IndigoObject* obj = nullptr;
+            if (_array != nullptr)
+            {
+                if (_next_index < _array->objects.size())
+                    obj = _array->objects[_next_index++];
+            }
+            else
+            {
+                obj = _iterator->next();
+                if (obj != nullptr)
+                    cmd.owned.emplace_back(obj);
+            }
+
+            if (obj == nullptr)
+            {
+                _finished = true;
+                break;
+            }
+            cmd.objects.push_back(obj);
+        }
+
+        return !cmd.objects.empty();
+    }
+
+    void _canonicalize(IndigoObject& obj, _Result& result) const
+    {
+        profTimerStart(t, "canonical_batch_record");
+        try
+        {
+            IndigoCanonicalSmilesSaver::generateSmiles(obj, result.smiles);
+            result.lines.appendString(result.smiles.ptr(), false);
+            if (_hash_bits > 0)
+            {
+                result.lines.push('\t');
+                Hash128::get(result.smiles.ptr(), result.smiles.size() - 1).appendHex(result.lines, _hash_bits);
+            }
+        }
+        catch (Exception& e)
+        {
+            if (_hash_bits > 0)
+                result.lines.push('\t');
+            result.lines.push('\t');
+            // Keep the record on one line and in its fields
+            for (const char* c = e.message(); *c != 0; c++)
+                result.lines.push((*c == '\t' || *c == '\n' || *c == '\r') ? ' ' : *c);
+        }
+        result.lines.push('\n');
+        result.count++;
+    }
+
+    void _handleResult(OsCommandResult& result) override
+    {
+        _Result& res = static_cast<_Result&>(result);
+        _output.write(res.lines.ptr(), res.lines.size());
+        _record_count += res.count;
+    }
+
+    Output& _output;
+    int _hash_bits;
+    IndigoArray* _array;
+    IndigoObject* _iterator;
+    int _next_index;
+    bool _finished;
+    int _record_count;
+};
+
+static void _parseCanonicalBatchOptions(const char* options, int& thread_count, int& hash_bits)
+{
+    thread_count = 0;
+    hash_bits = 128;
+
+    std::vector<std::pair<std::string, int>> values;
+    indigoParseIntOptions(options, "indigoCanonicalSmilesBatch", values);
+    for (auto& option : values)
+    {
+        if (option.first == "threads")
+        {
+            if (option.second < 0)
+                throw IndigoError("indigoCanonicalSmilesBatch: incorrect threads option %d", option.second);
+            thread_count = option.second;
+        }
+        else if (option.first == "hash")
+        {
+            if (option.second != 0 && option.second != 64 && option.second != 128)
+                throw IndigoError("indigoCanonicalSmilesBatch: hash option must be 0, 64 or 128");
+            hash_bits = option.second;
+        }
+        else
+            throw IndigoError("indigoCanonicalSmilesBatch: unknown option \"%s\"", option.first.c_str());
+    }
+
+    if (thread_count == 0)
+        thread_count = std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+CEXPORT int indigoCanonicalSmilesBatch(int source, int output, const char* options)
+{
+    INDIGO_BEGIN
+    {
+        IndigoObject& source_obj = self.getObject(source);
+        Output& out = IndigoOutput::get(self.getObject(output));
+
+        int thread_count, hash_bits;
+        _parseCanonicalBatchOptions(options, thread_count, hash_bits);
+
+        profTimerStart(t, "indigoCanonicalSmilesBatch");
+        IndigoCanonicalBatchDispatcher dispatcher(source_obj, out, hash_bits);
+        dispatcher.run(thread_count);
+        out.flush();
+
+        return dispatcher.getRecordCount();
+    }
+    INDIGO_END(-1);
+}
@@ -21,6 +21,7 @@
 #include "base_cpp/obj_array.h"
 #include "base_cpp/obj_list.h"
 #include "base_cpp/red_black.h"
+#include "base_cpp/task_executor.h"
 #include "base_cpp/tlscont.h"
 #include "graph/automorphism_search.h"
 #include "indigo_array.h"
@@ -36,10 +37,13 @@
 #include "molecule/molfile_saver.h"
 #include "molecule/query_molecule.h"
 
+#include <exception>
+#include <vector>
+
 IMPL_ERROR(IndigoDeconvolution, "R-Group deconvolution");
 
 IndigoDeconvolution::IndigoDeconvolution()
-    : IndigoObject(IndigoObject::DECONVOLUTION), save_ap_bond_orders(false), ignore_errors(false), aromatize(true), cbEmbedding(0), embeddingUserdata(0),
+    : IndigoObject(IndigoObject::DECONVOLUTION), save_ap_bond_orders(false), ignore_errors(false), aromatize(true), thread_count(1), cbEmbedding(0), embeddingUserdata(0),
       _userDefinedScaffold(false)
 {
 }
@@ -100,10 +104,50 @@ void IndigoDeconvolution::makeRGroups(QueryMolecule& scaffold)
 
     setScaffold(scaffold);
 
-    for (int mol_idx = 0; mol_idx < _deconvolutionElems.size(); ++mol_idx)
+    int count = _deconvolutionElems.size();
+    if (count > 0 && _fullScaffold.vertexCount() == 0)
+        throw Error("error: scaffold vertex count equals 0");
+
+    Indigo& indigo = indigoGetInstance();
+    const AromaticityOptions arom_options = indigo.arom_options;
+
+    if (thread_count == 1)
+    {
+        for (int mol_idx = 0; mol_idx < _deconvolutionElems.size(); ++mol_idx)
+        {
+            IndigoDeconvolutionElem& elem = _deconvolutionElems[mol_idx];
+            _findEmbeddings(elem, _scaffold, arom_options, false);
+            _addEmbeddings(elem, true);
+        }
+        return;
+    }
+
+    /*
+     * Search embeddings in parallel. Every item has a scaffold copy of its own
+     * for the matcher, errors are raised in the order of the items.
+     */
+    std::vector<std::exception_ptr> errors(count);
+    TaskGroup::parallelFor(count, thread_count, [&](int i) {
+        try
+        {
+            QueryMolecule scaffold;
+            scaffold.clone_KeepIndices(_scaffold, 0);
+            _findEmbeddings(_deconvolutionElems[i], scaffold, arom_options, false);
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    });
+
+    /*
+     * Add R-groups to the full scaffold in the order of the items
+     */
+    for (int i = 0; i < count; ++i)
     {
-        IndigoDeconvolutionElem& elem = _deconvolutionElems[mol_idx];
-        makeRGroup(elem, false, true);
+        if (errors[i])
+            std::rethrow_exception(errors[i]);
+        _addEmbeddings(_deconvolutionElems[i], true);
     }
 }
 
@@ -113,6 +157,13 @@ void IndigoDeconvolution::makeRGroup(IndigoDeconvolutionElem& elem, bool all_mat
     if (_fullScaffold.vertexCount() == 0)
         throw Error("error: scaffold vertex count equals 0");
 
+    Indigo& indigo = indigoGetInstance();
+    _findEmbeddings(elem, _scaffold, indigo.arom_options, all_matches);
+    _addEmbeddings(elem, change_scaffold);
+}
+
+void IndigoDeconvolution::_findEmbeddings(IndigoDeconvolutionElem& elem, QueryMolecule& scaffold, const AromaticityOptions& arom_options, bool all_matches)
+{
     Molecule& mol_in = elem.mol_in;
 
     DecompositionEnumerator& deco_enum = elem.deco_enum;
@@ -123,19 +174,13 @@ void IndigoDeconvolution::makeRGroup(IndigoDeconvolutionElem& elem, bool all_mat
     }
 
     if (aromatize)
-    {
-        Indigo& indigo = indigoGetInstance();
-        MoleculeAromatizer::aromatizeBonds(mol_in, indigo.arom_options);
-    }
+        MoleculeAromatizer::aromatizeBonds(mol_in, arom_options);
 
     /*
      * Set enumerator parameters
      */
-    if (aromatize && AromaticityMatcher::isNecessary(_scaffold))
-    {
-        Indigo& indigo = indigoGetInstance();
-        deco_enum.am = std::make_unique<AromaticityMatcher>(_scaffold, mol_in, indigo.arom_options);
-    }
+    if (aromatize && AromaticityMatcher::isNecessary(scaffold))
+        deco_enum.am = std::make_unique<AromaticityMatcher>(scaffold, mol_in, arom_options);
 
     deco_enum.fmcache = std::make_unique<MoleculeSubstructureMatcher::FragmentMatchCache>();
     deco_enum.fmcache->clear();
@@ -143,13 +188,13 @@ void IndigoDeconvolution::makeRGroup(IndigoDeconvolutionElem& elem, bool all_mat
     deco_enum.remove_rsites = _userDefinedScaffold;
     deco_enum.contexts.clear();
     deco_enum.deco = this;
-    deco_enum.calculateAutoMaps(_scaffold);
+    deco_enum.calculateAutoMaps(scaffold);
 
     /*
      * Create substructure enumerator and set up options
      */
     EmbeddingEnumerator emb_enum(mol_in);
-    emb_enum.setSubgraph(_scaffold);
+    emb_enum.setSubgraph(scaffold);
     emb_enum.cb_embedding = _rGroupsEmbedding;
     emb_enum.cb_match_edge = _matchBonds;
     emb_enum.cb_match_vertex = _matchAtoms;
@@ -161,6 +206,19 @@ void IndigoDeconvolution::makeRGroup(IndigoDeconvolutionElem& elem, bool all_mat
      */
     emb_enum.process();
 
+    /*
+     * The matcher refers to the scaffold, which can be a temporary copy
+     */
+    deco_enum.am.reset();
+}
+
+void IndigoDeconvolution::_addEmbeddings(IndigoDeconvolutionElem& elem, bool change_scaffold)
+{
+    Molecule& mol_in = elem.mol_in;
+    DecompositionEnumerator& deco_enum = elem.deco_enum;
+    if (mol_in.vertexCount() == 0)
+        return;
+
     if (deco_enum.contexts.size() == 0)
     {
         if (ignore_errors)
@@ -1567,15 +1625,34 @@ CEXPORT int indigoDecomposeMolecules(int scaffold, int structures)
 {
     INDIGO_BEGIN
     {
-        IndigoArray& mol_array = IndigoArray::cast(self.getObject(structures));
+        IndigoObject& structures_obj = self.getObject(structures);
         std::unique_ptr<IndigoDeconvolution> deco = std::make_unique<IndigoDeconvolution>();
         deco->save_ap_bond_orders = self.deco_save_ap_bond_orders;
         deco->ignore_errors = self.deco_ignore_errors;
         deco->aromatize = self.deconvolution_aromatization;
-        for (int i = 0; i < mol_array.objects.size(); i++)
+        deco->thread_count = self.deco_thread_count;
+        if (IndigoArray::is(structures_obj))
         {
-            IndigoObject& obj = *mol_array.objects[i];
-            deco->addMolecule(obj.getMolecule(), obj.getProperties(), i);
+            IndigoArray& mol_array = IndigoArray::cast(structures_obj);
+            for (int i = 0; i < mol_array.objects.size(); i++)
+            {
+                IndigoObject& obj = *mol_array.objects[i];
+                deco->addMolecule(obj.getMolecule(), obj.getProperties(), i);
+            }
+        }
+        else
+        {
+            /*
+             * The whole input is read before the decomposition: the full
+             * scaffold depends on every item and the items are kept
+             */
+            for (int i = 0;; i++)
+            {
+                std::unique_ptr<IndigoObject> obj(structures_obj.next());
+                if (obj.get() == nullptr)
+                    break;
+                deco->addMolecule(obj->getMolecule(), obj->getProperties(), i);
+            }
         }
         QueryMolecule& scaf = self.getObject(scaffold).getQueryMolecule();
         deco->makeRGroups(scaf);
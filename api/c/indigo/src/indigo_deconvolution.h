@@ -52,6 +52,10 @@ public:
     void addMolecule(Molecule& mol, PropertiesMap& props, int idx);
 
     void setScaffold(QueryMolecule& scaffold);
+    /*
+     * Embeddings are searched on thread_count threads, R-groups are numbered
+     * in the order of the items like with a single thread.
+     */
     void makeRGroups(QueryMolecule& scaffold);
     void makeRGroup(IndigoDeconvolutionElem& elem, bool all_matches, bool change_scaffold);
 
@@ -75,6 +79,10 @@ public:
      * Aromatize
      */
     bool aromatize;
+    /*
+     * Threads for makeRGroups, 0 for one per core
+     */
+    int thread_count;
 
     int (*cbEmbedding)(const int* sub_vert_map, const int* sub_edge_map, const void* info, void* userdata);
     void* embeddingUserdata;
@@ -122,6 +130,9 @@ public:
 private:
     void _parseOptions(const char* options);
 
+    void _findEmbeddings(IndigoDeconvolutionElem& elem, QueryMolecule& scaffold, const AromaticityOptions& arom_options, bool all_matches);
+    void _addEmbeddings(IndigoDeconvolutionElem& elem, bool change_scaffold);
+
     void _addFullRGroup(IndigoDecompositionMatch& deco_match, Array<int>& auto_map, int rg_idx, int new_rg_idx);
 
     static int _rGroupsEmbedding(Graph& g1, Graph& g2, int* core1, int* core2, void* userdata);
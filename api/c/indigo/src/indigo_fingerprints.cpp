@@ -21,6 +21,7 @@
 #include "base_c/bitarray.h"
 #include "base_cpp/output.h"
 #include "base_cpp/scanner.h"
+#include "indigo_array.h"
 #include "indigo_io.h"
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
@@ -29,6 +30,7 @@
 #include "reaction/reaction_fingerprint.h"
 #include <math.h>
 #include <memory>
+#include <string>
 
 IndigoFingerprint::IndigoFingerprint() : IndigoObject(FINGERPRINT)
 {
@@ -45,6 +47,28 @@ IndigoFingerprint& IndigoFingerprint::cast(IndigoObject& obj)
     throw IndigoError("%s is not a fingerprint", obj.debugInfo());
 }
 
+IndigoFingerprintMatrix::IndigoFingerprintMatrix() : IndigoObject(FINGERPRINT_MATRIX)
+{
+}
+
+IndigoFingerprintMatrix::~IndigoFingerprintMatrix()
+{
+}
+
+IndigoFingerprintMatrix& IndigoFingerprintMatrix::cast(IndigoObject& obj)
+{
+    if (obj.type == IndigoObject::FINGERPRINT_MATRIX)
+        return (IndigoFingerprintMatrix&)obj;
+    throw IndigoError("%s is not a fingerprint matrix", obj.debugInfo());
+}
+
+void IndigoFingerprintMatrix::toBuffer(Array<char>& buf)
+{
+    buf.clear();
+    for (int i = 0; i < matrix.count(); i++)
+        buf.concat((const char*)matrix.row(i), matrix.fpSize());
+}
+
 void _indigoParseMoleculeFingerprintType(MoleculeFingerprintBuilder& builder, const char* type, bool query)
 {
     builder.query = query;
@@ -118,37 +142,37 @@ void _indigoParseReactionFingerprintType(ReactionFingerprintBuilder& builder, co
         throw IndigoError("unknown molecule fingerprint type: %s", type);
 }
 
+static void _indigoFingerprint(Indigo& self, IndigoObject& obj, const char* type, Array<byte>& bytes)
+{
+    if (IndigoBaseMolecule::is(obj))
+    {
+        BaseMolecule& mol = obj.getBaseMolecule();
+        MoleculeFingerprintBuilder builder(mol, self.fp_params);
+
+        _indigoParseMoleculeFingerprintType(builder, type, mol.isQueryMolecule());
+        builder.process();
+        bytes.copy(builder.get(), self.fp_params.fingerprintSize());
+    }
+    else if (IndigoBaseReaction::is(obj))
+    {
+        BaseReaction& rxn = obj.getBaseReaction();
+        ReactionFingerprintBuilder builder(rxn, self.fp_params);
+
+        _indigoParseReactionFingerprintType(builder, type, rxn.isQueryReaction());
+        builder.process();
+        bytes.copy(builder.get(), self.fp_params.fingerprintSizeExtOrdSim() * 2);
+    }
+    else
+        throw IndigoError("indigoFingerprint(): accepting only molecules and reactions, got %s", obj.debugInfo());
+}
+
 CEXPORT int indigoFingerprint(int item, const char* type)
 {
     INDIGO_BEGIN
     {
-        IndigoObject& obj = self.getObject(item);
-
-        if (IndigoBaseMolecule::is(obj))
-        {
-            BaseMolecule& mol = obj.getBaseMolecule();
-            MoleculeFingerprintBuilder builder(mol, self.fp_params);
-
-            _indigoParseMoleculeFingerprintType(builder, type, mol.isQueryMolecule());
-            builder.process();
-            std::unique_ptr<IndigoFingerprint> fp = std::make_unique<IndigoFingerprint>();
-            fp->bytes.copy(builder.get(), self.fp_params.fingerprintSize());
-            return self.addObject(fp.release());
-        }
-        else if (IndigoBaseReaction::is(obj))
-        {
-            BaseReaction& rxn = obj.getBaseReaction();
-            ReactionFingerprintBuilder builder(rxn, self.fp_params);
-
-            _indigoParseReactionFingerprintType(builder, type, rxn.isQueryReaction());
-            builder.process();
-            std::unique_ptr<IndigoFingerprint> fp = std::make_unique<IndigoFingerprint>();
-            fp->bytes.copy(builder.get(), self.fp_params.fingerprintSizeExtOrdSim() * 2);
-            return self.addObject(fp.release());
-        }
-        else
-            throw IndigoError("indigoFingerprint(): accepting only molecules and reactions, got %s", obj.debugInfo());
-        return 1;
+        std::unique_ptr<IndigoFingerprint> fp = std::make_unique<IndigoFingerprint>();
+        _indigoFingerprint(self, self.getObject(item), type, fp->bytes);
+        return self.addObject(fp.release());
     }
     INDIGO_END(-1);
 }
@@ -208,53 +232,52 @@ void IndigoFingerprint::toBuffer(Array<char>& buf)
     buf.copy((char*)bytes.ptr(), bytes.size());
 }
 
-static float _indigoSimilarity2(const byte* arr1, const byte* arr2, int size, const char* metrics)
+IndigoObject* IndigoFingerprint::clone()
 {
-    int ones1 = bitGetOnesCount(arr1, size);
-    int ones2 = bitGetOnesCount(arr2, size);
-    int common_ones = bitCommonOnes(arr1, arr2, size);
+    std::unique_ptr<IndigoFingerprint> fp = std::make_unique<IndigoFingerprint>();
+    fp->bytes.copy(bytes);
+    return fp.release();
+}
 
-    if (metrics == 0 || metrics[0] == 0 || strcasecmp(metrics, "tanimoto") == 0)
-    {
-        if (common_ones == 0)
-            return 0.f;
+static FingerprintMatrix::Metrics _indigoParseMetrics(const char* metrics)
+{
+    FingerprintMatrix::Metrics result;
 
-        return (float)common_ones / (ones1 + ones2 - common_ones);
-    }
+    if (metrics == 0 || metrics[0] == 0 || strcasecmp(metrics, "tanimoto") == 0)
+        result.type = FingerprintMatrix::Metrics::TANIMOTO;
     else if (strlen(metrics) >= 7 && strncasecmp(metrics, "tversky", 7) == 0)
     {
-        float alpha = 0.5f, beta = 0.5f;
+        result.type = FingerprintMatrix::Metrics::TVERSKY;
 
         const char* params = metrics + 7;
 
         if (*params != 0)
         {
             BufferScanner scanner(params);
-            if (!scanner.tryReadFloat(alpha))
+            if (!scanner.tryReadFloat(result.alpha))
                 throw IndigoError("unknown metrics: %s", metrics);
             scanner.skipSpace();
-            if (!scanner.tryReadFloat(beta))
+            if (!scanner.tryReadFloat(result.beta))
                 throw IndigoError("unknown metrics: %s", metrics);
         }
-        if (common_ones == 0)
-            return 0;
-
-        float denom = (ones1 - common_ones) * alpha + (ones2 - common_ones) * beta + common_ones;
-
-        if (denom < 1e-6f)
-            throw IndigoError("bad denominator");
-
-        return common_ones / denom;
     }
     else if (strcasecmp(metrics, "euclid-sub") == 0)
-    {
-        if (common_ones == 0)
-            return 0;
-
-        return (float)common_ones / ones1;
-    }
+        result.type = FingerprintMatrix::Metrics::EUCLID_SUB;
     else
         throw IndigoError("unknown metrics: %s", metrics);
+
+    return result;
+}
+
+static float _indigoSimilarity2(const byte* arr1, const byte* arr2, int size, const char* metrics)
+{
+    FingerprintMatrix::Metrics parsed = _indigoParseMetrics(metrics);
+
+    int ones1 = bitGetOnesCount(arr1, size);
+    int ones2 = bitGetOnesCount(arr2, size);
+    int common_ones = bitCommonOnes(arr1, arr2, size);
+
+    return parsed.similarity(ones1, ones2, common_ones);
 }
 
 static float _indigoSimilarity(Array<byte>& arr1, Array<byte>& arr2, const char* metrics)
@@ -509,4 +532,124 @@ CEXPORT const char* indigoOneBitsList(int fingerprint)
         return tmp.string.ptr();
     }
     INDIGO_END(0);
-}
\ No newline at end of file
+}
+
+CEXPORT int indigoFingerprintMatrix(int source, const char* type)
+{
+    INDIGO_BEGIN
+    {
+        IndigoObject& obj = self.getObject(source);
+        std::unique_ptr<IndigoFingerprintMatrix> fpm = std::make_unique<IndigoFingerprintMatrix>();
+        FingerprintMatrix& matrix = fpm->matrix;
+
+        QS_DEF(Array<byte>, bytes);
+        auto add = [&](IndigoObject& item) {
+            const Array<byte>* fp = &bytes;
+            if (item.type == IndigoObject::FINGERPRINT)
+                fp = &IndigoFingerprint::cast(item).bytes;
+            else
+                _indigoFingerprint(self, item, type, bytes);
+
+            if (matrix.count() == 0)
+                matrix.clear(fp->size());
+            else if (fp->size() != matrix.fpSize())
+                throw IndigoError("indigoFingerprintMatrix(): fingerprint sizes do not match (%d and %d)", matrix.fpSize(), fp->size());
+            matrix.add(fp->ptr());
+        };
+
+        if (IndigoArray::is(obj))
+        {
+            IndigoArray& arr = IndigoArray::cast(obj);
+            for (int i = 0; i < arr.objects.size(); i++)
+                add(*arr.objects[i]);
+        }
+        else
+        {
+            IndigoObject* item;
+            while ((item = obj.next()) != nullptr)
+            {
+                std::unique_ptr<IndigoObject> holder(item);
+                add(*item);
+            }
+        }
+
+        return self.addObject(fpm.release());
+    }
+    INDIGO_END(-1);
+}
+
+static int _indigoParseSimilarityOptions(const char* options, const char* function)
+{
+    int thread_count = 0;
+
+    std::vector<std::pair<std::string, int>> values;
+    indigoParseIntOptions(options, function, values);
+    for (auto& option : values)
+    {
+        if (option.first == "threads")
+        {
+            if (option.second < 0)
+                throw IndigoError("%s: incorrect threads option %d", function, option.second);
+            thread_count = option.second;
+        }
+        else
+            throw IndigoError("%s: unknown option \"%s\"", function, option.first.c_str());
+    }
+
+    return thread_count;
+}
+
+CEXPORT int indigoSimilarityMatrix(int rows, int columns, const char* metrics, const char* options, float* similarities)
+{
+    INDIGO_BEGIN
+    {
+        FingerprintMatrix& row_matrix = IndigoFingerprintMatrix::cast(self.getObject(rows)).matrix;
+        FingerprintMatrix& column_matrix = IndigoFingerprintMatrix::cast(self.getObject(columns)).matrix;
+        int thread_count = _indigoParseSimilarityOptions(options, "indigoSimilarityMatrix");
+
+        FingerprintMatrix::similarities(row_matrix, column_matrix, _indigoParseMetrics(metrics), thread_count, similarities);
+        return row_matrix.count();
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT int indigoSimilarityMatrixSparse(int rows, int columns, const char* metrics, const char* options, float threshold, int capacity, int* row_indices,
+                                         int* column_indices, float* similarities)
+{
+    INDIGO_BEGIN
+    {
+        FingerprintMatrix& row_matrix = IndigoFingerprintMatrix::cast(self.getObject(rows)).matrix;
+        FingerprintMatrix& column_matrix = IndigoFingerprintMatrix::cast(self.getObject(columns)).matrix;
+        int thread_count = _indigoParseSimilarityOptions(options, "indigoSimilarityMatrixSparse");
+
+        QS_DEF(Array<int>, pair_rows);
+        QS_DEF(Array<int>, pair_columns);
+        QS_DEF(Array<float>, pair_similarities);
+        FingerprintMatrix::thresholdPairs(row_matrix, column_matrix, _indigoParseMetrics(metrics), threshold, thread_count, pair_rows, pair_columns,
+                                          pair_similarities);
+
+        int written = std::min(std::max(capacity, 0), pair_rows.size());
+        if (written > 0)
+        {
+            memcpy(row_indices, pair_rows.ptr(), written * sizeof(int));
+            memcpy(column_indices, pair_columns.ptr(), written * sizeof(int));
+            memcpy(similarities, pair_similarities.ptr(), written * sizeof(float));
+        }
+        return pair_rows.size();
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT int indigoSimilarityTopK(int rows, int columns, const char* metrics, const char* options, int k, int* neighbors, float* similarities)
+{
+    INDIGO_BEGIN
+    {
+        FingerprintMatrix& row_matrix = IndigoFingerprintMatrix::cast(self.getObject(rows)).matrix;
+        FingerprintMatrix& column_matrix = IndigoFingerprintMatrix::cast(self.getObject(columns)).matrix;
+        int thread_count = _indigoParseSimilarityOptions(options, "indigoSimilarityTopK");
+
+        FingerprintMatrix::topK(row_matrix, column_matrix, _indigoParseMetrics(metrics), k, thread_count, neighbors, similarities);
+        return row_matrix.count();
+    }
+    INDIGO_END(-1);
+}
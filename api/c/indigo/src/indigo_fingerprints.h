@@ -19,6 +19,7 @@
 #ifndef __indigo_fingerprints__
 #define __indigo_fingerprints__
 
+#include "base_cpp/fingerprint_matrix.h"
 #include "indigo_internal.h"
 
 #ifdef _WIN32
@@ -34,12 +35,27 @@ public:
 
     void toString(Array<char>& str) override;
     void toBuffer(Array<char>& buf) override;
+    IndigoObject* clone() override;
 
     static IndigoFingerprint& cast(IndigoObject& obj);
 
     Array<byte> bytes;
 };
 
+// Fingerprints packed row by row for the batch similarity functions
+class DLLEXPORT IndigoFingerprintMatrix : public IndigoObject
+{
+public:
+    IndigoFingerprintMatrix();
+    ~IndigoFingerprintMatrix() override;
+
+    void toBuffer(Array<char>& buf) override;
+
+    static IndigoFingerprintMatrix& cast(IndigoObject& obj);
+
+    FingerprintMatrix matrix;
+};
+
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
@@ -25,7 +25,9 @@
 #endif
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "indigo.h"
 
@@ -40,6 +42,7 @@
 #include "molecule/molecule_standardize_options.h"
 #include "molecule/molecule_stereocenter_options.h"
 #include "molecule/molecule_tautomer.h"
+#include "indigo_object_table.h"
 #include "option_manager.h"
 
 /* When Indigo internal code is used dynamically the INDIGO_VERSION define
@@ -164,6 +167,7 @@ public:
         GROSS_REACTION,
         JSON_MOLECULE,
         JSON_REACTION,
+        FINGERPRINT_MATRIX,
         INDIGO_OBJECT_LAST_TYPE // must be the last element in the enum
     };
 
@@ -306,6 +310,7 @@ public:
     bool deconvolution_aromatization;
     bool deco_save_ap_bond_orders;
     bool deco_ignore_errors;
+    int deco_thread_count; // threads for indigoDecomposeMolecules, 0 - one per core
 
     int molfile_saving_mode; // MolfileSaver::MODE_***, default is zero
     bool molfile_saving_no_chiral;
@@ -318,11 +323,13 @@ public:
     bool smiles_saving_smarts_mode;
 
     Encoding filename_encoding;
+    bool mmap_file_scanner;
 
     bool embedding_edges_uniqueness, find_unique_embeddings;
     int max_embeddings;
 
     int layout_max_iterations; // default is zero -- no limit
+    int layout_thread_count;   // threads for disconnected components and arrays, 0 - one per core
     bool smart_layout = false;
     float layout_horintervalfactor = 1.4f;
 
@@ -362,12 +369,7 @@ private:
     static INDIGO_ERROR_HANDLER& error_handler();
     static void*& error_handler_context();
 
-    struct ObjectsHolder
-    {
-        RedBlackMap<int, IndigoObject*> objects;
-        int next_id = 1000; // FIXME:MK: Why does it matter?
-    };
-    sf::safe_shared_hide_obj<ObjectsHolder> _objects_holder;
+    IndigoObjectTable _objects;
 
     int _indigo_id;
 };
@@ -414,6 +416,12 @@ public:
     explicit IndigoError(const char* format, ...);
 };
 
+// Parses "name:value" options separated by ';', as taken by the batch
+// functions, into names and integer values. Throws IndigoError prefixed
+// with the function name if an option has no value or its value is not
+// an integer. The names are checked by the caller.
+DLLEXPORT void indigoParseIntOptions(const char* options, const char* function, std::vector<std::pair<std::string, int>>& values);
+
 class IndigoOptionHandlerSetter
 {
 public:
@@ -17,22 +17,120 @@
  ***************************************************************************/
 
 #include "base_cpp/cancellation_handler.h"
+#include "indigo_array.h"
 #include "indigo_internal.h"
 #include "indigo_molecule.h"
 #include "indigo_reaction.h"
 #include "layout/molecule_cleaner_2d.h"
 #include "layout/molecule_layout.h"
+#include "layout/molecule_layout_macrocycles_cache.h"
 #include "layout/reaction_layout.h"
 #include "reaction/base_reaction.h"
 #include <algorithm>
 #include <vector>
 
+static void _markLayoutStereo(BaseMolecule& mol)
+{
+    mol.clearBondDirections();
+    try
+    {
+        mol.markBondsStereocenters();
+        mol.markBondsAlleneStereo();
+    }
+    catch (Exception e)
+    {
+    }
+    for (int i = 1; i <= mol.rgroups.getRGroupCount(); i++)
+    {
+        RGroup& rgp = mol.rgroups.getRGroup(i);
+
+        for (int j = rgp.fragments.begin(); j != rgp.fragments.end(); j = rgp.fragments.next(j))
+        {
+            rgp.fragments[j]->clearBondDirections();
+            try
+            {
+                rgp.fragments[j]->markBondsStereocenters();
+                rgp.fragments[j]->markBondsAlleneStereo();
+            }
+            catch (Exception e)
+            {
+            }
+        }
+    }
+}
+
+static void _layoutReaction(Indigo& self, BaseReaction& rxn)
+{
+    ReactionLayout rl(rxn, self.smart_layout);
+    rl.max_iterations = self.layout_max_iterations;
+    rl.layout_orientation = (layout_orientation_value)self.layout_orientation;
+    rl.bond_length = 1.6f;
+    rl.horizontal_interval_factor = self.layout_horintervalfactor;
+
+    rl.make();
+    try
+    {
+        rxn.markStereocenterBonds();
+    }
+    catch (Exception e)
+    {
+    }
+}
+
+// Molecules of the array are laid out by MoleculeBatchLayout in worker
+// threads, reactions one by one. Like a loop over the items, layout stops
+// at the first item that fails; molecules already in progress in other
+// threads are finished.
+static void _layoutArray(Indigo& self, IndigoArray& arr)
+{
+    for (int i = 0; i < arr.objects.size(); i++)
+    {
+        IndigoObject& item = *arr.objects[i];
+        if (!IndigoBaseMolecule::is(item) && !IndigoBaseReaction::is(item))
+            throw IndigoError("indigoLayout(): array element %d is neither a molecule, nor a reaction", i);
+        if (item.type == IndigoObject::SUBMOLECULE)
+            throw IndigoError("indigoLayout(): array element %d is a submolecule", i);
+    }
+
+    Array<BaseMolecule*> molecules;
+    for (int i = 0; i < arr.objects.size(); i++)
+    {
+        IndigoObject& item = *arr.objects[i];
+        if (IndigoBaseMolecule::is(item))
+            molecules.push(&item.getBaseMolecule());
+    }
+
+    MoleculeBatchLayout batch;
+    batch.smart_layout = self.smart_layout;
+    batch.max_iterations = self.layout_max_iterations;
+    batch.bond_length = 1.6f;
+    batch.layout_orientation = (layout_orientation_value)self.layout_orientation;
+    batch.cancellation_timeout = self.cancellation_timeout;
+    batch.thread_count = self.layout_thread_count;
+    batch.stop_on_error = true;
+    batch.make(molecules);
+
+    int mol_idx = 0;
+    for (int i = 0; i < arr.objects.size(); i++)
+    {
+        IndigoObject& item = *arr.objects[i];
+        if (IndigoBaseMolecule::is(item))
+        {
+            const char* error = batch.getError(mol_idx++);
+            if (error != nullptr)
+                throw IndigoError("indigoLayout(): %s", error);
+            _markLayoutStereo(item.getBaseMolecule());
+        }
+        else
+            _layoutReaction(self, item.getBaseReaction());
+    }
+}
+
 CEXPORT int indigoLayout(int object)
 {
     INDIGO_BEGIN
     {
         IndigoObject& obj = self.getObject(object);
-        int i;
 
         if (IndigoBaseMolecule::is(obj))
         {
@@ -58,6 +156,7 @@ CEXPORT int indigoLayout(int object)
             ml.max_iterations = self.layout_max_iterations;
             ml.bond_length = 1.6f;
             ml.layout_orientation = (layout_orientation_value)self.layout_orientation;
+            ml.thread_count = self.layout_thread_count;
 
             TimeoutCancellationHandler cancellation(self.cancellation_timeout);
             ml.setCancellationHandler(&cancellation);
@@ -67,51 +166,16 @@ CEXPORT int indigoLayout(int object)
             if (obj.type != IndigoObject::SUBMOLECULE)
             {
                 // Not for submolecule yet
-                mol->clearBondDirections();
-                try
-                {
-                    mol->markBondsStereocenters();
-                    mol->markBondsAlleneStereo();
-                }
-                catch (Exception e)
-                {
-                }
-                for (i = 1; i <= mol->rgroups.getRGroupCount(); i++)
-                {
-                    RGroup& rgp = mol->rgroups.getRGroup(i);
-
-                    for (int j = rgp.fragments.begin(); j != rgp.fragments.end(); j = rgp.fragments.next(j))
-                    {
-                        rgp.fragments[j]->clearBondDirections();
-                        try
-                        {
-                            rgp.fragments[j]->markBondsStereocenters();
-                            rgp.fragments[j]->markBondsAlleneStereo();
-                        }
-                        catch (Exception e)
-                        {
-                        }
-                    }
-                }
+                _markLayoutStereo(*mol);
             }
         }
         else if (IndigoBaseReaction::is(obj))
         {
-            BaseReaction& rxn = obj.getBaseReaction();
-            ReactionLayout rl(rxn, self.smart_layout);
-            rl.max_iterations = self.layout_max_iterations;
-            rl.layout_orientation = (layout_orientation_value)self.layout_orientation;
-            rl.bond_length = 1.6f;
-            rl.horizontal_interval_factor = self.layout_horintervalfactor;
-
-            rl.make();
-            try
-            {
-                rxn.markStereocenterBonds();
-            }
-            catch (Exception e)
-            {
-            }
+            _layoutReaction(self, obj.getBaseReaction());
+        }
+        else if (IndigoArray::is(obj))
+        {
+            _layoutArray(self, IndigoArray::cast(obj));
         }
         else
         {
@@ -183,3 +247,21 @@ CEXPORT int indigoClean2d(int object)
     }
     INDIGO_END(-1);
 }
+
+CEXPORT int indigoLoadMacrocycleLayoutCache(const char* filename)
+{
+    INDIGO_BEGIN
+    {
+        return MoleculeLayoutMacrocyclesCache::instance().loadFromFile(filename);
+    }
+    INDIGO_END(-1);
+}
+
+CEXPORT int indigoSaveMacrocycleLayoutCache(const char* filename)
+{
+    INDIGO_BEGIN
+    {
+        return MoleculeLayoutMacrocyclesCache::instance().saveToFile(filename);
+    }
+    INDIGO_END(-1);
+}
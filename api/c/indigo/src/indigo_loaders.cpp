@@ -28,6 +28,7 @@
 #include "molecule/multiple_cdx_loader.h"
 #include "molecule/multiple_cml_loader.h"
 #include "molecule/rdf_loader.h"
+#include "molecule/record_index.h"
 #include "molecule/sdf_loader.h"
 #include "molecule/smiles_loader.h"
 #include "reaction/reaction_cdx_loader.h"
@@ -75,6 +76,16 @@ IndigoJSONMolecule::~IndigoJSONMolecule()
 {
 }
 
+// Multi-record files are mapped into memory with the "mmap-file-scanner" option,
+// so record boundaries are found without parsing and records are read in place
+static std::unique_ptr<Scanner> _openRecordFile(const char* filename)
+{
+    Indigo& self = indigoGetInstance();
+    if (self.mmap_file_scanner)
+        return std::make_unique<MappedFileScanner>(self.filename_encoding, filename);
+    return std::make_unique<FileScanner>(self.filename_encoding, filename);
+}
+
 IndigoSdfLoader::IndigoSdfLoader(Scanner& scanner) : IndigoObject(SDF_LOADER)
 {
     sdf_loader = std::make_unique<SdfLoader>(scanner);
@@ -83,7 +94,7 @@ IndigoSdfLoader::IndigoSdfLoader(Scanner& scanner) : IndigoObject(SDF_LOADER)
 IndigoSdfLoader::IndigoSdfLoader(const char* filename) : IndigoObject(SDF_LOADER)
 {
     // AutoPtr guard in case of exception in SdfLoader (happens in case of empty file)
-    _own_scanner = std::make_unique<FileScanner>(indigoGetInstance().filename_encoding, filename);
+    _own_scanner = _openRecordFile(filename);
     sdf_loader = std::make_unique<SdfLoader>(*_own_scanner);
 }
 
@@ -279,7 +290,7 @@ IndigoRdfLoader::IndigoRdfLoader(Scanner& scanner) : IndigoObject(RDF_LOADER)
 
 IndigoRdfLoader::IndigoRdfLoader(const char* filename) : IndigoObject(RDF_LOADER)
 {
-    _own_scanner = std::make_unique<FileScanner>(indigoGetInstance().filename_encoding, filename);
+    _own_scanner = _openRecordFile(filename);
     rdf_loader = std::make_unique<RdfLoader>(*_own_scanner);
 }
 
@@ -420,7 +431,7 @@ IndigoMultilineSmilesLoader::IndigoMultilineSmilesLoader(Scanner& scanner) : Ind
 
 IndigoMultilineSmilesLoader::IndigoMultilineSmilesLoader(const char* filename) : IndigoObject(MULTILINE_SMILES_LOADER), CP_INIT, TL_CP_GET(_offsets)
 {
-    _own_scanner = std::make_unique<FileScanner>(indigoGetInstance().filename_encoding, filename);
+    _own_scanner = _openRecordFile(filename);
     _scanner = _own_scanner.get();
 
     _current_number = 0;
@@ -468,8 +479,29 @@ long long IndigoMultilineSmilesLoader::tell()
     return _scanner->tell();
 }
 
+bool IndigoMultilineSmilesLoader::_indexMappedFile()
+{
+    MappedFileScanner* mapped = dynamic_cast<MappedFileScanner*>(_scanner);
+    if (mapped == nullptr)
+        return false;
+
+    long long size = mapped->length();
+    if (_max_offset < size)
+    {
+        RecordIndex index;
+        index.build(mapped->data() + _max_offset, size - _max_offset, RecordIndex::FORMAT_SMILES, 0);
+        for (int i = 0; i < index.count(); i++)
+            _offsets.push(_max_offset + index.offset(i));
+        _max_offset = size;
+    }
+    return true;
+}
+
 int IndigoMultilineSmilesLoader::count()
 {
+    if (_indexMappedFile())
+        return _offsets.size();
+
     long long offset = _scanner->tell();
     int cn = _current_number;
 
@@ -495,6 +527,9 @@ int IndigoMultilineSmilesLoader::count()
 
 IndigoObject* IndigoMultilineSmilesLoader::at(int index)
 {
+    if (index >= _offsets.size())
+        _indexMappedFile();
+
     if (index < _offsets.size())
     {
         _scanner->seek(_offsets[index], SEEK_SET);
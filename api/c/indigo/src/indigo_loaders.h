@@ -204,6 +204,7 @@ protected:
     std::unique_ptr<Scanner> _own_scanner;
 
     void _advance();
+    bool _indexMappedFile();
 
     CP_DECL;
     TL_CP_DECL(Array<long long>, _offsets);
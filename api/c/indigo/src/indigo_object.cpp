@@ -120,6 +120,7 @@ IndigoObjectTypes::IndigoObjectTypes()
     emplace(IndigoObject::GROSS_REACTION, "<GrossReaction>");
     emplace(IndigoObject::JSON_MOLECULE, "<JsonMolecule>");
     emplace(IndigoObject::JSON_REACTION, "<JsonReaction>");
+    emplace(IndigoObject::FINGERPRINT_MATRIX, "<FingerprintMatrix>");
 
     if (size() != IndigoObject::INDIGO_OBJECT_LAST_TYPE - 1)
     {
@@ -0,0 +1,211 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "indigo_object_table.h"
+
+#include <vector>
+
+#include "indigo_internal.h"
+
+IndigoObjectTable::IndigoObjectTable()
+{
+    for (auto& shard : _shards)
+        for (auto& chunk : shard.chunks)
+            chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+IndigoObjectTable::~IndigoObjectTable()
+{
+    removeAll();
+    for (auto& shard : _shards)
+        for (auto& chunk : shard.chunks)
+            delete[] chunk.load(std::memory_order_relaxed);
+}
+
+int IndigoObjectTable::_threadShard()
+{
+    // Threads are spread over the shards round-robin
+    static std::atomic<int> next_shard(0);
+    static thread_local int shard = next_shard++ % SHARD_COUNT;
+    return shard;
+}
+
+int IndigoObjectTable::_makeHandle(int shard, int slot, unsigned generation)
+{
+    return HANDLE_BASE + (int)((generation << (SHARD_BITS + SLOT_BITS)) | ((unsigned)slot << SHARD_BITS) | (unsigned)shard);
+}
+
+IndigoObjectTable::Slot& IndigoObjectTable::_slotAt(Shard& shard, int slot_index)
+{
+    return shard.chunks[slot_index / CHUNK_SIZE].load(std::memory_order_relaxed)[slot_index % CHUNK_SIZE];
+}
+
+int IndigoObjectTable::_addToShard(int shard_index, IndigoObject* obj)
+{
+    Shard& shard = _shards[shard_index];
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    int slot_index;
+    Slot* slot;
+    if (shard.free_count > FREE_SLOTS_DELAY || (shard.free_count > 0 && shard.slot_count == SHARD_SIZE))
+    {
+        slot_index = shard.free_head;
+        slot = &_slotAt(shard, slot_index);
+        shard.free_head = slot->next_free;
+        if (--shard.free_count == 0)
+            shard.free_tail = -1;
+    }
+    else if (shard.slot_count < SHARD_SIZE)
+    {
+        slot_index = shard.slot_count++;
+        Slot* chunk = shard.chunks[slot_index / CHUNK_SIZE].load(std::memory_order_relaxed);
+        if (chunk == nullptr)
+        {
+            chunk = new Slot[CHUNK_SIZE];
+            shard.chunks[slot_index / CHUNK_SIZE].store(chunk, std::memory_order_release);
+        }
+        slot = &chunk[slot_index % CHUNK_SIZE];
+    }
+    else
+        return -1;
+
+    slot->object.store(obj, std::memory_order_release);
+    shard.object_count++;
+    return _makeHandle(shard_index, slot_index, slot->generation.load(std::memory_order_relaxed));
+}
+
+int IndigoObjectTable::add(IndigoObject* obj)
+{
+    int shard_index = _threadShard();
+    for (int i = 0; i < SHARD_COUNT; i++)
+    {
+        int handle = _addToShard((shard_index + i) % SHARD_COUNT, obj);
+        if (handle != -1)
+            return handle;
+    }
+    throw IndigoError("too many objects: %d objects are alive", count());
+}
+
+const IndigoObjectTable::Slot* IndigoObjectTable::_findSlot(int handle, int& shard, int& slot) const
+{
+    if (handle < HANDLE_BASE || handle >= HANDLE_LIMIT)
+        return nullptr;
+
+    int index = handle - HANDLE_BASE;
+    shard = index & (SHARD_COUNT - 1);
+    slot = (index >> SHARD_BITS) & (SHARD_SIZE - 1);
+    unsigned generation = (unsigned)index >> (SHARD_BITS + SLOT_BITS);
+
+    const Slot* chunk = _shards[shard].chunks[slot / CHUNK_SIZE].load(std::memory_order_acquire);
+    if (chunk == nullptr)
+        return nullptr;
+
+    const Slot& found = chunk[slot % CHUNK_SIZE];
+    if (found.generation.load(std::memory_order_acquire) != generation)
+        return nullptr;
+    return &found;
+}
+
+IndigoObject* IndigoObjectTable::get(int handle) const
+{
+    int shard, slot;
+    const Slot* found = _findSlot(handle, shard, slot);
+    if (found == nullptr)
+        return nullptr;
+    IndigoObject* obj = found->object.load(std::memory_order_acquire);
+
+    // The slot may have been freed and reused after the generation was
+    // checked. Its generation changes before a new object is stored, so the
+    // object read above belongs to the handle if the generation still matches.
+    if (found->generation.load(std::memory_order_acquire) != ((unsigned)(handle - HANDLE_BASE) >> (SHARD_BITS + SLOT_BITS)))
+        return nullptr;
+    return obj;
+}
+
+void IndigoObjectTable::_releaseSlot(Shard& shard, int slot_index, Slot& slot)
+{
+    unsigned generation = (slot.generation.load(std::memory_order_relaxed) + 1) & GENERATION_MASK;
+    slot.generation.store(generation, std::memory_order_release);
+    shard.object_count--;
+
+    slot.next_free = -1;
+    if (shard.free_tail == -1)
+        shard.free_head = slot_index;
+    else
+        _slotAt(shard, shard.free_tail).next_free = slot_index;
+    shard.free_tail = slot_index;
+    shard.free_count++;
+}
+
+bool IndigoObjectTable::remove(int handle)
+{
+    int shard_index, slot_index;
+    if (_findSlot(handle, shard_index, slot_index) == nullptr)
+        return false;
+
+    Shard& shard = _shards[shard_index];
+    IndigoObject* obj;
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        // Checked again under the lock in case another thread has removed it
+        if (_findSlot(handle, shard_index, slot_index) == nullptr)
+            return false;
+        Slot& slot = _slotAt(shard, slot_index);
+        obj = slot.object.exchange(nullptr);
+        if (obj == nullptr)
+            return false;
+        _releaseSlot(shard, slot_index, slot);
+    }
+
+    // Objects are deleted outside of the lock: destructors may free other handles
+    delete obj;
+    return true;
+}
+
+void IndigoObjectTable::removeAll()
+{
+    std::vector<IndigoObject*> objects;
+    for (auto& shard : _shards)
+    {
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            for (int i = 0; i < shard.slot_count; i++)
+            {
+                Slot& slot = _slotAt(shard, i);
+                IndigoObject* obj = slot.object.exchange(nullptr);
+                if (obj == nullptr)
+                    continue;
+                _releaseSlot(shard, i, slot);
+                objects.push_back(obj);
+            }
+        }
+
+        for (IndigoObject* obj : objects)
+            delete obj;
+        objects.clear();
+    }
+}
+
+int IndigoObjectTable::count() const
+{
+    int result = 0;
+    for (auto& shard : _shards)
+        result += shard.object_count.load(std::memory_order_relaxed);
+    return result;
+}
@@ -0,0 +1,109 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __indigo_object_table__
+#define __indigo_object_table__
+
+#include <atomic>
+#include <mutex>
+
+#include "base_c/defs.h"
+
+class IndigoObject;
+
+// Handle table of the objects of a session. Each thread adds objects to its
+// own shard, so allocations from different threads do not contend, and
+// lookups take no lock at all. A handle holds the shard, the slot and the
+// slot generation, which changes when the object is removed: a freed or
+// reused handle is reported as invalid instead of reaching another object.
+// Generations wrap around, so a stale handle could match again after its slot
+// has been reused 256 times. Freed slots are reused in order and only once
+// more than 1024 of them are waiting, which keeps that window at several
+// hundred thousand frees in the shard. Objects that do not fit in the shard
+// of a thread go to the other shards.
+class DLLEXPORT IndigoObjectTable
+{
+public:
+    IndigoObjectTable();
+    ~IndigoObjectTable();
+
+    // Takes ownership of the object
+    int add(IndigoObject* obj);
+
+    // Returns nullptr for unknown and freed handles
+    IndigoObject* get(int handle) const;
+
+    // Deletes the object, returns false for unknown and freed handles
+    bool remove(int handle);
+
+    void removeAll();
+    int count() const;
+
+private:
+    enum
+    {
+        // Handles start at 1000 as they always did
+        HANDLE_BASE = 1000,
+        SHARD_BITS = 4,
+        SLOT_BITS = 18,
+        GENERATION_BITS = 8,
+        GENERATION_MASK = (1 << GENERATION_BITS) - 1,
+        HANDLE_LIMIT = HANDLE_BASE + (1 << (SHARD_BITS + SLOT_BITS + GENERATION_BITS)),
+        SHARD_COUNT = 1 << SHARD_BITS,
+        SHARD_SIZE = 1 << SLOT_BITS,
+        // Freed slots wait in the free list until there are more of them than this
+        FREE_SLOTS_DELAY = 1024,
+        CHUNK_SIZE = 1024,
+        MAX_CHUNKS = SHARD_SIZE / CHUNK_SIZE
+    };
+
+    struct Slot
+    {
+        std::atomic<IndigoObject*> object{nullptr};
+        std::atomic<unsigned> generation{0};
+        int next_free = -1;
+    };
+
+    struct Shard
+    {
+        std::mutex lock;
+        // Slot chunks never move, so lookups can read them without locking
+        std::atomic<Slot*> chunks[MAX_CHUNKS];
+        int slot_count = 0;
+        // Freed slots, oldest first
+        int free_head = -1;
+        int free_tail = -1;
+        int free_count = 0;
+        std::atomic<int> object_count{0};
+    };
+
+    static int _threadShard();
+    static int _makeHandle(int shard, int slot, unsigned generation);
+    const Slot* _findSlot(int handle, int& shard, int& slot) const;
+    static void _releaseSlot(Shard& shard, int slot_index, Slot& slot);
+    static Slot& _slotAt(Shard& shard, int slot_index);
+
+    int _addToShard(int shard_index, IndigoObject* obj);
+
+    Shard _shards[SHARD_COUNT];
+
+    // no implicit copy
+    IndigoObjectTable(const IndigoObjectTable&);
+};
+
+#endif
@@ -18,6 +18,13 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <base_cpp/hash128.h>
 #include <molecule/molecule_mass.h>
 
 #include <indigo-renderer.h>
@@ -265,6 +272,60 @@ TEST_F(IndigoApiBasicTest, submolecule_test_layout)
     }
 }
 
+TEST_F(IndigoApiBasicTest, layout_array)
+{
+    auto coordinates = [](int mol) {
+        std::vector<float> xyz;
+        int atoms = indigoIterateAtoms(mol);
+        int atom;
+        while ((atom = indigoNext(atoms)) != 0)
+        {
+            float* p = indigoXYZ(atom);
+            xyz.push_back(p[0]);
+            xyz.push_back(p[1]);
+            indigoFree(atom);
+        }
+        indigoFree(atoms);
+        return xyz;
+    };
+
+    const char* smiles[] = {"CCO.c1ccccc1.OC(=O)C1CCCCC1", "C1CCCCCCCCCCCC1.CN.[Na+].[Cl-]", "CC(=O)Oc1ccccc1C(=O)O"};
+    int array = indigoCreateArray();
+    std::vector<int> expected;
+    for (const char* s : smiles)
+    {
+        int mol = indigoLoadMoleculeFromString(s);
+        indigoArrayAdd(array, mol);
+        indigoLayout(mol);
+        expected.push_back(mol);
+    }
+    int rxn = indigoLoadReactionFromString("CCO>>CC=O");
+    indigoArrayAdd(array, rxn);
+    indigoFree(rxn);
+
+    // Array molecules are laid out in worker threads the way they are one by one
+    indigoSetOptionInt("layout-thread-count", 2);
+    ASSERT_EQ(0, indigoLayout(array));
+    for (int i = 0; i < (int)expected.size(); i++)
+    {
+        int mol = indigoAt(array, i);
+        EXPECT_EQ(coordinates(expected[i]), coordinates(mol)) << smiles[i];
+        indigoFree(mol);
+        indigoFree(expected[i]);
+    }
+
+    int atom = indigoLoadMoleculeFromString("C");
+    int bad = indigoCreateArray();
+    indigoArrayAdd(bad, atom);
+    int atom_obj = indigoGetAtom(atom, 0);
+    indigoArrayAdd(bad, atom_obj);
+    EXPECT_ANY_THROW(indigoLayout(bad));
+    indigoFree(atom_obj);
+    indigoFree(atom);
+    indigoFree(bad);
+    indigoFree(array);
+}
+
 TEST_F(IndigoApiBasicTest, submolecule_test_general)
 {
     try
@@ -293,3 +354,251 @@ TEST_F(IndigoApiBasicTest, submolecule_test_general)
         ASSERT_STREQ("", e.message());
     }
 }
+
+TEST_F(IndigoApiBasicTest, object_handles)
+{
+    int references = indigoCountReferences();
+    int mol = indigoLoadMoleculeFromString("CCO");
+    ASSERT_EQ(references + 1, indigoCountReferences());
+    indigoFree(mol);
+    ASSERT_EQ(references, indigoCountReferences());
+
+    // A freed handle stays invalid after its slot is reused
+    int other = indigoLoadMoleculeFromString("CCN");
+    ASSERT_NE(mol, other);
+    ASSERT_THROW(indigoCanonicalSmiles(mol), Exception);
+    ASSERT_THROW(indigoCanonicalSmiles(-1), Exception);
+    ASSERT_STREQ("CCN", indigoCanonicalSmiles(other));
+
+    // Threads of one session allocate and free handles concurrently
+    const int thread_count = 4;
+    const int objects_per_thread = 1000;
+    std::vector<std::vector<int>> handles(thread_count);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++)
+        threads.emplace_back([this, &handles, t]() {
+            indigoSetSessionId(session);
+            for (int i = 0; i < objects_per_thread; i++)
+            {
+                handles[t].push_back(indigoLoadMoleculeFromString("C"));
+                if (i % 2 == 1)
+                    indigoFree(handles[t][i - 1]);
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    ASSERT_EQ(references + 1 + thread_count * objects_per_thread / 2, indigoCountReferences());
+    for (int t = 0; t < thread_count; t++)
+        for (int i = 1; i < objects_per_thread; i += 2)
+            ASSERT_EQ(1, indigoCountAtoms(handles[t][i]));
+
+    indigoFreeAllObjects();
+    ASSERT_EQ(0, indigoCountReferences());
+    ASSERT_THROW(indigoCountAtoms(handles[0][1]), Exception);
+
+    // Handles start at 1000, and a handle freed long ago never reaches a new object
+    int stale = indigoLoadMoleculeFromString("C");
+    ASSERT_GE(stale, 1000);
+    indigoFree(stale);
+    for (int i = 0; i < 10000; i++)
+    {
+        int mol = indigoLoadMoleculeFromString("C");
+        ASSERT_NE(stale, mol);
+        indigoFree(mol);
+    }
+    ASSERT_THROW(indigoCountAtoms(stale), Exception);
+
+    // Handles are never used up: slot generations wrap around after 256 reuses
+    for (int i = 0; i < 300000; i++)
+    {
+        int mol = indigoLoadMoleculeFromString("C");
+        ASSERT_EQ(1, indigoCountAtoms(mol));
+        indigoFree(mol);
+    }
+    ASSERT_EQ(0, indigoCountReferences());
+
+    // One thread may hold many objects at once
+    std::vector<int> many;
+    for (int i = 0; i < 20000; i++)
+        many.push_back(indigoLoadMoleculeFromString("C"));
+    ASSERT_EQ(20000, indigoCountReferences());
+    ASSERT_EQ(1, indigoCountAtoms(many.back()));
+    indigoFree(many.back());
+    ASSERT_THROW(indigoCountAtoms(many.back()), Exception);
+    indigoFreeAllObjects();
+    ASSERT_EQ(0, indigoCountReferences());
+}
+
+TEST_F(IndigoApiBasicTest, canonical_smiles_batch)
+{
+    auto split = [](const std::string& text) {
+        std::vector<std::vector<std::string>> rows;
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            std::vector<std::string> fields;
+            size_t pos = 0, tab;
+            while ((tab = line.find('\t', pos)) != std::string::npos)
+            {
+                fields.push_back(line.substr(pos, tab - pos));
+                pos = tab + 1;
+            }
+            fields.push_back(line.substr(pos));
+            rows.push_back(fields);
+        }
+        return rows;
+    };
+
+    auto run = [](int source, const char* options) {
+        int output = indigoWriteBuffer();
+        int count = indigoCanonicalSmilesBatch(source, output, options);
+        std::string text = indigoToString(output);
+        indigoFree(output);
+        EXPECT_EQ(count, (int)std::count(text.begin(), text.end(), '\n'));
+        return text;
+    };
+
+    // Records 0 and 2 are the same structure written differently
+    const char* smiles[] = {"OCc1ccccc1", "C1CCNCC1C(=O)O", "c1ccccc1CO", "C1CC", "CC(C)Cc1ccc(cc1)C(C)C(=O)O"};
+    std::string smiles_list;
+    int array = indigoCreateArray();
+    for (const char* s : smiles)
+    {
+        smiles_list += std::string(s) + "\n";
+        if (std::string(s) != "C1CC")
+        {
+            int mol = indigoLoadMoleculeFromString(s);
+            indigoArrayAdd(array, mol);
+            indigoFree(mol);
+        }
+    }
+
+    int reader = indigoLoadString(smiles_list.c_str());
+    int iterator = indigoIterateSmiles(reader);
+    std::string serial = run(iterator, "threads:1");
+    indigoFree(iterator);
+
+    auto rows = split(serial);
+    ASSERT_EQ(5, (int)rows.size());
+    EXPECT_EQ(rows[0], rows[2]);
+    EXPECT_NE(rows[0][1], rows[1][1]);
+    EXPECT_EQ(32, (int)rows[0][1].size());
+    // The broken record keeps its line, with the error in the third field
+    ASSERT_EQ(3, (int)rows[3].size());
+    EXPECT_TRUE(rows[3][0].empty() && rows[3][1].empty() && !rows[3][2].empty());
+
+    Array<char> hex;
+    Hash128::get(rows[1][0].c_str()).appendHex(hex);
+    hex.push(0);
+    EXPECT_STREQ(hex.ptr(), rows[1][1].c_str());
+
+    // Parallel canonicalization keeps the input order
+    indigoFree(reader);
+    reader = indigoLoadString(smiles_list.c_str());
+    iterator = indigoIterateSmiles(reader);
+    EXPECT_EQ(serial, run(iterator, "threads:4"));
+    indigoFree(iterator);
+
+    // Arrays are accepted as well, records match indigoCanonicalSmiles
+    auto array_rows = split(run(array, "threads:3;hash:64"));
+    ASSERT_EQ(4, (int)array_rows.size());
+    for (int i = 0; i < 4; i++)
+    {
+        int item = indigoAt(array, i);
+        EXPECT_EQ(std::string(indigoCanonicalSmiles(item)), array_rows[i][0]);
+        indigoFree(item);
+        const auto& row = rows[i < 3 ? i : 4];
+        EXPECT_EQ(row[1].substr(0, 16), array_rows[i][1]);
+    }
+    EXPECT_EQ(1, (int)split(run(array, "hash:0"))[0].size());
+
+    EXPECT_THROW(run(array, "threads:-1"), Exception);
+    EXPECT_THROW(run(array, "hash:32"), Exception);
+    EXPECT_THROW(run(array, "unknown:1"), Exception);
+    EXPECT_THROW(run(array, "threads:abc"), Exception);
+    EXPECT_THROW(run(array, "threads:2x"), Exception);
+    EXPECT_THROW(run(array, "hash:"), Exception);
+
+    // Error messages quoting the input can not break the record into fields
+    const char* molfile = "\n  test\n\n  0  0  0  0  0  0  0  0  0  0999 V3000\n"
+                          "M  V30 BEGIN CTAB\nM  V30 COUNTS 1 0 0 0 0\nM  V30 BEGIN ATOM\nM  V30 1 C 0 0 0 0\nM  V30 END ATOM\n"
+                          "M  V30 BAD\tLINE\nM  V30 END CTAB\nM  END\n$$$$\n";
+    int sdf_reader = indigoLoadString(molfile);
+    iterator = indigoIterateSDF(sdf_reader);
+    auto error_rows = split(run(iterator, "threads:1"));
+    ASSERT_EQ(1, (int)error_rows.size());
+    ASSERT_EQ(3, (int)error_rows[0].size());
+    EXPECT_NE(std::string::npos, error_rows[0][2].find("BAD LINE"));
+    indigoFree(iterator);
+    indigoFree(sdf_reader);
+
+    indigoFree(reader);
+    indigoFree(array);
+}
+
+TEST_F(IndigoApiBasicTest, decomposition_parallel)
+{
+    const char* smiles[] = {"Cc1ccc(O)cc1N", "Clc1ccc(Br)cc1", "OCc1ccccc1C(=O)O", "c1ccccc1", "Nc1ccc(cc1)-c1ccccc1F", "CCc1cc(C)ccc1OC", "Oc1ccccc1"};
+    std::string lines;
+    for (auto s : smiles)
+        lines += std::string(s) + "\n";
+
+    auto decompose = [&](bool iterator) {
+        int scaffold = indigoLoadQueryMoleculeFromString("c1ccccc1");
+        int structures, reader = -1;
+        if (iterator)
+        {
+            reader = indigoLoadString(lines.c_str());
+            structures = indigoIterateSmiles(reader);
+        }
+        else
+        {
+            structures = indigoCreateArray();
+            for (auto s : smiles)
+            {
+                int mol = indigoLoadMoleculeFromString(s);
+                indigoArrayAdd(structures, mol);
+                indigoFree(mol);
+            }
+        }
+        int deco = indigoDecomposeMolecules(scaffold, structures);
+
+        int full_scaffold = indigoDecomposedMoleculeScaffold(deco);
+        std::vector<std::string> result = {indigoSmiles(full_scaffold)};
+        indigoFree(full_scaffold);
+        int items = indigoIterateDecomposedMolecules(deco);
+        int item;
+        while ((item = indigoNext(items)))
+        {
+            int mol = indigoDecomposedMoleculeWithRGroups(item);
+            result.push_back(indigoSmiles(mol));
+            indigoFree(mol);
+            indigoFree(item);
+        }
+        indigoFree(items);
+        indigoFree(deco);
+        indigoFree(structures);
+        if (reader >= 0)
+            indigoFree(reader);
+        indigoFree(scaffold);
+        return result;
+    };
+
+    try
+    {
+        std::vector<std::string> expected = decompose(false);
+        ASSERT_EQ(sizeof(smiles) / sizeof(smiles[0]) + 1, expected.size());
+
+        // R-groups are numbered in the order of the molecules with any thread count
+        indigoSetOptionInt("deco-thread-count", 4);
+        EXPECT_EQ(expected, decompose(false));
+        EXPECT_EQ(expected, decompose(true));
+        indigoSetOptionInt("deco-thread-count", 1);
+    }
+    catch (Exception& e)
+    {
+        ASSERT_STREQ("", e.message());
+    }
+}
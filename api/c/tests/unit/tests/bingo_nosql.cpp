@@ -16,7 +16,10 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <algorithm>
 #include <functional>
+#include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -85,3 +88,224 @@ TEST_F(BingoNosqlTest, multiple_instances_same_name)
         bingoCloseDatabase(db_id);
     }
 }
+
+TEST_F(BingoNosqlTest, parallel_search_matches_serial)
+{
+    int db = bingoCreateDatabaseFile(::testing::UnitTest::GetInstance()->current_test_info()->name(), "molecule", "");
+
+    const char* fragments[] = {"C1CCCCC1", "c1ccccc1", "N", "O", "C(=O)", "C(Cl)", "C1CCNCC1"};
+    // More records than the small base size, so similarity search walks the fingerprint table
+    for (int i = 0; i < 12000; i++)
+    {
+        std::string smiles = "C";
+        for (int k = 0; k < 1 + i % 9; k++)
+            smiles += "C";
+        smiles += fragments[i % 7];
+        smiles += fragments[(i / 7) % 7];
+        int obj = indigoLoadMoleculeFromString(smiles.c_str());
+        bingoInsertRecordObj(db, obj);
+        indigoFree(obj);
+    }
+    bingoOptimize(db);
+
+    auto collect = [](int search) {
+        std::vector<int> ids;
+        while (bingoNext(search))
+            ids.push_back(bingoGetCurrentId(search));
+        bingoEndSearch(search);
+        return ids;
+    };
+
+    int sub_query = indigoLoadQueryMoleculeFromString("C1CCNCC1");
+    int sim_query = indigoLoadMoleculeFromString("CCCCc1ccccc1Cl");
+
+    std::vector<int> sub_serial = collect(bingoSearchSub(db, sub_query, ""));
+    std::vector<int> sim_serial = collect(bingoSearchSim(db, sim_query, 0.4f, 1.0f, ""));
+    EXPECT_FALSE(sub_serial.empty());
+    EXPECT_FALSE(sim_serial.empty());
+
+    for (const char* options : {"threads:1", "threads:4", "threads:0"})
+    {
+        EXPECT_EQ(sub_serial, collect(bingoSearchSub(db, sub_query, options)));
+        EXPECT_EQ(sim_serial, collect(bingoSearchSim(db, sim_query, 0.4f, 1.0f, options)));
+    }
+
+    EXPECT_ANY_THROW(bingoSearchSub(db, sub_query, "threads:-1"));
+    EXPECT_ANY_THROW(bingoSearchSub(db, sub_query, "threads:4abc"));
+
+    indigoFree(sub_query);
+    indigoFree(sim_query);
+    bingoCloseDatabase(db);
+}
+
+TEST_F(BingoNosqlTest, insert_batch_matches_serial_insert)
+{
+    const std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    int db_serial = bingoCreateDatabaseFile((name + "_serial").c_str(), "molecule", "");
+    int db_batch = bingoCreateDatabaseFile((name + "_batch").c_str(), "molecule", "");
+
+    const char* fragments[] = {"C1CCCCC1", "c1ccccc1", "N", "O", "C(=O)", "C(Cl)", "C1CCNCC1"};
+    std::string smiles_list;
+    for (int i = 0; i < 300; i++)
+    {
+        std::string smiles = "C";
+        for (int k = 0; k < 1 + i % 5; k++)
+            smiles += "C";
+        smiles += fragments[i % 7];
+        smiles += fragments[(i / 7) % 7];
+        smiles_list += smiles + "\n";
+
+        int obj = indigoLoadMoleculeFromString(smiles.c_str());
+        bingoInsertRecordObj(db_serial, obj);
+        indigoFree(obj);
+    }
+    // Broken records are skipped
+    smiles_list += "C1CC\n";
+
+    int reader = indigoLoadString(smiles_list.c_str());
+    int iterator = indigoIterateSmiles(reader);
+    EXPECT_EQ(300, bingoInsertBatch(db_batch, iterator, "threads:4"));
+    indigoFree(iterator);
+    indigoFree(reader);
+
+    auto collect = [](int search) {
+        std::vector<int> ids;
+        while (bingoNext(search))
+            ids.push_back(bingoGetCurrentId(search));
+        bingoEndSearch(search);
+        return ids;
+    };
+
+    int sub_query = indigoLoadQueryMoleculeFromString("C1CCNCC1");
+    int exact_query = indigoLoadMoleculeFromString("CCCC1CCNCC1N");
+    std::vector<int> sub_serial = collect(bingoSearchSub(db_serial, sub_query, ""));
+    EXPECT_FALSE(sub_serial.empty());
+    EXPECT_EQ(sub_serial, collect(bingoSearchSub(db_batch, sub_query, "")));
+    EXPECT_EQ(collect(bingoSearchExact(db_serial, exact_query, "")), collect(bingoSearchExact(db_batch, exact_query, "")));
+
+    EXPECT_ANY_THROW(bingoInsertBatch(db_batch, sub_query, "threads:-1"));
+    EXPECT_ANY_THROW(bingoInsertBatch(db_batch, sub_query, "threads:abc"));
+    EXPECT_ANY_THROW(bingoInsertBatch(db_batch, sub_query, "threads:2x"));
+    EXPECT_ANY_THROW(bingoInsertBatch(db_batch, sub_query, "report:"));
+
+    indigoFree(sub_query);
+    indigoFree(exact_query);
+    bingoCloseDatabase(db_serial);
+    bingoCloseDatabase(db_batch);
+}
+
+TEST_F(BingoNosqlTest, molecule_cache_matches_uncached)
+{
+    const std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    int db_plain = bingoCreateDatabaseFile((name + "_plain").c_str(), "molecule", "");
+    int db_cached = bingoCreateDatabaseFile((name + "_cached").c_str(), "molecule", "mol_cache_size:16");
+
+    const char* fragments[] = {"C1CCCCC1", "c1ccccc1", "N", "O", "C(=O)", "C(Cl)", "C1CCNCC1"};
+    for (int i = 0; i < 200; i++)
+    {
+        std::string smiles = "C";
+        for (int k = 0; k < 1 + i % 5; k++)
+            smiles += "C";
+        smiles += fragments[i % 7];
+        smiles += fragments[(i / 7) % 7];
+
+        int obj = indigoLoadMoleculeFromString(smiles.c_str());
+        bingoInsertRecordObjWithId(db_plain, obj, i);
+        bingoInsertRecordObjWithId(db_cached, obj, i);
+        indigoFree(obj);
+    }
+
+    auto collect = [](int search) {
+        std::vector<int> ids;
+        while (bingoNext(search))
+            ids.push_back(bingoGetCurrentId(search));
+        bingoEndSearch(search);
+        return ids;
+    };
+
+    int sub_query = indigoLoadQueryMoleculeFromString("C1CCNCC1");
+    int exact_query = indigoLoadMoleculeFromString("CCCC1CCNCC1N");
+    std::vector<int> sub_plain = collect(bingoSearchSub(db_plain, sub_query, ""));
+    std::vector<int> exact_plain = collect(bingoSearchExact(db_plain, exact_query, ""));
+    EXPECT_FALSE(sub_plain.empty());
+
+    // The second pass is served from the cache
+    for (int pass = 0; pass < 2; pass++)
+    {
+        EXPECT_EQ(sub_plain, collect(bingoSearchSub(db_cached, sub_query, "")));
+        EXPECT_EQ(exact_plain, collect(bingoSearchExact(db_cached, exact_query, "")));
+    }
+
+    // Loading similarity results neither reads nor fills the cache
+    qword hits = indigoDbgProfilingGetCounter("mol_cache_hits", 1);
+    qword misses = indigoDbgProfilingGetCounter("mol_cache_misses", 1);
+    EXPECT_GT(hits, 0);
+    EXPECT_FALSE(collect(bingoSearchSim(db_cached, exact_query, 0.3f, 1.0f, "")).empty());
+    EXPECT_EQ(hits, indigoDbgProfilingGetCounter("mol_cache_hits", 1));
+    EXPECT_EQ(misses, indigoDbgProfilingGetCounter("mol_cache_misses", 1));
+
+    // Removed records are not returned from the cache
+    bingoDeleteRecord(db_plain, sub_plain.front());
+    bingoDeleteRecord(db_cached, sub_plain.front());
+    EXPECT_EQ(collect(bingoSearchSub(db_plain, sub_query, "")), collect(bingoSearchSub(db_cached, sub_query, "")));
+
+    EXPECT_ANY_THROW(bingoCreateDatabaseFile((name + "_invalid").c_str(), "molecule", "mol_cache_size:abc"));
+
+    indigoFree(sub_query);
+    indigoFree(exact_query);
+    bingoCloseDatabase(db_plain);
+    bingoCloseDatabase(db_cached);
+}
+
+TEST_F(BingoNosqlTest, canonical_exact_hash)
+{
+    const std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    int db_plain = bingoCreateDatabaseFile((name + "_plain").c_str(), "molecule", "");
+    int db_canonical = bingoCreateDatabaseFile((name + "_canonical").c_str(), "molecule", "exact_hash:canonical");
+
+    const char* smiles[] = {"C[C@H](N)C(=O)O", "C[C@@H](N)C(=O)O", "CC(N)C(=O)O",   "CC(N)C(=O)[O-]", "[13CH3]C(N)C(=O)O",
+                            "F/C=C/Cl",        "F/C=C\\Cl",        "FC=CCl",        "Oc1ccccc1",      "O=C1C=CC=CC1"};
+    for (int i = 0; i < (int)(sizeof(smiles) / sizeof(smiles[0])); i++)
+    {
+        int obj = indigoLoadMoleculeFromString(smiles[i]);
+        bingoInsertRecordObjWithId(db_plain, obj, i);
+        bingoInsertRecordObjWithId(db_canonical, obj, i);
+        indigoFree(obj);
+    }
+
+    auto collect = [](int search) {
+        std::vector<int> ids;
+        while (bingoNext(search))
+            ids.push_back(bingoGetCurrentId(search));
+        bingoEndSearch(search);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    // Queries are written in another atom order than the records
+    const char* queries[] = {"OC(=O)[C@@H](N)C", "NC(C)C(O)=O", "Cl/C=C/F", "c1ccccc1O"};
+    const char* options[] = {"", "ALL", "ALL -STE", "TAU"};
+    for (auto query_smiles : queries)
+    {
+        int query = indigoLoadMoleculeFromString(query_smiles);
+        for (auto search_options : options)
+        {
+            std::vector<int> plain = collect(bingoSearchExact(db_plain, query, search_options));
+            EXPECT_EQ(plain, collect(bingoSearchExact(db_canonical, query, search_options))) << query_smiles << " " << search_options;
+        }
+        EXPECT_EQ(1, collect(bingoSearchExact(db_canonical, query, "ALL")).size()) << query_smiles;
+        indigoFree(query);
+    }
+
+    // The hash type is kept in the database properties
+    bingoCloseDatabase(db_canonical);
+    db_canonical = bingoLoadDatabaseFile((name + "_canonical").c_str(), "");
+    int query = indigoLoadMoleculeFromString("OC(=O)[C@@H](N)C");
+    EXPECT_EQ(collect(bingoSearchExact(db_plain, query, "ALL")), collect(bingoSearchExact(db_canonical, query, "ALL")));
+    indigoFree(query);
+
+    EXPECT_ANY_THROW(bingoCreateDatabaseFile((name + "_invalid").c_str(), "molecule", "exact_hash:inchi"));
+
+    bingoCloseDatabase(db_plain);
+    bingoCloseDatabase(db_canonical);
+}
@@ -16,6 +16,7 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <string>
 #include <thread>
 
 #include <gtest/gtest.h>
@@ -135,3 +136,109 @@ TEST_F(IndigoApiRendererTest, render_superatoms)
         thread.join();
     }
 }
+
+TEST_F(IndigoApiRendererTest, render_batch)
+{
+    const char* smiles[] = {"CC(=O)Oc1ccccc1C(=O)O", "CN1C=NC2=C1C(=O)N(C(=O)N2C)C", "CC(C)Cc1ccc(cc1)C(C)C(=O)O", "NC(=O)N1c2ccccc2C=Cc3ccccc13",
+                            "C1OCCOCCOCCOCCOCCOCCOCCOCCOCCOC1"};
+    const int count = sizeof(smiles) / sizeof(smiles[0]);
+
+    try
+    {
+        indigoSetOptionXY("render-image-size", 300, 300);
+        indigoSetOption("render-output-format", "png");
+        indigoSetOptionInt("render-thread-count", 4);
+
+        int array = indigoCreateArray();
+        int outputs[count];
+        for (int i = 0; i < count; i++)
+        {
+            int m = indigoLoadMoleculeFromString(smiles[i]);
+            indigoSetProperty(m, "name", smiles[i]);
+            indigoArrayAdd(array, m);
+            indigoFree(m);
+            outputs[i] = indigoWriteBuffer();
+        }
+        ASSERT_EQ(count, indigoRenderBatch(array, outputs));
+
+        for (int i = 0; i < count; i++)
+        {
+            int m = indigoLoadMoleculeFromString(smiles[i]);
+            int buf = indigoWriteBuffer();
+            indigoRender(m, buf);
+
+            char *expected, *actual;
+            int expected_size, actual_size;
+            indigoToBuffer(buf, &expected, &expected_size);
+            indigoToBuffer(outputs[i], &actual, &actual_size);
+            ASSERT_EQ(std::string(expected, expected_size), std::string(actual, actual_size));
+            indigoFree(buf);
+            indigoFree(m);
+        }
+
+        // Grids drawn on worker threads match the serial ones
+        indigoSetOptionXY("render-image-size", -1, -1);
+        indigoSetOption("render-grid-title-property", "name");
+        const char* formats[] = {"png", "svg"};
+        for (auto format : formats)
+        {
+            indigoSetOption("render-output-format", format);
+            std::string grids[2];
+            const int thread_counts[] = {1, 4};
+            for (int k = 0; k < 2; k++)
+            {
+                indigoSetOptionInt("render-thread-count", thread_counts[k]);
+                int buf = indigoWriteBuffer();
+                ASSERT_EQ(1, indigoRenderGrid(array, nullptr, 2, buf));
+                char* data;
+                int size;
+                indigoToBuffer(buf, &data, &size);
+                ASSERT_GT(size, 0);
+                grids[k].assign(data, size);
+                indigoFree(buf);
+            }
+            ASSERT_EQ(grids[0], grids[1]) << format;
+        }
+        indigoSetOptionInt("render-thread-count", 1);
+
+        for (int i = 0; i < count; i++)
+            indigoFree(outputs[i]);
+        indigoFree(array);
+    }
+    catch (Exception& e)
+    {
+        ASSERT_STREQ("", e.message());
+    }
+}
+
+TEST_F(IndigoApiRendererTest, text_extents_cache)
+{
+    try
+    {
+        indigoSetOptionXY("render-image-size", 300, 300);
+        indigoSetOption("render-output-format", "png");
+
+        int m = indigoLoadMoleculeFromString("OC(=O)C[NH3+].[O-]S(=O)(=O)c1ccc(Cl)cc1");
+        std::string images[2];
+        indigoDbgResetProfiling(0);
+        for (auto& image : images)
+        {
+            int buf = indigoWriteBuffer();
+            indigoRender(m, buf);
+            char* data;
+            int size;
+            indigoToBuffer(buf, &data, &size);
+            image.assign(data, size);
+            indigoFree(buf);
+        }
+        indigoFree(m);
+
+        // Labels repeat within a render and all of them repeat in the second one
+        ASSERT_EQ(images[0], images[1]);
+        ASSERT_GT(indigoDbgProfilingGetCounter("render.text_extents_cache_hits", 0), indigoDbgProfilingGetCounter("render.text_extents_cache_misses", 0));
+    }
+    catch (Exception& e)
+    {
+        ASSERT_STREQ("", e.message());
+    }
+}
@@ -18,6 +18,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include <indigo_internal.h>
 
 #include "common.h"
@@ -220,3 +222,90 @@ TEST_F(IndigoSimilarityTest, similarity_sim_ECFP8_mode)
     EXPECT_GT(0.99, indigoSimilarity(f1, f2, "tanimoto"));
     EXPECT_EQ(1.00, indigoSimilarity(f2, f3, "tanimoto"));
 }
+
+TEST_F(IndigoSimilarityTest, similarity_matrix)
+{
+    const int mols[] = {m1, m2, m3, m4};
+    const int count = 4;
+
+    int array = indigoCreateArray();
+    int fingerprints = indigoCreateArray();
+    for (int mol : mols)
+    {
+        indigoArrayAdd(array, mol);
+        int fp = indigoFingerprint(mol, "sim");
+        indigoArrayAdd(fingerprints, fp);
+        indigoFree(fp);
+    }
+    int matrix = indigoFingerprintMatrix(array, "sim");
+    ASSERT_EQ(count, indigoCount(matrix));
+
+    // Packed fingerprints are the same as the ones of the molecules
+    int fp_matrix = indigoFingerprintMatrix(fingerprints, nullptr);
+    int size1, size2;
+    char *buf1, *buf2;
+    indigoToBuffer(matrix, &buf1, &size1);
+    std::vector<char> packed(buf1, buf1 + size1);
+    indigoToBuffer(fp_matrix, &buf2, &size2);
+    EXPECT_EQ(packed, std::vector<char>(buf2, buf2 + size2));
+    indigoFree(fp_matrix);
+    indigoFree(fingerprints);
+
+    // Rows and columns may be the same matrix, values match indigoSimilarity()
+    for (const char* metrics : {"tanimoto", "tversky 0.3 0.7", "euclid-sub"})
+    {
+        float similarities[count * count];
+        ASSERT_EQ(count, indigoSimilarityMatrix(matrix, matrix, metrics, "threads:2", similarities));
+        for (int i = 0; i < count; i++)
+        {
+            int fp1 = indigoFingerprint(mols[i], "sim");
+            for (int j = 0; j < count; j++)
+            {
+                int fp2 = indigoFingerprint(mols[j], "sim");
+                EXPECT_EQ(indigoSimilarity(fp1, fp2, metrics), similarities[i * count + j]) << metrics;
+                indigoFree(fp2);
+            }
+            indigoFree(fp1);
+        }
+    }
+
+    float similarities[count * count];
+    indigoSimilarityMatrix(matrix, matrix, nullptr, nullptr, similarities);
+
+    int pair_count = indigoSimilarityMatrixSparse(matrix, matrix, "tanimoto", nullptr, 0.85f, 0, nullptr, nullptr, nullptr);
+    int expected_pairs = 0;
+    for (float sim : similarities)
+        if (sim >= 0.85f)
+            expected_pairs++;
+    ASSERT_EQ(expected_pairs, pair_count);
+    std::vector<int> rows(pair_count), columns(pair_count);
+    std::vector<float> pair_similarities(pair_count);
+    indigoSimilarityMatrixSparse(matrix, matrix, "tanimoto", nullptr, 0.85f, pair_count, rows.data(), columns.data(), pair_similarities.data());
+    for (int i = 0; i < pair_count; i++)
+        EXPECT_EQ(similarities[rows[i] * count + columns[i]], pair_similarities[i]);
+
+    // m2 and m3 are the same structure, each is the best match of the other after itself
+    int neighbors[count * 2];
+    float top_similarities[count * 2];
+    indigoSimilarityTopK(matrix, matrix, "tanimoto", "threads:1", 2, neighbors, top_similarities);
+    EXPECT_EQ(1, neighbors[2]);
+    EXPECT_EQ(2, neighbors[3]);
+    EXPECT_EQ(1, neighbors[4]);
+    EXPECT_EQ(2, neighbors[5]);
+    EXPECT_EQ(1.f, top_similarities[3]);
+
+    const byte short_fp[] = {1, 2, 3};
+    int fp = indigoLoadFingerprintFromBuffer(short_fp, 3);
+    int wrong_size = indigoCreateArray();
+    indigoArrayAdd(wrong_size, fp);
+    indigoArrayAdd(wrong_size, m1);
+    EXPECT_ANY_THROW(indigoFingerprintMatrix(wrong_size, "sim"));
+    EXPECT_ANY_THROW(indigoSimilarityMatrix(matrix, matrix, nullptr, "threads:abc", similarities));
+    EXPECT_ANY_THROW(indigoSimilarityMatrix(matrix, matrix, nullptr, "threads:1.5", similarities));
+    EXPECT_ANY_THROW(indigoSimilarityTopK(matrix, matrix, "tanimoto", "threads:", 2, neighbors, top_similarities));
+
+    indigoFree(wrong_size);
+    indigoFree(fp);
+    indigoFree(matrix);
+    indigoFree(array);
+}
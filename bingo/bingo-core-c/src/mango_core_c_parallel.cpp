@@ -43,6 +43,9 @@ indigo::BingoIndex& MangoIndexingCommandResult::getIndex(int index)
 //
 // MangoIndexingDispatcher
 //
+// Results are handled in completion order: the Postgres build engines store each
+// result into the structure cache slot given by its record index and insert the
+// caches in order afterwards, so they do not need the ordered result pipeline.
 MangoIndexingDispatcher::MangoIndexingDispatcher(BingoCore& core) : IndexingDispatcher(core, HANDLING_ORDER_ANY, true, 30)
 {
 }
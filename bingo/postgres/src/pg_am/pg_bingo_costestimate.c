@@ -9,10 +9,27 @@
 #include <optimizer/predtest.h>
 #endif
 
+#if PG_VERSION_NUM / 100 < 1200
+#include <optimizer/clauses.h>
+#endif
+
+#include <access/genam.h>
 #include <optimizer/cost.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
 #include <utils/selfuncs.h>
 #include <utils/spccache.h>
 
+/*
+ * Matching a screened candidate costs as much as this number of operators
+ */
+#define BINGO_MATCH_COST_FACTOR 250.0
+
+/*
+ * Screening estimation by the index statistics (pg_bingo_search.cpp)
+ */
+extern int bingo_estimate_screening(Relation index, int strategy, Datum query, double* selectivity, double* pages);
+
 /*
 #include "access/sysattr.h"
 #include "catalog/index.h"
@@ -306,6 +323,79 @@
 //     *indexCorrelation = -1.0;
 // }
 
+/*
+ * Estimates the screening of the first index qual
+ * The query should be known at planning time
+ */
+static bool bingo_estimate_path(PlannerInfo* root, IndexPath* path, double* selectivity, double* pages)
+{
+    IndexOptInfo* index = path->indexinfo;
+    Expr* clause;
+    OpExpr* op;
+    Node* query;
+    int strategy;
+    Relation index_rel;
+    int result;
+
+#if PG_VERSION_NUM / 100 >= 1200
+    IndexClause* iclause;
+
+    if (path->indexclauses == NIL)
+        return false;
+    iclause = (IndexClause*)linitial(path->indexclauses);
+    if (iclause->indexquals == NIL)
+        return false;
+    clause = ((RestrictInfo*)linitial(iclause->indexquals))->clause;
+#else
+    if (path->indexquals == NIL)
+        return false;
+    clause = ((RestrictInfo*)linitial(path->indexquals))->clause;
+#endif
+
+    if (!IsA(clause, OpExpr))
+        return false;
+    op = (OpExpr*)clause;
+    if (list_length(op->args) != 2)
+        return false;
+
+    query = estimate_expression_value(root, (Node*)lsecond(op->args));
+    if (!IsA(query, Const) || ((Const*)query)->constisnull)
+        return false;
+
+    strategy = get_op_opfamily_strategy(op->opno, index->opfamily[0]);
+    if (strategy == 0)
+        return false;
+
+    index_rel = index_open(index->indexoid, AccessShareLock);
+    result = bingo_estimate_screening(index_rel, strategy, ((Const*)query)->constvalue, selectivity, pages);
+    index_close(index_rel, AccessShareLock);
+
+    return result != 0;
+}
+
+/*
+ * Costs of the screening: fingerprint pages of every section are read once,
+ * every screened candidate is read and matched
+ */
+static void bingo_screening_costs(IndexOptInfo* index, double selectivity, double screening_pages, Cost* indexStartupCost, Cost* indexTotalCost,
+                                  Selectivity* indexSelectivity, double* indexCorrelation)
+{
+    double spc_random_page_cost;
+    double tuples = (index->tuples > 0) ? index->tuples : index->rel->tuples;
+    double candidates = Max(selectivity * tuples, 1.0);
+
+    get_tablespace_page_costs(index->reltablespace, &spc_random_page_cost, NULL);
+
+    *indexStartupCost = 100.0 * cpu_operator_cost;
+    *indexTotalCost = *indexStartupCost + screening_pages * spc_random_page_cost;
+    *indexTotalCost += candidates * (cpu_index_tuple_cost + BINGO_MATCH_COST_FACTOR * cpu_operator_cost);
+    *indexSelectivity = selectivity;
+    /*
+     * Matches are returned section by section
+     */
+    *indexCorrelation = 0.0;
+}
+
 #if PG_VERSION_NUM / 100 >= 1200
 
 void bingo_costestimate120(struct PlannerInfo* root, struct IndexPath* path, double loop_count, Cost* indexStartupCost, Cost* indexTotalCost,
@@ -313,6 +403,18 @@ void bingo_costestimate120(struct PlannerInfo* root, struct IndexPath* path, dou
 {
 
     GenericCosts costs;
+    double selectivity, screening_pages;
+
+    if (bingo_estimate_path(root, path, &selectivity, &screening_pages))
+    {
+        bingo_screening_costs(path->indexinfo, selectivity, screening_pages, indexStartupCost, indexTotalCost, indexSelectivity, indexCorrelation);
+        *indexPages = screening_pages;
+        return;
+    }
+
+    /*
+     * Index has no statistics or the query is not known
+     */
     MemSet(&costs, 0, sizeof(costs));
     costs.numIndexTuples = 1;
     costs.numIndexPages = 1;
@@ -567,12 +669,28 @@ static void genericcostestimate92(PlannerInfo* root, IndexPath* path, double loo
 void bingo_costestimate96(struct PlannerInfo* root, struct IndexPath* path, double loop_count, Cost* indexStartupCost, Cost* indexTotalCost,
                           Selectivity* indexSelectivity, double* indexCorrelation)
 {
+    double selectivity, screening_pages;
+
+    if (bingo_estimate_path(root, path, &selectivity, &screening_pages))
+    {
+        bingo_screening_costs(path->indexinfo, selectivity, screening_pages, indexStartupCost, indexTotalCost, indexSelectivity, indexCorrelation);
+        return;
+    }
+
     genericcostestimate92(root, path, loop_count, 1.0, indexStartupCost, indexTotalCost, indexSelectivity, indexCorrelation);
 }
 
 void bingo_costestimate101(struct PlannerInfo* root, struct IndexPath* path, double loop_count, Cost* indexStartupCost, Cost* indexTotalCost,
                            Selectivity* indexSelectivity, double* indexCorrelation, double* indexPages)
 {
+    double selectivity, screening_pages;
+
+    if (bingo_estimate_path(root, path, &selectivity, &screening_pages))
+    {
+        bingo_screening_costs(path->indexinfo, selectivity, screening_pages, indexStartupCost, indexTotalCost, indexSelectivity, indexCorrelation);
+        *indexPages = screening_pages;
+        return;
+    }
 
     genericcostestimate92(root, path, loop_count, 1.0, indexStartupCost, indexTotalCost, indexSelectivity, indexCorrelation);
 
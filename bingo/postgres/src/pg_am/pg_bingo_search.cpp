@@ -17,8 +17,12 @@ extern "C"
 
 #include "bingo_pg_fix_post.h"
 
+#include <string>
+#include <unordered_map>
+
 #include "base_cpp/tlscont.h"
 #include "bingo_pg_common.h"
+#include "bingo_pg_index.h"
 #include "bingo_pg_search.h"
 #include "bingo_pg_search_engine.h"
 #include "pg_bingo_context.h"
@@ -104,6 +108,89 @@ Datum bingo_beginscan(PG_FUNCTION_ARGS)
 #endif
 }
 
+/*
+ * Estimates of the recent queries, kept by the backend: planning the same
+ * query again reads only the index meta page. An estimate is used while the
+ * index has the same structures and sections numbers.
+ */
+struct BingoScreeningEstimate
+{
+    int structures_number;
+    int sections_number;
+    int result;
+    double selectivity;
+    double pages;
+};
+
+static const size_t BINGO_SCREENING_ESTIMATES_MAX = 64;
+static std::unordered_map<std::string, BingoScreeningEstimate> bingo_screening_estimates;
+
+/*
+ * Estimates the screening of the query for the cost estimate (pg_bingo_costestimate.c)
+ * Returns 0 if there is no estimation
+ */
+CEXPORT int bingo_estimate_screening(Relation rel, int strategy, Datum query, double* selectivity, double* pages)
+{
+    /*
+     * The query is detoasted before any C++ object is created, postgres errors do not unwind them
+     */
+    struct varlena* query_value = PG_DETOAST_DATUM(query);
+
+    int result = 0;
+    IndexScanDesc scan = RelationGetIndexScan(rel, 1, 0);
+    scan->keyData[0].sk_strategy = strategy;
+    scan->keyData[0].sk_argument = query;
+
+    try
+    {
+        std::string key((const char*)&rel->rd_id, sizeof(rel->rd_id));
+        key.append((const char*)&strategy, sizeof(strategy));
+        key.append((const char*)query_value, VARSIZE(query_value));
+
+        BingoPgIndex bingo_index(rel);
+        bingo_index.readMetaInfo();
+        int structures_number = bingo_index.getStructuresNumber();
+        int sections_number = bingo_index.getSectionNumber();
+
+        auto found = bingo_screening_estimates.find(key);
+        if (found != bingo_screening_estimates.end() && found->second.structures_number == structures_number &&
+            found->second.sections_number == sections_number)
+        {
+            result = found->second.result;
+            *selectivity = found->second.selectivity;
+            *pages = found->second.pages;
+        }
+        else
+        {
+            BingoPgSearch search(rel);
+            result = search.estimateScreening(scan, *selectivity, *pages) ? 1 : 0;
+
+            if (bingo_screening_estimates.size() >= BINGO_SCREENING_ESTIMATES_MAX)
+                bingo_screening_estimates.clear();
+            bingo_screening_estimates[key] = BingoScreeningEstimate{structures_number, sections_number, result, *selectivity, *pages};
+        }
+    }
+    catch (indigo::Exception& e)
+    {
+        /*
+         * Query errors are reported by the scan
+         */
+        elog(DEBUG1, "bingo: cost estimate: %s", e.message());
+        result = 0;
+    }
+    catch (...)
+    {
+        /*
+         * Nothing is thrown to the planner
+         */
+        elog(DEBUG1, "bingo: cost estimate: unknown error");
+        result = 0;
+    }
+
+    IndexScanEnd(scan);
+    return result;
+}
+
 /*
  * Rescan an index relation
  */
@@ -222,6 +222,17 @@ Datum bingo_vacuumcleanup(PG_FUNCTION_ARGS)
     BlockNumber num_pages = 0;
 
     elog(NOTICE, "bingo.index: start post-vacuum");
+
+    PG_BINGO_BEGIN
+    {
+        /*
+         * Statistics of the index used by the planner are refreshed by VACUUM and ANALYZE
+         */
+        BingoPgIndex bingo_index(rel);
+        bingo_index.readMetaInfo();
+        bingo_index.refreshStatistics();
+    }
+    PG_BINGO_END
     /*
      * Always return null since no index values are removed
      */
@@ -9,6 +9,8 @@ extern "C"
 
 #include "bingo_pg_fix_post.h"
 
+#include <algorithm>
+
 #include "base_cpp/profiling.h"
 #include "base_cpp/tlscont.h"
 #include "bingo_pg_common.h"
@@ -42,6 +44,17 @@ BingoPgSection::BingoPgSection(BingoPgIndex& bingo_idx, int idx_strategy, int of
         _sectionInfoBuffer.changeAccess(BINGO_PG_NOLOCK);
         _sectionInfo.n_blocks_for_map = bingo_idx.getMapSize();
         _sectionInfo.n_blocks_for_fp = bingo_idx.getFpSize();
+        /*
+         * Collect statistics if they fit the section info block
+         */
+        _hasStatistics = ((int)sizeof(BingoSectionInfoData) + _getStatisticsSize() <= SECTION_INFO_MAX_SIZE);
+        if (_hasStatistics)
+        {
+            _bitFrequency.clear_resize(_sectionInfo.n_blocks_for_fp);
+            _bitFrequency.zerofill();
+            _bitsCountHistogram.clear_resize(BINGO_SECTION_BITS_COUNT_BUCKETS);
+            _bitsCountHistogram.zerofill();
+        }
         /*
          * Initialize existing structures fingerprint
          */
@@ -67,6 +80,7 @@ BingoPgSection::BingoPgSection(BingoPgIndex& bingo_idx, int idx_strategy, int of
         int data_len;
         BingoSectionInfoData* data = (BingoSectionInfoData*)_sectionInfoBuffer.getIndexData(data_len);
         _sectionInfo = *data;
+        _readStatistics((const char*)data, data_len);
         _sectionInfoBuffer.changeAccess(BINGO_PG_NOLOCK);
 
         _existStructures = std::make_unique<BingoPgBufferCacheFp>(offset + 1, _index, false);
@@ -124,6 +138,10 @@ BingoPgSection::BingoPgSection(BingoPgIndex& bingo_idx, int idx_strategy, int of
 
 BingoPgSection::~BingoPgSection()
 {
+    /*
+     * Structures removed from the section are taken out of the statistics
+     */
+    _removeStatisticsData();
     /*
      * Write meta info
      */
@@ -131,16 +149,27 @@ BingoPgSection::~BingoPgSection()
     _sectionInfo.section_size = getPagesCount();
     if (_idxStrategy == BingoPgIndex::BUILDING_STRATEGY)
     {
+        /*
+         * Statistics are stored right after the section info
+         */
+        indigo::Array<char> section_data;
+        section_data.resize(sizeof(_sectionInfo) + (_hasStatistics ? _getStatisticsSize() : 0));
+        memcpy(section_data.ptr(), &_sectionInfo, sizeof(_sectionInfo));
+        if (_hasStatistics)
+            _writeStatistics(section_data.ptr());
+
         _sectionInfoBuffer.changeAccess(BINGO_PG_WRITE);
-        _sectionInfoBuffer.formIndexTuple(&_sectionInfo, sizeof(_sectionInfo));
+        _sectionInfoBuffer.formIndexTuple(section_data.ptr(), section_data.sizeInBytes());
         _sectionInfoBuffer.changeAccess(BINGO_PG_NOLOCK);
     }
-    else if (_idxStrategy == BingoPgIndex::UPDATING_STRATEGY)
+    else if (_idxStrategy == BingoPgIndex::UPDATING_STRATEGY || _statisticsChanged)
     {
         _sectionInfoBuffer.changeAccess(BINGO_PG_WRITE);
         int data_len;
         BingoSectionInfoData* data = (BingoSectionInfoData*)_sectionInfoBuffer.getIndexData(data_len);
         *data = _sectionInfo;
+        if (_hasStatistics)
+            _writeStatistics((char*)data);
         _sectionInfoBuffer.changeAccess(BINGO_PG_NOLOCK);
     }
 }
@@ -163,6 +192,11 @@ void BingoPgSection::clear()
     _offsetBin.clear();
     _offsetFp.clear();
     _offsetMap.clear();
+    _hasStatistics = false;
+    _statisticsChanged = false;
+    _bitFrequency.clear();
+    _bitsCountHistogram.clear();
+    _removedStructures.clear();
 }
 
 bool BingoPgSection::isExtended()
@@ -206,6 +240,10 @@ void BingoPgSection::addStructure(BingoPgFpData& item_data)
      * Set bits number
      */
     _setBitsCountData(item_data.getBitsCount());
+    /*
+     * Update section statistics
+     */
+    _setStatisticsData(item_data);
     /*
      * Set structure index
      */
@@ -236,6 +274,11 @@ void BingoPgSection::removeStructure(int mol_idx)
 {
     _existStructures->setBit(mol_idx, false);
     _sectionInfo.has_removed = 1;
+    /*
+     * Statistics are updated for all the removed structures at once
+     */
+    if (_hasStatistics)
+        _removedStructures.push(mol_idx);
 }
 
 bool BingoPgSection::isStructureRemoved(int mol_idx)
@@ -405,6 +448,102 @@ void BingoPgSection::_setBitsCountData(unsigned short bits_count)
     bits_buffer.changeAccess(BINGO_PG_NOLOCK);
 }
 
+bool BingoPgSection::readSectionStatistics(indigo::Array<int>& bit_frequency, indigo::Array<int>& bits_count_hist)
+{
+    if (!_hasStatistics)
+        return false;
+    /*
+     * Structures removed since the section was read are taken out first
+     */
+    _removeStatisticsData();
+    bit_frequency.copy(_bitFrequency);
+    bits_count_hist.copy(_bitsCountHistogram);
+    return true;
+}
+
+void BingoPgSection::_setStatisticsData(BingoPgFpData& item_data)
+{
+    if (!_hasStatistics)
+        return;
+
+    for (int idx = item_data.bitBegin(); idx != item_data.bitEnd(); idx = item_data.bitNext(idx))
+        ++_bitFrequency[item_data.getBit(idx)];
+
+    int bucket = std::min(item_data.getBitsCount() / BINGO_SECTION_BITS_COUNT_BUCKET_WIDTH, BINGO_SECTION_BITS_COUNT_BUCKETS - 1);
+    ++_bitsCountHistogram[bucket];
+}
+
+void BingoPgSection::_removeStatisticsData()
+{
+    if (!_hasStatistics || _removedStructures.size() == 0)
+        return;
+
+    QS_DEF(Array<int>, bits_count);
+    readSectionBitsCount(bits_count);
+    for (int i = 0; i < _removedStructures.size(); ++i)
+    {
+        int bucket = std::min(bits_count[_removedStructures[i]] / BINGO_SECTION_BITS_COUNT_BUCKET_WIDTH, BINGO_SECTION_BITS_COUNT_BUCKETS - 1);
+        if (_bitsCountHistogram[bucket] > 0)
+            --_bitsCountHistogram[bucket];
+    }
+
+    /*
+     * Every fingerprint buffer is read once for all the removed structures
+     */
+    BingoPgExternalBitset fp_bits(BINGO_MOLS_PER_SECTION);
+    for (int fp_idx = 0; fp_idx < _bitFrequency.size(); ++fp_idx)
+    {
+        getFpBufferCache(fp_idx).getCopy(fp_bits);
+        for (int i = 0; i < _removedStructures.size(); ++i)
+        {
+            if (fp_bits.get(_removedStructures[i]) && _bitFrequency[fp_idx] > 0)
+                --_bitFrequency[fp_idx];
+        }
+    }
+
+    _removedStructures.clear();
+    _statisticsChanged = true;
+}
+
+int BingoPgSection::_getStatisticsSize() const
+{
+    return sizeof(BingoSectionStatsData) + _sectionInfo.n_blocks_for_fp * sizeof(unsigned short);
+}
+
+void BingoPgSection::_readStatistics(const char* data, int data_len)
+{
+    /*
+     * Sections of older indexes have no statistics
+     */
+    _hasStatistics = false;
+    if (data_len < (int)sizeof(BingoSectionInfoData) + _getStatisticsSize())
+        return;
+
+    const BingoSectionStatsData* stats = (const BingoSectionStatsData*)(data + sizeof(BingoSectionInfoData));
+    if (stats->n_fp_bits != _sectionInfo.n_blocks_for_fp)
+        return;
+
+    _bitsCountHistogram.copy(stats->bits_count_hist, BINGO_SECTION_BITS_COUNT_BUCKETS);
+
+    const unsigned short* frequency = (const unsigned short*)(stats + 1);
+    _bitFrequency.clear_resize(stats->n_fp_bits);
+    for (int i = 0; i < stats->n_fp_bits; ++i)
+        _bitFrequency[i] = frequency[i];
+
+    _hasStatistics = true;
+}
+
+void BingoPgSection::_writeStatistics(char* data)
+{
+    BingoSectionStatsData* stats = (BingoSectionStatsData*)(data + sizeof(BingoSectionInfoData));
+    stats->n_fp_bits = _bitFrequency.size();
+    memcpy(stats->bits_count_hist, _bitsCountHistogram.ptr(), sizeof(stats->bits_count_hist));
+
+    unsigned short* frequency = (unsigned short*)(stats + 1);
+    for (int i = 0; i < _bitFrequency.size(); ++i)
+        frequency[i] = (unsigned short)_bitFrequency[i];
+}
+
 BingoPgBufferCacheBin* BingoPgSection::_getBufferBin(int idx)
 {
     BingoPgBufferCacheBin* elem = _buffersBin.at(idx);
@@ -17,7 +17,7 @@ class BingoPgExternalBitset;
 /*
  * Class for handling bingo postgres section
  * Section consists of:
- *    section meta info (1 block) |
+ *    section meta info and statistics (1 block) |
  *    section removed bitset (1 block) |
  *    bits count buffers (16 blocks) |
  *    map buffers (64k / 500) |
@@ -31,7 +31,8 @@ public:
     {
         SECTION_META_PAGES = 2,
         SECTION_BITSNUMBER_PAGES = 16,
-        SECTION_BITS_PER_BLOCK = 4000 /* 4000 * sizeof(unsigned short) < 8K*/
+        SECTION_BITS_PER_BLOCK = 4000, /* 4000 * sizeof(unsigned short) < 8K*/
+        SECTION_INFO_MAX_SIZE = 8000   /* section info with statistics < 8K */
     };
     BingoPgSection(BingoPgIndex& bingo_idx, int idx_strategy, int offset);
     ~BingoPgSection();
@@ -65,6 +66,11 @@ public:
     BingoPgBufferCacheBin& getBinBufferCache(int bin_idx);
 
     void readSectionBitsCount(indigo::Array<int>& bits_count);
+    /*
+     * Reads fingerprint bits frequency and structure bits count histogram
+     * Returns false if the section has no statistics (too large fingerprint or an index of older version)
+     */
+    bool readSectionStatistics(indigo::Array<int>& bit_frequency, indigo::Array<int>& bits_count_hist);
 
     const BingoSectionInfoData& getSectionInfo() const
     {
@@ -80,6 +86,12 @@ private:
     void _setXyzData(indigo::Array<char>& xyz_buf, int map_buf_idx, int map_idx);
     void _setBinData(indigo::Array<char>& buf, int& last_buf, ItemPointerData& item_data);
     void _setBitsCountData(unsigned short bits_count);
+    void _setStatisticsData(BingoPgFpData& item_data);
+    void _removeStatisticsData();
+
+    int _getStatisticsSize() const;
+    void _readStatistics(const char* data, int data_len);
+    void _writeStatistics(char* data);
 
     BingoPgBufferCacheBin* _getBufferBin(int idx);
 
@@ -100,6 +112,12 @@ private:
     indigo::Array<int> _offsetBin;
 
     indigo::ObjArray<BingoPgBuffer> _bitsCountBuffers;
+
+    bool _hasStatistics;
+    bool _statisticsChanged;
+    indigo::Array<int> _bitFrequency;
+    indigo::Array<int> _bitsCountHistogram;
+    indigo::Array<int> _removedStructures;
 };
 
 #endif /* BINGO_PG_SECTION1_H */
@@ -86,4 +86,35 @@ typedef struct BingoSectionInfoData
     char has_removed;
 } BingoSectionInfoData;
 
+#define BINGO_SECTION_BITS_COUNT_BUCKETS 64
+#define BINGO_SECTION_BITS_COUNT_BUCKET_WIDTH 16
+
+/*
+ * Section statistics are stored after the section info. They are followed by
+ * the number of structures having each fingerprint bit (unsigned short per bit)
+ */
+typedef struct BingoSectionStatsData
+{
+    int n_fp_bits;
+    int bits_count_hist[BINGO_SECTION_BITS_COUNT_BUCKETS];
+} BingoSectionStatsData;
+
+/*
+ * Statistics of all the sections, stored in the meta page right after the meta
+ * info, so the planner does not read the meta page of every section. They are
+ * followed by the share of structures having each fingerprint bit, in units of
+ * 1/BINGO_INDEX_STATS_SHARE_SCALE (unsigned short per bit). They are written by
+ * the index build and refreshed by VACUUM and ANALYZE.
+ */
+typedef struct BingoIndexStatsData
+{
+    int n_structures; /* 0 if the meta page has no statistics */
+    int n_fp_bits;
+    int bits_count_hist[BINGO_SECTION_BITS_COUNT_BUCKETS];
+} BingoIndexStatsData;
+
+#define BINGO_INDEX_STATS_SHARE_SCALE 65535
+
+#define BingoPageGetStats(page) ((BingoIndexStatsData*)((char*)BingoPageGetMeta(page) + MAXALIGN(sizeof(BingoMetaPageData))))
+
 #endif /* BINGO_PG_CONTEXT_H */
@@ -0,0 +1,113 @@
+#include "bingo_pg_fix_pre.h"
+
+#include <algorithm>
+#include <math.h>
+
+extern "C"
+{
+#include "postgres.h"
+}
+
+#include "bingo_pg_fix_post.h"
+
+#include "base_cpp/tlscont.h"
+
+#include "bingo_pg_cost_estimator.h"
+#include "bingo_pg_index.h"
+#include "bingo_pg_search_engine.h"
+#include "bingo_pg_section.h"
+
+using namespace indigo;
+
+/*
+ * Fingerprint bits are strongly correlated, so only the most selective bits
+ * are taken into account with decreasing weights
+ */
+static const int SUB_SCREENING_BITS = 4;
+
+BingoPgCostEstimator::BingoPgCostEstimator() : _structuresNumber(0), _sectionsNumber(0)
+{
+}
+
+bool BingoPgCostEstimator::readStatistics(BingoPgIndex& bingo_index)
+{
+    _sectionsNumber = bingo_index.getSectionNumber();
+    if (bingo_index.readStatistics(_structuresNumber, _bitShare, _bitsCountHistogram))
+        return true;
+
+    /*
+     * Indexes of older version and indexes filled by inserts only have no
+     * statistics in the meta page until VACUUM or ANALYZE
+     */
+    QS_DEF(Array<int>, bit_frequency);
+    if (!bingo_index.sumSectionStatistics(_structuresNumber, bit_frequency, _bitsCountHistogram))
+        return false;
+
+    _bitShare.clear_resize(bit_frequency.size());
+    for (int i = 0; i < bit_frequency.size(); ++i)
+        _bitShare[i] = (double)bit_frequency[i] / _structuresNumber;
+    return true;
+}
+
+double BingoPgCostEstimator::estimateSubScreening(BingoPgFpData& query_data) const
+{
+    if (_structuresNumber == 0)
+        return 1.0;
+
+    QS_DEF(Array<double>, bit_selectivity);
+    bit_selectivity.clear();
+    for (int idx = query_data.bitBegin(); idx != query_data.bitEnd(); idx = query_data.bitNext(idx))
+    {
+        int fp_block = query_data.getBit(idx);
+        if (fp_block < _bitShare.size())
+            bit_selectivity.push(_bitShare[fp_block]);
+    }
+    std::sort(bit_selectivity.ptr(), bit_selectivity.ptr() + bit_selectivity.size());
+
+    double result = 1.0;
+    double weight = 1.0;
+    for (int i = 0; i < std::min(bit_selectivity.size(), SUB_SCREENING_BITS); ++i)
+    {
+        result *= pow(bit_selectivity[i], weight);
+        weight /= 2;
+    }
+
+    return std::max(result, 1.0 / _structuresNumber);
+}
+
+void BingoPgCostEstimator::getBucketsBitsCount(indigo::Array<int>& bits_count) const
+{
+    bits_count.clear_resize(BINGO_SECTION_BITS_COUNT_BUCKETS);
+    for (int i = 0; i < BINGO_SECTION_BITS_COUNT_BUCKETS; ++i)
+        bits_count[i] = i * BINGO_SECTION_BITS_COUNT_BUCKET_WIDTH + BINGO_SECTION_BITS_COUNT_BUCKET_WIDTH / 2;
+}
+
+double BingoPgCostEstimator::estimateSimScreening(int query_bits, const int* min_bounds, const int* max_bounds) const
+{
+    if (_structuresNumber == 0)
+        return 1.0;
+
+    int passed = 0;
+    for (int i = 0; i < BINGO_SECTION_BITS_COUNT_BUCKETS; ++i)
+    {
+        /*
+         * Structures of the bucket can pass if the bounds allow common bits number
+         */
+        int max_common = std::min(query_bits, (i + 1) * BINGO_SECTION_BITS_COUNT_BUCKET_WIDTH);
+        if (min_bounds[i] <= max_bounds[i] && min_bounds[i] <= max_common)
+            passed += _bitsCountHistogram[i];
+    }
+
+    return std::max((double)passed / _structuresNumber, 1.0 / _structuresNumber);
+}
+
+double BingoPgCostEstimator::estimateScreeningPages(int query_bits, bool bits_count) const
+{
+    /*
+     * Section meta pages, a page for each query bit and the bits count pages
+     */
+    int section_pages = BingoPgSection::SECTION_META_PAGES + query_bits;
+    if (bits_count)
+        section_pages += BingoPgSection::SECTION_BITSNUMBER_PAGES;
+    return (double)_sectionsNumber * section_pages;
+}
@@ -0,0 +1,67 @@
+#ifndef _BINGO_PG_COST_ESTIMATOR_H__
+#define _BINGO_PG_COST_ESTIMATOR_H__
+
+#include "base_cpp/array.h"
+
+#include "bingo_postgres.h"
+
+class BingoPgIndex;
+class BingoPgFpData;
+
+/*
+ * Class for estimating the fingerprint screening of a query
+ * Uses the bits frequency and bits count histograms collected by the index build
+ */
+class BingoPgCostEstimator
+{
+public:
+    BingoPgCostEstimator();
+    ~BingoPgCostEstimator()
+    {
+    }
+
+    /*
+     * Reads statistics of the index from its meta page, or sums the statistics
+     * of all the sections if the meta page has none
+     * Returns false if some section has no statistics
+     */
+    bool readStatistics(BingoPgIndex& bingo_index);
+
+    int getStructuresNumber() const
+    {
+        return _structuresNumber;
+    }
+
+    /*
+     * Fraction of the structures having all the query fingerprint bits
+     */
+    double estimateSubScreening(BingoPgFpData& query_data) const;
+
+    /*
+     * Bits count of each histogram bucket (middle of the bucket)
+     */
+    void getBucketsBitsCount(indigo::Array<int>& bits_count) const;
+    /*
+     * Fraction of the structures which bits count can fit the similarity bounds
+     * Bounds are given for each histogram bucket
+     */
+    double estimateSimScreening(int query_bits, const int* min_bounds, const int* max_bounds) const;
+
+    /*
+     * Index pages read by the screening of all the sections
+     */
+    double estimateScreeningPages(int query_bits, bool bits_count) const;
+
+private:
+    BingoPgCostEstimator(const BingoPgCostEstimator&); // no implicit copy
+
+    int _structuresNumber;
+    int _sectionsNumber;
+    /*
+     * Share of the structures having each fingerprint bit
+     */
+    indigo::Array<double> _bitShare;
+    indigo::Array<int> _bitsCountHistogram;
+};
+
+#endif /* BINGO_PG_COST_ESTIMATOR_H */
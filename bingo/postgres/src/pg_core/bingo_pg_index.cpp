@@ -6,6 +6,7 @@ extern "C"
 {
 #include "postgres.h"
 
+#include "access/itup.h"
 #include "fmgr.h"
 #include "storage/bufmgr.h"
 }
@@ -13,6 +14,7 @@ extern "C"
 #include "bingo_pg_fix_post.h"
 
 #include "base_cpp/profiling.h"
+#include "base_cpp/tlscont.h"
 
 #include "bingo_core_c.h"
 #include "bingo_pg_build_engine.h"
@@ -40,6 +42,7 @@ BingoPgIndex::BingoPgIndex(PG_OBJECT index) : _index(index), _strategy(READING_S
     _metaInfo.index_type = 0;
     _metaInfo.n_pages = 0;
     _currentSectionIdx = -1;
+    _buildStructures = 0;
 }
 
 /*
@@ -64,6 +67,15 @@ void BingoPgIndex::writeBegin(BingoPgBuildEngine& fp_engine, BingoPgConfig& bing
     _metaInfo.n_sections = 0;
     _initializeNewSection();
 
+    /*
+     * Prepare statistics of the index
+     */
+    _buildStructures = 0;
+    _buildBitFrequency.clear_resize(_metaInfo.n_blocks_for_fp);
+    _buildBitFrequency.zerofill();
+    _buildBitsCountHist.clear_resize(BINGO_SECTION_BITS_COUNT_BUCKETS);
+    _buildBitsCountHist.zerofill();
+
     /*
      * Set up write strategy
      */
@@ -156,6 +168,12 @@ void BingoPgIndex::writeMetaInfo()
     BingoMetaPage meta_page = BingoPageGetMeta(BufferGetPage(_metaBuffer.getBuffer()));
     *meta_page = _metaInfo;
     _metaBuffer.changeAccess(BINGO_PG_NOLOCK);
+
+    /*
+     * The build has the statistics of all the structures
+     */
+    if (_strategy == BUILDING_STRATEGY)
+        _writeStatistics(_buildStructures, _buildBitFrequency, _buildBitsCountHist);
 }
 
 void BingoPgIndex::_initializeMetaPages(BingoPgConfig& bingo_config)
@@ -433,6 +451,8 @@ void BingoPgIndex::insertStructure(BingoPgFpData& data_item)
      * Add a structure
      */
     _currentSection->addStructure(data_item);
+    if (_strategy == BUILDING_STRATEGY)
+        _addBuildStatistics(data_item);
 
     elog(DEBUG1, "bingo: index: finish adding a structure to the section %d", _currentSectionIdx);
 
@@ -514,6 +534,127 @@ void BingoPgIndex::getSectionBitsCount(int section_idx, indigo::Array<int>& bits
     current_section.readSectionBitsCount(bits_count);
 }
 
+bool BingoPgIndex::getSectionStatistics(int section_idx, indigo::Array<int>& bit_frequency, indigo::Array<int>& bits_count_hist)
+{
+    BingoPgSection& current_section = _jumpToSection(section_idx);
+    return current_section.readSectionStatistics(bit_frequency, bits_count_hist);
+}
+
+bool BingoPgIndex::sumSectionStatistics(int& structures_number, indigo::Array<int>& bit_frequency, indigo::Array<int>& bits_count_hist)
+{
+    QS_DEF(indigo::Array<int>, section_frequency);
+    QS_DEF(indigo::Array<int>, section_hist);
+
+    structures_number = 0;
+    bit_frequency.clear();
+    bits_count_hist.clear_resize(BINGO_SECTION_BITS_COUNT_BUCKETS);
+    bits_count_hist.zerofill();
+
+    for (int section_idx = 0; section_idx < getSectionNumber(); ++section_idx)
+    {
+        if (!getSectionStatistics(section_idx, section_frequency, section_hist))
+            return false;
+
+        if (bit_frequency.size() == 0)
+        {
+            bit_frequency.clear_resize(section_frequency.size());
+            bit_frequency.zerofill();
+        }
+        for (int i = 0; i < std::min(bit_frequency.size(), section_frequency.size()); ++i)
+            bit_frequency[i] += section_frequency[i];
+        for (int i = 0; i < BINGO_SECTION_BITS_COUNT_BUCKETS; ++i)
+            bits_count_hist[i] += section_hist[i];
+
+        structures_number += getSectionStructuresNumber(section_idx);
+    }
+
+    return structures_number > 0;
+}
+
+bool BingoPgIndex::readStatistics(int& structures_number, indigo::Array<double>& bit_share, indigo::Array<int>& bits_count_hist)
+{
+    _metaBuffer.changeAccess(BINGO_PG_READ);
+    const BingoIndexStatsData* stats = BingoPageGetStats(BufferGetPage(_metaBuffer.getBuffer()));
+
+    structures_number = stats->n_structures;
+    bool result = (structures_number > 0 && stats->n_fp_bits == _metaInfo.n_blocks_for_fp &&
+                   (int)sizeof(BingoIndexStatsData) + stats->n_fp_bits * (int)sizeof(unsigned short) <= _getStatisticsMaxSize());
+    if (result)
+    {
+        bits_count_hist.copy(stats->bits_count_hist, BINGO_SECTION_BITS_COUNT_BUCKETS);
+
+        const unsigned short* share = (const unsigned short*)(stats + 1);
+        bit_share.clear_resize(stats->n_fp_bits);
+        for (int i = 0; i < stats->n_fp_bits; ++i)
+            bit_share[i] = (double)share[i] / BINGO_INDEX_STATS_SHARE_SCALE;
+    }
+    _metaBuffer.changeAccess(BINGO_PG_NOLOCK);
+
+    return result;
+}
+
+void BingoPgIndex::refreshStatistics()
+{
+    if (_strategy == BUILDING_STRATEGY)
+        throw Error("can not refresh statistics while building");
+
+    QS_DEF(indigo::Array<int>, bit_frequency);
+    QS_DEF(indigo::Array<int>, bits_count_hist);
+    int structures_number;
+    if (!sumSectionStatistics(structures_number, bit_frequency, bits_count_hist))
+        structures_number = 0;
+    _writeStatistics(structures_number, bit_frequency, bits_count_hist);
+}
+
+void BingoPgIndex::_addBuildStatistics(BingoPgFpData& data_item)
+{
+    for (int idx = data_item.bitBegin(); idx != data_item.bitEnd(); idx = data_item.bitNext(idx))
+    {
+        int fp_block = data_item.getBit(idx);
+        if (fp_block < _buildBitFrequency.size())
+            ++_buildBitFrequency[fp_block];
+    }
+
+    int bucket = std::min(data_item.getBitsCount() / BINGO_SECTION_BITS_COUNT_BUCKET_WIDTH, BINGO_SECTION_BITS_COUNT_BUCKETS - 1);
+    ++_buildBitsCountHist[bucket];
+    ++_buildStructures;
+}
+
+void BingoPgIndex::_writeStatistics(int structures_number, const indigo::Array<int>& bit_frequency, const indigo::Array<int>& bits_count_hist)
+{
+    _metaBuffer.changeAccess(BINGO_PG_WRITE);
+    BingoIndexStatsData* stats = BingoPageGetStats(BufferGetPage(_metaBuffer.getBuffer()));
+
+    /*
+     * Statistics that do not fit the meta page are not kept, the planner reads the sections then
+     */
+    int stats_size = sizeof(BingoIndexStatsData) + bit_frequency.size() * sizeof(unsigned short);
+    if (structures_number <= 0 || stats_size > _getStatisticsMaxSize())
+    {
+        stats->n_structures = 0;
+    }
+    else
+    {
+        stats->n_structures = structures_number;
+        stats->n_fp_bits = bit_frequency.size();
+        memcpy(stats->bits_count_hist, bits_count_hist.ptr(), sizeof(stats->bits_count_hist));
+
+        unsigned short* share = (unsigned short*)(stats + 1);
+        for (int i = 0; i < bit_frequency.size(); ++i)
+            share[i] = (unsigned short)std::min((double)BINGO_INDEX_STATS_SHARE_SCALE,
+                                                (double)bit_frequency[i] * BINGO_INDEX_STATS_SHARE_SCALE / structures_number + 0.5);
+    }
+    _metaBuffer.changeAccess(BINGO_PG_NOLOCK);
+}
+
+int BingoPgIndex::_getStatisticsMaxSize()
+{
+    /*
+     * The meta info tuple is kept at the end of the page
+     */
+    return BLCKSZ - MAXALIGN(SizeOfPageHeaderData) - MAXALIGN(sizeof(BingoMetaPageData)) - 2 * MAXALIGN(sizeof(IndexTupleData) + sizeof(BingoMetaPageData));
+}
+
 void BingoPgIndex::removeStructure(int section_idx, int mol_idx)
 {
     BingoPgSection& current_section = _jumpToSection(section_idx);
@@ -128,6 +128,22 @@ public:
 
     void getSectionBitset(int section_idx, BingoPgExternalBitset& section_bitset);
     void getSectionBitsCount(int section_idx, indigo::Array<int>& bits_count);
+    bool getSectionStatistics(int section_idx, indigo::Array<int>& bit_frequency, indigo::Array<int>& bits_count_hist);
+    /*
+     * Sums statistics of all the sections
+     * Returns false if some section has no statistics or there are no structures
+     */
+    bool sumSectionStatistics(int& structures_number, indigo::Array<int>& bit_frequency, indigo::Array<int>& bits_count_hist);
+
+    /*
+     * Statistics of the whole index kept in the meta page
+     * Returns false if the meta page has no statistics (an index of older version or too large fingerprint)
+     */
+    bool readStatistics(int& structures_number, indigo::Array<double>& bit_share, indigo::Array<int>& bits_count_hist);
+    /*
+     * Writes the sum of the section statistics to the meta page
+     */
+    void refreshStatistics();
 
     void removeStructure(int section_idx, int mol_idx);
     bool isStructureRemoved(int section_idx, int mol_idx);
@@ -153,6 +169,10 @@ private:
     BingoPgSection& _jumpToSection(int section_idx);
     int _getSectionOffset(int section_idx);
 
+    void _addBuildStatistics(BingoPgFpData& data_item);
+    void _writeStatistics(int structures_number, const indigo::Array<int>& bit_frequency, const indigo::Array<int>& bits_count_hist);
+    static int _getStatisticsMaxSize();
+
     PG_OBJECT _index;
     INDEX_STRATEGY _strategy;
 
@@ -161,6 +181,13 @@ private:
     indigo::PtrArray<BingoPgBuffer> _sectionOffsetBuffers;
     std::unique_ptr<BingoPgSection> _currentSection;
     int _currentSectionIdx;
+
+    /*
+     * Statistics of the structures added by the build, written with the meta info
+     */
+    int _buildStructures;
+    indigo::Array<int> _buildBitFrequency;
+    indigo::Array<int> _buildBitsCountHist;
 };
 
 #endif /* BINGO_PG_SECTION_H */
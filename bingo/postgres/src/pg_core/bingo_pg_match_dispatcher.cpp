@@ -0,0 +1,280 @@
+#include "bingo_pg_fix_pre.h"
+#include "gzip/gzip_scanner.h"
+
+extern "C"
+{
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "storage/itemptr.h"
+}
+
+#include "bingo_pg_fix_post.h"
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include "bingo_pg_match_dispatcher.h"
+
+#include "base_cpp/profiling.h"
+#include "base_cpp/tlscont.h"
+
+#include "bingo_pg_common.h"
+#include "bingo_pg_index.h"
+#include "bingo_pg_search_engine.h"
+
+using namespace indigo;
+
+/*
+ * Targets are handed to workers in small batches to balance the load
+ */
+static const int MATCH_TARGETS_PER_COMMAND = 32;
+
+BingoPgMatchDispatcher::_Worker::_Worker()
+{
+    _bingoContext = std::make_unique<BingoContext>(0);
+    _mangoContext = std::make_unique<MangoContext>(*_bingoContext.get());
+    _ringoContext = std::make_unique<RingoContext>(*_bingoContext.get());
+
+    bingoCore.bingo_context = _bingoContext.get();
+    bingoCore.mango_context = _mangoContext.get();
+    bingoCore.ringo_context = _ringoContext.get();
+}
+
+BingoPgMatchDispatcher::_Worker::~_Worker()
+{
+    bingoCore.bingoIndexEnd();
+}
+
+BingoPgMatchDispatcher::BingoPgMatchDispatcher(BingoPgSearchEngine& engine, int thread_count)
+    : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _engine(engine), _threadCount(thread_count), _targets(0), _nextTarget(0),
+      _errorTarget(-1)
+{
+    /*
+     * Worker cores are set up by the backend, configuration is read from the index
+     */
+    for (int i = 0; i < _threadCount; ++i)
+    {
+        _Worker& worker = _workers.add(new _Worker());
+        _engine._setUpWorkerCore(worker.bingoCore);
+        _vacantWorkers.push(i);
+    }
+}
+
+BingoPgMatchDispatcher::~BingoPgMatchDispatcher()
+{
+    /*
+     * The search can be ended while the workers still match the targets
+     */
+    if (_matchThread.joinable())
+    {
+        markToTerminate();
+        _matchThread.join();
+    }
+}
+
+void BingoPgMatchDispatcher::match(ObjArray<BingoPgMatchTarget>& targets, Array<int>& matched)
+{
+    start(targets);
+    wait(matched);
+}
+
+void BingoPgMatchDispatcher::start(ObjArray<BingoPgMatchTarget>& targets)
+{
+    _targets = &targets;
+    _nextTarget = 0;
+    _errorTarget = -1;
+    _error.clear();
+    _warningTargets.clear();
+    _warnings.clear();
+    _matched.clear();
+    _matchException = nullptr;
+
+    int session_id = TL_GET_SESSION_ID();
+
+#ifndef _WIN32
+    /*
+     * Threads inherit the signal mask, so postgres signal handlers are only
+     * called by the backend
+     */
+    sigset_t all_signals, backend_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &backend_signals);
+#endif
+    try
+    {
+        /*
+         * The commands are handed out by a thread of its own, so the backend is
+         * free until wait is called
+         */
+        _matchThread = std::thread([this, session_id]() {
+            profTimerStart(t0, "bingo_pg.match_parallel");
+            TL_SET_SESSION_ID(session_id);
+            try
+            {
+                run(_threadCount);
+            }
+            catch (...)
+            {
+                _matchException = std::current_exception();
+            }
+        });
+    }
+    catch (...)
+    {
+#ifndef _WIN32
+        pthread_sigmask(SIG_SETMASK, &backend_signals, 0);
+#endif
+        throw;
+    }
+#ifndef _WIN32
+    pthread_sigmask(SIG_SETMASK, &backend_signals, 0);
+#endif
+}
+
+void BingoPgMatchDispatcher::wait(Array<int>& matched)
+{
+    profTimerStart(t0, "bingo_pg.match_wait");
+
+    _matchThread.join();
+    if (_matchException)
+        std::rethrow_exception(_matchException);
+
+    matched.copy(_matched);
+
+    ObjArray<BingoPgMatchTarget>& targets = *_targets;
+    BingoPgIndex& bingo_index = *_engine._bufferIndexPtr;
+    for (int i = 0; i < _warningTargets.size(); ++i)
+    {
+        BingoPgMatchTarget& target = targets[_warningTargets[i]];
+        ItemPointerData target_item;
+        bingo_index.readTidItem(target.sectionIdx, target.structureIdx, &target_item);
+        elog(WARNING, "search engine: error while matching target with ctid='(%d,%d)'::tid: %s", ItemPointerGetBlockNumber(&target_item),
+             ItemPointerGetOffsetNumber(&target_item), _warnings[i].ptr());
+    }
+
+    if (_errorTarget != -1)
+    {
+        BingoPgMatchTarget& target = targets[_errorTarget];
+        ItemPointerData target_item;
+        bingo_index.readTidItem(target.sectionIdx, target.structureIdx, &target_item);
+        throw BingoPgError("search engine: error while matching target with ctid='(%d,%d)'::tid: %s", ItemPointerGetBlockNumber(&target_item),
+                           ItemPointerGetOffsetNumber(&target_item), _error.ptr());
+    }
+}
+
+BingoPgMatchDispatcher::_Worker& BingoPgMatchDispatcher::_acquireWorker()
+{
+    std::lock_guard<std::mutex> guard(_workersLock);
+    return *_workers[_vacantWorkers.pop()];
+}
+
+void BingoPgMatchDispatcher::_releaseWorker(_Worker& worker)
+{
+    std::lock_guard<std::mutex> guard(_workersLock);
+    for (int i = 0; i < _workers.size(); ++i)
+    {
+        if (_workers[i] == &worker)
+        {
+            _vacantWorkers.push(i);
+            break;
+        }
+    }
+}
+
+void BingoPgMatchDispatcher::_Command::execute(OsCommandResult& result_base)
+{
+    _Result& result = static_cast<_Result&>(result_base);
+    _Worker& worker = dispatcher->_acquireWorker();
+    ObjArray<BingoPgMatchTarget>& targets = *dispatcher->_targets;
+
+    for (int i = begin; i < end; ++i)
+    {
+        int bingo_res;
+        try
+        {
+            bingo_res = dispatcher->_engine._matchTargetData(worker.bingoCore, targets[i]);
+        }
+        catch (Exception& e)
+        {
+            result.errorTarget = i;
+            result.error.readString(e.message(), true);
+            break;
+        }
+        catch (...)
+        {
+            result.errorTarget = i;
+            result.error.readString("bingo unknown error", true);
+            break;
+        }
+
+        if (bingo_res < 0)
+        {
+            result.warningTargets.push(i);
+            result.warnings.push().readString(worker.bingoCore.warning.ptr(), true);
+        }
+        else if (bingo_res > 0)
+        {
+            result.matched.push(i);
+        }
+    }
+
+    dispatcher->_releaseWorker(worker);
+}
+
+void BingoPgMatchDispatcher::_Result::clear()
+{
+    matched.clear();
+    warningTargets.clear();
+    warnings.clear();
+    errorTarget = -1;
+    error.clear();
+}
+
+OsCommand* BingoPgMatchDispatcher::_allocateCommand()
+{
+    return new _Command();
+}
+
+OsCommandResult* BingoPgMatchDispatcher::_allocateResult()
+{
+    return new _Result();
+}
+
+bool BingoPgMatchDispatcher::_setupCommand(OsCommand& command_base)
+{
+    /*
+     * Stop matching after the first error
+     */
+    if (_nextTarget == _targets->size() || _errorTarget != -1)
+        return false;
+
+    _Command& command = static_cast<_Command&>(command_base);
+    command.dispatcher = this;
+    command.begin = _nextTarget;
+    command.end = std::min(_nextTarget + MATCH_TARGETS_PER_COMMAND, _targets->size());
+    _nextTarget = command.end;
+    return true;
+}
+
+void BingoPgMatchDispatcher::_handleResult(OsCommandResult& result_base)
+{
+    _Result& result = static_cast<_Result&>(result_base);
+
+    if (_errorTarget != -1)
+        return;
+
+    _matched.concat(result.matched);
+    _warningTargets.concat(result.warningTargets);
+    for (int i = 0; i < result.warnings.size(); ++i)
+        _warnings.push().copy(result.warnings[i]);
+
+    if (result.errorTarget != -1)
+    {
+        _errorTarget = result.errorTarget;
+        _error.copy(result.error);
+    }
+}
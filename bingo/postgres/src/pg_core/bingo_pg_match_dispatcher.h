@@ -0,0 +1,131 @@
+#ifndef _BINGO_PG_MATCH_DISPATCHER_H__
+#define _BINGO_PG_MATCH_DISPATCHER_H__
+
+/*
+ * Parallel verification of the candidates passed by the fingerprint screening
+ */
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "base_cpp/array.h"
+#include "base_cpp/obj_array.h"
+#include "base_cpp/os_thread_wrapper.h"
+#include "base_cpp/ptr_array.h"
+
+#include "bingo_core_c_internal.h"
+
+class BingoPgSearchEngine;
+
+/*
+ * Target read from the index by the backend, matched by a worker
+ */
+class BingoPgMatchTarget
+{
+public:
+    int sectionIdx;
+    int structureIdx;
+    indigo::Array<char> cmfBuf;
+    indigo::Array<char> xyzBuf;
+};
+
+/*
+ * Worker threads never call postgres: targets are read by the backend before
+ * matching, and every worker has its own bingo core set up with the same
+ * configuration and query as the engine core. Matches, warnings and errors
+ * are handed back to the backend in the order of targets.
+ */
+class BingoPgMatchDispatcher : public indigo::OsCommandDispatcher
+{
+public:
+    BingoPgMatchDispatcher(BingoPgSearchEngine& engine, int thread_count);
+    ~BingoPgMatchDispatcher() override;
+
+    /*
+     * Matches the targets, fills indices of the matched ones in ascending order.
+     * Warnings are reported and errors are thrown as BingoPgError by the backend
+     */
+    void match(indigo::ObjArray<BingoPgMatchTarget>& targets, indigo::Array<int>& matched);
+
+    /*
+     * Same as match, split in two calls: the workers match the targets in the
+     * background after start, so the backend can read the next targets meanwhile.
+     * The targets must not be changed until wait returns
+     */
+    void start(indigo::ObjArray<BingoPgMatchTarget>& targets);
+    void wait(indigo::Array<int>& matched);
+    bool started() const
+    {
+        return _matchThread.joinable();
+    }
+
+private:
+    BingoPgMatchDispatcher(const BingoPgMatchDispatcher&); // no implicit copy
+
+    class _Worker
+    {
+    public:
+        _Worker();
+        ~_Worker();
+
+        indigo::bingo_core::BingoCore bingoCore;
+
+    private:
+        std::unique_ptr<indigo::BingoContext> _bingoContext;
+        std::unique_ptr<indigo::MangoContext> _mangoContext;
+        std::unique_ptr<indigo::RingoContext> _ringoContext;
+    };
+
+    class _Command : public indigo::OsCommand
+    {
+    public:
+        void execute(indigo::OsCommandResult& result) override;
+
+        BingoPgMatchDispatcher* dispatcher;
+        int begin;
+        int end;
+    };
+
+    class _Result : public indigo::OsCommandResult
+    {
+    public:
+        void clear() override;
+
+        indigo::Array<int> matched;
+        indigo::Array<int> warningTargets;
+        indigo::ObjArray<indigo::Array<char>> warnings;
+        int errorTarget;
+        indigo::Array<char> error;
+    };
+
+    indigo::OsCommand* _allocateCommand() override;
+    indigo::OsCommandResult* _allocateResult() override;
+    bool _setupCommand(indigo::OsCommand& command) override;
+    void _handleResult(indigo::OsCommandResult& result) override;
+
+    _Worker& _acquireWorker();
+    void _releaseWorker(_Worker& worker);
+
+    BingoPgSearchEngine& _engine;
+    int _threadCount;
+
+    indigo::PtrArray<_Worker> _workers;
+    indigo::Array<int> _vacantWorkers;
+    std::mutex _workersLock;
+
+    indigo::ObjArray<BingoPgMatchTarget>* _targets;
+    indigo::Array<int> _matched;
+    int _nextTarget;
+
+    std::thread _matchThread;
+    std::exception_ptr _matchException;
+
+    int _errorTarget;
+    indigo::Array<char> _error;
+    indigo::Array<int> _warningTargets;
+    indigo::ObjArray<indigo::Array<char>> _warnings;
+};
+
+#endif /* _BINGO_PG_MATCH_DISPATCHER_H__ */
@@ -81,10 +81,28 @@ void BingoPgSearch::prepareRescan(PG_OBJECT scan_desc_ptr)
     }
 }
 
+bool BingoPgSearch::estimateScreening(PG_OBJECT scan_desc_ptr, double& selectivity, double& pages)
+{
+    _indexScanDesc = scan_desc_ptr;
+    _initSearchEngine();
+
+    return _fpEngine->estimateScreening(_bufferIndex, _indexScanDesc, selectivity, pages);
+}
+
 void BingoPgSearch::_initScanSearch()
 {
     _initSearch = false;
+    _initSearchEngine();
 
+    /*
+     * Process query structure with parameters
+     */
+    _fpEngine->prepareQuerySearch(_bufferIndex, _indexScanDesc);
+    _fpEngine->loadDictionary(_bufferIndex);
+}
+
+void BingoPgSearch::_initSearchEngine()
+{
     Relation index = ((IndexScanDesc)_indexScanDesc)->indexRelation;
 
     BingoPgWrapper rel_wr;
@@ -115,10 +133,4 @@ void BingoPgSearch::_initScanSearch()
     bingo_config.setUpBingoConfiguration();
     bingo_core.bingoTautomerRulesReady(0, 0, 0);
     bingo_core.bingoIndexBegin();
-
-    /*
-     * Process query structure with parameters
-     */
-    _fpEngine->prepareQuerySearch(_bufferIndex, _indexScanDesc);
-    _fpEngine->loadDictionary(_bufferIndex);
 }
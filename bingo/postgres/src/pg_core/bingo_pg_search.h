@@ -45,12 +45,19 @@ public:
 
     void prepareRescan(PG_OBJECT scan_desc_ptr);
 
+    /*
+     * Estimates the screening selectivity and the index pages read for the scan key
+     * Returns false if there is no estimation
+     */
+    bool estimateScreening(PG_OBJECT scan_desc_ptr, double& selectivity, double& pages);
+
     DECL_ERROR;
 
 private:
     BingoPgSearch(const BingoPgSearch&); // no implicit copy
 
     void _initScanSearch();
+    void _initSearchEngine();
     //   void _defineQueryOptions();
 
     bool _initSearch;
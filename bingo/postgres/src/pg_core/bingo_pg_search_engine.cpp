@@ -58,7 +58,8 @@ void BingoPgFpData::setXyz(const char* xyz_buf, int xyz_len)
 }
 
 BingoPgSearchEngine::BingoPgSearchEngine()
-    : _fetchFound(false), _currentSection(-1), _currentIdx(-1), _blockBegin(0), _blockEnd(0), _bufferIndexPtr(0), _sectionBitset(BINGO_MOLS_PER_SECTION)
+    : _fetchFound(false), _currentSection(-1), _currentIdx(-1), _blockBegin(0), _blockEnd(0), _threadCount(1), _matchWindow(0), _matchResultIdx(0), _bufferIndexPtr(0),
+      _sectionBitset(BINGO_MOLS_PER_SECTION)
 {
     _bingoContext = std::make_unique<BingoContext>(0);
     _mangoContext = std::make_unique<MangoContext>(*_bingoContext.get());
@@ -71,6 +72,7 @@ BingoPgSearchEngine::BingoPgSearchEngine()
 
 BingoPgSearchEngine::~BingoPgSearchEngine()
 {
+    _matchDispatcher.reset();
 }
 
 void BingoPgSearchEngine::setItemPointer(PG_OBJECT result_ptr)
@@ -98,6 +100,16 @@ void BingoPgSearchEngine::prepareQuerySearch(BingoPgIndex& bingo_idx, PG_OBJECT)
     _fetchFound = false;
     _blockBegin = 0;
     _blockEnd = bingo_idx.getSectionNumber();
+    /*
+     * Worker cores hold the previous query
+     */
+    _threadCount = 1;
+    _matchDispatcher.reset();
+    _matchTargets[0].clear();
+    _matchTargets[1].clear();
+    _matchWindow = 0;
+    _matchResults.clear();
+    _matchResultIdx = 0;
 }
 
 bool BingoPgSearchEngine::_searchNextCursor(PG_OBJECT result_ptr)
@@ -135,8 +147,8 @@ bool BingoPgSearchEngine::_searchNextSub(PG_OBJECT result_ptr)
 {
 
     // profTimerStart(t0, "bingo_pg.search_sub");
-    BingoPgFpData& query_data = *_queryFpData;
-    BingoPgIndex& bingo_index = *_bufferIndexPtr;
+    if (_threadCount > 1 && _parallelMatchSupported())
+        return _searchNextSubParallel(result_ptr);
     /*
      * If there are matches found on the previous steps
      */
@@ -162,28 +174,8 @@ bool BingoPgSearchEngine::_searchNextSub(PG_OBJECT result_ptr)
      */
     for (; _currentSection < _blockEnd; ++_currentSection)
     {
-        /*
-         * Get section existing structures
-         */
-        bingo_index.getSectionBitset(_currentSection, _sectionBitset);
+        _screenSection();
         _currentIdx = -1;
-        /*
-         * If there is no fingerprints then check every molecule
-         */
-        if (query_data.bitEnd() != 0)
-        {
-            /*
-             * Iterate through the query bits
-             */
-            for (int fp_idx = query_data.bitBegin(); fp_idx != query_data.bitEnd() && _sectionBitset.hasBits(); fp_idx = query_data.bitNext(fp_idx))
-            {
-                int fp_block = query_data.getBit(fp_idx);
-                /*
-                 * Get fingerprint buffer in the current section
-                 */
-                bingo_index.andWithBitset(_currentSection, fp_block, _sectionBitset);
-            }
-        }
         /*
          * If bitset is not null then matches are found
          */
@@ -211,6 +203,149 @@ bool BingoPgSearchEngine::_searchNextSub(PG_OBJECT result_ptr)
     return false;
 }
 
+void BingoPgSearchEngine::_screenSection()
+{
+    BingoPgFpData& query_data = *_queryFpData;
+    BingoPgIndex& bingo_index = *_bufferIndexPtr;
+    /*
+     * Get section existing structures
+     */
+    bingo_index.getSectionBitset(_currentSection, _sectionBitset);
+    /*
+     * If there is no fingerprints then check every molecule
+     */
+    if (query_data.bitEnd() != 0)
+    {
+        /*
+         * Iterate through the query bits
+         */
+        for (int fp_idx = query_data.bitBegin(); fp_idx != query_data.bitEnd() && _sectionBitset.hasBits(); fp_idx = query_data.bitNext(fp_idx))
+        {
+            int fp_block = query_data.getBit(fp_idx);
+            /*
+             * Get fingerprint buffer in the current section
+             */
+            bingo_index.andWithBitset(_currentSection, fp_block, _sectionBitset);
+        }
+    }
+}
+
+bool BingoPgSearchEngine::_nextCandidate()
+{
+    /*
+     * Seek for next target passed by the fingerprint screening
+     */
+    if (_currentSection < 0)
+    {
+        _currentSection = _blockBegin;
+        _currentIdx = -1;
+        if (_currentSection < _blockEnd)
+            _screenSection();
+    }
+
+    while (_currentSection < _blockEnd)
+    {
+        if (_currentIdx == -1)
+            _currentIdx = _sectionBitset.begin();
+        else
+            _currentIdx = _sectionBitset.next(_currentIdx);
+
+        if (_currentIdx != _sectionBitset.end())
+            return true;
+
+        _currentIdx = -1;
+        if (++_currentSection < _blockEnd)
+            _screenSection();
+    }
+
+    return false;
+}
+
+bool BingoPgSearchEngine::_prefetchTargets(ObjArray<BingoPgMatchTarget>& targets)
+{
+    // profTimerStart(t0, "bingo_pg.prefetch_targets");
+    /*
+     * Screen sections and read candidates ahead for every worker
+     */
+    targets.clear();
+    int window = _threadCount * BINGO_PG_MATCH_TARGETS_PER_THREAD;
+
+    while (targets.size() < window && _nextCandidate())
+    {
+        BingoPgMatchTarget& target = targets.push();
+        target.sectionIdx = _currentSection;
+        target.structureIdx = _currentIdx;
+        _readTargetData(target);
+    }
+
+    return targets.size() > 0;
+}
+
+bool BingoPgSearchEngine::_searchNextSubParallel(PG_OBJECT result_ptr)
+{
+    /*
+     * Targets are read by the backend, since postgres can not be called from
+     * the other threads, and matched by the workers. While the workers match
+     * one window of targets the backend reads the next one. Matches are
+     * returned in the same order as by the serial search
+     */
+    while (_matchResultIdx == _matchResults.size())
+    {
+        int pending_window = 1 - _matchWindow;
+        if (_matchDispatcher.get() == 0 || !_matchDispatcher->started())
+        {
+            if (!_prefetchTargets(_matchTargets[pending_window]))
+                return false;
+
+            if (_matchDispatcher.get() == 0)
+                _matchDispatcher = std::make_unique<BingoPgMatchDispatcher>(*this, _threadCount);
+            _matchDispatcher->start(_matchTargets[pending_window]);
+        }
+
+        /*
+         * Matches of the current window are all returned, so it is reused for
+         * the window after the pending one
+         */
+        bool has_next;
+        try
+        {
+            has_next = _prefetchTargets(_matchTargets[_matchWindow]);
+        }
+        catch (...)
+        {
+            _matchDispatcher.reset();
+            throw;
+        }
+
+        _matchDispatcher->wait(_matchResults);
+        _matchResultIdx = 0;
+        _matchWindow = pending_window;
+
+        if (has_next)
+            _matchDispatcher->start(_matchTargets[1 - _matchWindow]);
+    }
+
+    BingoPgMatchTarget& target = _matchTargets[_matchWindow][_matchResults[_matchResultIdx++]];
+    _bufferIndexPtr->readTidItem(target.sectionIdx, target.structureIdx, result_ptr);
+    return true;
+}
+
+void BingoPgSearchEngine::_setUpWorkerCore(bingo_core::BingoCore& core)
+{
+    /*
+     * Same configuration as the engine core has
+     */
+    BingoPgConfig bingo_config(core);
+    _bufferIndexPtr->readConfigParameters(bingo_config);
+    bingo_config.setUpBingoConfiguration();
+    core.bingoTautomerRulesReady(0, 0, 0);
+    core.bingoIndexBegin();
+
+    QS_DEF(Array<char>, dict);
+    _bufferIndexPtr->readDictionary(dict);
+    core.bingoSetConfigBin("cmf_dict", dict.ptr(), dict.sizeInBytes());
+}
+
 using namespace indigo;
 
 void BingoPgSearchEngine::_setBingoContext()
@@ -292,6 +427,13 @@ void BingoPgSearchEngine::_getBlockParameters(Array<char>& params)
             if (block_count < 1)
                 throw BingoPgError("B_COUNT should be a positive value: %d", block_count);
         }
+        else if (strcasecmp(word.ptr(), "THREADS") == 0)
+        {
+            scanner.skipSpace();
+            _threadCount = scanner.readInt();
+            if (_threadCount < 1)
+                throw BingoPgError("THREADS should be a positive value: %d", _threadCount);
+        }
         else if (strcasecmp(word.ptr(), "") == 0)
         {
             break;
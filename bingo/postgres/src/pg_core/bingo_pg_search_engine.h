@@ -6,12 +6,14 @@
  */
 
 #include "base_cpp/array.h"
+#include "base_cpp/obj_array.h"
 #include <memory>
 
 #include "bingo_core_c_internal.h"
 #include "bingo_pg_buffer_cache.h"
 #include "bingo_pg_cursor.h"
 #include "bingo_pg_ext_bitset.h"
+#include "bingo_pg_match_dispatcher.h"
 #include "bingo_postgres.h"
 #include "pg_bingo_context.h"
 
@@ -139,6 +141,14 @@ public:
     {
         return false;
     }
+    /*
+     * Estimates the fingerprint screening of the query for the planner
+     * Returns false if there is no estimation for the search type or the index
+     */
+    virtual bool estimateScreening(BingoPgIndex&, PG_OBJECT scan_desc, double& selectivity, double& pages)
+    {
+        return false;
+    }
 
     void setItemPointer(PG_OBJECT result_ptr);
 
@@ -148,10 +158,36 @@ public:
 
 private:
     BingoPgSearchEngine(const BingoPgSearchEngine&); // no implicit copy
+
+    friend class BingoPgMatchDispatcher;
+
 protected:
     bool _searchNextCursor(PG_OBJECT result_ptr);
     bool _searchNextSub(PG_OBJECT result_ptr);
 
+    /*
+     * Parallel candidates verification, enabled by the THREADS block parameter.
+     * Engines that support it read target data on the backend and match it
+     * with a worker core
+     */
+    virtual bool _parallelMatchSupported() const
+    {
+        return false;
+    }
+    virtual void _readTargetData(BingoPgMatchTarget& target)
+    {
+    }
+    virtual int _matchTargetData(indigo::bingo_core::BingoCore& core, BingoPgMatchTarget& target)
+    {
+        return 0;
+    }
+    virtual void _setUpWorkerCore(indigo::bingo_core::BingoCore& core);
+
+    bool _searchNextSubParallel(PG_OBJECT result_ptr);
+    void _screenSection();
+    bool _nextCandidate();
+    bool _prefetchTargets(indigo::ObjArray<BingoPgMatchTarget>& targets);
+
     void _setBingoContext();
     bool _fetchForNext();
 
@@ -164,6 +200,17 @@ protected:
     int _blockBegin;
     int _blockEnd;
 
+    int _threadCount;
+    /*
+     * Two windows of targets: matches of one are returned while the workers
+     * match the other, and the backend reads the window after it
+     */
+    indigo::ObjArray<BingoPgMatchTarget> _matchTargets[2];
+    int _matchWindow;
+    indigo::Array<int> _matchResults;
+    int _matchResultIdx;
+    std::unique_ptr<BingoPgMatchDispatcher> _matchDispatcher;
+
     BingoPgIndex* _bufferIndexPtr;
 
     BingoPgExternalBitset _sectionBitset;
@@ -23,6 +23,7 @@ extern "C"
 
 #include "bingo_pg_common.h"
 #include "bingo_pg_config.h"
+#include "bingo_pg_cost_estimator.h"
 #include "bingo_pg_index.h"
 #include "bingo_pg_text.h"
 
@@ -62,6 +63,8 @@ MangoPgSearchEngine::MangoPgSearchEngine(const char* rel_name) : BingoPgSearchEn
 
 MangoPgSearchEngine::~MangoPgSearchEngine()
 {
+    // Workers may still match targets in the background
+    _matchDispatcher.reset();
     bingoCore.bingoIndexEnd();
 }
 
@@ -132,6 +135,43 @@ bool MangoPgSearchEngine::matchTarget(int section_idx, int structure_idx)
     return result;
 }
 
+bool MangoPgSearchEngine::_parallelMatchSupported() const
+{
+    return _searchType == BingoPgCommon::MOL_SUB || _searchType == BingoPgCommon::MOL_SMARTS;
+}
+
+void MangoPgSearchEngine::_readTargetData(BingoPgMatchTarget& target)
+{
+    int bingo_res;
+    target.xyzBuf.clear();
+    _bufferIndexPtr->readCmfItem(target.sectionIdx, target.structureIdx, target.cmfBuf);
+    try
+    {
+        bingo_res = bingoCore.mangoNeedCoords();
+    }
+    CORE_CATCH_ERROR("molecule search engine: error while getting coordinates flag")
+
+    if (bingo_res > 0)
+    {
+        _bufferIndexPtr->readXyzItem(target.sectionIdx, target.structureIdx, target.xyzBuf);
+    }
+}
+
+int MangoPgSearchEngine::_matchTargetData(indigo::bingo_core::BingoCore& core, BingoPgMatchTarget& target)
+{
+    return core.mangoMatchTargetBinary(target.cmfBuf.ptr(), target.cmfBuf.sizeInBytes(), target.xyzBuf.ptr(), target.xyzBuf.sizeInBytes());
+}
+
+void MangoPgSearchEngine::_setUpWorkerCore(indigo::bingo_core::BingoCore& core)
+{
+    BingoPgSearchEngine::_setUpWorkerCore(core);
+    try
+    {
+        core.mangoSetupMatch(_matchSearchType.ptr(), _matchQuery.ptr(), _matchOptions.ptr());
+    }
+    CORE_CATCH_ERROR("molecule search engine: can not set sub search context");
+}
+
 void MangoPgSearchEngine::prepareQuerySearch(BingoPgIndex& bingo_idx, PG_OBJECT scan_desc_ptr)
 {
 
@@ -203,6 +243,45 @@ bool MangoPgSearchEngine::searchNext(PG_OBJECT result_ptr)
     return result;
 }
 
+bool MangoPgSearchEngine::estimateScreening(BingoPgIndex& bingo_idx, PG_OBJECT scan_desc_ptr, double& selectivity, double& pages)
+{
+    IndexScanDesc scan_desc = (IndexScanDesc)scan_desc_ptr;
+    /*
+     * Exact, gross and mass searches use shadow tables
+     */
+    int search_type = scan_desc->keyData[0].sk_strategy;
+    if (search_type != BingoPgCommon::MOL_SUB && search_type != BingoPgCommon::MOL_SMARTS && search_type != BingoPgCommon::MOL_SIM)
+        return false;
+
+    BingoPgCostEstimator estimator;
+    if (!estimator.readStatistics(bingo_idx))
+        return false;
+
+    prepareQuerySearch(bingo_idx, scan_desc_ptr);
+    int query_bits = _queryFpData->bitEnd();
+
+    if (_searchType == BingoPgCommon::MOL_SIM)
+    {
+        QS_DEF(Array<int>, bits_count);
+        int *min_bounds, *max_bounds;
+        estimator.getBucketsBitsCount(bits_count);
+        try
+        {
+            bingoCore.mangoSimilarityGetBitMinMaxBoundsArray(bits_count.size(), bits_count.ptr(), &min_bounds, &max_bounds);
+        }
+        CORE_CATCH_ERROR("molecule search engine: error while getting similarity bounds array")
+
+        selectivity = estimator.estimateSimScreening(query_bits, min_bounds, max_bounds);
+        pages = estimator.estimateScreeningPages(query_bits, true);
+    }
+    else
+    {
+        selectivity = estimator.estimateSubScreening(*_queryFpData);
+        pages = estimator.estimateScreeningPages(query_bits, false);
+    }
+    return true;
+}
+
 void MangoPgSearchEngine::_prepareExactQueryStrings(indigo::Array<char>& what_clause_str, indigo::Array<char>& from_clause_str,
                                                     indigo::Array<char>& where_clause_str)
 {
@@ -370,6 +449,10 @@ void MangoPgSearchEngine::_prepareSubSearch(PG_OBJECT scan_desc_ptr)
     }
     CORE_CATCH_ERROR("molecule search engine: can not set sub search context");
 
+    _matchSearchType.copy(search_type);
+    _matchQuery.copy(search_query);
+    _matchOptions.copy(search_options);
+
     const char* fingerprint_buf;
     int fp_len;
     try
@@ -98,9 +98,16 @@ public:
 
     void prepareQuerySearch(BingoPgIndex&, PG_OBJECT scan_desc) override;
     bool searchNext(PG_OBJECT result_ptr) override;
+    bool estimateScreening(BingoPgIndex&, PG_OBJECT scan_desc, double& selectivity, double& pages) override;
 
     DECL_ERROR;
 
+protected:
+    bool _parallelMatchSupported() const override;
+    void _readTargetData(BingoPgMatchTarget& target) override;
+    int _matchTargetData(indigo::bingo_core::BingoCore& core, BingoPgMatchTarget& target) override;
+    void _setUpWorkerCore(indigo::bingo_core::BingoCore& core) override;
+
 private:
     MangoPgSearchEngine(const MangoPgSearchEngine&); // no implicit copy
 
@@ -123,5 +130,11 @@ private:
     indigo::Array<char> _shadowHashRelName;
 
     int _searchType;
+    /*
+     * Query setup for the worker cores
+     */
+    indigo::Array<char> _matchSearchType;
+    indigo::Array<char> _matchQuery;
+    indigo::Array<char> _matchOptions;
 };
 #endif /* MANGO_PG_SEARCH_ENGINE_H */
@@ -21,6 +21,7 @@ extern "C"
 
 #include "bingo_pg_common.h"
 #include "bingo_pg_config.h"
+#include "bingo_pg_cost_estimator.h"
 #include "bingo_pg_index.h"
 #include "bingo_pg_text.h"
 
@@ -38,6 +39,8 @@ RingoPgSearchEngine::RingoPgSearchEngine(const char* rel_name) : BingoPgSearchEn
 
 RingoPgSearchEngine::~RingoPgSearchEngine()
 {
+    // Workers may still match targets in the background
+    _matchDispatcher.reset();
     bingoCore.bingoIndexEnd();
 }
 
@@ -62,6 +65,31 @@ bool RingoPgSearchEngine::matchTarget(int section_idx, int structure_idx)
     return result;
 }
 
+bool RingoPgSearchEngine::_parallelMatchSupported() const
+{
+    return _searchType == BingoPgCommon::REACT_SUB || _searchType == BingoPgCommon::REACT_SMARTS;
+}
+
+void RingoPgSearchEngine::_readTargetData(BingoPgMatchTarget& target)
+{
+    _bufferIndexPtr->readCmfItem(target.sectionIdx, target.structureIdx, target.cmfBuf);
+}
+
+int RingoPgSearchEngine::_matchTargetData(indigo::bingo_core::BingoCore& core, BingoPgMatchTarget& target)
+{
+    return core.ringoMatchTargetBinary(target.cmfBuf.ptr(), target.cmfBuf.sizeInBytes());
+}
+
+void RingoPgSearchEngine::_setUpWorkerCore(indigo::bingo_core::BingoCore& core)
+{
+    BingoPgSearchEngine::_setUpWorkerCore(core);
+    try
+    {
+        core.ringoSetupMatch(_matchSearchType.ptr(), _matchQuery.ptr(), _matchOptions.ptr());
+    }
+    CORE_CATCH_ERROR("reaction search engine: can not set rsub search context")
+}
+
 void RingoPgSearchEngine::prepareQuerySearch(BingoPgIndex& bingo_idx, PG_OBJECT scan_desc_ptr)
 {
 
@@ -113,6 +141,27 @@ bool RingoPgSearchEngine::searchNext(PG_OBJECT result_ptr)
     return result;
 }
 
+bool RingoPgSearchEngine::estimateScreening(BingoPgIndex& bingo_idx, PG_OBJECT scan_desc_ptr, double& selectivity, double& pages)
+{
+    IndexScanDesc scan_desc = (IndexScanDesc)scan_desc_ptr;
+    /*
+     * Exact search uses the shadow table
+     */
+    int search_type = scan_desc->keyData[0].sk_strategy;
+    if (search_type != BingoPgCommon::REACT_SUB && search_type != BingoPgCommon::REACT_SMARTS)
+        return false;
+
+    BingoPgCostEstimator estimator;
+    if (!estimator.readStatistics(bingo_idx))
+        return false;
+
+    prepareQuerySearch(bingo_idx, scan_desc_ptr);
+
+    selectivity = estimator.estimateSubScreening(*_queryFpData);
+    pages = estimator.estimateScreeningPages(_queryFpData->bitEnd(), false);
+    return true;
+}
+
 void RingoPgSearchEngine::_errorHandler(const char* message, void*)
 {
     throw Error("Error while searching a reaction: %s", message);
@@ -175,6 +224,10 @@ void RingoPgSearchEngine::_prepareSubSearch(PG_OBJECT scan_desc_ptr)
     }
     CORE_CATCH_ERROR("reaction search engine: can not set rsub search context")
 
+    _matchSearchType.copy(search_type);
+    _matchQuery.copy(search_query);
+    _matchOptions.copy(search_options);
+
     const char* fingerprint_buf;
     int fp_len;
 
@@ -62,9 +62,16 @@ public:
 
     void prepareQuerySearch(BingoPgIndex&, PG_OBJECT scan_desc) override;
     bool searchNext(PG_OBJECT result_ptr) override;
+    bool estimateScreening(BingoPgIndex&, PG_OBJECT scan_desc, double& selectivity, double& pages) override;
 
     DECL_ERROR;
 
+protected:
+    bool _parallelMatchSupported() const override;
+    void _readTargetData(BingoPgMatchTarget& target) override;
+    int _matchTargetData(indigo::bingo_core::BingoCore& core, BingoPgMatchTarget& target) override;
+    void _setUpWorkerCore(indigo::bingo_core::BingoCore& core) override;
+
 private:
     RingoPgSearchEngine(const RingoPgSearchEngine&); // no implicit copy
 
@@ -81,6 +88,12 @@ private:
     indigo::Array<char> _shadowRelName;
 
     int _searchType;
+    /*
+     * Query setup for the worker cores
+     */
+    indigo::Array<char> _matchSearchType;
+    indigo::Array<char> _matchQuery;
+    indigo::Array<char> _matchOptions;
 };
 
 #endif /* RINGO_PG_SEARCH_ENGINE_H */
@@ -32,6 +32,13 @@ explain select * from btest where a @ cast(('CC(=O)', '') as bingo.sub)
 select * from btest where a @ ('NC(=O)', '')::bingo.sub
 select * from btest where a @ ('OC1=CC=CC=C1', '')::bingo.sub
 
+-- parallel matching returns the same rows in the same order as the serial one, both queries must return no rows
+(select ctid from btest where a @ ('NC(=O)', '')::bingo.sub) except all (select ctid from btest where a @ ('NC(=O)', 'THREADS 4')::bingo.sub)
+(select ctid from btest where a @ ('NC(=O)', 'THREADS 4')::bingo.sub) except all (select ctid from btest where a @ ('NC(=O)', '')::bingo.sub)
+select count(*) from btest where a @ ('C', 'THREADS 4')::bingo.sub
+select * from btest where a @ ('C1=CC=CC=C1', 'THREADS 2')::bingo.smarts limit 10
+select * from rtest where a @ ('OC1=CC=CC=C1>>', 'THREADS 4')::bingo.rsub
+
 drop table aatest
 truncate table btest
 select bingo.importSDF('btest(a)', '/home/tarquin/projects/indigo/indigo-git/bingo/tests/postgres/java_tests/test_mango.sdf')
@@ -67,6 +74,12 @@ insert into btest(a) values('CCC');
 
 vacuum btest
 
+-- screening statistics follow removals: the estimated rows drop after the delete and vacuum
+explain select * from btest where a @ ('NC(=O)', '')::bingo.sub
+delete from btest where a @ ('NC(=O)', '')::bingo.sub
+vacuum btest
+explain select * from btest where a @ ('NC(=O)', '')::bingo.sub
+
 select 'CC' @ 'CC'
 select ('CC', '')::molquery @ 'CC'
 drop table btest_idx_shadow
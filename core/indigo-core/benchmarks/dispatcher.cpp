@@ -0,0 +1,248 @@
+// OsCommandDispatcher overhead and indexing-like throughput.
+//
+// Usage: indigo-core-dispatcher-benchmark [records] [threads] [batch]
+//
+// Empty runs dispatch two trivial commands per run() and show the cost of
+// starting a run. Indexing loads SMILES records and builds their Bingo
+// fingerprints in commands of 30 records, like IndexingDispatcher, with the
+// results handled in serial order. Records are indexed in one run and in
+// runs of the given batch size, the way the database cartridges call the
+// dispatcher once per buffer of records. A new dispatcher is created for
+// every run, like the callers do. The mixed set has a large macrocycle
+// every MACROCYCLE_INTERVAL records, those commands are much slower than
+// the rest and the results after them wait in serial order.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base_c/nano.h"
+#include "base_cpp/array.h"
+#include "base_cpp/os_thread_wrapper.h"
+#include "base_cpp/scanner.h"
+#include "molecule/molecule.h"
+#include "molecule/molecule_fingerprint.h"
+#include "molecule/smiles_loader.h"
+
+using namespace indigo;
+
+namespace
+{
+    const int RECORDS_PER_COMMAND = 30;
+    const int MACROCYCLE_INTERVAL = 500;
+
+    const char* _smiles[] = {
+        "CC(=O)Oc1ccccc1C(=O)O",
+        "CN1C=NC2=C1C(=O)N(C(=O)N2C)C",
+        "CC(C)Cc1ccc(cc1)C(C)C(=O)O",
+        "CN1CCC23C4C1CC5=C2C(=C(C=C5)O)OC3C(C=C4)O",
+        "CC(C)NCC(O)COc1cccc2ccccc12",
+        "OC(=O)CC(O)(CC(O)=O)C(O)=O",
+        "CCN(CC)CCNC(=O)c1ccc(N)cc1",
+        "Clc1ccc2c(c1)C(=NCC(=O)N2C)c3ccccc3",
+        "CC1=C(C(=O)OC2=CC=CC=C12)CC(=O)C3=CC=CC=C3",
+        "NC(=O)N1c2ccccc2C=Cc3ccccc13",
+        "CCCCCCCCCCCCCCCC(=O)OCC(O)CO",
+        "c1ccc(cc1)Cc2ccccc2",
+        "CCOC(=O)c1ccc(cc1)N",
+        "COc1ccc(cc1)CCN",
+        "CC(C)(C)NCC(O)c1ccc(O)c(CO)c1",
+        "O=C(O)c1ccccc1O",
+    };
+
+    const char* _side_chains[] = {"C", "CC(C)C", "Cc1ccccc1", "CO", "CCSC", "CCC(N)=O"};
+
+    // Cyclic peptide with the given number of residues
+    std::string _macrocycle(int residues, int seed)
+    {
+        std::string smiles = "N1";
+        for (int i = 0; i < residues - 1; i++)
+            smiles += std::string("C(") + _side_chains[(seed + i) % 6] + ")C(=O)N";
+        smiles += std::string("C(") + _side_chains[(seed + residues) % 6] + ")C1=O";
+        return smiles;
+    }
+
+    class _EmptyDispatcher : public OsCommandDispatcher
+    {
+    public:
+        _EmptyDispatcher() : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _left(2)
+        {
+        }
+
+    protected:
+        class _Command : public OsCommand
+        {
+        public:
+            void execute(OsCommandResult& result) override
+            {
+            }
+        };
+
+        OsCommand* _allocateCommand() override
+        {
+            return new _Command();
+        }
+
+        bool _setupCommand(OsCommand& command) override
+        {
+            return _left-- > 0;
+        }
+
+    private:
+        int _left;
+    };
+
+    class _IndexingDispatcher : public OsCommandDispatcher
+    {
+    public:
+        _IndexingDispatcher(const std::vector<std::string>& records, const MoleculeFingerprintParameters& parameters, int from, int to, dword& checksum)
+            : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _records(records), _parameters(parameters), _next(from), _end(to), _checksum(checksum)
+        {
+        }
+
+    protected:
+        class _Result : public OsCommandResult
+        {
+        public:
+            void clear() override
+            {
+                fingerprints.clear();
+            }
+
+            Array<byte> fingerprints;
+        };
+
+        class _Command : public OsCommand
+        {
+        public:
+            void execute(OsCommandResult& result) override
+            {
+                Array<byte>& fingerprints = static_cast<_Result&>(result).fingerprints;
+                for (int i = from; i < to; i++)
+                {
+                    Molecule mol;
+                    BufferScanner scanner((*records)[i].c_str());
+                    SmilesLoader loader(scanner);
+                    loader.loadMolecule(mol);
+
+                    MoleculeFingerprintBuilder builder(mol, *parameters);
+                    builder.process();
+                    fingerprints.concat(builder.get(), parameters->fingerprintSize());
+                }
+            }
+
+            const std::vector<std::string>* records;
+            const MoleculeFingerprintParameters* parameters;
+            int from, to;
+        };
+
+        OsCommand* _allocateCommand() override
+        {
+            return new _Command();
+        }
+
+        OsCommandResult* _allocateResult() override
+        {
+            return new _Result();
+        }
+
+        bool _setupCommand(OsCommand& command) override
+        {
+            if (_next >= _end)
+                return false;
+
+            _Command& cmd = static_cast<_Command&>(command);
+            cmd.records = &_records;
+            cmd.parameters = &_parameters;
+            cmd.from = _next;
+            cmd.to = std::min(_next + RECORDS_PER_COMMAND, _end);
+            _next = cmd.to;
+            return true;
+        }
+
+        void _handleResult(OsCommandResult& result) override
+        {
+            Array<byte>& fingerprints = static_cast<_Result&>(result).fingerprints;
+            for (int i = 0; i < fingerprints.size(); i++)
+                _checksum = _checksum * 31 + fingerprints[i];
+        }
+
+    private:
+        const std::vector<std::string>& _records;
+        const MoleculeFingerprintParameters& _parameters;
+        int _next, _end;
+        dword& _checksum;
+    };
+
+    void _report(const char* mode, double count, const char* unit, qword start)
+    {
+        float seconds = nanoHowManySeconds(nanoClock() - start);
+        printf("%-18s %10.1f %s\n", mode, count / seconds / 1e3, unit);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int count = (argc > 1 ? atoi(argv[1]) : 20000);
+    int threads = (argc > 2 ? atoi(argv[2]) : -1);
+    int batch = (argc > 3 ? atoi(argv[3]) : 300);
+
+    std::vector<std::string> records;
+    for (int i = 0; i < count; i++)
+        records.push_back(_smiles[i % NELEM(_smiles)]);
+
+    printf("%d records, threads %d (-1 - automatic), batch %d\n\n", count, threads, batch);
+
+    const int empty_runs = 2000;
+    qword start = nanoClock();
+    for (int i = 0; i < empty_runs; i++)
+    {
+        _EmptyDispatcher empty;
+        empty.run(threads);
+    }
+    _report("empty runs", empty_runs, "k runs/s", start);
+
+    MoleculeFingerprintParameters parameters;
+    parameters.ext = true;
+    parameters.ord_qwords = 25;
+    parameters.any_qwords = 15;
+    parameters.tau_qwords = 10;
+    parameters.sim_qwords = 8;
+
+    dword single_checksum = 0;
+    start = nanoClock();
+    {
+        _IndexingDispatcher dispatcher(records, parameters, 0, count, single_checksum);
+        dispatcher.run(threads);
+    }
+    _report("index one run", count, "k records/s", start);
+
+    dword batched_checksum = 0;
+    start = nanoClock();
+    for (int from = 0; from < count; from += batch)
+    {
+        _IndexingDispatcher dispatcher(records, parameters, from, std::min(from + batch, count), batched_checksum);
+        dispatcher.run(threads);
+    }
+    _report("index batches", count, "k records/s", start);
+
+    if (single_checksum != batched_checksum)
+        printf("fingerprints differ\n");
+
+    std::vector<std::string> mixed(records);
+    for (int i = MACROCYCLE_INTERVAL / 2; i < count; i += MACROCYCLE_INTERVAL)
+        mixed[i] = _macrocycle(30, i);
+
+    dword mixed_checksum = 0;
+    start = nanoClock();
+    {
+        _IndexingDispatcher dispatcher(mixed, parameters, 0, count, mixed_checksum);
+        dispatcher.run(threads);
+    }
+    _report("index mixed", count, "k records/s", start);
+
+    return 0;
+}
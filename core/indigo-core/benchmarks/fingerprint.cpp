@@ -0,0 +1,116 @@
+// Fingerprint generation with and without MoleculeFragmentHashCache, on
+// drug-like molecules that share rings and chains like a screening library.
+//
+// Usage: indigo-core-fingerprint-benchmark [repeats]
+//
+// Fingerprints have the default Indigo layout (ORD, ANY, TAU and SIM parts).
+// Every molecule is fingerprinted once per repeat, first with the cache
+// disabled, then with a cold and a warm cache, and the fingerprints of all
+// modes are compared. The hit rate counts the fragment hash lookups answered
+// from the cache.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "base_c/nano.h"
+#include "base_cpp/array.h"
+#include "base_cpp/scanner.h"
+#include "molecule/molecule.h"
+#include "molecule/molecule_fingerprint.h"
+#include "molecule/molecule_fragment_hash_cache.h"
+#include "molecule/smiles_loader.h"
+
+using namespace indigo;
+
+namespace
+{
+    const char* _smiles[] = {
+        "CC(=O)Oc1ccccc1C(=O)O",
+        "CN1C=NC2=C1C(=O)N(C(=O)N2C)C",
+        "CC(C)Cc1ccc(cc1)C(C)C(=O)O",
+        "CN1CCC23C4C1CC5=C2C(=C(C=C5)O)OC3C(C=C4)O",
+        "CC(C)NCC(O)COc1cccc2ccccc12",
+        "OC(=O)CC(O)(CC(O)=O)C(O)=O",
+        "CCN(CC)CCNC(=O)c1ccc(N)cc1",
+        "Clc1ccc2c(c1)C(=NCC(=O)N2C)c3ccccc3",
+        "CC1=C(C(=O)OC2=CC=CC=C12)CC(=O)C3=CC=CC=C3",
+        "NC(=O)N1c2ccccc2C=Cc3ccccc13",
+        "CCCCCCCCCCCCCCCC(=O)OCC(O)CO",
+        "c1ccc(cc1)Cc2ccccc2",
+        "CCOC(=O)c1ccc(cc1)N",
+        "COc1ccc(cc1)CCN",
+        "CC(C)(C)NCC(O)c1ccc(O)c(CO)c1",
+        "O=C(O)c1ccccc1O",
+    };
+
+    void _build(const MoleculeFingerprintParameters& parameters, std::vector<std::unique_ptr<Molecule>>& mols, bool use_cache, Array<byte>& fingerprints)
+    {
+        int size = parameters.fingerprintSize();
+        fingerprints.clear_resize((int)mols.size() * size);
+        for (int i = 0; i < (int)mols.size(); i++)
+        {
+            MoleculeFingerprintBuilder builder(*mols[i], parameters);
+            builder.use_fragment_cache = use_cache;
+            builder.process();
+            memcpy(fingerprints.ptr() + i * size, builder.get(), size);
+        }
+    }
+
+    void _report(const char* mode, int count, qword start)
+    {
+        float seconds = nanoHowManySeconds(nanoClock() - start);
+        printf("%-18s %10.2f kmol/s", mode, count / seconds / 1e3);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int repeats = (argc > 1 ? atoi(argv[1]) : 20);
+
+    std::vector<std::unique_ptr<Molecule>> mols;
+    for (const char* smiles : _smiles)
+    {
+        BufferScanner scanner(smiles);
+        SmilesLoader loader(scanner);
+        mols.emplace_back(new Molecule());
+        loader.loadMolecule(*mols.back());
+    }
+
+    MoleculeFingerprintParameters parameters;
+    parameters.ext = true;
+    parameters.similarity_type = SimilarityType::SIM;
+    parameters.ord_qwords = 25;
+    parameters.any_qwords = 15;
+    parameters.tau_qwords = 10;
+    parameters.sim_qwords = 8;
+
+    int count = (int)mols.size() * repeats;
+    Array<byte> reference, fingerprints;
+
+    qword start = nanoClock();
+    for (int r = 0; r < repeats; r++)
+        _build(parameters, mols, false, reference);
+    _report("no cache", count, start);
+    printf("\n");
+
+    MoleculeFragmentHashCache& cache = MoleculeFragmentHashCache::getThreadCache();
+    const char* modes[] = {"cold cache", "warm cache"};
+    for (const char* mode : modes)
+    {
+        if (mode == modes[0])
+            cache.clear();
+        cache.resetCounters();
+
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            _build(parameters, mols, true, fingerprints);
+        _report(mode, count, start);
+        printf("  %5.1f%% hits, %d entries%s\n", cache.getHitRate() * 100, cache.size(), fingerprints.memcmp(reference) ? ", fingerprints differ" : "");
+    }
+
+    return 0;
+}
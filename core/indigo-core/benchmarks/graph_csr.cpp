@@ -0,0 +1,242 @@
+// Neighbor walks over the linked adjacency lists of Graph and over the
+// GraphCsr snapshot, on drug-like molecules and on macrocycles.
+//
+// Usage: indigo-core-graph-benchmark [repeats]
+//
+// For every set, Morgan-like code refinement (each vertex sums the codes of
+// its neighbors) is run with both adjacency representations, and the time to
+// build the snapshots is reported. Substructure matching and canonical SMILES
+// throughput are reported too, as both use the snapshot through
+// EmbeddingEnumerator and AutomorphismSearch, next to MoleculeCanonicalHash
+// that skips the SMILES string. ECFP4 throughput is reported for one reused
+// MoleculeMorganFingerprintBuilder and for its batch entry point.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base_c/nano.h"
+#include "base_cpp/array.h"
+#include "base_cpp/output.h"
+#include "base_cpp/scanner.h"
+#include "graph/graph_csr.h"
+#include "molecule/canonical_smiles_saver.h"
+#include "molecule/molecule.h"
+#include "molecule/molecule_canonical_hash.h"
+#include "molecule/molecule_morgan_fingerprint_builder.h"
+#include "molecule/molecule_substructure_matcher.h"
+#include "molecule/query_molecule.h"
+#include "molecule/smiles_loader.h"
+
+using namespace indigo;
+
+namespace
+{
+    const int REFINE_ITERATIONS = 8;
+
+    const char* _drug_like[] = {
+        "CC(=O)Oc1ccccc1C(=O)O",
+        "CN1C=NC2=C1C(=O)N(C(=O)N2C)C",
+        "CC(C)Cc1ccc(cc1)C(C)C(=O)O",
+        "Cc1ccc(cc1Nc2nccc(n2)c3cccnc3)NC(=O)c4ccc(cc4)CN5CCN(CC5)C",
+        "CN1CCC23C4C1CC5=C2C(=C(C=C5)O)OC3C(C=C4)O",
+        "COc1ccc2nc(sc2c1)S(=O)Cc3ncc(C)c(OC)c3C",
+        "CC(C)NCC(O)COc1cccc2ccccc12",
+        "OC(=O)CC(O)(CC(O)=O)C(O)=O",
+        "CCN(CC)CCNC(=O)c1ccc(N)cc1",
+        "Clc1ccc2c(c1)C(=NCC(=O)N2C)c3ccccc3",
+        "CC1=C(C(=O)OC2=CC=CC=C12)CC(=O)C3=CC=CC=C3",
+        "NC(=O)N1c2ccccc2C=Cc3ccccc13",
+    };
+
+    const char* _side_chains[] = {"C", "CC(C)C", "Cc1ccccc1", "CO", "CCSC", "CCC(N)=O"};
+
+    // Cyclic peptide with the given number of residues
+    std::string _macrocycle(int residues, int seed)
+    {
+        std::string smiles = "N1";
+        for (int i = 0; i < residues - 1; i++)
+            smiles += std::string("C(") + _side_chains[(seed + i) % 6] + ")C(=O)N";
+        smiles += std::string("C(") + _side_chains[(seed + residues) % 6] + ")C1=O";
+        return smiles;
+    }
+
+    void _load(const std::vector<std::string>& smiles, std::vector<std::unique_ptr<Molecule>>& mols)
+    {
+        for (auto& s : smiles)
+        {
+            BufferScanner scanner(s.c_str());
+            SmilesLoader loader(scanner);
+            mols.emplace_back(new Molecule());
+            loader.loadMolecule(*mols.back());
+        }
+    }
+
+    dword _refineList(const Graph& g, Array<dword>& codes, Array<dword>& old_codes)
+    {
+        codes.clear_resize(g.vertexEnd());
+        codes.fill(1);
+        old_codes.clear_resize(g.vertexEnd());
+        for (int iter = 0; iter < REFINE_ITERATIONS; iter++)
+        {
+            old_codes.copy(codes);
+            for (int v = g.vertexBegin(); v != g.vertexEnd(); v = g.vertexNext(v))
+            {
+                const Vertex& vertex = g.getVertex(v);
+                for (int i = vertex.neiBegin(); i != vertex.neiEnd(); i = vertex.neiNext(i))
+                    codes[v] += old_codes[vertex.neiVertex(i)] * 31 + vertex.neiEdge(i);
+            }
+        }
+        dword sum = 0;
+        for (int v = g.vertexBegin(); v != g.vertexEnd(); v = g.vertexNext(v))
+            sum += codes[v];
+        return sum;
+    }
+
+    dword _refineCsr(const GraphCsr& csr, Array<dword>& codes, Array<dword>& old_codes)
+    {
+        codes.clear_resize(csr.vertexEnd());
+        codes.fill(1);
+        old_codes.clear_resize(csr.vertexEnd());
+        const int* vertices = csr.getVertices();
+        for (int iter = 0; iter < REFINE_ITERATIONS; iter++)
+        {
+            old_codes.copy(codes);
+            for (int k = 0; k < csr.vertexCount(); k++)
+            {
+                int v = vertices[k];
+                int degree = csr.degree(v);
+                const int* nei_vertices = csr.getNeiVertices(v);
+                const int* nei_edges = csr.getNeiEdges(v);
+                for (int i = 0; i < degree; i++)
+                    codes[v] += old_codes[nei_vertices[i]] * 31 + nei_edges[i];
+            }
+        }
+        dword sum = 0;
+        for (int k = 0; k < csr.vertexCount(); k++)
+            sum += codes[vertices[k]];
+        return sum;
+    }
+
+    void _report(const char* mode, int count, qword start)
+    {
+        float seconds = nanoHowManySeconds(nanoClock() - start);
+        printf("  %-18s %10.1f kmol/s\n", mode, count / seconds / 1e3);
+    }
+
+    void _run(const char* name, std::vector<std::unique_ptr<Molecule>>& mols, int repeats)
+    {
+        int atoms = 0;
+        for (auto& mol : mols)
+            atoms += mol->vertexCount();
+        printf("%s: %d molecules, %.1f atoms on average\n", name, (int)mols.size(), (double)atoms / mols.size());
+
+        int count = (int)mols.size() * repeats;
+        Array<dword> codes, old_codes;
+
+        qword start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& mol : mols)
+            {
+                GraphCsr csr;
+                csr.build(*mol);
+            }
+        _report("csr build", count, start);
+
+        dword list_sum = 0, csr_sum = 0;
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& mol : mols)
+                list_sum += _refineList(*mol, codes, old_codes);
+        _report("list refine", count, start);
+
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& mol : mols)
+                csr_sum += _refineCsr(mol->getCsr(), codes, old_codes);
+        _report("csr refine", count, start);
+
+        if (list_sum != csr_sum)
+            printf("  refinement results differ\n");
+
+        QueryMolecule query;
+        BufferScanner query_scanner("C(=O)NC");
+        SmilesLoader query_loader(query_scanner);
+        query_loader.loadQueryMolecule(query);
+
+        int matched = 0;
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& mol : mols)
+            {
+                MoleculeSubstructureMatcher matcher(*mol);
+                matcher.setQuery(query);
+                if (matcher.find())
+                    matched++;
+            }
+        _report("substructure", count, start);
+
+        Array<char> out;
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& mol : mols)
+            {
+                ArrayOutput output(out);
+                CanonicalSmilesSaver saver(output);
+                saver.saveMolecule(*mol);
+            }
+        _report("canonical smiles", count, start);
+
+        MoleculeCanonicalHash canonical_hash;
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& mol : mols)
+                canonical_hash.calculate(*mol);
+        _report("canonical hash", count, start);
+
+        const int fp_bytes = 256;
+        MoleculeMorganFingerprintBuilder morgan;
+        Array<byte> fp;
+        fp.resize(fp_bytes);
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& mol : mols)
+            {
+                morgan.setMolecule(*mol);
+                morgan.packFingerprintECFP(2, fp);
+            }
+        _report("ecfp4", count, start);
+
+        Array<BaseMolecule*> batch;
+        for (auto& mol : mols)
+            batch.push(mol.get());
+        Array<byte> fps;
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            morgan.packFingerprintsECFP(2, batch, fp_bytes, fps);
+        _report("ecfp4 batch", count, start);
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int repeats = (argc > 1 ? atoi(argv[1]) : 200);
+
+    std::vector<std::string> drug_like(std::begin(_drug_like), std::end(_drug_like));
+    std::vector<std::string> macrocycles;
+    for (int residues = 8; residues <= 24; residues += 2)
+        macrocycles.push_back(_macrocycle(residues, residues));
+
+    std::vector<std::unique_ptr<Molecule>> drug_like_mols, macrocycle_mols;
+    _load(drug_like, drug_like_mols);
+    _load(macrocycles, macrocycle_mols);
+
+    _run("drug-like", drug_like_mols, repeats);
+    _run("macrocycles", macrocycle_mols, repeats / 4 + 1);
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Exact maximum common substructure search in one thread and with the
+// search tree shared by worker threads, on pairs like the MCS unit tests.
+//
+// Usage: indigo-core-mcs-benchmark [threads] [timeout_ms]
+//
+// For every pair the single-threaded and the multi-threaded searches are
+// timed, and the size of the best solution is printed. The last pair does
+// not finish in reasonable time, it is searched in the anytime mode with a
+// TimeoutCancellationHandler, which returns the best solution found before
+// the timeout.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base_c/nano.h"
+#include "base_cpp/array.h"
+#include "base_cpp/cancellation_handler.h"
+#include "base_cpp/scanner.h"
+#include "molecule/max_common_submolecule.h"
+#include "molecule/molecule.h"
+#include "molecule/smiles_loader.h"
+
+using namespace indigo;
+
+namespace
+{
+    const char* _pairs[][2] = {
+        {"C1C(=CC(=CC=1C1C=CC=CC=1)C1C=CC=CC=1)C1C=CC=CC=1", "C1C(=CC=CC=1C1C=CC=CC=1C1C=CC=CC=1)C1C=CC=CC=1"},
+        {"Cc1ccc(cc1Nc2nccc(n2)c3cccnc3)NC(=O)c4ccc(cc4)CN5CCN(CC5)C", "Cc1ccc(cc1Nc2nccc(n2)c3cccnc3)NC(=O)c4ccccc4"},
+        {"CN1CCC23C4C1CC5=C2C(=C(C=C5)O)OC3C(C=C4)O", "CN1CCC23C4C1CC5=C2C(=C(C=C5)OC)OC3C(=O)CC4"},
+        {"CC12CCC3C(CCC4=CC(=O)CCC34C)C1CCC2O", "CC12CCC3C(CCc4cc(O)ccc34)C1CCC2O"},
+    };
+
+    const char* _hard_pair[2] = {
+        "CC1CC2CCC3CC4=CC=C5CCCC6=C/C=C7/C8CCCC9CC%10CCCC%11CC%12=C(C(C%10%11)C89)C7=CC(C2=C3CC4=C56)=C1%12",
+        "C1CC2CC3CCCC4C3C3C2C(C1)C1CCC2CC5CCC6CC7=CC=C8CCCC9=C%10C=C4C4=C%11C(C5=C6C(C7=C89)=C%10%11)=C2C1=C34"};
+
+    void _load(const char* smiles, Molecule& mol)
+    {
+        BufferScanner scanner(smiles);
+        SmilesLoader loader(scanner);
+        loader.loadMolecule(mol);
+    }
+
+    int _mapSize(const Array<int>& map)
+    {
+        int size = 0;
+        for (int i = 0; i < map.size(); i++)
+            if (map[i] >= 0)
+                size++;
+        return size;
+    }
+
+    void _run(const char* mode, Molecule& mol1, Molecule& mol2, int threads, bool anytime)
+    {
+        MaxCommonSubmolecule mcs(mol1, mol2);
+        mcs.parametersForExact.threadCount = threads;
+        mcs.parametersForExact.anytime = anytime;
+
+        qword start = nanoClock();
+        mcs.findExactMCS();
+        float seconds = nanoHowManySeconds(nanoClock() - start);
+
+        Array<int> v_map;
+        mcs.getMaxSolutionMap(&v_map, 0);
+        printf("  %-18s %10.3f s  %3d atoms  %4d solutions%s\n", mode, seconds, _mapSize(v_map), mcs.parametersForExact.numberOfSolutions,
+               mcs.parametersForExact.isStopped ? "  (stopped)" : "");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int threads = (argc > 1 ? atoi(argv[1]) : 4);
+    int timeout_ms = (argc > 2 ? atoi(argv[2]) : 2000);
+
+    char mode[32];
+    snprintf(mode, sizeof(mode), "%d threads", threads);
+
+    for (auto& pair : _pairs)
+    {
+        Molecule mol1, mol2;
+        _load(pair[0], mol1);
+        _load(pair[1], mol2);
+
+        printf("%d and %d atoms\n", mol1.vertexCount(), mol2.vertexCount());
+        _run("1 thread", mol1, mol2, 1, false);
+        _run(mode, mol1, mol2, threads, false);
+    }
+
+    Molecule mol1, mol2;
+    _load(_hard_pair[0], mol1);
+    _load(_hard_pair[1], mol2);
+
+    printf("%d and %d atoms, anytime with %d ms timeout\n", mol1.vertexCount(), mol2.vertexCount(), timeout_ms);
+    resetCancellationHandler(new TimeoutCancellationHandler(timeout_ms));
+    _run("1 thread", mol1, mol2, 1, true);
+    resetCancellationHandler(new TimeoutCancellationHandler(timeout_ms));
+    _run(mode, mol1, mol2, threads, true);
+    resetCancellationHandler(nullptr);
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+// Heap traffic and throughput of streaming molecule loading, with the
+// storage of every record on the heap and in an ArenaAllocator.
+//
+// Usage: indigo-core-arena-benchmark [repeats]
+//
+// Drug-like molecules and cyclic peptides are loaded from SMILES and from
+// Molfiles like a streaming loader does: one molecule per record, built and
+// dropped before the next one. With the arena, every record is built inside
+// an ArenaAllocator::Scope and the arena is reset after it. Heap calls per
+// record (malloc, calloc, realloc and free, counted with glibc only) and
+// arena blocks per record are reported next to the throughput.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "base_c/nano.h"
+#include "base_cpp/arena_allocator.h"
+#include "base_cpp/array.h"
+#include "base_cpp/output.h"
+#include "base_cpp/scanner.h"
+#include "molecule/molecule.h"
+#include "molecule/molfile_loader.h"
+#include "molecule/molfile_saver.h"
+#include "molecule/smiles_loader.h"
+
+using namespace indigo;
+
+#ifdef __GLIBC__
+// Heap calls are counted by wrapping the glibc allocator
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void __libc_free(void* ptr);
+}
+
+static qword _heap_calls = 0;
+
+void* malloc(size_t size)
+{
+    _heap_calls++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    _heap_calls++;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    _heap_calls++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    if (ptr != nullptr)
+        _heap_calls++;
+    __libc_free(ptr);
+}
+
+static const bool _heap_calls_counted = true;
+#else
+static qword _heap_calls = 0;
+static const bool _heap_calls_counted = false;
+#endif
+
+namespace
+{
+    const char* _drug_like[] = {
+        "CC(=O)Oc1ccccc1C(=O)O",
+        "CN1C=NC2=C1C(=O)N(C(=O)N2C)C",
+        "CC(C)Cc1ccc(cc1)C(C)C(=O)O",
+        "Cc1ccc(cc1Nc2nccc(n2)c3cccnc3)NC(=O)c4ccc(cc4)CN5CCN(CC5)C",
+        "CN1CCC23C4C1CC5=C2C(=C(C=C5)O)OC3C(C=C4)O",
+        "COc1ccc2nc(sc2c1)S(=O)Cc3ncc(C)c(OC)c3C",
+        "CC(C)NCC(O)COc1cccc2ccccc12",
+        "OC(=O)CC(O)(CC(O)=O)C(O)=O",
+        "CCN(CC)CCNC(=O)c1ccc(N)cc1",
+        "Clc1ccc2c(c1)C(=NCC(=O)N2C)c3ccccc3",
+        "CC1=C(C(=O)OC2=CC=CC=C12)CC(=O)C3=CC=CC=C3",
+        "NC(=O)N1c2ccccc2C=Cc3ccccc13",
+    };
+
+    const char* _side_chains[] = {"C", "CC(C)C", "Cc1ccccc1", "CO", "CCSC", "CCC(N)=O"};
+
+    // Cyclic peptide with the given number of residues
+    std::string _macrocycle(int residues, int seed)
+    {
+        std::string smiles = "N1";
+        for (int i = 0; i < residues - 1; i++)
+            smiles += std::string("C(") + _side_chains[(seed + i) % 6] + ")C(=O)N";
+        smiles += std::string("C(") + _side_chains[(seed + residues) % 6] + ")C1=O";
+        return smiles;
+    }
+
+    void _loadSmiles(const std::string& record, Molecule& mol)
+    {
+        BufferScanner scanner(record.c_str());
+        SmilesLoader loader(scanner);
+        loader.loadMolecule(mol);
+    }
+
+    void _loadMolfile(const std::string& record, Molecule& mol)
+    {
+        BufferScanner scanner(record.c_str());
+        MolfileLoader loader(scanner);
+        loader.loadMolecule(mol);
+    }
+
+    std::string _toMolfile(const std::string& smiles)
+    {
+        Molecule mol;
+        _loadSmiles(smiles, mol);
+        Array<char> buf;
+        ArrayOutput output(buf);
+        MolfileSaver saver(output);
+        saver.saveMolecule(mol);
+        return std::string(buf.ptr(), buf.size());
+    }
+
+    void _report(const char* mode, int count, qword start, qword heap_calls, size_t arena_blocks)
+    {
+        float seconds = nanoHowManySeconds(nanoClock() - start);
+        printf("  %-18s %10.1f kmol/s", mode, count / seconds / 1e3);
+        if (_heap_calls_counted)
+            printf("  %8.1f heap calls/mol", (double)heap_calls / count);
+        printf("  %8.1f arena blocks/mol\n", (double)arena_blocks / count);
+    }
+
+    void _run(const char* name, const std::vector<std::string>& records, void (*load)(const std::string&, Molecule&), int repeats)
+    {
+        printf("%s: %d records\n", name, (int)records.size());
+        int count = (int)records.size() * repeats;
+        int atoms = 0;
+
+        qword heap_calls = _heap_calls;
+        qword start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& record : records)
+            {
+                Molecule mol;
+                load(record, mol);
+                atoms += mol.vertexCount();
+            }
+        _report("heap", count, start, _heap_calls - heap_calls, 0);
+
+        ArenaAllocator arena;
+        // Warm up the chunks
+        for (auto& record : records)
+        {
+            ArenaAllocator::Scope scope(arena);
+            Molecule mol;
+            load(record, mol);
+            arena.reset();
+        }
+
+        size_t arena_blocks = arena.allocationCount();
+        heap_calls = _heap_calls;
+        start = nanoClock();
+        for (int r = 0; r < repeats; r++)
+            for (auto& record : records)
+            {
+                {
+                    ArenaAllocator::Scope scope(arena);
+                    Molecule mol;
+                    load(record, mol);
+                    atoms -= mol.vertexCount();
+                }
+                arena.reset();
+            }
+        _report("arena", count, start, _heap_calls - heap_calls, arena.allocationCount() - arena_blocks);
+
+        if (atoms != 0)
+            printf("  loaded molecules differ\n");
+        printf("  %.1f KB of arena chunks\n\n", arena.reservedBytes() / 1024.0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int repeats = (argc > 1 ? atoi(argv[1]) : 200);
+
+    std::vector<std::string> smiles(std::begin(_drug_like), std::end(_drug_like));
+    for (int residues = 8; residues <= 24; residues += 2)
+        smiles.push_back(_macrocycle(residues, residues));
+
+    std::vector<std::string> molfiles;
+    for (auto& s : smiles)
+        molfiles.push_back(_toMolfile(s));
+
+    _run("smiles", smiles, _loadSmiles, repeats);
+    _run("molfile", molfiles, _loadMolfile, repeats);
+
+    return 0;
+}
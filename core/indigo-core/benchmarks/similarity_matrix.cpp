@@ -0,0 +1,95 @@
+// All-pairs similarity of fingerprint sets, pair by pair and with the
+// blocked FingerprintMatrix search.
+//
+// Usage: indigo-core-similarity-benchmark [count] [fp_bytes] [threads]
+//
+// Random fingerprints with about a quarter of the bits set are compared all
+// against all. The pair by pair loop calls bitCommonOnes for every pair like
+// repeated indigoSimilarity() calls on fingerprints do. The full matrix, the
+// thresholded pairs and the top 10 neighbors are then computed on one thread
+// and on the given number of threads (0 - one per core).
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base_c/bitarray.h"
+#include "base_c/nano.h"
+#include "base_cpp/array.h"
+#include "base_cpp/fingerprint_matrix.h"
+
+using namespace indigo;
+
+namespace
+{
+    void _report(const char* mode, double pairs, qword start)
+    {
+        float seconds = nanoHowManySeconds(nanoClock() - start);
+        printf("%-18s %10.1f Mpairs/s\n", mode, pairs / seconds / 1e6);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int count = (argc > 1 ? atoi(argv[1]) : 4000);
+    int fp_bytes = (argc > 2 ? atoi(argv[2]) : 128);
+    int threads = (argc > 3 ? atoi(argv[3]) : 0);
+
+    FingerprintMatrix matrix;
+    matrix.clear(fp_bytes);
+    Array<byte> fp;
+    fp.clear_resize(fp_bytes);
+    unsigned seed = 42;
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < fp_bytes; j++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            fp[j] = (byte)((seed >> 16) & (seed >> 8));
+        }
+        matrix.add(fp.ptr());
+    }
+
+    double pairs = (double)count * count;
+    printf("%d fingerprints of %d bytes\n\n", count, fp_bytes);
+
+    FingerprintMatrix::Metrics metrics;
+    Array<float> reference, similarities;
+    reference.clear_resize(count * count);
+    similarities.clear_resize(count * count);
+
+    qword start = nanoClock();
+    for (int i = 0; i < count; i++)
+        for (int j = 0; j < count; j++)
+            reference[i * count + j] = metrics.similarity(matrix.ones(i), matrix.ones(j), bitCommonOnes(matrix.row(i), matrix.row(j), fp_bytes));
+    _report("pair by pair", pairs, start);
+
+    const int k = 10;
+    Array<int> neighbors, pair_rows, pair_columns;
+    Array<float> top_similarities, pair_similarities;
+    neighbors.clear_resize(count * k);
+    top_similarities.clear_resize(count * k);
+
+    for (int thread_count : {1, threads})
+    {
+        char mode[32];
+
+        start = nanoClock();
+        FingerprintMatrix::similarities(matrix, matrix, metrics, thread_count, similarities.ptr());
+        snprintf(mode, sizeof(mode), "full, %d thr", thread_count);
+        _report(mode, pairs, start);
+        if (similarities.memcmp(reference) != 0)
+            printf("  similarities differ\n");
+
+        start = nanoClock();
+        FingerprintMatrix::thresholdPairs(matrix, matrix, metrics, 0.3f, thread_count, pair_rows, pair_columns, pair_similarities);
+        snprintf(mode, sizeof(mode), ">= 0.3, %d thr", thread_count);
+        _report(mode, pairs, start);
+
+        start = nanoClock();
+        FingerprintMatrix::topK(matrix, matrix, metrics, k, thread_count, neighbors.ptr(), top_similarities.ptr());
+        snprintf(mode, sizeof(mode), "top %d, %d thr", k, thread_count);
+        _report(mode, pairs, start);
+    }
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "base_cpp/arena_allocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace indigo;
+
+namespace
+{
+    const size_t ALIGNMENT = alignof(std::max_align_t);
+
+    thread_local ArenaAllocator* _current_arena = nullptr;
+
+    size_t _align(size_t size)
+    {
+        return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+}
+
+ArenaAllocator::ArenaAllocator(size_t chunk_size)
+    : _owner(std::this_thread::get_id()), _chunk_size(_align(chunk_size)), _chunk(0), _offset(0), _last(nullptr), _allocation_count(0), _chunk_allocation_count(0), _used_bytes(0)
+{
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+    for (auto& chunk : _chunks)
+        std::free(chunk.data);
+}
+
+void* ArenaAllocator::allocate(size_t size)
+{
+    size = _align(std::max(size, (size_t)1));
+
+    // Chunks kept by reset() are reused in order, the ones too small for the block are skipped
+    while (_chunk < _chunks.size() && _offset + size > _chunks[_chunk].size)
+    {
+        _chunk++;
+        _offset = 0;
+    }
+
+    if (_chunk == _chunks.size())
+    {
+        _Chunk chunk;
+        chunk.size = std::max(_chunk_size, size);
+        chunk.data = static_cast<char*>(std::malloc(chunk.size));
+        if (chunk.data == nullptr)
+            throw std::bad_alloc();
+        _chunks.push_back(chunk);
+        _chunk_allocation_count++;
+        _offset = 0;
+    }
+
+    _last = _chunks[_chunk].data + _offset;
+    _offset += size;
+    _allocation_count++;
+    _used_bytes += size;
+    return _last;
+}
+
+void* ArenaAllocator::reallocate(void* ptr, size_t old_size, size_t new_size)
+{
+    if (ptr == nullptr)
+        return allocate(new_size);
+
+    if (ptr == _last)
+    {
+        size_t start = _last - _chunks[_chunk].data;
+        size_t size = _align(std::max(new_size, (size_t)1));
+        if (start + size <= _chunks[_chunk].size)
+        {
+            _used_bytes += size - (_offset - start);
+            _offset = start + size;
+            return ptr;
+        }
+    }
+
+    void* block = allocate(new_size);
+    memcpy(block, ptr, std::min(old_size, new_size));
+    return block;
+}
+
+void ArenaAllocator::reset()
+{
+    _chunk = 0;
+    _offset = 0;
+    _last = nullptr;
+    _used_bytes = 0;
+}
+
+size_t ArenaAllocator::allocationCount() const
+{
+    return _allocation_count;
+}
+
+size_t ArenaAllocator::chunkAllocationCount() const
+{
+    return _chunk_allocation_count;
+}
+
+size_t ArenaAllocator::usedBytes() const
+{
+    return _used_bytes;
+}
+
+size_t ArenaAllocator::reservedBytes() const
+{
+    size_t bytes = 0;
+    for (auto& chunk : _chunks)
+        bytes += chunk.size;
+    return bytes;
+}
+
+bool ArenaAllocator::ownedByCurrentThread() const
+{
+    return _owner == std::this_thread::get_id();
+}
+
+ArenaAllocator* ArenaAllocator::current()
+{
+    return _current_arena;
+}
+
+ArenaAllocator::Scope::Scope(ArenaAllocator& arena) : _previous(_current_arena)
+{
+    _current_arena = arena.ownedByCurrentThread() ? &arena : nullptr;
+}
+
+ArenaAllocator::Scope::Scope(ArenaAllocator* arena) : _previous(_current_arena)
+{
+    _current_arena = arena != nullptr && arena->ownedByCurrentThread() ? arena : nullptr;
+}
+
+ArenaAllocator::Scope::~Scope()
+{
+    _current_arena = _previous;
+}
+
+ArenaAllocator::Suspend::Suspend() : _previous(_current_arena)
+{
+    _current_arena = nullptr;
+}
+
+ArenaAllocator::Suspend::~Suspend()
+{
+    _current_arena = _previous;
+}
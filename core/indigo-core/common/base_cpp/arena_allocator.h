@@ -0,0 +1,151 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __arena_allocator_h__
+#define __arena_allocator_h__
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "base_c/defs.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+    // Bump allocator for the storage of Array, and so of the containers built
+    // on it: Pool, ObjArray, ObjPool, RedBlackMap and the molecule classes.
+    //
+    // While a Scope is active on a thread, every Array constructed on that
+    // thread takes its buffers from the arena instead of the heap. Such
+    // buffers are never freed one by one: reset() releases all of them at
+    // once and keeps the chunks for the next round, so a loader that builds
+    // each record inside a scope and resets the arena afterwards stops making
+    // heap calls for it once the chunks are warm.
+    //
+    // Elements that ObjArray, ObjPool, ObjList and the object maps construct
+    // take their storage where the container does, and so does the data a
+    // Graph builds on demand, so a long-lived object keeps growing on the heap
+    // when it is used from inside a scope.
+    //
+    // Objects built inside a scope may be destroyed at any time, before or
+    // after reset(), but must not be used after it. Long-lived caches and
+    // function-local statics that can be created from inside a scope suspend
+    // it while they allocate.
+    //
+    // An arena serves only the thread that created it and takes no locks. A
+    // scope of the arena made on another thread makes the heap current, and
+    // an array of the arena that grows on another thread moves its elements
+    // to the heap, so code that hands work to other threads may be called
+    // from inside a scope.
+    class DLLEXPORT ArenaAllocator
+    {
+    public:
+        enum
+        {
+            DEFAULT_CHUNK_SIZE = 256 * 1024
+        };
+
+        explicit ArenaAllocator(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+        ~ArenaAllocator();
+
+        void* allocate(size_t size);
+
+        // Grows the block in place if it is the last one allocated, otherwise
+        // copies old_size bytes to a new block. A null ptr allocates.
+        void* reallocate(void* ptr, size_t old_size, size_t new_size);
+
+        // Releases all blocks in constant time, the chunks are kept
+        void reset();
+
+        // Blocks served since construction
+        size_t allocationCount() const;
+        // Chunks requested from the heap since construction
+        size_t chunkAllocationCount() const;
+        // Bytes of the blocks served since the last reset
+        size_t usedBytes() const;
+        // Bytes of all chunks
+        size_t reservedBytes() const;
+
+        // True on the thread that created the arena, the only one it serves
+        bool ownedByCurrentThread() const;
+
+        // Arena of the active scope on this thread, or nullptr
+        static ArenaAllocator* current();
+
+        // Makes the arena current on this thread, scopes can be nested
+        class DLLEXPORT Scope
+        {
+        public:
+            explicit Scope(ArenaAllocator& arena);
+            // Makes the arena, or the heap for nullptr, current
+            explicit Scope(ArenaAllocator* arena);
+            ~Scope();
+
+        private:
+            Scope(const Scope&);
+            ArenaAllocator* _previous;
+        };
+
+        // Makes the heap current on this thread until destroyed
+        class DLLEXPORT Suspend
+        {
+        public:
+            Suspend();
+            ~Suspend();
+
+        private:
+            Suspend(const Suspend&);
+            ArenaAllocator* _previous;
+        };
+
+    private:
+        ArenaAllocator(const ArenaAllocator&); // no implicit copy
+
+        struct _Chunk
+        {
+            char* data;
+            size_t size;
+        };
+
+        std::thread::id _owner;
+
+        std::vector<_Chunk> _chunks;
+        size_t _chunk_size;
+
+        // Chunk and offset of the free space
+        size_t _chunk;
+        size_t _offset;
+        // Last block, the only one that can grow in place
+        char* _last;
+
+        size_t _allocation_count;
+        size_t _chunk_allocation_count;
+        size_t _used_bytes;
+    };
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif // __arena_allocator_h__
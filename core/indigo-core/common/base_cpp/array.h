@@ -28,23 +28,27 @@
 #include <utility>
 
 #include "base_c/defs.h"
+#include "base_cpp/arena_allocator.h"
 #include "base_cpp/exception.h"
 
 namespace indigo
 {
     DECL_EXCEPTION(ArrayError);
 
+    // Arrays constructed while an ArenaAllocator::Scope is active keep their
+    // elements in that arena until they grow on another thread, see
+    // arena_allocator.h
     template <typename T>
     class Array
     {
     public:
         DECL_TPL_ERROR(ArrayError);
 
-        explicit Array() : _reserved(0), _length(0), _array(nullptr)
+        explicit Array() : _reserved(0), _length(0), _array(nullptr), _arena(ArenaAllocator::current())
         {
         }
 
-        Array(Array&& other) : _reserved(other._reserved), _length(other._length), _array(other._array)
+        Array(Array&& other) : _reserved(other._reserved), _length(other._length), _array(other._array), _arena(other._arena)
         {
             other._array = nullptr;
             other._length = 0;
@@ -55,7 +59,8 @@ namespace indigo
         {
             if (_array != nullptr)
             {
-                std::free(static_cast<void*>(_array));
+                if (_arena == nullptr)
+                    std::free(static_cast<void*>(_array));
                 _array = nullptr;
                 _length = 0;
                 _reserved = 0;
@@ -74,6 +79,28 @@ namespace indigo
 
             if (to_reserve > _reserved)
             {
+                if (_arena != nullptr && !_arena->ownedByCurrentThread())
+                {
+                    // The arena serves only its own thread, the elements move to the heap
+                    T* heap = static_cast<T*>(std::malloc(sizeof(T) * to_reserve));
+                    if (heap == nullptr)
+                        throw std::bad_alloc();
+                    if (_length > 0)
+                        memcpy(static_cast<void*>(heap), static_cast<void*>(_array), sizeof(T) * _length);
+                    _array = heap;
+                    _reserved = to_reserve;
+                    _arena = nullptr;
+                    return;
+                }
+
+                if (_arena != nullptr)
+                {
+                    // Arena blocks are never freed, the old one is copied only when it has elements
+                    _array = static_cast<T*>(_arena->reallocate(_length < 1 ? nullptr : _array, sizeof(T) * _reserved, sizeof(T) * to_reserve));
+                    _reserved = to_reserve;
+                    return;
+                }
+
                 if (_length < 1)
                 {
                     if (_array != nullptr)
@@ -167,6 +194,12 @@ namespace indigo
             return _length * sizeof(T);
         }
 
+        // Arena of the elements, nullptr for the heap
+        ArenaAllocator* arena() const
+        {
+            return _arena;
+        }
+
         void copy(const Array<T>& other)
         {
             copy(other._array, other._length);
@@ -363,6 +396,7 @@ namespace indigo
             std::swap(_array, other._array);
             std::swap(_reserved, other._reserved);
             std::swap(_length, other._length);
+            std::swap(_arena, other._arena);
         }
 
         T* begin()
@@ -555,6 +589,9 @@ namespace indigo
         int _reserved;
         int _length;
 
+        // Arena of the elements, nullptr for the heap
+        ArenaAllocator* _arena;
+
     private:
         Array(const Array&);                            // no implicit copy
         Array<int>& operator=(const Array<int>& right); // no copy constructor
@@ -59,6 +59,32 @@ void TimeoutCancellationHandler::reset(int mseconds)
     _currentTime = nanoClock();
 }
 
+SharedCancellationHandler::SharedCancellationHandler(CancellationHandler* handler) : _handler(handler), _cancelled(false)
+{
+}
+
+bool SharedCancellationHandler::isCancelled()
+{
+    if (_cancelled)
+        return true;
+    if (_handler == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_handler->isCancelled())
+        _cancelled = true;
+    return _cancelled;
+}
+
+const char* SharedCancellationHandler::cancelledRequestMessage()
+{
+    if (_handler == nullptr)
+        return "";
+
+    std::lock_guard<std::mutex> lock(_lock);
+    return _handler->cancelledRequestMessage();
+}
+
 CancellationHandler* indigo::getCancellationHandler()
 {
     return CancellationHandler::cancellation_handler().get();
@@ -18,7 +18,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "base_c/defs.h"
@@ -63,6 +65,25 @@ namespace indigo
         qword _currentTime;
     };
 
+    // Lets the threads working on one task share a handler that is not
+    // thread-safe, like TimeoutCancellationHandler. Calls to the wrapped
+    // handler are serialized, and once it reports cancellation the answer
+    // is returned without locking.
+    class DLLEXPORT SharedCancellationHandler : public CancellationHandler
+    {
+    public:
+        explicit SharedCancellationHandler(CancellationHandler* handler);
+        ~SharedCancellationHandler() override = default;
+
+        bool isCancelled() override;
+        const char* cancelledRequestMessage() override;
+
+    private:
+        CancellationHandler* _handler;
+        std::mutex _lock;
+        std::atomic<bool> _cancelled;
+    };
+
     // Global thread-local cancellation handler
     DLLEXPORT CancellationHandler* getCancellationHandler();
 
@@ -486,6 +486,7 @@ int Dbitset::Iterator::begin()
 {
     if (all_indexes.size() == 0)
     {
+        ArenaAllocator::Suspend suspend;
         for (unsigned int buf = 0; buf < 256; ++buf)
         {
             Array<int>& indexes = all_indexes.push();
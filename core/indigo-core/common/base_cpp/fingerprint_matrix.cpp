@@ -0,0 +1,485 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "base_cpp/fingerprint_matrix.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "base_c/bitarray.h"
+#include "base_cpp/os_thread_wrapper.h"
+#include "base_cpp/popcount_kernels.h"
+#include "base_cpp/profiling.h"
+
+using namespace indigo;
+
+IMPL_ERROR(FingerprintMatrix, "fingerprint matrix");
+
+namespace
+{
+    const int ROW_BLOCK = 64;
+
+    // Columns of a tile take about this many bytes, so they stay in the L1
+    // cache while all rows of the block are compared with them
+    const int TILE_BYTES = 1 << 15;
+    const int MIN_TILE = 16;
+}
+
+FingerprintMatrix::Metrics::Metrics() : type(TANIMOTO), alpha(0.5f), beta(0.5f)
+{
+}
+
+float FingerprintMatrix::Metrics::similarity(int row_ones, int column_ones, int common_ones) const
+{
+    if (common_ones == 0)
+        return 0.f;
+
+    switch (type)
+    {
+    case TVERSKY: {
+        float denom = (row_ones - common_ones) * alpha + (column_ones - common_ones) * beta + common_ones;
+        if (denom < 1e-6f)
+            throw Error("bad denominator");
+        return common_ones / denom;
+    }
+    case EUCLID_SUB:
+        return (float)common_ones / row_ones;
+    default:
+        return (float)common_ones / (row_ones + column_ones - common_ones);
+    }
+}
+
+FingerprintMatrix::FingerprintMatrix() : _fp_size(0)
+{
+}
+
+void FingerprintMatrix::clear(int fp_size)
+{
+    if (fp_size <= 0)
+        throw Error("fingerprint size must be positive");
+    _fp_size = fp_size;
+    _data.clear();
+    _ones.clear();
+}
+
+void FingerprintMatrix::add(const byte* fingerprint)
+{
+    int offset = _data.size();
+    _data.resize(offset + _fp_size);
+    memcpy(_data.ptr() + offset, fingerprint, _fp_size);
+    _ones.push(bitGetOnesCount(fingerprint, _fp_size));
+}
+
+int FingerprintMatrix::count() const
+{
+    return _ones.size();
+}
+
+int FingerprintMatrix::fpSize() const
+{
+    return _fp_size;
+}
+
+const byte* FingerprintMatrix::row(int idx) const
+{
+    return _data.ptr() + (size_t)idx * _fp_size;
+}
+
+int FingerprintMatrix::ones(int idx) const
+{
+    return _ones[idx];
+}
+
+//
+// FingerprintMatrix::_Search
+//
+
+class FingerprintMatrix::_Search
+{
+public:
+    enum Mode
+    {
+        FULL,
+        THRESHOLD,
+        TOP_K
+    };
+
+    // Buffers of one thread, reused for all its blocks
+    struct Workspace
+    {
+        Array<int> counts;
+
+        // Pairs of the threshold search, in tile order and then sorted by row
+        Array<int> pair_rows, pair_columns;
+        Array<float> pair_similarities;
+        Array<int> row_starts;
+        Array<int> sorted_columns;
+        Array<float> sorted_similarities;
+
+        // Heap of the k best columns of every row of the block
+        Array<int> heap_sizes;
+        Array<int> heap_columns;
+        Array<float> heap_similarities;
+
+        int block_begin, block_end;
+    };
+
+    _Search(const FingerprintMatrix& rows, const FingerprintMatrix& columns, const Metrics& metrics, Mode mode)
+        : rows(rows), columns(columns), metrics(metrics), mode(mode), threshold(0), k(0), similarities(nullptr), neighbors(nullptr), row_indices(nullptr),
+          column_indices(nullptr), pair_similarities(nullptr)
+    {
+        if (rows.count() > 0 && columns.count() > 0 && rows.fpSize() != columns.fpSize())
+            throw Error("fingerprint sizes do not match (%d and %d)", rows.fpSize(), columns.fpSize());
+    }
+
+    int blockCount() const
+    {
+        return (rows.count() + ROW_BLOCK - 1) / ROW_BLOCK;
+    }
+
+    void run(int thread_count);
+    void processBlock(int block, Workspace& ws) const;
+    void collect(Workspace& ws);
+
+    const FingerprintMatrix& rows;
+    const FingerprintMatrix& columns;
+    const Metrics& metrics;
+    Mode mode;
+
+    float threshold;
+    int k;
+
+    // Outputs
+    float* similarities;
+    int* neighbors;
+    Array<int>* row_indices;
+    Array<int>* column_indices;
+    Array<float>* pair_similarities;
+
+private:
+    static bool _worse(float sim1, int col1, float sim2, int col2)
+    {
+        return sim1 < sim2 || (sim1 == sim2 && col1 > col2);
+    }
+
+    void _pushHeap(Workspace& ws, int row, int column, float sim) const;
+    void _popHeap(Workspace& ws, int row) const;
+};
+
+void FingerprintMatrix::_Search::_pushHeap(Workspace& ws, int row, int column, float sim) const
+{
+    int* cols = ws.heap_columns.ptr() + row * k;
+    float* sims = ws.heap_similarities.ptr() + row * k;
+    int& size = ws.heap_sizes[row];
+
+    int i;
+    if (size < k)
+        i = size++;
+    else
+    {
+        // The root is the worst of the k kept columns
+        if (!_worse(sims[0], cols[0], sim, column))
+            return;
+        _popHeap(ws, row);
+        i = size++;
+    }
+
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!_worse(sim, column, sims[parent], cols[parent]))
+            break;
+        cols[i] = cols[parent];
+        sims[i] = sims[parent];
+        i = parent;
+    }
+    cols[i] = column;
+    sims[i] = sim;
+}
+
+void FingerprintMatrix::_Search::_popHeap(Workspace& ws, int row) const
+{
+    int* cols = ws.heap_columns.ptr() + row * k;
+    float* sims = ws.heap_similarities.ptr() + row * k;
+    int& size = ws.heap_sizes[row];
+
+    size--;
+    int column = cols[size];
+    float sim = sims[size];
+    int i = 0;
+    while (2 * i + 1 < size)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < size && _worse(sims[child + 1], cols[child + 1], sims[child], cols[child]))
+            child++;
+        if (!_worse(sims[child], cols[child], sim, column))
+            break;
+        cols[i] = cols[child];
+        sims[i] = sims[child];
+        i = child;
+    }
+    cols[i] = column;
+    sims[i] = sim;
+}
+
+void FingerprintMatrix::_Search::processBlock(int block, Workspace& ws) const
+{
+    const int begin = block * ROW_BLOCK;
+    const int end = std::min(begin + ROW_BLOCK, rows.count());
+    const int column_count = columns.count();
+    const int fp_size = rows.fpSize();
+    const int tile = std::max(MIN_TILE, TILE_BYTES / fp_size);
+
+    ws.block_begin = begin;
+    ws.block_end = end;
+    ws.counts.clear_resize(tile);
+    if (mode == THRESHOLD)
+    {
+        ws.pair_rows.clear();
+        ws.pair_columns.clear();
+        ws.pair_similarities.clear();
+    }
+    else if (mode == TOP_K)
+    {
+        ws.heap_sizes.clear_resize(end - begin);
+        ws.heap_sizes.zerofill();
+        ws.heap_columns.clear_resize((end - begin) * k);
+        ws.heap_similarities.clear_resize((end - begin) * k);
+    }
+
+    int* counts = ws.counts.ptr();
+    for (int tile_begin = 0; tile_begin < column_count; tile_begin += tile)
+    {
+        const int tile_size = std::min(tile, column_count - tile_begin);
+        for (int r = begin; r < end; r++)
+        {
+            PopcountKernels::commonOnes(rows.row(r), columns.row(tile_begin), nullptr, tile_size, fp_size, counts);
+            const int row_ones = rows.ones(r);
+
+            if (mode == FULL)
+            {
+                float* out = similarities + (size_t)r * column_count + tile_begin;
+                for (int j = 0; j < tile_size; j++)
+                    out[j] = metrics.similarity(row_ones, columns.ones(tile_begin + j), counts[j]);
+            }
+            else if (mode == THRESHOLD)
+            {
+                for (int j = 0; j < tile_size; j++)
+                {
+                    float sim = metrics.similarity(row_ones, columns.ones(tile_begin + j), counts[j]);
+                    if (sim >= threshold)
+                    {
+                        ws.pair_rows.push(r);
+                        ws.pair_columns.push(tile_begin + j);
+                        ws.pair_similarities.push(sim);
+                    }
+                }
+            }
+            else
+            {
+                for (int j = 0; j < tile_size; j++)
+                    _pushHeap(ws, r - begin, tile_begin + j, metrics.similarity(row_ones, columns.ones(tile_begin + j), counts[j]));
+            }
+        }
+    }
+
+    if (mode == THRESHOLD)
+    {
+        // Pairs come tile by tile, a counting sort by row keeps the column order within a row
+        ws.row_starts.clear_resize(end - begin + 1);
+        ws.row_starts.zerofill();
+        for (int i = 0; i < ws.pair_rows.size(); i++)
+            ws.row_starts[ws.pair_rows[i] - begin + 1]++;
+        for (int i = 0; i < end - begin; i++)
+            ws.row_starts[i + 1] += ws.row_starts[i];
+
+        ws.sorted_columns.clear_resize(ws.pair_columns.size());
+        ws.sorted_similarities.clear_resize(ws.pair_similarities.size());
+        for (int i = 0; i < ws.pair_rows.size(); i++)
+        {
+            int pos = ws.row_starts[ws.pair_rows[i] - begin]++;
+            ws.sorted_columns[pos] = ws.pair_columns[i];
+            ws.sorted_similarities[pos] = ws.pair_similarities[i];
+        }
+    }
+    else if (mode == TOP_K)
+    {
+        for (int r = begin; r < end; r++)
+        {
+            int* out_neighbors = neighbors + (size_t)r * k;
+            float* out_similarities = similarities + (size_t)r * k;
+            int size = ws.heap_sizes[r - begin];
+            for (int i = size; i < k; i++)
+            {
+                out_neighbors[i] = -1;
+                out_similarities[i] = 0.f;
+            }
+            // The heap yields the worst column first
+            while (size > 0)
+            {
+                size--;
+                out_neighbors[size] = ws.heap_columns[(r - begin) * k];
+                out_similarities[size] = ws.heap_similarities[(r - begin) * k];
+                _popHeap(ws, r - begin);
+            }
+        }
+    }
+}
+
+void FingerprintMatrix::_Search::collect(Workspace& ws)
+{
+    if (mode != THRESHOLD)
+        return;
+
+    // After the counting sort row_starts[i] is the end of the pairs of row i
+    int pos = 0;
+    for (int r = ws.block_begin; r < ws.block_end; r++)
+        for (; pos < ws.row_starts[r - ws.block_begin]; pos++)
+        {
+            row_indices->push(r);
+            column_indices->push(ws.sorted_columns[pos]);
+            pair_similarities->push(ws.sorted_similarities[pos]);
+        }
+}
+
+//
+// FingerprintMatrix::_Dispatcher
+//
+
+class FingerprintMatrix::_Dispatcher : public OsCommandDispatcher
+{
+public:
+    _Dispatcher(_Search& search) : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _search(search), _next_block(0)
+    {
+    }
+
+protected:
+    class _Result : public OsCommandResult
+    {
+    public:
+        _Search::Workspace workspace;
+    };
+
+    class _Command : public OsCommand
+    {
+    public:
+        void execute(OsCommandResult& result) override
+        {
+            search->processBlock(block, static_cast<_Result&>(result).workspace);
+        }
+
+        _Search* search;
+        int block;
+    };
+
+    OsCommand* _allocateCommand() override
+    {
+        return new _Command();
+    }
+
+    OsCommandResult* _allocateResult() override
+    {
+        return new _Result();
+    }
+
+    bool _setupCommand(OsCommand& command) override
+    {
+        if (_next_block == _search.blockCount())
+            return false;
+
+        _Command& cmd = static_cast<_Command&>(command);
+        cmd.search = &_search;
+        cmd.block = _next_block++;
+        return true;
+    }
+
+    void _handleResult(OsCommandResult& result) override
+    {
+        _search.collect(static_cast<_Result&>(result).workspace);
+    }
+
+private:
+    _Search& _search;
+    int _next_block;
+};
+
+void FingerprintMatrix::_Search::run(int thread_count)
+{
+    if (rows.count() == 0)
+        return;
+
+    int threads = thread_count;
+    if (threads == 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    threads = std::min(threads, blockCount());
+
+    if (threads <= 1)
+    {
+        Workspace ws;
+        for (int block = 0; block < blockCount(); block++)
+        {
+            processBlock(block, ws);
+            collect(ws);
+        }
+        return;
+    }
+
+    _Dispatcher dispatcher(*this);
+    dispatcher.run(threads);
+}
+
+void FingerprintMatrix::similarities(const FingerprintMatrix& rows, const FingerprintMatrix& columns, const Metrics& metrics, int thread_count,
+                                     float* similarities)
+{
+    profTimerStart(t, "fingerprint_matrix.similarities");
+    _Search search(rows, columns, metrics, _Search::FULL);
+    search.similarities = similarities;
+    search.run(thread_count);
+}
+
+void FingerprintMatrix::thresholdPairs(const FingerprintMatrix& rows, const FingerprintMatrix& columns, const Metrics& metrics, float threshold,
+                                       int thread_count, Array<int>& row_indices, Array<int>& column_indices, Array<float>& similarities)
+{
+    profTimerStart(t, "fingerprint_matrix.threshold");
+    row_indices.clear();
+    column_indices.clear();
+    similarities.clear();
+
+    _Search search(rows, columns, metrics, _Search::THRESHOLD);
+    search.threshold = threshold;
+    search.row_indices = &row_indices;
+    search.column_indices = &column_indices;
+    search.pair_similarities = &similarities;
+    search.run(thread_count);
+}
+
+void FingerprintMatrix::topK(const FingerprintMatrix& rows, const FingerprintMatrix& columns, const Metrics& metrics, int k, int thread_count, int* neighbors,
+                             float* similarities)
+{
+    if (k <= 0)
+        throw Error("k must be positive");
+
+    profTimerStart(t, "fingerprint_matrix.top_k");
+    _Search search(rows, columns, metrics, _Search::TOP_K);
+    search.k = k;
+    search.neighbors = neighbors;
+    search.similarities = similarities;
+    search.run(thread_count);
+}
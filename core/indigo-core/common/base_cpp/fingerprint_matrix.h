@@ -0,0 +1,100 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __fingerprint_matrix_h__
+#define __fingerprint_matrix_h__
+
+#include "base_cpp/array.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+    // Fingerprints of the same size stored row by row in one buffer, with
+    // the number of ones of every row, and the all-pairs similarity search
+    // between two matrices. Row blocks are processed by worker threads, and
+    // every row of a block is compared with a tile of columns that stays in
+    // cache, using the PopcountKernels batch counting.
+    class DLLEXPORT FingerprintMatrix
+    {
+    public:
+        // Similarity measure computed from the numbers of ones, the same
+        // formulas as indigoSimilarity() uses for fingerprints
+        struct DLLEXPORT Metrics
+        {
+            enum Type
+            {
+                TANIMOTO,
+                TVERSKY,
+                EUCLID_SUB
+            };
+
+            Metrics();
+
+            float similarity(int row_ones, int column_ones, int common_ones) const;
+
+            Type type;
+            float alpha;
+            float beta;
+        };
+
+        FingerprintMatrix();
+
+        void clear(int fp_size);
+        void add(const byte* fingerprint);
+
+        int count() const;
+        int fpSize() const;
+        const byte* row(int idx) const;
+        int ones(int idx) const;
+
+        // similarities[i * columns.count() + j] = similarity of row i and column j
+        static void similarities(const FingerprintMatrix& rows, const FingerprintMatrix& columns, const Metrics& metrics, int thread_count,
+                                 float* similarities);
+
+        // Pairs with similarity >= threshold, ordered by row and then by column
+        static void thresholdPairs(const FingerprintMatrix& rows, const FingerprintMatrix& columns, const Metrics& metrics, float threshold,
+                                   int thread_count, Array<int>& row_indices, Array<int>& column_indices, Array<float>& similarities);
+
+        // The k most similar columns of every row, in descending order of
+        // similarity and then by column. Rows with fewer than k columns are
+        // padded with -1 neighbors of similarity 0.
+        static void topK(const FingerprintMatrix& rows, const FingerprintMatrix& columns, const Metrics& metrics, int k, int thread_count, int* neighbors,
+                         float* similarities);
+
+        DECL_ERROR;
+
+    private:
+        class _Search;
+        class _Dispatcher;
+
+        int _fp_size;
+        Array<byte> _data;
+        Array<int> _ones;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif // __fingerprint_matrix_h__
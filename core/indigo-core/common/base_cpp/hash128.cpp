@@ -0,0 +1,138 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "base_cpp/hash128.h"
+
+#include <string.h>
+
+using namespace indigo;
+
+namespace
+{
+    const qword _C1 = 0x87c37b91114253d5ULL;
+    const qword _C2 = 0x4cf5ad432745937fULL;
+
+    inline qword _rotl(qword x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    inline qword _fmix(qword k)
+    {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    inline qword _readBytes(const byte* data, int count)
+    {
+        qword value = 0;
+        for (int i = count - 1; i >= 0; i--)
+            value = (value << 8) | data[i];
+        return value;
+    }
+}
+
+Hash128 Hash128::get(const char* data, int len, dword seed)
+{
+    const byte* bytes = (const byte*)data;
+    int nblocks = len / 16;
+
+    qword h1 = seed;
+    qword h2 = seed;
+
+    for (int i = 0; i < nblocks; i++)
+    {
+        qword k1 = _readBytes(bytes + i * 16, 8);
+        qword k2 = _readBytes(bytes + i * 16 + 8, 8);
+
+        k1 *= _C1;
+        k1 = _rotl(k1, 31);
+        k1 *= _C2;
+        h1 ^= k1;
+
+        h1 = _rotl(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= _C2;
+        k2 = _rotl(k2, 33);
+        k2 *= _C1;
+        h2 ^= k2;
+
+        h2 = _rotl(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const byte* tail = bytes + nblocks * 16;
+    int tail_len = len & 15;
+
+    if (tail_len > 8)
+    {
+        qword k2 = _readBytes(tail + 8, tail_len - 8);
+        k2 *= _C2;
+        k2 = _rotl(k2, 33);
+        k2 *= _C1;
+        h2 ^= k2;
+    }
+    if (tail_len > 0)
+    {
+        qword k1 = _readBytes(tail, tail_len > 8 ? 8 : tail_len);
+        k1 *= _C1;
+        k1 = _rotl(k1, 31);
+        k1 *= _C2;
+        h1 ^= k1;
+    }
+
+    h1 ^= (qword)len;
+    h2 ^= (qword)len;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = _fmix(h1);
+    h2 = _fmix(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    Hash128 result;
+    result.h1 = h1;
+    result.h2 = h2;
+    return result;
+}
+
+Hash128 Hash128::get(const char* text)
+{
+    return get(text, (int)strlen(text));
+}
+
+void Hash128::appendHex(Array<char>& out, int bits) const
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (int shift = 60; shift >= 0; shift -= 4)
+        out.push(digits[(h1 >> shift) & 15]);
+    if (bits > 64)
+        for (int shift = 60; shift >= 0; shift -= 4)
+            out.push(digits[(h2 >> shift) & 15]);
+}
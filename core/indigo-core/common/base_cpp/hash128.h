@@ -0,0 +1,54 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __hash128_h__
+#define __hash128_h__
+
+#include "base_c/defs.h"
+#include "base_cpp/array.h"
+
+namespace indigo
+{
+    // 128-bit non-cryptographic hash (MurmurHash3 x64_128) of a byte string.
+    // Input bytes are read in little-endian order on every platform, so hash
+    // values can be stored and compared across machines. The first half (h1)
+    // serves as a 64-bit hash.
+    struct DLLEXPORT Hash128
+    {
+        qword h1;
+        qword h2;
+
+        static Hash128 get(const char* data, int len, dword seed = 0);
+        static Hash128 get(const char* text);
+
+        // Appends the lowercase hexadecimal digits of h1 (bits == 64) or of h1 and h2 (bits == 128)
+        void appendHex(Array<char>& out, int bits = 128) const;
+
+        bool operator==(const Hash128& other) const
+        {
+            return h1 == other.h1 && h2 == other.h2;
+        }
+        bool operator!=(const Hash128& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+} // namespace indigo
+
+#endif // __hash128_h__
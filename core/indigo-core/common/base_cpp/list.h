@@ -152,6 +152,11 @@ namespace indigo
             return _size;
         }
 
+        ArenaAllocator* arena() const
+        {
+            return _pool->arena();
+        }
+
         int begin() const
         {
             if (_head == -1)
@@ -65,6 +65,8 @@ namespace indigo
 
         T& push()
         {
+            // Elements take their storage where the container does
+            ArenaAllocator::Scope scope(_array.arena());
             void* addr = &_array.push();
 
             new (addr) T();
@@ -75,6 +77,7 @@ namespace indigo
         template <typename A>
         T& push(A& a)
         {
+            ArenaAllocator::Scope scope(_array.arena());
             void* addr = &_array.push();
 
             new (addr) T(a);
@@ -85,6 +88,7 @@ namespace indigo
         template <typename A, typename B>
         T& push(A& a, B* b)
         {
+            ArenaAllocator::Scope scope(_array.arena());
             void* addr = &_array.push();
 
             new (addr) T(a, b);
@@ -95,6 +99,7 @@ namespace indigo
         template <typename A, typename B, typename C>
         T& push(A& a, B& b, C& c)
         {
+            ArenaAllocator::Scope scope(_array.arena());
             void* addr = &_array.push();
 
             new (addr) T(a, b, c);
@@ -105,6 +110,7 @@ namespace indigo
         template <typename A, typename B, typename C>
         T& push(A* a, B b, C c)
         {
+            ArenaAllocator::Scope scope(_array.arena());
             void* addr = &_array.push();
 
             new (addr) T(a, b, c);
@@ -45,6 +45,8 @@ namespace indigo
 
         int add()
         {
+            // Elements take their storage where the container does
+            ArenaAllocator::Scope scope(_list.arena());
             int idx = _list.add();
 
             new (&_list[idx]) T();
@@ -55,6 +57,7 @@ namespace indigo
         template <typename A>
         int add(A& a)
         {
+            ArenaAllocator::Scope scope(_list.arena());
             int idx = _list.add();
 
             new (&_list[idx]) T(a);
@@ -64,6 +67,7 @@ namespace indigo
 
         int insertAfter(int existing)
         {
+            ArenaAllocator::Scope scope(_list.arena());
             int idx = _list.insertAfter(existing);
 
             new (&_list[idx]) T();
@@ -74,6 +78,7 @@ namespace indigo
         template <typename A>
         int insertAfter(int existing, A& a)
         {
+            ArenaAllocator::Scope scope(_list.arena());
             int idx = _list.insertAfter(existing);
 
             new (&_list[idx]) T(a);
@@ -83,6 +88,7 @@ namespace indigo
 
         int insertBefore(int existing)
         {
+            ArenaAllocator::Scope scope(_list.arena());
             int idx = _list.insertBefore(existing);
 
             new (&_list[idx]) T();
@@ -93,6 +99,7 @@ namespace indigo
         template <typename A>
         int insertBefore(int existing, A& a)
         {
+            ArenaAllocator::Scope scope(_list.arena());
             int idx = _list.insertBefore(existing);
 
             new (&_list[idx]) T(a);
@@ -39,6 +39,8 @@ namespace indigo
 
         int add()
         {
+            // Elements take their storage where the container does
+            ArenaAllocator::Scope scope(_pool.arena());
             int idx = _pool.add();
 
             void* addr = &_pool[idx];
@@ -51,6 +53,7 @@ namespace indigo
         template <typename A>
         int add(A& a)
         {
+            ArenaAllocator::Scope scope(_pool.arena());
             int idx = _pool.add();
 
             void* addr = &_pool[idx];
@@ -63,6 +66,7 @@ namespace indigo
         template <typename A, typename B>
         int add(A& a, B& b)
         {
+            ArenaAllocator::Scope scope(_pool.arena());
             int idx = _pool.add();
 
             void* addr = &_pool[idx];
@@ -20,56 +20,122 @@
 // Thread support based on command dispatcher:
 //
 
-#ifdef _WIN32
-#include <windows.h>
-#endif
-#ifdef __APPLE__
-#include <sys/sysctl.h>
-#endif
-
 #include "base_cpp/exception.h"
 #include "base_cpp/os_thread_wrapper.h"
 #include "base_cpp/profiling.h"
+#include "base_cpp/task_executor.h"
 #include "base_cpp/tlscont.h"
-#include <memory>
+
+#include <algorithm>
 #include <thread>
 
 using namespace indigo;
 
-// Messages
-enum
-{
-    MSG_NEED_TASK,
-    MSG_RECV_COMMAND,
-    MSG_RECV_RESULT,
-    MSG_RECV_INDEX,
-    MSG_NO_TASK,
-    MSG_HANDLE_RESULT,
-    MSG_SYSPEND_RESULT,
-    MSG_SYSPEND_SEMAPHORE,
-    MSG_OK,
-    MSG_CONNECT,
-    MSG_HANDLE_EXCEPTION,
-    MSG_TERMINATE
-};
-
 // Maximum number of results that are kept in queue if
 // _handling_order is HANDLING_ORDER_SERIAL
 static const int _MAX_RESULTS = 1000;
 
+// Commands set up ahead for every thread, so a thread that finishes
+// a command finds the next one without waiting for the main thread
+static const int _COMMANDS_PER_THREAD = 2;
+
+// Commands set up ahead for every thread if _handling_order is
+// HANDLING_ORDER_SERIAL: the threads keep executing the next commands
+// while the oldest one is slow, and their results wait for it
+static const int _SERIAL_COMMANDS_PER_THREAD = 16;
+
+// Exceptions thrown by commands and handlers reach the caller of run() as Exception
+static std::exception_ptr _currentException()
+{
+    try
+    {
+        throw;
+    }
+    catch (Exception&)
+    {
+        return std::current_exception();
+    }
+    catch (...)
+    {
+        return std::make_exception_ptr(Exception("Unknown exception"));
+    }
+}
+
+void OsCommandDispatcher::_SlotQueue::reset(int capacity)
+{
+    size_t size = 1;
+    while (size < (size_t)capacity)
+        size *= 2;
+
+    _cells.reset(new _Cell[size]);
+    for (size_t i = 0; i < size; i++)
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+    _mask = size - 1;
+    _head.store(0, std::memory_order_relaxed);
+    _tail = 0;
+}
+
+void OsCommandDispatcher::_SlotQueue::push(int slot)
+{
+    _Cell& cell = _cells[_tail & _mask];
+
+    // The queue has room for all slots, but the loop that took the slot
+    // pushed to this cell last time may not have released the cell yet
+    while (cell.sequence.load(std::memory_order_acquire) != _tail)
+        std::this_thread::yield();
+
+    cell.slot = slot;
+    cell.sequence.store(_tail + 1, std::memory_order_release);
+    _tail++;
+}
+
+bool OsCommandDispatcher::_SlotQueue::pop(int& slot)
+{
+    size_t pos = _head.load(std::memory_order_relaxed);
+    while (true)
+    {
+        _Cell& cell = _cells[pos & _mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence == pos + 1)
+        {
+            if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot = cell.slot;
+                // The cell can be reused when the producer wraps around
+                cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (sequence == pos)
+            return false;
+        else
+            pos = _head.load(std::memory_order_relaxed);
+    }
+}
+
+bool OsCommandDispatcher::_SlotQueue::empty() const
+{
+    size_t pos = _head.load(std::memory_order_relaxed);
+    return _cells[pos & _mask].sequence.load(std::memory_order_acquire) != pos + 1;
+}
+
 OsCommandDispatcher::OsCommandDispatcher(int handling_order, bool same_session_IDs)
 {
-    _storedResults.setSize(_MAX_RESULTS);
-    _storedResults.zeroFill();
     _handling_order = handling_order;
-    _session_id = TL_GET_SESSION_ID();
+    _slot_count = 0;
     _last_unique_command_id = 0;
     _same_session_IDs = same_session_IDs;
+    _need_to_terminate = false;
+    _no_more_commands = false;
+    _main_waiting = false;
+    _active_loops = 0;
+    _thread_count = 0;
+    _loops = nullptr;
 }
 
 void OsCommandDispatcher::run()
 {
-    _run(3 * std::thread::hardware_concurrency() / 2 + 1);
+    _run(TaskExecutor::defaultThreadCount());
 }
 
 void OsCommandDispatcher::run(int nthreads)
@@ -85,12 +151,19 @@ void OsCommandDispatcher::_run(int nthreads)
 {
     _last_command_index = 0;
     _expected_command_index = 0;
+    _no_more_commands = false;
     _need_to_terminate = false;
-    _exception_to_forward = NULL;
+    _exception_to_forward = nullptr;
 
-    _left_thread_count = nthreads;
+    // The executor is not started for a serial run
+    if (nthreads == 0)
+    {
+        _startStandalone();
+        return;
+    }
 
-    if (_left_thread_count == 0)
+    TaskExecutor& executor = TaskExecutor::instance();
+    if (executor.isWorkerThread())
     {
         _startStandalone();
         return;
@@ -98,40 +171,66 @@ void OsCommandDispatcher::_run(int nthreads)
 
     _parent_session_ID = TL_GET_SESSION_ID();
 
-    // Create handling threads
-    for (int i = 0; i < _left_thread_count; i++)
+    int thread_count = std::min(nthreads, executor.threadCount());
+    if (_handling_order == HANDLING_ORDER_SERIAL)
+        _max_in_flight = std::min(thread_count * _SERIAL_COMMANDS_PER_THREAD, _MAX_RESULTS);
+    else
+        _max_in_flight = std::min(thread_count * _COMMANDS_PER_THREAD, _MAX_RESULTS);
+
+    if (_slot_count < _max_in_flight)
     {
-        std::thread thread{[this]() { this->_threadFunc(); }};
-        thread.detach();
+        _slots.reset(new _Slot[_max_in_flight]);
+        _slot_count = _max_in_flight;
     }
-
+    _queue.reset(_max_in_flight);
+
+    _free_slots.clear();
+    for (int i = _max_in_flight - 1; i >= 0; i--)
+        _free_slots.push(i);
+    _busy_slots.clear();
+    _ordered_slots.clear_resize(_max_in_flight);
+    _thread_count = thread_count;
+    _active_loops = 0;
+    _main_waiting = false;
+
+    // Loops are started by _setupSlot. They still touch the dispatcher after
+    // the last result is handled, so they are waited for before the
+    // dispatcher can be destroyed
+    TaskGroup loops(executor);
+    _loops = &loops;
     _mainLoop();
+    loops.wait();
+    _loops = nullptr;
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> locker(_exception_lock);
+        std::swap(exception, _exception_to_forward);
+    }
+    if (exception)
+        std::rethrow_exception(exception);
 }
 
 void OsCommandDispatcher::_mainLoop()
 {
     profTimerStart(t, "dispatcher.main_loop");
 
-    // Main loop
-    int msg;
-    while (_left_thread_count != 0)
+    while (true)
     {
-        void* parameter;
-        _baseMessageSystem.RecvMsg(&msg, &parameter);
-
-        if (msg == MSG_NEED_TASK)
-            _onMsgNeedTask();
-        if (msg == MSG_HANDLE_RESULT)
-            _onMsgHandleResult();
-        if (msg == MSG_HANDLE_EXCEPTION)
-            _onMsgHandleException((Exception*)parameter);
-    }
+        while (!_no_more_commands && !_need_to_terminate && _free_slots.size() > 0)
+            if (!_setupSlot(_free_slots.pop()))
+                break;
 
-    if (_exception_to_forward != NULL)
-    {
-        Exception* cur = _exception_to_forward;
-        _exception_to_forward = NULL;
-        throw *cur;
+        if (_need_to_terminate && !_no_more_commands)
+            _finishCommands();
+
+        if (_handleReadySlots())
+            continue;
+
+        if (_no_more_commands && _free_slots.size() == _max_in_flight)
+            break;
+
+        _waitForResults();
     }
 }
 
@@ -142,8 +241,8 @@ void OsCommandDispatcher::markToTerminate()
 
 void OsCommandDispatcher::terminate()
 {
+    // Commands in flight are finished by run() before it returns
     markToTerminate();
-    _mainLoop();
 }
 
 OsCommand* OsCommandDispatcher::_getVacantCommand()
@@ -175,253 +274,243 @@ OsCommandResult* OsCommandDispatcher::_getVacantResult()
     return result;
 }
 
-void OsCommandDispatcher::_onMsgNeedTask()
+bool OsCommandDispatcher::_setupSlot(int slot)
 {
-    if (_need_to_terminate)
-    {
-        _privateMessageSystem.SendMsg(MSG_NO_TASK, NULL);
-        _left_thread_count--;
-        return;
-    }
-
     OsCommandResult* result = _getVacantResult();
     OsCommand* command = _getVacantCommand();
 
-    if (!_setupCommand(*command))
-    {
-        _availableResults.add(result);
-        _availableCommands.add(command);
-
-        _privateMessageSystem.SendMsg(MSG_NO_TASK, NULL);
-        _left_thread_count--;
-        return;
-    }
-    _privateMessageSystem.SendMsg(MSG_RECV_INDEX, &_last_command_index);
-    _privateMessageSystem.SendMsg(MSG_RECV_COMMAND, command);
-    _privateMessageSystem.SendMsg(MSG_RECV_RESULT, result);
-
-    _last_command_index++;
-}
-
-void OsCommandDispatcher::_handleResultWithCheck(OsCommandResult* result)
-{
-    Exception* exception = 0;
+    bool ready = false;
     try
     {
-        if (!_need_to_terminate)
-            _handleResult(*result);
-    }
-    catch (Exception& e)
-    {
-        exception = new Exception(e);
+        ready = _setupCommand(*command);
     }
     catch (...)
     {
-        exception = new Exception("Unknown exception");
+        _handleException(std::current_exception());
     }
-    if (exception != NULL)
-        _handleException(exception);
-}
 
-void OsCommandDispatcher::_onMsgHandleResult()
-{
-    OsCommandResult* result = nullptr;
-    OsCommand* command = nullptr;
-    int index, msg;
-    void* param;
+    if (!ready)
+    {
+        _availableResults.add(result);
+        _availableCommands.add(command);
+        _free_slots.push(slot);
+        _finishCommands();
+        return false;
+    }
 
-    _privateMessageSystem.RecvMsg(&msg, &param);
-    if (msg != MSG_RECV_INDEX)
-        throw Exception("cmdDispatcher::_OnMsgHandleResult: internal error");
-    index = *(int*)param;
+    _Slot& s = _slots[slot];
+    s.index = _last_command_index++;
+    s.command = command;
+    s.result = result;
+    s.exception = nullptr;
+    s.ready.store(false, std::memory_order_relaxed);
 
     if (_handling_order == HANDLING_ORDER_SERIAL)
-        if (!_storedResults.isInBound(index))
-        {
-            profIncCounter("dispatcher.syspend_count", 1);
+        _ordered_slots[s.index % _max_in_flight] = slot;
+    else
+        _busy_slots.push(slot);
 
-            _privateMessageSystem.SendMsg(MSG_SYSPEND_RESULT);
-            _privateMessageSystem.RecvMsg(&msg, &param);
-            if (msg != MSG_SYSPEND_SEMAPHORE)
-                throw Exception("cmdDispatcher::_OnMsgHandleResult: internal error #2");
+    _queue.push(slot);
 
-            OsSemaphore* sem = (OsSemaphore*)param;
-            _syspendedThreads.push(sem);
+    // Pairs with the fence in _threadFunc: either a loop sees the slot
+    // before it leaves, or it is seen gone here and a new one is started
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_addLoop())
+        _loops->run([this]() { _threadFunc(); });
+    return true;
+}
 
-            return;
-        }
+bool OsCommandDispatcher::_addLoop()
+{
+    int count = _active_loops.load();
+    while (count < _thread_count)
+        if (_active_loops.compare_exchange_weak(count, count + 1))
+            return true;
+    return false;
+}
 
-    _privateMessageSystem.SendMsg(MSG_OK);
-    _recvCommandAndResult(result, command);
-    _availableCommands.add(command);
+void OsCommandDispatcher::_finishCommands()
+{
+    _no_more_commands = true;
+}
 
-    if (_handling_order == HANDLING_ORDER_ANY)
+bool OsCommandDispatcher::_hasReadySlots() const
+{
+    if (_handling_order == HANDLING_ORDER_SERIAL)
     {
-        // Handle result in parallel mode
-        _handleResultWithCheck(result);
-        _availableResults.add(result);
+        if (_expected_command_index == _last_command_index)
+            return false;
+        int slot = _ordered_slots[_expected_command_index % _max_in_flight];
+        return _slots[slot].ready.load(std::memory_order_acquire);
     }
-    else
+
+    for (int i = 0; i < _busy_slots.size(); i++)
+        if (_slots[_busy_slots[i]].ready.load(std::memory_order_acquire))
+            return true;
+    return false;
+}
+
+bool OsCommandDispatcher::_handleReadySlots()
+{
+    bool handled = false;
+
+    if (_handling_order == HANDLING_ORDER_SERIAL)
     {
-        // Handle results in correct order
-        _storedResults[index] = result;
-        while (_storedResults[_expected_command_index] != NULL)
+        // Handle results in correct order, the later ones wait in their slots
+        while (_hasReadySlots())
         {
-            OsCommandResult* current = _storedResults[_expected_command_index];
-            _storedResults[_expected_command_index] = NULL;
-
-            _handleResultWithCheck(current);
-            _availableResults.add(current);
+            _releaseSlot(_ordered_slots[_expected_command_index % _max_in_flight]);
             _expected_command_index++;
+            handled = true;
+        }
+        return handled;
+    }
+
+    int i = 0;
+    while (i < _busy_slots.size())
+    {
+        int slot = _busy_slots[i];
+        if (!_slots[slot].ready.load(std::memory_order_acquire))
+        {
+            i++;
+            continue;
         }
-        _storedResults.setOffset(_expected_command_index);
 
-        _wakeSuspended();
+        _busy_slots[i] = _busy_slots.top();
+        _busy_slots.pop();
+        _releaseSlot(slot);
+        handled = true;
     }
+    return handled;
 }
 
-void OsCommandDispatcher::_wakeSuspended()
+void OsCommandDispatcher::_releaseSlot(int slot)
 {
-    // Wake up all syspended threads
-    for (int i = 0; i < _syspendedThreads.size(); i++)
-        _syspendedThreads[i]->Post();
-    _syspendedThreads.clear();
-}
+    _Slot& s = _slots[slot];
 
-void OsCommandDispatcher::_onMsgHandleException(Exception* exception)
-{
-    OsCommandResult* result = nullptr;
-    OsCommand* command = nullptr;
+    _availableCommands.add(s.command);
 
-    _recvCommandAndResult(result, command);
-    _availableResults.add(result);
-    _availableCommands.add(command);
+    if (s.exception)
+        _handleException(s.exception);
+
+    // Results are dropped after termination
+    _handleResultWithCheck(s.result);
+    _availableResults.add(s.result);
 
-    _handleException(exception);
+    s.command = nullptr;
+    s.result = nullptr;
+    s.exception = nullptr;
+    _free_slots.push(slot);
 }
 
-void OsCommandDispatcher::_handleException(Exception* exception)
+void OsCommandDispatcher::_handleResultWithCheck(OsCommandResult* result)
 {
-    if (!_need_to_terminate)
+    try
     {
-        _need_to_terminate = true;
-        // Store exception to correct memory deallocation in the next time...
-        TL_DECL(std::unique_ptr<Exception>, exception_ptr);
-        TL_GET(std::unique_ptr<Exception>, exception_ptr);
-
-        exception_ptr.reset(exception);
-        _exception_to_forward = exception;
-
-        _wakeSuspended();
+        if (!_need_to_terminate)
+            _handleResult(*result);
     }
-    else
+    catch (...)
     {
-        // This is second exception. Skip it
-        delete exception;
+        _handleException(_currentException());
     }
 }
 
-void OsCommandDispatcher::_threadFunc(void)
+void OsCommandDispatcher::_handleException(std::exception_ptr exception)
 {
-    qword initial_SID = TL_GET_SESSION_ID();
-
-    if (_same_session_IDs)
-        TL_SET_SESSION_ID(_parent_session_ID);
+    // Only the first exception is forwarded
+    {
+        std::lock_guard<std::mutex> locker(_exception_lock);
+        if (!_exception_to_forward)
+            _exception_to_forward = exception;
+    }
+    _need_to_terminate = true;
+}
 
-    _prepareThread();
+void OsCommandDispatcher::_waitForResults()
+{
+    std::unique_lock<std::mutex> locker(_lock);
+    _main_waiting.store(true);
+    // Pairs with the fence in _notifyMain
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    _results_ready.wait(locker, [this]() { return _hasReadySlots(); });
+    _main_waiting.store(false);
+}
 
-    OsSemaphore syspendSem(0, 1);
-    while (true)
+void OsCommandDispatcher::_notifyMain()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_main_waiting.load(std::memory_order_relaxed))
     {
-        int msg;
-        _baseMessageSystem.SendMsg(MSG_NEED_TASK, NULL);
-
-        void* param;
-        _privateMessageSystem.RecvMsg(&msg, &param);
-        if (msg == MSG_NO_TASK)
-            break;
-        if (msg != MSG_RECV_INDEX)
-            throw Exception("cmdDispatcher::_ThreadFunc: internal error");
+        std::lock_guard<std::mutex> locker(_lock);
+        _results_ready.notify_one();
+    }
+}
 
-        int index;
-        index = *(int*)param;
+void OsCommandDispatcher::_threadFunc(void)
+{
+    // A loop without the parent session ID uses the default one, like a new thread
+    TL_SET_SESSION_ID(_same_session_IDs ? _parent_session_ID : 0);
 
-        OsCommandResult* result = nullptr;
-        OsCommand* command = nullptr;
-        _recvCommandAndResult(result, command);
+    std::exception_ptr exception;
+    try
+    {
+        _prepareThread();
+    }
+    catch (...)
+    {
+        // Reported with the commands this loop takes, the first one terminates the run
+        exception = _currentException();
+    }
 
-        Exception* exception = nullptr;
-        try
-        {
-            result->clear();
-            command->execute(*result);
-        }
-        catch (Exception& e)
-        {
-            exception = new Exception(e);
-        }
-        catch (...)
+    bool took_command = false;
+    while (true)
+    {
+        int slot;
+        if (!_queue.pop(slot))
         {
-            exception = new Exception("Unknown exception");
+            // The worker goes back to the executor instead of waiting for
+            // commands, so idle loops do not hold workers that other parallel
+            // code, including the handlers of this dispatcher, may need
+            _active_loops--;
+            // Pairs with the fence in _setupSlot
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!_queue.empty() && _addLoop())
+                continue;
+            break;
         }
 
-        if (exception)
-        {
-            // Forward exception into main thread
-            _baseMessageSystem.SendMsg(MSG_HANDLE_EXCEPTION, exception);
-            // Send current command and result to add
-            // them to the vacant list
-            _privateMessageSystem.SendMsg(MSG_RECV_COMMAND, command);
-            _privateMessageSystem.SendMsg(MSG_RECV_RESULT, result);
-            continue;
-        }
+        _Slot& s = _slots[slot];
+        took_command = true;
 
-        while (true)
+        // After termination the remaining commands are only returned to the main thread
+        if (exception)
+            s.exception = exception;
+        else if (!_need_to_terminate)
         {
-            _baseMessageSystem.SendMsg(MSG_HANDLE_RESULT, NULL);
-
-            _privateMessageSystem.SendMsg(MSG_RECV_INDEX, &index);
-            _privateMessageSystem.RecvMsg(&msg, &param);
-
-            if (msg == MSG_SYSPEND_RESULT)
+            try
             {
-                // Enter syspend mode
-                _privateMessageSystem.SendMsg(MSG_SYSPEND_SEMAPHORE, &syspendSem);
-                syspendSem.Wait();
-                continue;
+                s.result->clear();
+                s.command->execute(*s.result);
             }
-            else if (msg == MSG_OK)
+            catch (...)
             {
-                _privateMessageSystem.SendMsg(MSG_RECV_COMMAND, command);
-                _privateMessageSystem.SendMsg(MSG_RECV_RESULT, result);
-                break;
+                s.exception = _currentException();
             }
-            else
-                // This should terminate application
-                throw Exception("cmdDispatcher::_ThreadFunc: internal error #2");
         }
-    }
 
-    _cleanupThread();
+        s.ready.store(true, std::memory_order_release);
+        _notifyMain();
+    }
 
-    TL_RELEASE_SESSION_ID(initial_SID);
-}
+    // The other loops took all commands, run() rethrows it after the loops are finished
+    if (exception && !took_command)
+        _handleException(exception);
 
-void OsCommandDispatcher::_recvCommandAndResult(OsCommandResult*& result, OsCommand*& command)
-{
-    for (int i = 0; i < 2; i++)
-    {
-        void* param;
-        int msg;
-
-        _privateMessageSystem.RecvMsg(&msg, &param);
-        if (msg == MSG_RECV_RESULT)
-            result = (OsCommandResult*)param;
-        else if (msg == MSG_RECV_COMMAND)
-            command = (OsCommand*)param;
-        else
-            throw Exception("cmdDispatcher::_RecvCommandAndResult");
-    }
+    // The session ID of this thread was not allocated by TL_ALLOC_SESSION_ID,
+    // so it is not released here: releasing the default ID would let
+    // TL_ALLOC_SESSION_ID hand it out to several sessions
+    _cleanupThread();
 }
 
 OsCommandResult* OsCommandDispatcher::_allocateResult()
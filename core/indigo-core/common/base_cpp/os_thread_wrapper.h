@@ -28,10 +28,22 @@
 //    the main thread.
 //
 // There is two options to handle results:
-// OsCommandDispatcher::HANDLING_ORDER_ANY -
+// OsCommandDispatcher::HANDLING_ORDER_ANY - as soon as they are ready
+// OsCommandDispatcher::HANDLING_ORDER_SERIAL - in the order the commands
+//    were set up. Later results wait for a slow command in a reorder buffer
+//    while the threads go on with the next commands.
 //
-// Session ID for each thread, created by dispatcher, is
-// released before thread exit automatically via TL_RELEASE_SESSION_ID.
+// Commands are passed to the threads through a lock-free queue.
+//
+// Commands are executed on the workers of TaskExecutor, by
+// at most one loop per requested thread (and per worker).
+// A loop returns its worker to the executor when the queue
+// is empty, and is started again when commands are queued,
+// so handlers may run parallel code of their own.
+// The loops share the session ID of the parent thread when
+// same_session_IDs is set. They are finished before run()
+// returns. run() called on a worker thread of TaskExecutor
+// executes the commands on that thread.
 //
 // Note: OsCommand and OsCommandResult objects are reusable,
 // so they shouldn't have specific parameters in
@@ -39,14 +51,22 @@
 // used many time.
 //
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "base_c/defs.h"
 #include "base_cpp/array.h"
-#include "base_cpp/cyclic_array.h"
 #include "base_cpp/os_sync_wrapper.h"
 #include "base_cpp/ptr_array.h"
 
 namespace indigo
 {
+    class TaskGroup;
 
     class OsCommandResult
     {
@@ -65,8 +85,6 @@ namespace indigo
         int unique_id;
     };
 
-    class Exception;
-
     class OsCommandDispatcher
     {
     public:
@@ -79,6 +97,7 @@ namespace indigo
         OsCommandDispatcher(int handling_order, bool same_session_IDs);
         virtual ~OsCommandDispatcher(){};
 
+        // One thread per worker of TaskExecutor
         void run();
         void run(int nthreads);
 
@@ -99,7 +118,8 @@ namespace indigo
         {
         }
 
-        // Callback function to initialize thread-local variables
+        // Callback function to initialize thread-local variables,
+        // called whenever a loop is started on a worker.
         // Custom Session ID can be set in this callback function.
         virtual void _prepareThread(void)
         {
@@ -110,43 +130,99 @@ namespace indigo
         }
 
     private:
+        // Command in flight. Slots are handed out by the thread that called
+        // run(), a loop marks the slot ready when the command is executed.
+        struct _Slot
+        {
+            int index;
+            OsCommand* command;
+            OsCommandResult* result;
+            std::exception_ptr exception;
+            std::atomic<bool> ready;
+        };
+
+        // Bounded queue of slots, filled by the thread that called run() and
+        // emptied by the loops without locks. It has room for all slots.
+        class _SlotQueue
+        {
+        public:
+            void reset(int capacity);
+            void push(int slot);
+            bool pop(int& slot);
+            bool empty() const;
+
+        private:
+            struct _Cell
+            {
+                std::atomic<size_t> sequence;
+                int slot;
+            };
+
+            std::unique_ptr<_Cell[]> _cells;
+            size_t _mask;
+            std::atomic<size_t> _head;
+            size_t _tail;
+        };
+
         // Methods
         void _startStandalone();
 
-        void _onMsgNeedTask();
-        void _onMsgHandleResult();
-        void _onMsgHandleException(Exception* exception);
+        void _mainLoop();
 
-        void _recvCommandAndResult(OsCommandResult*& result, OsCommand*& command);
+        bool _setupSlot(int slot);
+        bool _handleReadySlots();
+        bool _hasReadySlots() const;
+        void _releaseSlot(int slot);
 
-        void _mainLoop();
+        bool _addLoop();
+        void _finishCommands();
+        void _waitForResults();
+        void _notifyMain();
 
         OsCommand* _getVacantCommand();
         OsCommandResult* _getVacantResult();
 
-        void _handleException(Exception* exception);
+        void _handleException(std::exception_ptr exception);
         void _handleResultWithCheck(OsCommandResult* result);
 
-        void _wakeSuspended();
-
     private:
         // Variables
         PtrArray<OsCommand> _availableCommands;
         PtrArray<OsCommandResult> _availableResults;
-        CyclicArray<OsCommandResult*> _storedResults;
-        Array<OsSemaphore*> _syspendedThreads;
 
-        Exception* _exception_to_forward;
+        std::unique_ptr<_Slot[]> _slots;
+        int _slot_count;
+        _SlotQueue _queue;
+
+        // Used by the thread that called run() only: vacant slots, slots in
+        // flight for HANDLING_ORDER_ANY, slots by command index for
+        // HANDLING_ORDER_SERIAL (a reorder buffer of _max_in_flight entries)
+        Array<int> _free_slots;
+        Array<int> _busy_slots;
+        Array<int> _ordered_slots;
+
+        // Loops of the current run, at most _thread_count of them are active
+        TaskGroup* _loops;
+        int _thread_count;
+        std::atomic<int> _active_loops;
+
+        // Only for sleeping when there is nothing to do
+        std::mutex _lock;
+        std::condition_variable _results_ready;
+        std::atomic<bool> _main_waiting;
 
-        OsMessageSystem _baseMessageSystem;
-        OsMessageSystem _privateMessageSystem;
+        // Set by the thread that called run(), and by a loop that failed to
+        // prepare and took no command
+        std::mutex _exception_lock;
+        std::exception_ptr _exception_to_forward;
 
         int _last_command_index;
         int _expected_command_index;
         int _handling_order;
-        int _left_thread_count;
-        bool _need_to_terminate;
-        qword _session_id;
+        // Limit of commands set up and not handled yet
+        int _max_in_flight;
+        std::atomic<bool> _need_to_terminate;
+        bool _no_more_commands;
         int _last_unique_command_id;
 
         bool _same_session_IDs;
@@ -90,6 +90,11 @@ namespace indigo
             return _size;
         }
 
+        ArenaAllocator* arena() const
+        {
+            return _array.arena();
+        }
+
         int begin() const
         {
             int i;
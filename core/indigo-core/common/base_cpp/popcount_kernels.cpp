@@ -0,0 +1,366 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "base_cpp/popcount_kernels.h"
+
+#include <atomic>
+#include <string.h>
+
+#include "base_c/bitarray.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__) && !defined(__EMSCRIPTEN__)
+#define INDIGO_POPCOUNT_X86
+#include <immintrin.h>
+#endif
+
+using namespace indigo;
+
+namespace
+{
+    inline qword _loadTail(const byte* data, int n_bytes)
+    {
+        qword value = 0;
+        memcpy(&value, data, n_bytes);
+        return value;
+    }
+
+    inline const byte* _fingerprint(const byte* fingerprints, const int* indices, int i, int fp_size)
+    {
+        return fingerprints + (size_t)(indices != nullptr ? indices[i] : i) * fp_size;
+    }
+
+    inline int _onesScalar(const byte* fp, int fp_size)
+    {
+        int count = 0;
+        int i = 0;
+        for (; i + 8 <= fp_size; i += 8)
+        {
+            qword value;
+            memcpy(&value, fp + i, sizeof(value));
+            count += bitGetOnesCountQword(value);
+        }
+        if (i < fp_size)
+            count += bitGetOnesCountQword(_loadTail(fp + i, fp_size - i));
+        return count;
+    }
+
+    inline int _commonScalar(const byte* query, const byte* fp, int fp_size)
+    {
+        int count = 0;
+        int i = 0;
+        for (; i + 8 <= fp_size; i += 8)
+        {
+            qword a, b;
+            memcpy(&a, query + i, sizeof(a));
+            memcpy(&b, fp + i, sizeof(b));
+            count += bitGetOnesCountQword(a & b);
+        }
+        if (i < fp_size)
+            count += bitGetOnesCountQword(_loadTail(query + i, fp_size - i) & _loadTail(fp + i, fp_size - i));
+        return count;
+    }
+
+    inline bool _andScalar(byte* dst, const byte* src, int size)
+    {
+        qword any = 0;
+        int i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            qword a, b;
+            memcpy(&a, dst + i, sizeof(a));
+            memcpy(&b, src + i, sizeof(b));
+            a &= b;
+            memcpy(dst + i, &a, sizeof(a));
+            any |= a;
+        }
+        for (; i < size; i++)
+        {
+            dst[i] &= src[i];
+            any |= dst[i];
+        }
+        return any != 0;
+    }
+
+#ifdef INDIGO_POPCOUNT_X86
+    // Nibble lookup popcount (W. Mula), summed into four 64-bit lanes
+    __attribute__((target("avx2"))) inline __m256i _popcount256(__m256i v)
+    {
+        const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0f);
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+    }
+
+    __attribute__((target("avx2"))) inline int _sum256(__m256i acc)
+    {
+        __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        return (int)(_mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1));
+    }
+
+    __attribute__((target("avx2,popcnt"))) inline int _onesAvx2(const byte* fp, int fp_size)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        int i = 0;
+        for (; i + 32 <= fp_size; i += 32)
+            acc = _mm256_add_epi64(acc, _popcount256(_mm256_loadu_si256((const __m256i*)(fp + i))));
+        int count = _sum256(acc);
+        for (; i + 8 <= fp_size; i += 8)
+        {
+            qword value;
+            memcpy(&value, fp + i, sizeof(value));
+            count += (int)_mm_popcnt_u64(value);
+        }
+        if (i < fp_size)
+            count += (int)_mm_popcnt_u64(_loadTail(fp + i, fp_size - i));
+        return count;
+    }
+
+    __attribute__((target("avx2,popcnt"))) inline int _commonAvx2(const byte* query, const byte* fp, int fp_size)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        int i = 0;
+        for (; i + 32 <= fp_size; i += 32)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(query + i));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(fp + i));
+            acc = _mm256_add_epi64(acc, _popcount256(_mm256_and_si256(a, b)));
+        }
+        int count = _sum256(acc);
+        for (; i + 8 <= fp_size; i += 8)
+        {
+            qword a, b;
+            memcpy(&a, query + i, sizeof(a));
+            memcpy(&b, fp + i, sizeof(b));
+            count += (int)_mm_popcnt_u64(a & b);
+        }
+        if (i < fp_size)
+            count += (int)_mm_popcnt_u64(_loadTail(query + i, fp_size - i) & _loadTail(fp + i, fp_size - i));
+        return count;
+    }
+
+    __attribute__((target("avx2,popcnt"))) void _onesBatchAvx2(const byte* fingerprints, const int* indices, int count, int fp_size, int* counts)
+    {
+        for (int i = 0; i < count; i++)
+            counts[i] = _onesAvx2(_fingerprint(fingerprints, indices, i, fp_size), fp_size);
+    }
+
+    __attribute__((target("avx2,popcnt"))) void _commonBatchAvx2(const byte* query, const byte* fingerprints, const int* indices, int count, int fp_size,
+                                                                 int* counts)
+    {
+        for (int i = 0; i < count; i++)
+            counts[i] = _commonAvx2(query, _fingerprint(fingerprints, indices, i, fp_size), fp_size);
+    }
+
+    __attribute__((target("avx2"))) bool _andAvx2(byte* dst, const byte* src, int size)
+    {
+        __m256i any = _mm256_setzero_si256();
+        int i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(dst + i)), _mm256_loadu_si256((const __m256i*)(src + i)));
+            _mm256_storeu_si256((__m256i*)(dst + i), a);
+            any = _mm256_or_si256(any, a);
+        }
+        bool non_zero = !_mm256_testz_si256(any, any);
+        if (i < size)
+            non_zero = _andScalar(dst + i, src + i, size - i) || non_zero;
+        return non_zero;
+    }
+
+    // The tail is read with a masked load, so no bytes past the fingerprint are touched
+    __attribute__((target("avx512f,avx512bw,avx512vpopcntdq"))) inline int _onesAvx512(const byte* fp, int fp_size)
+    {
+        __m512i acc = _mm512_setzero_si512();
+        int i = 0;
+        for (; i + 64 <= fp_size; i += 64)
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_loadu_si512(fp + i)));
+        if (i < fp_size)
+        {
+            __mmask64 mask = _cvtu64_mask64(~0ULL >> (64 - (fp_size - i)));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi8(mask, fp + i)));
+        }
+        return (int)_mm512_reduce_add_epi64(acc);
+    }
+
+    __attribute__((target("avx512f,avx512bw,avx512vpopcntdq"))) inline int _commonAvx512(const byte* query, const byte* fp, int fp_size)
+    {
+        __m512i acc = _mm512_setzero_si512();
+        int i = 0;
+        for (; i + 64 <= fp_size; i += 64)
+        {
+            __m512i a = _mm512_loadu_si512(query + i);
+            __m512i b = _mm512_loadu_si512(fp + i);
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_and_si512(a, b)));
+        }
+        if (i < fp_size)
+        {
+            __mmask64 mask = _cvtu64_mask64(~0ULL >> (64 - (fp_size - i)));
+            __m512i a = _mm512_maskz_loadu_epi8(mask, query + i);
+            __m512i b = _mm512_maskz_loadu_epi8(mask, fp + i);
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_and_si512(a, b)));
+        }
+        return (int)_mm512_reduce_add_epi64(acc);
+    }
+
+    __attribute__((target("avx512f,avx512bw,avx512vpopcntdq"))) void _onesBatchAvx512(const byte* fingerprints, const int* indices, int count, int fp_size,
+                                                                                       int* counts)
+    {
+        for (int i = 0; i < count; i++)
+            counts[i] = _onesAvx512(_fingerprint(fingerprints, indices, i, fp_size), fp_size);
+    }
+
+    __attribute__((target("avx512f,avx512bw,avx512vpopcntdq"))) void _commonBatchAvx512(const byte* query, const byte* fingerprints, const int* indices,
+                                                                                         int count, int fp_size, int* counts)
+    {
+        for (int i = 0; i < count; i++)
+            counts[i] = _commonAvx512(query, _fingerprint(fingerprints, indices, i, fp_size), fp_size);
+    }
+
+    __attribute__((target("avx512f,avx512bw"))) bool _andAvx512(byte* dst, const byte* src, int size)
+    {
+        __m512i any = _mm512_setzero_si512();
+        int i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            __m512i a = _mm512_and_si512(_mm512_loadu_si512(dst + i), _mm512_loadu_si512(src + i));
+            _mm512_storeu_si512(dst + i, a);
+            any = _mm512_or_si512(any, a);
+        }
+        if (i < size)
+        {
+            __mmask64 mask = _cvtu64_mask64(~0ULL >> (64 - (size - i)));
+            __m512i a = _mm512_and_si512(_mm512_maskz_loadu_epi8(mask, dst + i), _mm512_maskz_loadu_epi8(mask, src + i));
+            _mm512_mask_storeu_epi8(dst + i, mask, a);
+            any = _mm512_or_si512(any, a);
+        }
+        return _mm512_test_epi64_mask(any, any) != 0;
+    }
+#endif
+
+    void _onesBatchScalar(const byte* fingerprints, const int* indices, int count, int fp_size, int* counts)
+    {
+        for (int i = 0; i < count; i++)
+            counts[i] = _onesScalar(_fingerprint(fingerprints, indices, i, fp_size), fp_size);
+    }
+
+    void _commonBatchScalar(const byte* query, const byte* fingerprints, const int* indices, int count, int fp_size, int* counts)
+    {
+        for (int i = 0; i < count; i++)
+            counts[i] = _commonScalar(query, _fingerprint(fingerprints, indices, i, fp_size), fp_size);
+    }
+
+    std::atomic<int> _selected_isa(-1);
+} // namespace
+
+PopcountKernels::Isa PopcountKernels::detectIsa()
+{
+    static const Isa detected = []() {
+#ifdef INDIGO_POPCOUNT_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vpopcntdq"))
+            return ISA_AVX512_VPOPCNTDQ;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+            return ISA_AVX2;
+#endif
+        return ISA_SCALAR;
+    }();
+    return detected;
+}
+
+PopcountKernels::Isa PopcountKernels::isa()
+{
+    int selected = _selected_isa.load(std::memory_order_relaxed);
+    if (selected < 0)
+    {
+        selected = detectIsa();
+        _selected_isa.store(selected, std::memory_order_relaxed);
+    }
+    return (Isa)selected;
+}
+
+void PopcountKernels::setIsa(Isa isa)
+{
+    Isa detected = detectIsa();
+    _selected_isa.store(isa > detected ? detected : isa, std::memory_order_relaxed);
+}
+
+const char* PopcountKernels::isaName(Isa isa)
+{
+    switch (isa)
+    {
+    case ISA_AVX512_VPOPCNTDQ:
+        return "avx512-vpopcntdq";
+    case ISA_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+void PopcountKernels::onesCount(const byte* fingerprints, const int* indices, int count, int fp_size, int* counts)
+{
+    switch (isa())
+    {
+#ifdef INDIGO_POPCOUNT_X86
+    case ISA_AVX512_VPOPCNTDQ:
+        _onesBatchAvx512(fingerprints, indices, count, fp_size, counts);
+        break;
+    case ISA_AVX2:
+        _onesBatchAvx2(fingerprints, indices, count, fp_size, counts);
+        break;
+#endif
+    default:
+        _onesBatchScalar(fingerprints, indices, count, fp_size, counts);
+        break;
+    }
+}
+
+void PopcountKernels::commonOnes(const byte* query, const byte* fingerprints, const int* indices, int count, int fp_size, int* counts)
+{
+    switch (isa())
+    {
+#ifdef INDIGO_POPCOUNT_X86
+    case ISA_AVX512_VPOPCNTDQ:
+        _commonBatchAvx512(query, fingerprints, indices, count, fp_size, counts);
+        break;
+    case ISA_AVX2:
+        _commonBatchAvx2(query, fingerprints, indices, count, fp_size, counts);
+        break;
+#endif
+    default:
+        _commonBatchScalar(query, fingerprints, indices, count, fp_size, counts);
+        break;
+    }
+}
+
+bool PopcountKernels::andNonZero(byte* dst, const byte* src, int size)
+{
+    switch (isa())
+    {
+#ifdef INDIGO_POPCOUNT_X86
+    case ISA_AVX512_VPOPCNTDQ:
+        return _andAvx512(dst, src, size);
+    case ISA_AVX2:
+        return _andAvx2(dst, src, size);
+#endif
+    default:
+        return _andScalar(dst, src, size);
+    }
+}
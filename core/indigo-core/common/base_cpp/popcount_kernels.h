@@ -0,0 +1,67 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __popcount_kernels_h__
+#define __popcount_kernels_h__
+
+#include "base_c/defs.h"
+
+namespace indigo
+{
+    // Batched bit counting over many fingerprints of the same size, and
+    // bitwise screening of transposed fingerprint blocks.
+    // The implementation is chosen at runtime: AVX-512 VPOPCNTDQ, AVX2 or
+    // portable scalar code, depending on what the CPU supports.
+    //
+    // Fingerprint i of a batch starts at fingerprints + idx * fp_size, where
+    // idx is indices[i] when indices are given and i otherwise.
+    class DLLEXPORT PopcountKernels
+    {
+    public:
+        enum Isa
+        {
+            ISA_SCALAR = 0,
+            ISA_AVX2,
+            ISA_AVX512_VPOPCNTDQ
+        };
+
+        // Best instruction set supported by this CPU
+        static Isa detectIsa();
+
+        // Instruction set used by the kernels, detectIsa() by default
+        static Isa isa();
+
+        // Restricts the kernels to the given instruction set. Requests above
+        // detectIsa() are clamped. Used by benchmarks to compare the paths.
+        static void setIsa(Isa isa);
+
+        static const char* isaName(Isa isa);
+
+        // counts[i] = number of ones in fingerprint i
+        static void onesCount(const byte* fingerprints, const int* indices, int count, int fp_size, int* counts);
+
+        // counts[i] = number of ones in (query & fingerprint i)
+        static void commonOnes(const byte* query, const byte* fingerprints, const int* indices, int count, int fp_size, int* counts);
+
+        // dst &= src for size bytes. Returns false when dst became all zeros.
+        static bool andNonZero(byte* dst, const byte* src, int size);
+    };
+
+} // namespace indigo
+
+#endif
@@ -20,6 +20,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <safe_ptr.h>
 
@@ -49,10 +52,7 @@ qword ProfilingTimer::stop()
         return 0;
     }
     _dt = nanoClock() - _start_time;
-    {
-        auto inst = sf::xlock_safe_ptr(ProfilingSystem::getInstance());
-        inst->addTimer(_name_index, _dt);
-    }
+    ProfilingSystem::addTimer(_name_index, _dt);
     _name_index = -1;
     return _dt;
 }
@@ -71,6 +71,164 @@ float ProfilingTimer::getTimeSec() const
     return nanoHowManySeconds(getTime());
 }
 
+//
+// Per-thread record shards
+//
+
+namespace
+{
+    // Reset generations: records of an older generation are treated as empty,
+    // so reset() never writes to shards owned by other threads
+    std::atomic<unsigned> _session_generation(1);
+    std::atomic<unsigned> _total_generation(1);
+
+    // Record data written by the owner thread only. Fields are atomic to be
+    // read by the statistics merge, but updates are plain loads and stores.
+    struct ShardData
+    {
+        std::atomic<unsigned> generation{0};
+        std::atomic<qword> count{0}, value{0}, max_value{0};
+        std::atomic<double> square_sum{0};
+
+        void add(qword adding_value, unsigned current_generation)
+        {
+            if (generation.load(std::memory_order_relaxed) != current_generation)
+            {
+                count.store(0, std::memory_order_relaxed);
+                value.store(0, std::memory_order_relaxed);
+                max_value.store(0, std::memory_order_relaxed);
+                square_sum.store(0, std::memory_order_relaxed);
+                generation.store(current_generation, std::memory_order_release);
+            }
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            value.store(value.load(std::memory_order_relaxed) + adding_value, std::memory_order_relaxed);
+            if (adding_value > max_value.load(std::memory_order_relaxed))
+                max_value.store(adding_value, std::memory_order_relaxed);
+            const auto adding_value_dbl = static_cast<double>(adding_value);
+            square_sum.store(square_sum.load(std::memory_order_relaxed) + adding_value_dbl * adding_value_dbl, std::memory_order_relaxed);
+        }
+    };
+
+    struct ShardSlot
+    {
+        std::atomic<int> type{-1};
+        ShardData current, total;
+    };
+
+    // Slots are allocated in chunks that never move, so the merge can read
+    // them while the owner thread adds new ones
+    const int SHARD_CHUNK_SIZE = 64;
+    const int SHARD_MAX_CHUNKS = 256;
+
+    struct ShardChunk
+    {
+        ShardSlot slots[SHARD_CHUNK_SIZE];
+    };
+
+    class Shard
+    {
+    public:
+        Shard()
+        {
+            for (auto& chunk : chunks)
+                chunk.store(nullptr, std::memory_order_relaxed);
+        }
+
+        ~Shard()
+        {
+            for (auto& chunk : chunks)
+                delete chunk.load(std::memory_order_relaxed);
+        }
+
+        ShardSlot* slot(int name_index)
+        {
+            int chunk_index = name_index / SHARD_CHUNK_SIZE;
+            if (chunk_index >= SHARD_MAX_CHUNKS)
+                return nullptr;
+
+            ShardChunk* chunk = chunks[chunk_index].load(std::memory_order_relaxed);
+            if (chunk == nullptr)
+            {
+                chunk = new ShardChunk();
+                chunks[chunk_index].store(chunk, std::memory_order_release);
+            }
+            return &chunk->slots[name_index % SHARD_CHUNK_SIZE];
+        }
+
+        std::atomic<ShardChunk*> chunks[SHARD_MAX_CHUNKS];
+    };
+
+    // Shards of finished threads keep their records and are handed to new
+    // threads, so the number of shards is bounded by the peak thread count
+    class ShardRegistry
+    {
+    public:
+        Shard* acquire()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!vacant.empty())
+            {
+                Shard* shard = vacant.back();
+                vacant.pop_back();
+                return shard;
+            }
+            shards.emplace_back(new Shard());
+            return shards.back().get();
+        }
+
+        void release(Shard* shard)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            vacant.push_back(shard);
+        }
+
+        std::mutex lock;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::vector<Shard*> vacant;
+    };
+
+    // Never destroyed: threads may still add records during process shutdown
+    ShardRegistry& shardRegistry()
+    {
+        static ShardRegistry* registry = new ShardRegistry();
+        return *registry;
+    }
+
+    class ThreadShard
+    {
+    public:
+        ~ThreadShard()
+        {
+            if (shard != nullptr)
+                shardRegistry().release(shard);
+        }
+
+        Shard* get()
+        {
+            if (shard == nullptr)
+                shard = shardRegistry().acquire();
+            return shard;
+        }
+
+    private:
+        Shard* shard = nullptr;
+    };
+
+    thread_local ThreadShard _thread_shard;
+
+    void addToShard(int name_index, qword value, int type)
+    {
+        if (name_index < 0)
+            return;
+        ShardSlot* slot = _thread_shard.get()->slot(name_index);
+        if (slot == nullptr)
+            return;
+        slot->type.store(type, std::memory_order_relaxed);
+        slot->current.add(value, _session_generation.load(std::memory_order_relaxed));
+        slot->total.add(value, _total_generation.load(std::memory_order_relaxed));
+    }
+}
+
 //
 // Profiling functionality
 //
@@ -83,6 +241,7 @@ namespace indigo
 
 sf::safe_shared_hide_obj<ProfilingSystem>& ProfilingSystem::getInstance()
 {
+    ArenaAllocator::Suspend suspend;
     static sf::safe_shared_hide_obj<ProfilingSystem> _profiling_system;
     return _profiling_system;
 }
@@ -101,6 +260,7 @@ int ProfilingSystem::getNameIndex(const char* name, bool add_if_not_exists)
         return -1;
     }
     // Add new label
+    ArenaAllocator::Suspend suspend;
     Array<char>& name_record = _names.push();
     name_record.copy(name, static_cast<int>(strlen(name)) + 1);
     return _names.size() - 1;
@@ -108,30 +268,79 @@ int ProfilingSystem::getNameIndex(const char* name, bool add_if_not_exists)
 
 void ProfilingSystem::addTimer(const int name_index, const qword dt)
 {
-    _ensureRecordExistanceLocked(name_index);
-    Record& rec = _records[name_index];
-    rec.type = Record::RecordType::TYPE_TIMER;
-    rec.current.add(dt);
-    rec.total.add(dt);
+    addToShard(name_index, dt, (int)Record::RecordType::TYPE_TIMER);
 }
 
 void ProfilingSystem::addCounter(const int name_index, const int value)
 {
-    _ensureRecordExistanceLocked(name_index);
-    Record& rec = _records[name_index];
-    rec.type = Record::RecordType::TYPE_COUNTER;
-    rec.current.add(value);
-    rec.total.add(value);
+    addToShard(name_index, value, (int)Record::RecordType::TYPE_COUNTER);
 }
 
 void ProfilingSystem::reset(const bool all)
 {
+    _session_generation++;
+    if (all)
+    {
+        _total_generation++;
+    }
     for (int i = 0; i < _records.size(); i++)
     {
         _records[i].reset(all);
     }
 }
 
+static void _mergeShardData(const ShardData& shard_data, unsigned generation, qword& count, qword& value, qword& max_value, double& square_sum)
+{
+    if (shard_data.generation.load(std::memory_order_acquire) != generation)
+    {
+        return;
+    }
+    count += shard_data.count.load(std::memory_order_relaxed);
+    value += shard_data.value.load(std::memory_order_relaxed);
+    max_value = std::max(max_value, shard_data.max_value.load(std::memory_order_relaxed));
+    square_sum += shard_data.square_sum.load(std::memory_order_relaxed);
+}
+
+void ProfilingSystem::_collectRecords()
+{
+    _ensureRecordExistanceLocked(_names.size() - 1);
+    for (int i = 0; i < _records.size(); i++)
+    {
+        _records[i].reset(true);
+    }
+
+    unsigned session_generation = _session_generation.load();
+    unsigned total_generation = _total_generation.load();
+
+    ShardRegistry& registry = shardRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    for (auto& shard : registry.shards)
+    {
+        for (int c = 0; c < SHARD_MAX_CHUNKS; c++)
+        {
+            ShardChunk* chunk = shard->chunks[c].load(std::memory_order_acquire);
+            if (chunk == nullptr)
+            {
+                continue;
+            }
+            for (int i = 0; i < SHARD_CHUNK_SIZE; i++)
+            {
+                int name_index = c * SHARD_CHUNK_SIZE + i;
+                const ShardSlot& slot = chunk->slots[i];
+                int type = slot.type.load(std::memory_order_relaxed);
+                if (type == -1 || name_index >= _records.size())
+                {
+                    continue;
+                }
+                Record& rec = _records[name_index];
+                rec.type = (Record::RecordType)type;
+                _mergeShardData(slot.current, session_generation, rec.current.count, rec.current.value, rec.current.max_value, rec.current.square_sum);
+                _mergeShardData(slot.total, total_generation, rec.total.count, rec.total.value, rec.total.max_value, rec.total.square_sum);
+            }
+        }
+    }
+}
+
 int ProfilingSystem::_recordsCmp(const int idx1, const int idx2, void* context)
 {
     auto* this_ = static_cast<ProfilingSystem*>(context);
@@ -140,6 +349,8 @@ int ProfilingSystem::_recordsCmp(const int idx1, const int idx2, void* context)
 
 void ProfilingSystem::getStatistics(Output& output, const bool get_all)
 {
+    _collectRecords();
+
     // Print formatted statistics
     while (_sorted_records.size() < _records.size())
     {
@@ -252,11 +463,13 @@ bool ProfilingSystem::hasLabel(const char* name)
     {
         return false;
     }
+    _collectRecords();
     return _hasLabelIndex(name_index);
 }
 
 void ProfilingSystem::_ensureRecordExistanceLocked(const int name_index)
 {
+    ArenaAllocator::Suspend suspend;
     while (_records.size() <= name_index)
     {
         _records.push();
@@ -267,6 +480,7 @@ float ProfilingSystem::getLabelExecTime(const char* name, const bool total)
 {
     int idx = getNameIndex(name);
     _ensureRecordExistanceLocked(idx);
+    _collectRecords();
 
     if (total)
     {
@@ -279,6 +493,7 @@ qword ProfilingSystem::getLabelValue(const char* name, const bool total)
 {
     int idx = getNameIndex(name);
     _ensureRecordExistanceLocked(idx);
+    _collectRecords();
     if (total)
     {
         return _records[idx].total.value;
@@ -290,6 +505,7 @@ qword ProfilingSystem::getLabelCallCount(const char* name, const bool total)
 {
     int idx = getNameIndex(name);
     _ensureRecordExistanceLocked(idx);
+    _collectRecords();
     if (total)
     {
         return _records[idx].total.count;
@@ -48,16 +48,14 @@
     do                                                                                                                                                         \
     {                                                                                                                                                          \
         PROF_GET_NAME_INDEX(var_name, name)                                                                                                                    \
-        auto inst = sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance());                                                                                \
-        inst->addTimer(var_name##_name_index, dt);                                                                                                             \
+        indigo::ProfilingSystem::addTimer(var_name##_name_index, dt);                                                                                          \
     } while (false)
 
 #define profIncCounter(name, count)                                                                                                                            \
     do                                                                                                                                                         \
     {                                                                                                                                                          \
         PROF_GET_NAME_INDEX(var_name, name)                                                                                                                    \
-        auto inst = sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance());                                                                                \
-        inst->addCounter(var_name##_name_index, count);                                                                                                        \
+        indigo::ProfilingSystem::addCounter(var_name##_name_index, count);                                                                                     \
     } while (false)
 
 #define profTimersReset() sf::xlock_safe_ptr(indigo::ProfilingSystem::getInstance())->reset(false)
@@ -69,6 +67,9 @@ namespace indigo
 {
     class Output;
 
+    // Timers and counters are added without locking: every thread adds to its
+    // own shard of records, and the shards are summed up when statistics are
+    // read. Name registration and reading still require the instance lock.
     class DLLEXPORT ProfilingSystem
     {
     public:
@@ -76,8 +77,8 @@ namespace indigo
 
         int getNameIndex(const char* name, bool add_if_not_exists = true);
 
-        void addTimer(int name_index, qword dt);
-        void addCounter(int name_index, int value);
+        static void addTimer(int name_index, qword dt);
+        static void addCounter(int name_index, int value);
         void reset(bool all);
         void getStatistics(Output& output, bool get_all);
 
@@ -124,6 +125,9 @@ namespace indigo
         bool _hasLabelIndex(int name_index) const;
         void _ensureRecordExistanceLocked(int name_index);
 
+        // Sums up thread shards into _records
+        void _collectRecords();
+
         ObjArray<Array<char>> _names;
         ObjArray<Record> _records;
         Array<int> _sorted_records;
@@ -1010,6 +1010,7 @@ namespace indigo
 
         Value& _insertObj(Key key, int parent, int sign)
         {
+            ArenaAllocator::Scope scope(this->_nodes->arena());
             Value* value = _insert(key, parent, sign);
             new (value) Value();
             return *value;
@@ -1018,6 +1019,7 @@ namespace indigo
         template <typename A>
         Value& _insertObj(Key key, int parent, int sign, A& a)
         {
+            ArenaAllocator::Scope scope(this->_nodes->arena());
             Value* value = _insert(key, parent, sign);
             new (value) Value(a);
             return *value;
@@ -1194,6 +1196,7 @@ namespace indigo
 
         int _insertObj(const char* key, int parent, int sign)
         {
+            ArenaAllocator::Scope scope(this->_nodes->arena());
             int idx = _insert(key, parent, sign);
             Value* value = &this->value(idx);
 
@@ -1204,6 +1207,7 @@ namespace indigo
         template <typename A>
         int _insertObj(const char* key, int parent, int sign, A& a)
         {
+            ArenaAllocator::Scope scope(this->_nodes->arena());
             int idx = _insert(key, parent, sign);
             Value* value = &this->value(idx);
 
@@ -30,6 +30,15 @@
 
 #include <limits>
 
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#undef min
+#undef max
+#else
+#include <sys/mman.h>
+#endif
+
 using namespace indigo;
 
 enum
@@ -684,6 +693,156 @@ FileScanner::~FileScanner()
         fclose(_file);
 }
 
+//
+// MappedFileScanner
+//
+
+MappedFileScanner::MappedFileScanner(Encoding filename_encoding, const char* filename)
+{
+    _data = nullptr;
+    _size = 0;
+    _offset = 0;
+#ifdef _WIN32
+    _mapping = nullptr;
+#endif
+
+    if (filename == 0)
+        throw Error("null filename");
+
+    // The file is opened like FileScanner does to get the same filename
+    // encoding handling, the mapping keeps its own reference to the file
+    FILE* file = openFile(filename_encoding, filename, "rb");
+    if (file == NULL)
+        throw Error("can't open file %s. Error: %s", filename, strerror(errno));
+
+#ifdef _WIN32
+    _fseeki64(file, 0LL, SEEK_END);
+    _size = _ftelli64(file);
+#else
+    fseeko(file, 0LL, SEEK_END);
+    _size = ftello(file);
+#endif
+
+    // Empty files can not be mapped
+    if (_size > 0)
+    {
+#ifdef _WIN32
+        HANDLE h_file = (HANDLE)_get_osfhandle(_fileno(file));
+        _mapping = CreateFileMapping(h_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (_mapping != NULL)
+            _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        void* ptr = mmap(nullptr, (size_t)_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (ptr != MAP_FAILED)
+        {
+            _data = (const char*)ptr;
+            madvise(ptr, (size_t)_size, MADV_SEQUENTIAL);
+        }
+#endif
+    }
+    fclose(file);
+
+    if (_size > 0 && _data == nullptr)
+    {
+#ifdef _WIN32
+        if (_mapping != NULL)
+            CloseHandle(_mapping);
+        throw Error("can't map file %s. Error: %lu", filename, GetLastError());
+#else
+        throw Error("can't map file %s. Error: %s", filename, strerror(errno));
+#endif
+    }
+}
+
+MappedFileScanner::~MappedFileScanner()
+{
+    if (_data == nullptr)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+#else
+    munmap((void*)_data, (size_t)_size);
+#endif
+}
+
+void MappedFileScanner::read(int length, void* res)
+{
+    if (length < 0 || _offset + length > _size)
+        throw Error("MappedFileScanner::read() error");
+
+    memcpy(res, _data + _offset, length);
+    _offset += length;
+}
+
+bool MappedFileScanner::isEOF()
+{
+    return _offset >= _size;
+}
+
+void MappedFileScanner::skip(int n)
+{
+    _offset += n;
+
+    if (_offset > _size)
+        throw Error("skip() passes after end of file");
+}
+
+int MappedFileScanner::lookNext()
+{
+    if (_offset >= _size)
+        return -1;
+
+    return (unsigned char)_data[_offset];
+}
+
+void MappedFileScanner::seek(long long pos, int from)
+{
+    if (from == SEEK_SET)
+        _offset = pos;
+    else if (from == SEEK_CUR)
+        _offset += pos;
+    else // SEEK_END
+        _offset = _size - pos;
+
+    if (_offset > _size || _offset < 0)
+        throw Error("size = %lld, offset = %lld after seek()", _size, _offset);
+}
+
+long long MappedFileScanner::length()
+{
+    return _size;
+}
+
+long long MappedFileScanner::tell()
+{
+    return _offset;
+}
+
+char MappedFileScanner::readChar()
+{
+    if (_offset >= _size)
+        throw Error("readChar() passes after end of file");
+    return _data[_offset++];
+}
+
+byte MappedFileScanner::readByte()
+{
+    if (_offset >= _size)
+        throw Error("readByte(): end of file");
+    return _data[_offset++];
+}
+
+const char* MappedFileScanner::data() const
+{
+    return _data;
+}
+
+const char* MappedFileScanner::curptr() const
+{
+    return _data + _offset;
+}
+
 //
 // BufferScanner
 //
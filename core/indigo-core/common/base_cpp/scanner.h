@@ -152,6 +152,42 @@ namespace indigo
         BufferScanner(const BufferScanner&);
     };
 
+    // Scanner over a read-only memory mapping of a whole file. Records can be
+    // parsed in place: data() stays valid while the scanner exists, so a
+    // BufferScanner over data() + offset reads a record without copying it.
+    class DLLEXPORT MappedFileScanner : public Scanner
+    {
+    public:
+        MappedFileScanner(Encoding filename_encoding, const char* filename);
+        ~MappedFileScanner() override;
+
+        void read(int length, void* res) override;
+        bool isEOF() override;
+        void skip(int n) override;
+        int lookNext() override;
+        void seek(long long pos, int from) override;
+        long long length() override;
+        long long tell() override;
+
+        char readChar() override;
+        byte readByte() override;
+
+        const char* data() const;
+        const char* curptr() const;
+
+    private:
+        const char* _data;
+        long long _size;
+        long long _offset;
+
+#ifdef _WIN32
+        void* _mapping;
+#endif
+
+        // no implicit copy
+        MappedFileScanner(const MappedFileScanner&);
+    };
+
 } // namespace indigo
 
 #endif
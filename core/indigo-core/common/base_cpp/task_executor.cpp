@@ -0,0 +1,287 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "base_cpp/task_executor.h"
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include "base_cpp/tlscont.h"
+
+using namespace indigo;
+
+namespace
+{
+    // Executor and deque of the current worker thread
+    thread_local const TaskExecutor* _thread_executor = nullptr;
+    thread_local int _thread_worker = -1;
+}
+
+//
+// TaskExecutor
+//
+
+TaskExecutor::TaskExecutor(int thread_count) : _pending(0), _next_worker(0), _stop(false)
+{
+    thread_count = std::max(thread_count, 1);
+    for (int i = 0; i < thread_count; i++)
+        _workers.emplace_back(new _Worker());
+
+#ifndef _WIN32
+    // Workers are started with all signals blocked, whatever the mask of the
+    // thread that created the executor, so signal handlers of the host
+    // process (a database backend, for instance) are never called on them
+    sigset_t all_signals, caller_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &caller_signals);
+#endif
+    try
+    {
+        for (int i = 0; i < thread_count; i++)
+            _threads.emplace_back([this, i]() { _workerFunc(i); });
+    }
+    catch (...)
+    {
+#ifndef _WIN32
+        pthread_sigmask(SIG_SETMASK, &caller_signals, nullptr);
+#endif
+        throw;
+    }
+#ifndef _WIN32
+    pthread_sigmask(SIG_SETMASK, &caller_signals, nullptr);
+#endif
+}
+
+TaskExecutor::~TaskExecutor()
+{
+    {
+        std::lock_guard<std::mutex> locker(_sleep_lock);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _threads)
+        thread.join();
+}
+
+TaskExecutor& TaskExecutor::instance()
+{
+    // Never destroyed: workers may still run tasks during process shutdown
+    static TaskExecutor* executor = new TaskExecutor(defaultThreadCount());
+    return *executor;
+}
+
+int TaskExecutor::defaultThreadCount()
+{
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+int TaskExecutor::threadCount() const
+{
+    return (int)_threads.size();
+}
+
+bool TaskExecutor::isWorkerThread() const
+{
+    return _thread_executor == this;
+}
+
+void TaskExecutor::submit(Task task)
+{
+    int index;
+    if (isWorkerThread())
+        index = _thread_worker;
+    else
+        index = _next_worker++ % _workers.size();
+
+    {
+        _Worker& worker = *_workers[index];
+        std::lock_guard<std::mutex> locker(worker.lock);
+        worker.tasks.push_back(_Item{std::move(task), TL_GET_SESSION_ID()});
+    }
+    _pending++;
+
+    // Taking the lock orders the counter update before a worker goes to sleep
+    {
+        std::lock_guard<std::mutex> locker(_sleep_lock);
+    }
+    _wake.notify_one();
+}
+
+bool TaskExecutor::_take(int index, _Item& item)
+{
+    int count = (int)_workers.size();
+    for (int i = 0; i < count; i++)
+    {
+        _Worker& worker = *_workers[(index + i) % count];
+        std::lock_guard<std::mutex> locker(worker.lock);
+        if (worker.tasks.empty())
+            continue;
+
+        // Own tasks are taken in the reverse order, stolen ones in the submission order
+        if (i == 0)
+        {
+            item = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+        else
+        {
+            item = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        _pending--;
+        return true;
+    }
+    return false;
+}
+
+void TaskExecutor::_execute(_Item& item)
+{
+    qword session_id = TL_GET_SESSION_ID();
+    TL_SET_SESSION_ID(item.session_id);
+    try
+    {
+        item.task();
+    }
+    catch (...)
+    {
+    }
+    TL_SET_SESSION_ID(session_id);
+    item.task = nullptr;
+}
+
+void TaskExecutor::_workerFunc(int index)
+{
+    _thread_executor = this;
+    _thread_worker = index;
+
+    _Item item;
+    while (true)
+    {
+        if (_take(index, item))
+        {
+            _execute(item);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> locker(_sleep_lock);
+        _wake.wait(locker, [this]() { return _pending > 0 || _stop; });
+        if (_stop && _pending == 0)
+            break;
+    }
+}
+
+//
+// TaskGroup
+//
+
+TaskGroup::TaskGroup(TaskExecutor& executor) : _executor(executor), _inline(executor.isWorkerThread()), _pending(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    std::unique_lock<std::mutex> locker(_lock);
+    _done.wait(locker, [this]() { return _pending == 0; });
+}
+
+void TaskGroup::run(TaskExecutor::Task task)
+{
+    {
+        std::lock_guard<std::mutex> locker(_lock);
+        _pending++;
+    }
+
+    if (_inline)
+        _runTask(task);
+    else
+        _executor.submit([this, task]() { _runTask(task); });
+}
+
+void TaskGroup::_runTask(const TaskExecutor::Task& task)
+{
+    std::exception_ptr exception;
+    try
+    {
+        task();
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> locker(_lock);
+    if (exception && !_exception)
+        _exception = exception;
+    if (--_pending == 0)
+        _done.notify_all();
+}
+
+void TaskGroup::wait()
+{
+    std::unique_lock<std::mutex> locker(_lock);
+    _done.wait(locker, [this]() { return _pending == 0; });
+
+    std::exception_ptr exception = _exception;
+    _exception = nullptr;
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+void TaskGroup::parallelFor(int count, int thread_count, const std::function<void(int)>& func)
+{
+    // The executor is not started for a serial loop
+    TaskExecutor* executor = nullptr;
+    if (thread_count != 1 && count > 1)
+    {
+        executor = &TaskExecutor::instance();
+        if (thread_count <= 0 || thread_count > executor->threadCount())
+            thread_count = executor->threadCount();
+        thread_count = std::min(thread_count, count);
+    }
+
+    if (executor == nullptr || thread_count <= 1)
+    {
+        for (int i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    // Items are taken one by one, so a slow item does not hold up a share of the others
+    std::atomic<int> next(0);
+    TaskGroup group(*executor);
+    for (int t = 0; t < thread_count; t++)
+        group.run([&]() {
+            for (int i = next++; i < count; i = next++)
+            {
+                try
+                {
+                    func(i);
+                }
+                catch (...)
+                {
+                    // The other loops stop at their next item
+                    next = count;
+                    throw;
+                }
+            }
+        });
+    group.wait();
+}
@@ -0,0 +1,143 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __task_executor_h__
+#define __task_executor_h__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base_c/defs.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+    // Pool of worker threads that live until the process exits, so parallel
+    // code does not start threads of its own on every call.
+    //
+    // Every worker owns a deque of tasks. Tasks submitted from a worker go to
+    // the back of its own deque, and the worker takes them from the back too;
+    // tasks submitted from other threads are spread over the deques in turn.
+    // A worker with an empty deque steals from the front of the others.
+    //
+    // A task runs with the session ID of the thread that submitted it, and
+    // the worker gets its own session ID back afterwards.
+    class DLLEXPORT TaskExecutor
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        explicit TaskExecutor(int thread_count);
+        ~TaskExecutor();
+
+        // Process-wide executor with one worker per core
+        static TaskExecutor& instance();
+        // Thread count of instance(), known without starting it
+        static int defaultThreadCount();
+
+        int threadCount() const;
+
+        // True on the worker threads of this executor
+        bool isWorkerThread() const;
+
+        // The task must not throw, use TaskGroup to get its exceptions
+        void submit(Task task);
+
+    private:
+        TaskExecutor(const TaskExecutor&); // no implicit copy
+
+        struct _Item
+        {
+            Task task;
+            qword session_id;
+        };
+
+        struct _Worker
+        {
+            std::mutex lock;
+            std::deque<_Item> tasks;
+        };
+
+        void _workerFunc(int index);
+
+        bool _take(int index, _Item& item);
+        void _execute(_Item& item);
+
+        std::vector<std::unique_ptr<_Worker>> _workers;
+        std::vector<std::thread> _threads;
+
+        std::atomic<int> _pending;
+        std::atomic<unsigned> _next_worker;
+
+        std::mutex _sleep_lock;
+        std::condition_variable _wake;
+        bool _stop;
+    };
+
+    // Tasks that are waited for together. A group created on a worker thread
+    // of its executor runs the tasks right away on that thread: nested parallel
+    // code does not oversubscribe the cores and cannot wait for workers that
+    // are all busy waiting for it.
+    class DLLEXPORT TaskGroup
+    {
+    public:
+        explicit TaskGroup(TaskExecutor& executor = TaskExecutor::instance());
+        // Waits for the tasks, their exceptions are dropped
+        ~TaskGroup();
+
+        void run(TaskExecutor::Task task);
+
+        // Waits for all tasks and rethrows the first exception thrown by them
+        void wait();
+
+        // Calls func(i) for every i below count on at most thread_count workers,
+        // 0 for all of them, and rethrows the first exception. With one thread
+        // the loop runs on the calling thread.
+        static void parallelFor(int count, int thread_count, const std::function<void(int)>& func);
+
+    private:
+        TaskGroup(const TaskGroup&); // no implicit copy
+
+        void _runTask(const TaskExecutor::Task& task);
+
+        TaskExecutor& _executor;
+        bool _inline;
+
+        std::mutex _lock;
+        std::condition_variable _done;
+        int _pending;
+        std::exception_ptr _exception;
+    };
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif // __task_executor_h__
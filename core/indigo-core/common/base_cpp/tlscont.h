@@ -92,6 +92,8 @@ namespace indigo
             auto map = sf::xlock_safe_ptr(_map);
             if (!map->count(id))
             {
+                // Session objects outlive any arena scope they are first requested from
+                ArenaAllocator::Suspend suspend;
                 map->emplace(id, std::make_unique<T>());
             }
             return *map->at(id);
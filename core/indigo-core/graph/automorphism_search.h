@@ -23,6 +23,7 @@
 #include "base_cpp/reusable_obj_array.h"
 #include "base_cpp/tlscont.h"
 #include "graph/graph.h"
+#include "graph/graph_csr.h"
 
 namespace indigo
 {
@@ -136,6 +137,7 @@ namespace indigo
 
         int _n;
         Graph* _given_graph;
+        const GraphCsr* _csr; // adjacency snapshot of _graph
 
         int _gca_first;
         int _canonlevel, _gca_canon;
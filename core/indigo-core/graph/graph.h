@@ -27,7 +27,9 @@
 #include "base_cpp/ptr_array.h"
 #include "graph/filter.h"
 #include "graph/graph_iterators.h"
+#include <atomic>
 #include <list>
+#include <mutex>
 
 #ifdef _WIN32
 #pragma warning(push)
@@ -136,6 +138,7 @@ namespace indigo
     };
 
     class CycleBasis;
+    class GraphCsr;
 
     class DLLEXPORT Graph : public NonCopyable
     {
@@ -245,6 +248,11 @@ namespace indigo
         int countComponentEdges(int comp_idx);
         const Array<int>& getDecomposition();
 
+        // Compact adjacency snapshot, rebuilt on the first call after the graph
+        // is modified. Threads may call it concurrently on a graph they share
+        // read-only, like a query or a layout pattern.
+        const GraphCsr& getCsr();
+
     protected:
         void _mergeWithSubgraph(const Graph& other, const Array<int>& vertices, const Array<int>* edges, Array<int>* mapping, Array<int>* edge_mapping);
 
@@ -270,6 +278,10 @@ namespace indigo
 
         PtrArray<GraphMetaObject> _meta_data;
 
+        GraphCsr* _csr;
+        std::atomic<bool> _csr_valid;
+        std::mutex _csr_lock;
+
         void _calculateTopology();
         void _calculateSSSR();
         void _calculateSSSRInit();
@@ -0,0 +1,114 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __graph_csr_h__
+#define __graph_csr_h__
+
+#include "base_cpp/array.h"
+#include "graph/graph.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    // Immutable compressed sparse row snapshot of the graph adjacency.
+    // Neighbor vertices and edges of all vertices are stored in two flat
+    // arrays in the order of the vertex neighbor lists, so neighbor walks
+    // do not chase the list pointers of the graph. Vertex and edge indices
+    // are the same as in the graph; removed vertices have no neighbors.
+    // Use Graph::getCsr() to get a snapshot that is rebuilt on demand
+    // after the graph has been modified.
+    class DLLEXPORT GraphCsr
+    {
+    public:
+        void build(const Graph& g);
+
+        int vertexEnd() const
+        {
+            return _offsets.size() - 1;
+        }
+
+        // Existing vertices in the graph order
+        int vertexCount() const
+        {
+            return _vertices.size();
+        }
+        const int* getVertices() const
+        {
+            return _vertices.ptr();
+        }
+
+        int degree(int v) const
+        {
+            return _offsets[v + 1] - _offsets[v];
+        }
+
+        // Numeration of neighbor vertices and neighbor edges is coherent
+        const int* getNeiVertices(int v) const
+        {
+            return _nei_vertices.ptr() + _offsets[v];
+        }
+        const int* getNeiEdges(int v) const
+        {
+            return _nei_edges.ptr() + _offsets[v];
+        }
+
+        int findEdgeIndex(int v1, int v2) const
+        {
+            const int* nei = _nei_vertices.ptr();
+            for (int i = _offsets[v1]; i < _offsets[v1 + 1]; i++)
+                if (nei[i] == v2)
+                    return _nei_edges[i];
+            return -1;
+        }
+
+        bool haveEdge(int v1, int v2) const
+        {
+            return findEdgeIndex(v1, v2) != -1;
+        }
+
+        // Edges indexed up to Graph::edgeEnd(), removed edges are left uninitialized
+        const Edge& getEdge(int e) const
+        {
+            return _edges[e];
+        }
+        const Edge* getEdges() const
+        {
+            return _edges.ptr();
+        }
+
+    private:
+        Array<int> _offsets;
+        Array<int> _vertices;
+        Array<int> _nei_vertices, _nei_edges;
+        // Graph keeps edges in a pool, interleaved with the pool links, so
+        // they are copied to give edge walks a flat array
+        Array<Edge> _edges;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif // __graph_csr_h__
@@ -23,6 +23,7 @@
 #include "base_cpp/obj_array.h"
 #include "base_cpp/tlscont.h"
 #include "graph/graph.h"
+#include "graph/graph_csr.h"
 
 namespace indigo
 {
@@ -58,6 +59,7 @@ namespace indigo
 
     protected:
         Graph& _graph;
+        const GraphCsr* _csr;
 
         struct VertexEdgeParent
         {
@@ -19,6 +19,8 @@
 #ifndef _max_common_subgraph
 #define _max_common_subgraph
 
+#include <atomic>
+
 #include "base_cpp/cancellation_handler.h"
 #include "base_cpp/d_bitset.h"
 #include "base_cpp/obj_list.h"
@@ -63,6 +65,11 @@ namespace indigo
             int numberOfSolutions;
             // throw error if input map is incorrect
             bool throw_error_for_incorrect_map;
+            // number of threads that share the search tree; 1 searches in the calling thread, 0 uses one thread per core.
+            // Threads find the same maximum solutions, other solutions may differ from the single-threaded search
+            int threadCount;
+            // if true then cancellation stops the search (isStopped is set) and keeps the solutions found so far instead of throwing
+            bool anytime;
         };
 
         // parameters for approximate algorithm
@@ -182,6 +189,12 @@ namespace indigo
             {
                 _maxIteration = m;
             };
+            // makes the maximum iterations number a limit of the given counter, which
+            // graphs parsing branches of one search in different threads share
+            void shareIterations(std::atomic<int>* counter)
+            {
+                _sharedIterations = counter;
+            };
             // set sizes for util variables
             void setSizes(int n1, int n2);
             // adds new RePoint to nodes set
@@ -197,23 +210,45 @@ namespace indigo
             //  RGraph using allowed adjacency relationship.
 
             void parse(bool findAllStructure);
+            // parses only the subtree of the search that starts at the given node. Nodes
+            // with smaller indices are forbidden there, as they are visited by their own subtrees.
+            // Parsing subtrees of all nodes gives the same solutions as parse() does.
+            void parseBranch(bool findAllStructure, int node);
             // retruns index of RePoint which corespondes to input edges ids
             int getPointIndex(int i, int j) const;
             // returns number of nodes (RePoints) in resolution graph
             int size() const
             {
-                return _graph.size();
+                return _nodes->size();
             };
             // returns true if algorithm has reached maximum iteration
             bool stopped()
             {
                 return _stop;
             };
+            // breaks the search
+            void stop()
+            {
+                _stop = true;
+            };
+            // returns number of iterations done
+            int iterations() const
+            {
+                return _nbIteration;
+            };
+            void addIterations(int count);
             // gets RePoint with index i
             RePoint* getPoint(int i)
             {
-                return _graph[i];
+                return _nodes->at(i);
             };
+            // makes this graph work on the nodes of another one, for parsing its branches in another thread.
+            // Nodes must not be changed while they are shared.
+            void shareNodes(ReGraph& other);
+            // replaces solutions by copies of solutions of another graph
+            void copySolutions(const ReGraph& other);
+            // adds solution if it is not included in already found ones (and removes solutions it includes)
+            void addSolution(const Dbitset& sol, const Dbitset& sol_g1, const Dbitset& sol_g2);
 
             // solution getters
             // begin solution index
@@ -259,16 +294,22 @@ namespace indigo
             void* userdata;
 
             CancellationHandler* cancellation_handler;
+            // if true then cancellation stops parsing instead of throwing
+            bool anytime;
 
         protected:
             // list of ReGraph nodes each node keeping track of its  neighbours
             PtrArray<RePoint> _graph;
+            // nodes that are parsed: own nodes or nodes shared by another graph
+            PtrArray<RePoint>* _nodes;
             // size of ReGRaph
             int _size;
             // current number of iterations
             int _nbIteration;
             // maximal number of iterations before search break
             int _maxIteration;
+            // iterations of all the graphs parsing one search, if it is shared
+            std::atomic<int>* _sharedIterations;
             // dimensions of the compared graphs
             int _firstGraphSize;
             int _secondGraphSize;
@@ -281,7 +322,10 @@ namespace indigo
             // (not included in a previous solution)
             //  and add this solution to the solution list
             // in case of success.
-            void _solution(const Dbitset& traversed, Dbitset& trav_g1, Dbitset& trav_g2);
+            void _solution(const Dbitset& traversed, const Dbitset& trav_g1, const Dbitset& trav_g2);
+            // parses subtrees that start at nodes from first_node to last_node - 1
+            void _parse(int first_node, int last_node);
+            bool _checkCancelled();
             // Determine if there are potential soltution remaining.
             bool _mustContinue(const Dbitset& pnode_g1, const Dbitset& pnode_g2) const;
 
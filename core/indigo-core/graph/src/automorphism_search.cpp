@@ -46,6 +46,7 @@ AutomorphismSearch::AutomorphismSearch()
     cb_edge_rank = 0;
     context_automorphism = 0;
     _given_graph = 0;
+    _csr = 0;
     ignored_vertices = 0;
 
     _cancellation_handler = getCancellationHandler();
@@ -245,6 +246,7 @@ void AutomorphismSearch::getCanonicallyOrderedOrbits(Array<int>& orbits) const
 void AutomorphismSearch::process(Graph& graph)
 {
     _prepareGraph(graph);
+    _csr = &_graph.getCsr();
 
     _active.clear_resize(_n);
     _workperm.clear_resize(_n);
@@ -718,9 +720,9 @@ bool AutomorphismSearch::_isAutomorphism(Array<int>& perm)
 {
     for (int i = _graph.edgeBegin(); i != _graph.edgeEnd(); i = _graph.edgeNext(i))
     {
-        const Edge& edge = _graph.getEdge(i);
+        const Edge& edge = _csr->getEdge(i);
 
-        if (!_graph.haveEdge(perm[edge.beg], perm[edge.end]))
+        if (!_csr->haveEdge(perm[edge.beg], perm[edge.end]))
             return false;
     }
 
@@ -947,7 +949,7 @@ void AutomorphismSearch::_refineBySortingNeighbourhood(int level, int& numcells)
 
 bool AutomorphismSearch::_hasEdgeWithRank(int from, int to, int target_edge_rank)
 {
-    int edge_index = _graph.findEdgeIndex(from, to);
+    int edge_index = _csr->findEdgeIndex(from, to);
 
     if (edge_index == -1)
         return false;
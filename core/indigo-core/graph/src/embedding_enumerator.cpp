@@ -32,7 +32,7 @@ IMPL_TIMEOUT_EXCEPTION(EmbeddingEnumerator, "embedding enumerator");
 CP_DEF(EmbeddingEnumerator);
 
 EmbeddingEnumerator::EmbeddingEnumerator(Graph& supergraph)
-    : CP_INIT, TL_CP_GET(_core_1), TL_CP_GET(_core_2), TL_CP_GET(_term2), TL_CP_GET(_unterm2), TL_CP_GET(_s_pool), TL_CP_GET(_g1_fast), TL_CP_GET(_g2_fast),
+    : CP_INIT, TL_CP_GET(_core_1), TL_CP_GET(_core_2), TL_CP_GET(_term2), TL_CP_GET(_unterm2), TL_CP_GET(_s_pool),
       TL_CP_GET(_query_match_state), TL_CP_GET(_enumerators)
 {
     _g2 = &supergraph;
@@ -66,7 +66,7 @@ void EmbeddingEnumerator::validate()
 {
     // _core_2 must be preserved because there might be fixed vertices
     _core_2.expandFill(_g2->vertexEnd(), -1);
-    _g2_fast.setGraph(*_g2);
+    _g2_csr = &_g2->getCsr();
 }
 
 void EmbeddingEnumerator::setSubgraph(Graph& subgraph)
@@ -82,7 +82,7 @@ void EmbeddingEnumerator::setSubgraph(Graph& subgraph)
 
     _terminatePreviousMatch();
 
-    _g1_fast.setGraph(*_g1);
+    _g1_csr = &_g1->getCsr();
 }
 
 void EmbeddingEnumerator::ignoreSubgraphVertex(int idx)
@@ -142,6 +142,10 @@ void EmbeddingEnumerator::processStart()
     if (_g1 == 0)
         throw Error("subgraph not set");
 
+    // Rebuilds the adjacency snapshots if the graphs were modified after setSubgraph() or validate()
+    _g1_csr = &_g1->getCsr();
+    _g2_csr = &_g2->getCsr();
+
     if (_equivalence_handler != NULL)
         _equivalence_handler->prepareForQueries();
 
@@ -360,8 +364,8 @@ void EmbeddingEnumerator::_Enumerator::_addPairNode2(int node1, int node2)
 
     if (_t1_len > 0)
     {
-        int node2_nei_count;
-        int* node2_nei_v = _context._g2_fast.getVertexNeiVertices(node2, node2_nei_count);
+        int node2_nei_count = _context._g2_csr->degree(node2);
+        const int* node2_nei_v = _context._g2_csr->getNeiVertices(node2);
         for (i = 0; i < node2_nei_count; i++)
         {
             int other2 = node2_nei_v[i];
@@ -436,9 +440,9 @@ bool EmbeddingEnumerator::_Enumerator::_checkPair(int node1, int node2)
     int j;
     bool needRemove = false;
 
-    int node1_nei_count;
-    int* node1_nei_v = _context._g1_fast.getVertexNeiVertices(node1, node1_nei_count);
-    int* node1_nei_e = _context._g1_fast.getVertexNeiEdges(node1, node1_nei_count);
+    int node1_nei_count = _context._g1_csr->degree(node1);
+    const int* node1_nei_v = _context._g1_csr->getNeiVertices(node1);
+    const int* node1_nei_e = _context._g1_csr->getNeiEdges(node1);
 
     for (j = 0; j < node1_nei_count; j++)
     {
@@ -448,7 +452,7 @@ bool EmbeddingEnumerator::_Enumerator::_checkPair(int node1, int node2)
         if (other2 >= 0)
         {
             int edge1 = node1_nei_e[j];
-            int edge2 = _context._g2_fast.findEdgeIndex(node2, other2);
+            int edge2 = _context._g2_csr->findEdgeIndex(node2, other2);
 
             if (edge2 == -1)
                 break;
@@ -554,8 +558,8 @@ int EmbeddingEnumerator::_Enumerator::nextPair()
 
     if (_t2_len == 0)
     {
-        int v2_count;
-        int* g2_vertices = _context._g2_fast.prepareVertices(v2_count);
+        int v2_count = _context._g2_csr->vertexCount();
+        const int* g2_vertices = _context._g2_csr->getVertices();
 
         // If _current_node2_idx == -1 then _current_node2_idx will be 0
         _current_node2_idx++;
@@ -590,13 +594,13 @@ int EmbeddingEnumerator::_Enumerator::nextPair()
                 throw Error("_current_node2_parent < 0");
         }
 
-        int nei_count;
-        int node2_parent_nei_id = _context._g2_fast.prepareVertexNeiVertices(_current_node2_parent, nei_count);
+        int nei_count = _context._g2_csr->degree(_current_node2_parent);
+        const int* node2_parent_nei = _context._g2_csr->getNeiVertices(_current_node2_parent);
 
         _current_node2_nei_index++;
         for (; _current_node2_nei_index != nei_count; _current_node2_nei_index++)
         {
-            _current_node2 = _context._g2_fast.getVertexNeiVertiex(node2_parent_nei_id, _current_node2_nei_index);
+            _current_node2 = node2_parent_nei[_current_node2_nei_index];
 
             if (!_checkNode2(_current_node2, _current_node1))
                 continue;
@@ -23,6 +23,7 @@
 #include "base_cpp/tlscont.h"
 #include "graph/cycle_basis.h"
 #include "graph/graph.h"
+#include "graph/graph_csr.h"
 #include "graph/graph_decomposer.h"
 #include "graph/spanning_tree.h"
 
@@ -59,6 +60,8 @@ Graph::Graph()
     _neighbors_pool = new Pool<List<VertexEdge>::Elem>();
     _sssr_pool = 0;
     _components_valid = false;
+    _csr = 0;
+    _csr_valid = false;
 }
 
 Graph::~Graph()
@@ -71,10 +74,12 @@ Graph::~Graph()
         _sssr_edges.clear();
         delete _sssr_pool;
     }
+    delete _csr;
 }
 
 int Graph::addVertex()
 {
+    _csr_valid = false;
     return _vertices->add(*_neighbors_pool);
 }
 
@@ -161,6 +166,7 @@ int Graph::addEdge(int beg, int end)
     _topology_valid = false;
     _sssr_valid = false;
     _components_valid = false;
+    _csr_valid = false;
 
     return edge_idx;
 }
@@ -169,6 +175,7 @@ void Graph::swapEdgeEnds(int edge_idx)
 {
 
     std::swap(_edges[edge_idx].beg, _edges[edge_idx].end);
+    _csr_valid = false;
 }
 
 void Graph::removeEdge(int idx)
@@ -186,6 +193,7 @@ void Graph::removeEdge(int idx)
     _topology_valid = false;
     _sssr_valid = false;
     _components_valid = false;
+    _csr_valid = false;
 }
 
 void Graph::removeAllEdges()
@@ -197,6 +205,7 @@ void Graph::removeAllEdges()
     _topology_valid = false;
     _sssr_valid = false;
     _components_valid = false;
+    _csr_valid = false;
 }
 
 void Graph::removeVertex(int idx)
@@ -220,6 +229,7 @@ void Graph::removeVertex(int idx)
     _topology_valid = false;
     _sssr_valid = false;
     _components_valid = false;
+    _csr_valid = false;
 }
 
 const Vertex& Graph::getVertex(int idx) const
@@ -320,6 +330,7 @@ void Graph::clear()
     _topology_valid = false;
     _sssr_valid = false;
     _components_valid = false;
+    _csr_valid = false;
 }
 
 bool Graph::isChain_AssumingConnected(const Graph& graph)
@@ -639,7 +650,11 @@ void Graph::_calculateSSSRInit()
     _v_sssr_count.zerofill();
 
     if (_sssr_pool == 0)
+    {
+        // Data built on demand takes its storage where the graph does
+        ArenaAllocator::Scope scope(_edges.arena());
         _sssr_pool = new Pool<List<int>::Elem>();
+    }
 
     _sssr_vertices.clear();
     _sssr_edges.clear();
@@ -762,6 +777,24 @@ const Array<int>& Graph::getDecomposition()
     return _component_numbers;
 }
 
+const GraphCsr& Graph::getCsr()
+{
+    if (!_csr_valid.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> guard(_csr_lock);
+
+        ArenaAllocator::Scope scope(_edges.arena());
+        if (_csr == 0)
+            _csr = new GraphCsr();
+        if (!_csr_valid.load(std::memory_order_relaxed))
+        {
+            _csr->build(*this);
+            _csr_valid.store(true, std::memory_order_release);
+        }
+    }
+    return *_csr;
+}
+
 List<int>& Graph::sssrEdges(int idx)
 {
     if (!_sssr_valid)
@@ -859,6 +892,7 @@ void Graph::_cloneGraph_KeepIndices(const Graph& other)
     _topology_valid = false;
     _sssr_valid = false;
     _components_valid = false;
+    _csr_valid = false;
 }
 
 void Graph::_calculateSSSRAddEdgesAndVertices(const Array<int>& cycle, List<int>& edges, List<int>& vertices)
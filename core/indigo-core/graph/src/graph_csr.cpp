@@ -0,0 +1,60 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "graph/graph_csr.h"
+
+using namespace indigo;
+
+void GraphCsr::build(const Graph& g)
+{
+    int vertex_end = g.vertexEnd();
+
+    _offsets.clear_resize(vertex_end + 1);
+    _offsets.zerofill();
+    _vertices.clear();
+    _vertices.reserve(g.vertexCount());
+
+    for (int v = g.vertexBegin(); v != vertex_end; v = g.vertexNext(v))
+    {
+        _vertices.push(v);
+        _offsets[v + 1] = g.getVertex(v).degree();
+    }
+
+    for (int v = 0; v < vertex_end; v++)
+        _offsets[v + 1] += _offsets[v];
+
+    _nei_vertices.clear_resize(_offsets[vertex_end]);
+    _nei_edges.clear_resize(_offsets[vertex_end]);
+
+    int* nei_vertices = _nei_vertices.ptr();
+    int* nei_edges = _nei_edges.ptr();
+    for (int i = 0; i < _vertices.size(); i++)
+    {
+        const Vertex& vertex = g.getVertex(_vertices[i]);
+        int pos = _offsets[_vertices[i]];
+        for (int j = vertex.neiBegin(); j != vertex.neiEnd(); j = vertex.neiNext(j), pos++)
+        {
+            nei_vertices[pos] = vertex.neiVertex(j);
+            nei_edges[pos] = vertex.neiEdge(j);
+        }
+    }
+
+    _edges.clear_resize(g.edgeEnd());
+    for (int e = g.edgeBegin(); e != g.edgeEnd(); e = g.edgeNext(e))
+        _edges[e] = g.getEdge(e);
+}
@@ -25,7 +25,7 @@ using namespace indigo;
 CP_DEF(GraphSubtreeEnumerator);
 
 GraphSubtreeEnumerator::GraphSubtreeEnumerator(Graph& graph)
-    : _graph(graph), CP_INIT, TL_CP_GET(_front), TL_CP_GET(_vertices), TL_CP_GET(_edges), TL_CP_GET(_v_processed)
+    : _graph(graph), _csr(0), CP_INIT, TL_CP_GET(_front), TL_CP_GET(_vertices), TL_CP_GET(_edges), TL_CP_GET(_v_processed)
 {
     min_vertices = 1;
     max_vertices = graph.vertexCount();
@@ -44,6 +44,7 @@ void GraphSubtreeEnumerator::process()
 {
     _edges.clear();
     _vertices.clear();
+    _csr = &_graph.getCsr();
 
     _v_processed.clear_resize(_graph.vertexEnd());
     _v_processed.zerofill();
@@ -97,16 +98,18 @@ void GraphSubtreeEnumerator::_reverseSearch(int front_idx, int cur_maximal_crite
 
         // Update front
         int v = front_prev_value.v;
-        const Vertex& vertex = _graph.getVertex(v);
-        for (int i = vertex.neiBegin(); i != vertex.neiEnd(); i = vertex.neiNext(i))
+        int degree = _csr->degree(v);
+        const int* nei_vertices = _csr->getNeiVertices(v);
+        const int* nei_edges = _csr->getNeiEdges(v);
+        for (int i = 0; i < degree; i++)
         {
-            int nei_v = vertex.neiVertex(i);
+            int nei_v = nei_vertices[i];
             if (_v_processed[nei_v] == 1)
                 continue;
 
             VertexEdgeParent& added = _front.push();
             added.v = nei_v;
-            added.e = vertex.neiEdge(i);
+            added.e = nei_edges[i];
             added.parent = v;
         }
         // Check if we can reuse front_idx front index
@@ -19,8 +19,10 @@
 #include "graph/max_common_subgraph.h"
 #include "base_cpp/array.h"
 #include "base_cpp/cancellation_handler.h"
+#include "base_cpp/os_thread_wrapper.h"
 #include "time.h"
 #include <algorithm>
+#include <thread>
 
 using namespace indigo;
 
@@ -35,6 +37,8 @@ MaxCommonSubgraph::MaxCommonSubgraph(Graph& subgraph, Graph& supergraph)
     parametersForExact.maxIteration = -1;
     parametersForExact.numberOfSolutions = 0;
     parametersForExact.throw_error_for_incorrect_map = false;
+    parametersForExact.threadCount = 1;
+    parametersForExact.anytime = false;
 
     parametersForApproximate.error = 0;
     parametersForApproximate.maxIteration = 1000;
@@ -148,6 +152,123 @@ void MaxCommonSubgraph::_addSolutionMap(Array<int>& v_map, Array<int>& e_map)
     }
 }
 
+namespace
+{
+    // Parses the subtrees of the resolution graph nodes in worker threads.
+    // Each subtree starts with the solutions found so far, so it can cut
+    // branches that can not give new solutions, and its own solutions are
+    // merged into the resolution graph in the main thread. The callback of
+    // the resolution graph is called from the main thread on merging.
+    class ReGraphParseDispatcher : public OsCommandDispatcher
+    {
+    public:
+        ReGraphParseDispatcher(MaxCommonSubgraph::ReGraph& regraph, bool find_all_structure)
+            : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _regraph(regraph), _find_all_structure(find_all_structure), _next_node(0),
+              _iterations(0), _cancellation(regraph.cancellation_handler)
+        {
+            _max_iteration = -1;
+        }
+
+        void setMaxIteration(int max_iteration)
+        {
+            _max_iteration = max_iteration;
+        }
+
+    private:
+        class _Result : public OsCommandResult
+        {
+        public:
+            void clear() override
+            {
+                solutions.clear();
+                solutions_g1.clear();
+                solutions_g2.clear();
+                iterations = 0;
+                stopped = false;
+            }
+
+            ObjArray<Dbitset> solutions;
+            ObjArray<Dbitset> solutions_g1;
+            ObjArray<Dbitset> solutions_g2;
+            int iterations;
+            bool stopped;
+        };
+
+        class _Command : public OsCommand
+        {
+        public:
+            void execute(OsCommandResult& result) override
+            {
+                _Result& res = static_cast<_Result&>(result);
+
+                regraph.parseBranch(find_all_structure, node);
+
+                for (int x = regraph.solBegin(); regraph.solIsNotEnd(x); x = regraph.solNext(x))
+                {
+                    res.solutions.push().copy(regraph.getSolBitset(x));
+                    res.solutions_g1.push().copy(regraph.getProj1Bitset(x));
+                    res.solutions_g2.push().copy(regraph.getProj2Bitset(x));
+                }
+                res.iterations = regraph.iterations();
+                res.stopped = regraph.stopped();
+            }
+
+            MaxCommonSubgraph::ReGraph regraph;
+            bool find_all_structure;
+            int node;
+        };
+
+        OsCommand* _allocateCommand() override
+        {
+            return new _Command();
+        }
+
+        OsCommandResult* _allocateResult() override
+        {
+            return new _Result();
+        }
+
+        bool _setupCommand(OsCommand& command) override
+        {
+            if (_next_node >= _regraph.size() || _regraph.stopped())
+                return false;
+            if (_max_iteration > -1 && _iterations.load(std::memory_order_relaxed) >= _max_iteration)
+                return false;
+
+            _Command& cmd = static_cast<_Command&>(command);
+            cmd.regraph.shareNodes(_regraph);
+            cmd.regraph.copySolutions(_regraph);
+            if (_regraph.cancellation_handler != nullptr)
+                cmd.regraph.cancellation_handler = &_cancellation;
+            // Workers count iterations together, so the limit applies to the whole search
+            cmd.regraph.setMaxIteration(_max_iteration);
+            cmd.regraph.shareIterations(&_iterations);
+            cmd.find_all_structure = _find_all_structure;
+            cmd.node = _next_node++;
+            return true;
+        }
+
+        void _handleResult(OsCommandResult& result) override
+        {
+            _Result& res = static_cast<_Result&>(result);
+
+            for (int i = 0; i < res.solutions.size(); i++)
+                _regraph.addSolution(res.solutions[i], res.solutions_g1[i], res.solutions_g2[i]);
+
+            _regraph.addIterations(res.iterations);
+            if (res.stopped)
+                _regraph.stop();
+        }
+
+        MaxCommonSubgraph::ReGraph& _regraph;
+        bool _find_all_structure;
+        int _next_node;
+        int _max_iteration;
+        std::atomic<int> _iterations;
+        SharedCancellationHandler _cancellation;
+    };
+}
+
 void MaxCommonSubgraph::findExactMCS()
 {
     /*
@@ -158,6 +279,7 @@ void MaxCommonSubgraph::findExactMCS()
 
     ReGraph regraph;
     regraph.setMaxIteration(parametersForExact.maxIteration);
+    regraph.anytime = parametersForExact.anytime;
 
     ReCreation rc(regraph, *this);
     rc.createRegraph();
@@ -167,7 +289,18 @@ void MaxCommonSubgraph::findExactMCS()
     regraph.cbEmbedding = cbEmbedding;
     regraph.userdata = embeddingUserdata;
 
-    regraph.parse(find_all_str);
+    int thread_count = parametersForExact.threadCount;
+    if (thread_count == 0)
+        thread_count = std::max(1, (int)std::thread::hardware_concurrency());
+
+    if (thread_count > 1)
+    {
+        ReGraphParseDispatcher dispatcher(regraph, find_all_str);
+        dispatcher.setMaxIteration(parametersForExact.maxIteration);
+        dispatcher.run(thread_count);
+    }
+    else
+        regraph.parse(find_all_str);
 
     parametersForExact.isStopped = regraph.stopped();
     parametersForExact.numberOfSolutions = rc.createSolutionMaps();
@@ -258,7 +391,11 @@ void MaxCommonSubgraph::ReCreation::createRegraph()
     if (_regraph.cancellation_handler != nullptr)
     {
         if (_regraph.cancellation_handler->isCancelled())
-            throw Error("mcs search was cancelled: %s", _regraph.cancellation_handler->cancelledRequestMessage());
+        {
+            if (!_regraph.anytime)
+                throw Error("mcs search was cancelled: %s", _regraph.cancellation_handler->cancelledRequestMessage());
+            _regraph.stop();
+        }
     }
     _nodeConstructor();
     _edgesConstructor();
@@ -653,18 +790,22 @@ void MaxCommonSubgraph::ReCreation::getSolutionListsSuper(ObjArray<Array<int>>&
 
 //-------------------------------------------------------------------------------------------------------------
 MaxCommonSubgraph::ReGraph::ReGraph()
-    : cbEmbedding(0), userdata(0), cancellation_handler(nullptr), _nbIteration(0), _maxIteration(-1), _firstGraphSize(0), _secondGraphSize(0),
+    : cbEmbedding(0), userdata(0), cancellation_handler(nullptr), _nbIteration(0), _maxIteration(-1), _sharedIterations(nullptr), _firstGraphSize(0), _secondGraphSize(0),
       _findAllStructure(true), _stop(false), _solutionObjList(_pool)
 {
     cancellation_handler = getCancellationHandler();
+    anytime = false;
+    _nodes = &_graph;
 }
 
 MaxCommonSubgraph::ReGraph::ReGraph(MaxCommonSubgraph& context)
-    : cbEmbedding(0), userdata(0), cancellation_handler(nullptr), _nbIteration(0), _maxIteration(-1), _firstGraphSize(0), _secondGraphSize(0),
+    : cbEmbedding(0), userdata(0), cancellation_handler(nullptr), _nbIteration(0), _maxIteration(-1), _sharedIterations(nullptr), _firstGraphSize(0), _secondGraphSize(0),
       _findAllStructure(true), _stop(false), _solutionObjList(_pool)
 {
     setMaxIteration(context.parametersForExact.maxIteration);
     cancellation_handler = getCancellationHandler();
+    anytime = context.parametersForExact.anytime;
+    _nodes = &_graph;
 }
 
 void MaxCommonSubgraph::ReGraph::setSizes(int n1, int n2)
@@ -676,13 +817,81 @@ void MaxCommonSubgraph::ReGraph::setSizes(int n1, int n2)
 void MaxCommonSubgraph::ReGraph::clear()
 {
     _graph.clear();
+    _nodes = &_graph;
     _solutionObjList.clear();
 }
 
+void MaxCommonSubgraph::ReGraph::addIterations(int count)
+{
+    _nbIteration += count;
+    if (_maxIteration > -1 && _nbIteration >= _maxIteration)
+        _stop = true;
+}
+
+void MaxCommonSubgraph::ReGraph::shareNodes(ReGraph& other)
+{
+    _graph.clear();
+    _nodes = other._nodes;
+    _firstGraphSize = other._firstGraphSize;
+    _secondGraphSize = other._secondGraphSize;
+    cancellation_handler = other.cancellation_handler;
+    anytime = other.anytime;
+    _nbIteration = 0;
+    _sharedIterations = nullptr;
+    _stop = false;
+}
+
+void MaxCommonSubgraph::ReGraph::copySolutions(const ReGraph& other)
+{
+    _solutionObjList.clear();
+
+    int last = _solutionObjList.end();
+    for (int x = other.solBegin(); other.solIsNotEnd(x); x = other.solNext(x))
+    {
+        last = (last == _solutionObjList.end() ? _solutionObjList.add() : _solutionObjList.insertAfter(last));
+
+        const Solution& solution = other._solutionObjList[x];
+        _solutionObjList[last].reSolution.copy(solution.reSolution);
+        _solutionObjList[last].solutionProj1.copy(solution.solutionProj1);
+        _solutionObjList[last].solutionProj2.copy(solution.solutionProj2);
+        _solutionObjList[last].numBits = solution.numBits;
+    }
+}
+
+void MaxCommonSubgraph::ReGraph::addSolution(const Dbitset& sol, const Dbitset& sol_g1, const Dbitset& sol_g2)
+{
+    _solution(sol, sol_g1, sol_g2);
+}
+
 void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure)
 {
-    _size = _graph.size();
     _findAllStructure = findAllStructure;
+    _parse(0, _nodes->size());
+}
+
+void MaxCommonSubgraph::ReGraph::parseBranch(bool findAllStructure, int node)
+{
+    _findAllStructure = findAllStructure;
+    _parse(node, node + 1);
+}
+
+bool MaxCommonSubgraph::ReGraph::_checkCancelled()
+{
+    if (cancellation_handler == nullptr || !cancellation_handler->isCancelled())
+        return false;
+
+    if (!anytime)
+        throw Error("mcs search was cancelled: %s", cancellation_handler->cancelledRequestMessage());
+
+    _stop = true;
+    return true;
+}
+
+void MaxCommonSubgraph::ReGraph::_parse(int first_node, int last_node)
+{
+    _size = _nodes->size();
+    if (first_node >= last_node)
+        return;
 
     Dbitset pnode_g1(_firstGraphSize);
     Dbitset pnode_g2(_secondGraphSize);
@@ -718,7 +927,8 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure)
         allowed_g2.push(_secondGraphSize);
         xk[i] = -1;
     }
-    extension[0].set();
+    extension[0].set(first_node, last_node);
+    forbidden[0].set(0, first_node);
     allowed_g1[0].set();
     allowed_g2[0].set();
 
@@ -732,17 +942,17 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure)
             next_level = level + 1;
             xk_level = xk[level];
 
-            forbidden[next_level].bsOrBs(forbidden[level], _graph.at(xk_level)->forbidden);
-            allowed_g1[next_level].bsAndBs(allowed_g1[level], _graph.at(xk_level)->allowed_g1);
-            allowed_g2[next_level].bsAndBs(allowed_g2[level], _graph.at(xk_level)->allowed_g2);
+            forbidden[next_level].bsOrBs(forbidden[level], _nodes->at(xk_level)->forbidden);
+            allowed_g1[next_level].bsAndBs(allowed_g1[level], _nodes->at(xk_level)->allowed_g1);
+            allowed_g2[next_level].bsAndBs(allowed_g2[level], _nodes->at(xk_level)->allowed_g2);
 
             if (traversed[level].isEmpty())
             {
-                extension[next_level].bsAndNotBs(_graph.at(xk_level)->extension, forbidden[next_level]);
+                extension[next_level].bsAndNotBs(_nodes->at(xk_level)->extension, forbidden[next_level]);
             }
             else
             {
-                extension[next_level].bsOrBs(extension[level], _graph.at(xk_level)->extension);
+                extension[next_level].bsOrBs(extension[level], _nodes->at(xk_level)->extension);
                 extension[next_level].andNotWith(forbidden[next_level]);
             }
 
@@ -751,8 +961,8 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure)
 
             traversed_g1[next_level].copy(traversed_g1[level]);
             traversed_g2[next_level].copy(traversed_g2[level]);
-            traversed_g1[next_level].set(_graph.at(xk_level)->getid1());
-            traversed_g2[next_level].set(_graph.at(xk_level)->getid2());
+            traversed_g1[next_level].set(_nodes->at(xk_level)->getid1());
+            traversed_g2[next_level].set(_nodes->at(xk_level)->getid2());
 
             forbidden[level].set(xk_level);
 
@@ -775,16 +985,11 @@ void MaxCommonSubgraph::ReGraph::parse(bool findAllStructure)
                 if (_mustContinue(pnode_g1, pnode_g2))
                 {
                     ++_nbIteration;
-                    if (_maxIteration > -1 && _nbIteration >= _maxIteration)
+                    int total = _sharedIterations != nullptr ? _sharedIterations->fetch_add(1, std::memory_order_relaxed) + 1 : _nbIteration;
+                    if (_maxIteration > -1 && total >= _maxIteration)
                         _stop = true;
                     if (_nbIteration % 10 == 0)
-                    {
-                        if (cancellation_handler != nullptr)
-                        {
-                            if (cancellation_handler->isCancelled())
-                                throw Error("mcs search was cancelled: %s", cancellation_handler->cancelledRequestMessage());
-                        }
-                    }
+                        _checkCancelled();
                 }
                 else
                 {
@@ -835,14 +1040,14 @@ void MaxCommonSubgraph::ReGraph::insertSolution(int ins_index, bool ins_after, c
 
         for (int x = sol.nextSetBit(0); x >= 0; x = sol.nextSetBit(x + 1))
         {
-            sub_edge_map[_graph.at(x)->getid1()] = _graph.at(x)->getid2();
+            sub_edge_map[_nodes->at(x)->getid1()] = _nodes->at(x)->getid2();
         }
         if (!cbEmbedding(0, sub_edge_map.ptr(), 0, userdata))
             _stop = true;
     }
 }
 
-void MaxCommonSubgraph::ReGraph::_solution(const Dbitset& traversed, Dbitset& trav_g1, Dbitset& trav_g2)
+void MaxCommonSubgraph::ReGraph::_solution(const Dbitset& traversed, const Dbitset& trav_g1, const Dbitset& trav_g2)
 {
 
     bool included = false;
@@ -930,9 +1135,9 @@ bool MaxCommonSubgraph::ReGraph::_mustContinue(const Dbitset& pnode_g1, const Db
 
 int MaxCommonSubgraph::ReGraph::getPointIndex(int i, int j) const
 {
-    for (int x = 0; x < _graph.size(); x++)
+    for (int x = 0; x < _nodes->size(); x++)
     {
-        if ((_graph.at(x)->getid1() == i && _graph.at(x)->getid2() == j))
+        if ((_nodes->at(x)->getid1() == i && _nodes->at(x)->getid2() == j))
         {
             return x;
         }
@@ -24,7 +24,7 @@ using namespace indigo;
 CP_DEF(SubgraphHash);
 
 SubgraphHash::SubgraphHash(Graph& g)
-    : _g(g), CP_INIT, TL_CP_GET(_codes), TL_CP_GET(_oldcodes), TL_CP_GET(_gf), TL_CP_GET(_default_vertex_codes), TL_CP_GET(_default_edge_codes)
+    : _g(g), CP_INIT, TL_CP_GET(_codes), TL_CP_GET(_oldcodes), TL_CP_GET(_default_vertex_codes), TL_CP_GET(_default_edge_codes)
 {
     max_iterations = _g.vertexEnd();
     _different_codes_count = 0;
@@ -40,9 +40,6 @@ SubgraphHash::SubgraphHash(Graph& g)
 
     vertex_codes = &_default_vertex_codes;
     edge_codes = &_default_edge_codes;
-
-    _gf.setGraph(g);
-    _gf.prepareEdges();
 }
 
 dword SubgraphHash::getHash()
@@ -81,7 +78,7 @@ dword SubgraphHash::getHash(const Array<int>& vertices, const Array<int>& edges)
     for (i = 0; i < vertices.size(); i++)
         codes_ptr[v[i]] = vc[v[i]];
 
-    const Edge* graph_edges = _gf.getEdges();
+    const Edge* graph_edges = _g.getCsr().getEdges();
 
     for (iter = 0; iter < max_iterations; iter++)
     {
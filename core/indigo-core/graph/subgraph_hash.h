@@ -21,7 +21,7 @@
 
 #include "base_cpp/array.h"
 #include "base_cpp/tlscont.h"
-#include "graph/graph_fast_access.h"
+#include "graph/graph_csr.h"
 
 #ifdef _WIN32
 #pragma warning(push)
@@ -55,7 +55,6 @@ namespace indigo
         CP_DECL;
         TL_CP_DECL(Array<dword>, _codes);
         TL_CP_DECL(Array<dword>, _oldcodes);
-        TL_CP_DECL(GraphFastAccess, _gf);
 
         TL_CP_DECL(Array<int>, _default_vertex_codes);
         TL_CP_DECL(Array<int>, _default_edge_codes);
@@ -19,6 +19,10 @@
 #ifndef __molecule_layout_h__
 #define __molecule_layout_h__
 
+#include <atomic>
+#include <string>
+#include <vector>
+
 #include "base_cpp/cancellation_handler.h"
 #include "layout/metalayout.h"
 #include "layout/molecule_layout_graph.h"
@@ -56,6 +60,9 @@ namespace indigo
         bool _smart_layout;
         layout_orientation_value layout_orientation;
 
+        // Threads laying out disconnected components, 0 - one per core
+        int thread_count;
+
         DECL_ERROR;
 
     protected:
@@ -84,6 +91,48 @@ namespace indigo
         bool _hasMulGroups;
     };
 
+    // Lays out many molecules with the same settings in worker threads, like
+    // MoleculeLayout::make() does for every one of them. Each molecule is laid
+    // out in one thread, so the components of a molecule are not split between
+    // threads. A molecule that fails to be laid out keeps its coordinates, its
+    // error is kept and the rest of the batch is still laid out.
+    class DLLEXPORT MoleculeBatchLayout
+    {
+    public:
+        MoleculeBatchLayout();
+
+        void make(const Array<BaseMolecule*>& molecules);
+
+        bool smart_layout;
+        float bond_length;
+        int max_iterations;
+        layout_orientation_value layout_orientation;
+
+        // Timeout for every molecule in milliseconds, 0 - no timeout
+        int cancellation_timeout;
+
+        // Worker threads, 0 - one per core
+        int thread_count;
+
+        // No molecule is started after one has failed. Molecules that are not
+        // started are left as they are and have no error
+        bool stop_on_error;
+
+        int getFailedCount() const;
+
+        // Error message of the idx-th molecule of the last batch, or nullptr
+        // if it has been laid out
+        const char* getError(int idx) const;
+
+    private:
+        void _layoutMolecule(BaseMolecule& mol, int idx);
+
+        class _Dispatcher;
+
+        std::vector<std::string> _errors;
+        std::atomic<bool> _failed;
+    };
+
 } // namespace indigo
 
 #ifdef _WIN32
@@ -169,6 +169,9 @@ namespace indigo
         int max_iterations;
         layout_orientation_value layout_orientation;
 
+        // Threads laying out disconnected components, 0 - one per core
+        int thread_count;
+
         CancellationHandler* cancellation;
 
         DECL_ERROR;
@@ -328,6 +331,7 @@ namespace indigo
         bool _prepareAssignedList(Array<int>& assigned_list, BiconnectedDecomposer& bc_decom, PtrArray<MoleculeLayoutGraph>& bc_components,
                                   Array<int>& bc_tree);
         void _assignFinalCoordinates(float bond_length, const Array<Vec2f>& src_layout);
+        void _layoutComponents(BaseMolecule& molecule, PtrArray<MoleculeLayoutGraph>& components, ObjArray<Array<Vec2f>>& src_layouts, float bond_length);
         void _copyLayout(MoleculeLayoutGraph& component);
         void _getAnchor(int& v1, int& v2, int& v3) const;
 
@@ -173,6 +173,11 @@ namespace indigo
         const Vec2f& getPos(int v) const;
         float preliminary_layout(CycleLayout& cl);
 
+        // Input of doLayout() as one byte string, equal tasks give equal positions
+        void getTask(Array<byte>& task) const;
+        const Array<Vec2f>& getPositions() const;
+        void setPositions(const Array<Vec2f>& positions);
+
         DECL_ERROR;
 
     private:
@@ -0,0 +1,119 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __molecule_layout_macrocycles_cache_h__
+#define __molecule_layout_macrocycles_cache_h__
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+#include "base_cpp/obj_array.h"
+#include "math/algebra.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    class Scanner;
+    class Output;
+    class MoleculeLayoutMacrocyclesLattice;
+
+    // Process-wide store of macrocycle layouts found by the lattice search of
+    // MoleculeLayoutMacrocyclesLattice. A template is keyed by the Morgan code
+    // of the cycle (Cycle::calcMorganCode) and holds the complete input of
+    // doLayout(), so a template is reused only for an identical task and the
+    // result is the same as the one of the search. Templates can be saved to
+    // and loaded from a file to be shared between runs. The cache is emptied
+    // when the number of templates reaches the capacity.
+    class DLLEXPORT MoleculeLayoutMacrocyclesCache
+    {
+    public:
+        enum
+        {
+            // Smaller cycles without trans bonds are laid out as regular polygons
+            MIN_CYCLE_SIZE = 10,
+            DEFAULT_CAPACITY = 1 << 12
+        };
+
+        static MoleculeLayoutMacrocyclesCache& instance();
+
+        MoleculeLayoutMacrocyclesCache();
+
+        // Sets the positions of the layout and returns true if a template matches
+        bool find(long morgan_code, MoleculeLayoutMacrocyclesLattice& layout);
+        // Stores the positions of the layout after doLayout()
+        void add(long morgan_code, const MoleculeLayoutMacrocyclesLattice& layout);
+
+        // Adds the templates of the stream to the cache and returns their count
+        int load(Scanner& scanner);
+        int loadFromFile(const char* filename);
+        // Returns the number of saved templates
+        int save(Output& output);
+        int saveToFile(const char* filename);
+
+        void setEnabled(bool enabled);
+        bool isEnabled() const;
+
+        void setCapacity(int capacity);
+        int getCapacity() const;
+        int size() const;
+        void clear();
+
+        qword getHits() const;
+        qword getMisses() const;
+        void resetCounters();
+
+        DECL_ERROR;
+
+    private:
+        struct _Template
+        {
+            long morgan_code;
+            Array<byte> task;
+            Array<Vec2f> positions;
+        };
+
+        int _find(long morgan_code, const Array<byte>& task) const;
+        void _add(long morgan_code, const Array<byte>& task, const Array<Vec2f>& positions);
+        void _clear();
+
+        mutable std::mutex _lock;
+        ObjArray<_Template> _templates;
+        std::unordered_multimap<long, int> _index;
+        int _capacity;
+        // Checked and counted by layout threads outside of the lock
+        std::atomic<bool> _enabled;
+
+        std::atomic<qword> _hits;
+        std::atomic<qword> _misses;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif // __molecule_layout_macrocycles_cache_h__
@@ -115,6 +115,9 @@ void PatternLayoutFinder::_initPatterns()
 
     profTimerStart(t0, "layout.init-patterns");
 
+    // The patterns are shared by all later layouts
+    ArenaAllocator::Suspend suspend;
+
     _patterns.reserve(NELEM(layout_templates));
     for (const char* tpl : layout_templates)
     {
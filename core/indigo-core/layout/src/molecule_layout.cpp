@@ -19,7 +19,10 @@
 #include "layout/molecule_layout.h"
 #include "base_cpp/array.h"
 #include "base_cpp/obj_array.h"
+#include "base_cpp/os_thread_wrapper.h"
 #include "graph/filter.h"
+#include <algorithm>
+#include <thread>
 #include <vector>
 
 using namespace indigo;
@@ -45,6 +48,8 @@ void MoleculeLayout::_init(bool smart_layout)
         _layout_graph = std::make_unique<MoleculeLayoutGraphSimple>();
 
     max_iterations = LAYOUT_MAX_ITERATION;
+    layout_orientation = UNCPECIFIED;
+    thread_count = 1;
     _query = false;
     _atomMapping.clear();
 
@@ -364,6 +369,7 @@ void MoleculeLayout::_make()
 {
     _layout_graph->max_iterations = max_iterations;
     _layout_graph->layout_orientation = layout_orientation;
+    _layout_graph->thread_count = thread_count;
 
     // 0. Find 2D coordinates via proxy _layout_graph object
     _layout_graph->max_iterations = max_iterations;
@@ -531,3 +537,116 @@ void MoleculeLayout::_updateMultipleGroups()
         }
     }
 }
+
+class MoleculeBatchLayout::_Dispatcher : public OsCommandDispatcher
+{
+public:
+    _Dispatcher(MoleculeBatchLayout& layout, const Array<BaseMolecule*>& molecules)
+        : OsCommandDispatcher(HANDLING_ORDER_ANY, true), _layout(layout), _molecules(molecules), _next_molecule(0)
+    {
+    }
+
+protected:
+    class _Command : public OsCommand
+    {
+    public:
+        void execute(OsCommandResult& result) override
+        {
+            dispatcher->_layout._layoutMolecule(*dispatcher->_molecules[molecule], molecule);
+        }
+
+        _Dispatcher* dispatcher;
+        int molecule;
+    };
+
+    OsCommand* _allocateCommand() override
+    {
+        return new _Command();
+    }
+
+    bool _setupCommand(OsCommand& command) override
+    {
+        if (_next_molecule == _molecules.size())
+            return false;
+        if (_layout.stop_on_error && _layout._failed.load())
+            return false;
+
+        _Command& cmd = static_cast<_Command&>(command);
+        cmd.dispatcher = this;
+        cmd.molecule = _next_molecule++;
+        return true;
+    }
+
+private:
+    MoleculeBatchLayout& _layout;
+    const Array<BaseMolecule*>& _molecules;
+    int _next_molecule;
+};
+
+MoleculeBatchLayout::MoleculeBatchLayout()
+{
+    smart_layout = false;
+    bond_length = 1.f;
+    max_iterations = MoleculeLayout::LAYOUT_MAX_ITERATION;
+    layout_orientation = UNCPECIFIED;
+    cancellation_timeout = 0;
+    thread_count = 0;
+    stop_on_error = false;
+    _failed = false;
+}
+
+void MoleculeBatchLayout::make(const Array<BaseMolecule*>& molecules)
+{
+    _errors.clear();
+    _errors.resize(molecules.size());
+    _failed = false;
+
+    int threads = thread_count;
+    if (threads == 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    threads = std::min(threads, molecules.size());
+
+    if (threads <= 1)
+    {
+        for (int i = 0; i < molecules.size() && !(stop_on_error && _failed); i++)
+            _layoutMolecule(*molecules[i], i);
+        return;
+    }
+
+    _Dispatcher dispatcher(*this, molecules);
+    dispatcher.run(threads);
+}
+
+void MoleculeBatchLayout::_layoutMolecule(BaseMolecule& mol, int idx)
+{
+    try
+    {
+        MoleculeLayout layout(mol, smart_layout);
+        layout.max_iterations = max_iterations;
+        layout.layout_orientation = layout_orientation;
+        layout.bond_length = bond_length;
+
+        TimeoutCancellationHandler cancellation(cancellation_timeout);
+        if (cancellation_timeout > 0)
+            layout.setCancellationHandler(&cancellation);
+
+        layout.make();
+    }
+    catch (Exception& e)
+    {
+        _errors[idx] = e.message();
+        _failed = true;
+    }
+}
+
+int MoleculeBatchLayout::getFailedCount() const
+{
+    return (int)std::count_if(_errors.begin(), _errors.end(), [](const std::string& error) { return !error.empty(); });
+}
+
+const char* MoleculeBatchLayout::getError(int idx) const
+{
+    if (_errors[idx].empty())
+        return nullptr;
+    return _errors[idx].c_str();
+}
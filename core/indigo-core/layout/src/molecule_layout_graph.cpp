@@ -17,10 +17,13 @@
  ***************************************************************************/
 
 #include "layout/molecule_layout_graph.h"
+#include "base_cpp/os_thread_wrapper.h"
 #include "graph/biconnected_decomposer.h"
 #include "graph/morgan_code.h"
 
+#include <algorithm>
 #include <memory>
+#include <thread>
 
 using namespace indigo;
 
@@ -34,6 +37,7 @@ MoleculeLayoutGraph::MoleculeLayoutGraph() : Graph()
     _molecule = 0;
     _molecule_edge_mapping = 0;
     cancellation = 0;
+    thread_count = 1;
     _flipped = false;
 }
 
@@ -202,6 +206,115 @@ void MoleculeLayoutGraph::makeOnGraph(Graph& graph)
     }
 }
 
+namespace
+{
+    // Lays out disconnected components in worker threads, one command per
+    // component. Components are independent graphs, they only share the
+    // molecule and the cancellation handler. The molecule is read, except
+    // that smart layout resets the cis-trans parity of bonds in small rings.
+    // Each component writes only the parities of its own bonds, and the
+    // parity array is grown by _layoutComponents beforehand, so the writes
+    // do not race.
+    class ComponentLayoutDispatcher : public OsCommandDispatcher
+    {
+    public:
+        ComponentLayoutDispatcher(PtrArray<MoleculeLayoutGraph>& components, ObjArray<Array<Vec2f>>& src_layouts, float bond_length)
+            : OsCommandDispatcher(HANDLING_ORDER_ANY, true), _components(components), _src_layouts(src_layouts), _bond_length(bond_length), _next_component(0)
+        {
+        }
+
+        static void layoutComponent(MoleculeLayoutGraph& component, const Array<Vec2f>& src_layout, float bond_length)
+        {
+            if (component.vertexCount() > 1)
+            {
+                component._calcMorganCodes();
+                component._assignAbsoluteCoordinates(bond_length);
+            }
+            component._assignFinalCoordinates(bond_length, src_layout);
+        }
+
+    protected:
+        class _Command : public OsCommand
+        {
+        public:
+            void execute(OsCommandResult& result) override
+            {
+                dispatcher->layoutComponent(*dispatcher->_components[component], dispatcher->_src_layouts[component], dispatcher->_bond_length);
+            }
+
+            ComponentLayoutDispatcher* dispatcher;
+            int component;
+        };
+
+        OsCommand* _allocateCommand() override
+        {
+            return new _Command();
+        }
+
+        bool _setupCommand(OsCommand& command) override
+        {
+            if (_next_component == _components.size())
+                return false;
+
+            _Command& cmd = static_cast<_Command&>(command);
+            cmd.dispatcher = this;
+            cmd.component = _next_component++;
+            return true;
+        }
+
+    private:
+        PtrArray<MoleculeLayoutGraph>& _components;
+        ObjArray<Array<Vec2f>>& _src_layouts;
+        float _bond_length;
+        int _next_component;
+    };
+}
+
+void MoleculeLayoutGraph::_layoutComponents(BaseMolecule& molecule, PtrArray<MoleculeLayoutGraph>& components, ObjArray<Array<Vec2f>>& src_layouts,
+                                            float bond_length)
+{
+    int threads = thread_count;
+    if (threads == 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    threads = std::min(threads, components.size());
+
+    if (threads <= 1)
+    {
+        for (int i = 0; i < components.size(); i++)
+            ComponentLayoutDispatcher::layoutComponent(*components[i], src_layouts[i], bond_length);
+        return;
+    }
+
+    // Smart layout resets the cis-trans parity of small rings (see
+    // MoleculeLayoutGraphSmart::_assignEveryCycle). Parities are stored up
+    // to the last bond that has one, so the array is grown here rather than
+    // concurrently by the components, which then only write their own bonds.
+    if (molecule.edgeCount() > 0)
+    {
+        int last_edge = molecule.edgeEnd() - 1;
+        molecule.cis_trans.setParity(last_edge, molecule.cis_trans.getParity(last_edge));
+    }
+
+    SharedCancellationHandler shared_cancellation(cancellation);
+    auto set_cancellation = [&](CancellationHandler* handler) {
+        for (int i = 0; i < components.size(); i++)
+            components[i]->cancellation = handler;
+    };
+
+    set_cancellation(cancellation != 0 ? &shared_cancellation : 0);
+    ComponentLayoutDispatcher dispatcher(components, src_layouts, bond_length);
+    try
+    {
+        dispatcher.run(threads);
+    }
+    catch (...)
+    {
+        set_cancellation(cancellation);
+        throw;
+    }
+    set_cancellation(cancellation);
+}
+
 IMPL_ERROR(MoleculeLayoutGraphSimple, "layout_graph");
 
 MoleculeLayoutGraphSimple::MoleculeLayoutGraphSimple() : MoleculeLayoutGraph()
@@ -214,6 +327,8 @@ MoleculeLayoutGraphSimple::~MoleculeLayoutGraphSimple()
 
 ObjArray<PatternLayout>& MoleculeLayoutGraphSimple::getPatterns()
 {
+    // The patterns outlive any arena scope of the first layout
+    ArenaAllocator::Suspend suspend;
     static LayoutPatternHolder _patternHolder;
     return _patternHolder.getPatterns();
 }
@@ -346,7 +461,6 @@ int MoleculeLayoutGraphSimple::_pattern_cmp2(const PatternLayout& p1, int n_v, i
 
 void MoleculeLayoutGraphSimple::_layoutMultipleComponents(BaseMolecule& molecule, bool respect_existing, const Filter* filter, float bond_length)
 {
-    QS_DEF(Array<Vec2f>, src_layout);
     QS_DEF(Array<int>, molecule_edge_mapping);
 
     int n_components = countComponents();
@@ -360,6 +474,7 @@ void MoleculeLayoutGraphSimple::_layoutMultipleComponents(BaseMolecule& molecule
         molecule_edge_mapping[i] = getEdgeExtIdx(i);
 
     PtrArray<MoleculeLayoutGraph> components;
+    ObjArray<Array<Vec2f>> src_layouts;
 
     components.clear();
 
@@ -380,6 +495,7 @@ void MoleculeLayoutGraphSimple::_layoutMultipleComponents(BaseMolecule& molecule
         component._molecule = &molecule;
         component._molecule_edge_mapping = molecule_edge_mapping.ptr();
 
+        Array<Vec2f>& src_layout = src_layouts.push();
         src_layout.clear_resize(component.vertexEnd());
 
         if (respect_existing)
@@ -401,15 +517,10 @@ void MoleculeLayoutGraphSimple::_layoutMultipleComponents(BaseMolecule& molecule
                     component._layout_vertices[j].pos = getPos(component.getVertexExtIdx(j));
                 }
         }
-
-        if (component.vertexCount() > 1)
-        {
-            component._calcMorganCodes();
-            component._assignAbsoluteCoordinates(bond_length);
-        }
-        component._assignFinalCoordinates(bond_length, src_layout);
     }
 
+    _layoutComponents(molecule, components, src_layouts, bond_length);
+
     // position components
     float x_min, x_max, x_start = 0.f, dx;
     float y_min, y_max, y_start = 0.f, max_height = 0.f, dy;
@@ -27,6 +27,7 @@
 #include "layout/layout_pattern_smart.h"
 #include "layout/molecule_layout_graph.h"
 #include "layout/molecule_layout_macrocycles.h"
+#include "layout/molecule_layout_macrocycles_cache.h"
 
 #include <algorithm>
 #include <math/random.h>
@@ -886,7 +887,16 @@ void MoleculeLayoutGraphSmart::_assignEveryCycle(const Cycle& cycle)
         }
     }
 
-    layout.doLayout();
+    // Repeated macrocycles, like peptide scaffolds of a library, take the
+    // positions found by an earlier lattice search
+    MoleculeLayoutMacrocyclesCache& templates = MoleculeLayoutMacrocyclesCache::instance();
+    bool use_templates = size >= MoleculeLayoutMacrocyclesCache::MIN_CYCLE_SIZE;
+    if (!use_templates || !templates.find(cycle.morganCode(), layout))
+    {
+        layout.doLayout();
+        if (use_templates)
+            templates.add(cycle.morganCode(), layout);
+    }
 
     // now we must to smooth just made layout
     // lets check if all cycle is layouted ealier in single biconnected compenent
@@ -174,7 +174,6 @@ void MoleculeLayoutGraphSmart::_makeComponentsTree(BiconnectedDecomposer& decon,
 
 void MoleculeLayoutGraphSmart::_layoutMultipleComponents(BaseMolecule& molecule, bool respect_existing, const Filter* filter, float bond_length)
 {
-    QS_DEF(Array<Vec2f>, src_layout);
     QS_DEF(Array<int>, molecule_edge_mapping);
 
     int n_components = countComponents();
@@ -190,6 +189,7 @@ void MoleculeLayoutGraphSmart::_layoutMultipleComponents(BaseMolecule& molecule,
     _molecule_edge_mapping = molecule_edge_mapping.ptr();
 
     PtrArray<MoleculeLayoutGraph> components;
+    ObjArray<Array<Vec2f>> src_layouts;
 
     components.clear();
 
@@ -209,6 +209,7 @@ void MoleculeLayoutGraphSmart::_layoutMultipleComponents(BaseMolecule& molecule,
         component._molecule = &molecule;
         component._molecule_edge_mapping = molecule_edge_mapping.ptr();
 
+        Array<Vec2f>& src_layout = src_layouts.push();
         src_layout.clear_resize(component.vertexEnd());
 
         if (respect_existing)
@@ -230,15 +231,10 @@ void MoleculeLayoutGraphSmart::_layoutMultipleComponents(BaseMolecule& molecule,
                     component._layout_vertices[j].pos = getPos(component.getVertexExtIdx(j));
                 }
         }
-
-        if (component.vertexCount() > 1)
-        {
-            component._calcMorganCodes();
-            component._assignAbsoluteCoordinates(bond_length);
-        }
-        component._assignFinalCoordinates(bond_length, src_layout);
     }
 
+    _layoutComponents(molecule, components, src_layouts, bond_length);
+
     // position components
     float x_min, x_max, x_start = 0.f, dx;
     float y_min, y_max, y_start = 0.f, max_height = 0.f, dy;
@@ -29,6 +29,7 @@
 #include <sstream>
 #include <stack>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <vector>
 
@@ -262,6 +263,36 @@ const Vec2f& MoleculeLayoutMacrocyclesLattice::getPos(int v) const
     return _positions[v];
 }
 
+void MoleculeLayoutMacrocyclesLattice::getTask(Array<byte>& task) const
+{
+    auto append = [&task](const void* data, int size) {
+        int offset = task.size();
+        task.resize(offset + size);
+        memcpy(task.ptr() + offset, data, size);
+    };
+
+    task.clear();
+    append(&length, sizeof(length));
+    append(_vertex_weight.ptr(), _vertex_weight.sizeInBytes());
+    append(_vertex_stereo.ptr(), _vertex_stereo.sizeInBytes());
+    append(_edge_stereo.ptr(), _edge_stereo.sizeInBytes());
+    append(_vertex_added_square.ptr(), _vertex_added_square.sizeInBytes());
+    append(_vertex_drawn.ptr(), _vertex_drawn.sizeInBytes());
+    append(_component_finish.ptr(), _component_finish.sizeInBytes());
+    append(_target_angle.ptr(), _target_angle.sizeInBytes());
+    append(_angle_importance.ptr(), _angle_importance.sizeInBytes());
+}
+
+const Array<Vec2f>& MoleculeLayoutMacrocyclesLattice::getPositions() const
+{
+    return _positions;
+}
+
+void MoleculeLayoutMacrocyclesLattice::setPositions(const Array<Vec2f>& positions)
+{
+    _positions.copy(positions);
+}
+
 void MoleculeLayoutMacrocyclesLattice::setEdgeStereo(int e, int stereo)
 {
     _edge_stereo[e] = stereo;
@@ -0,0 +1,255 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "layout/molecule_layout_macrocycles_cache.h"
+
+#include <string.h>
+
+#include "base_cpp/output.h"
+#include "base_cpp/profiling.h"
+#include "base_cpp/scanner.h"
+#include "layout/molecule_layout_macrocycles.h"
+
+using namespace indigo;
+
+IMPL_ERROR(MoleculeLayoutMacrocyclesCache, "macrocycle layout cache");
+
+static const char _SIGNATURE[4] = {'I', 'M', 'L', 'C'};
+static const int _VERSION = 1;
+
+MoleculeLayoutMacrocyclesCache& MoleculeLayoutMacrocyclesCache::instance()
+{
+    // The cache outlives any arena scope of the first layout
+    ArenaAllocator::Suspend suspend;
+    static MoleculeLayoutMacrocyclesCache cache;
+    return cache;
+}
+
+MoleculeLayoutMacrocyclesCache::MoleculeLayoutMacrocyclesCache() : _capacity(DEFAULT_CAPACITY), _enabled(true), _hits(0), _misses(0)
+{
+}
+
+int MoleculeLayoutMacrocyclesCache::_find(long morgan_code, const Array<byte>& task) const
+{
+    auto range = _index.equal_range(morgan_code);
+    for (auto it = range.first; it != range.second; ++it)
+        if (_templates[it->second].task.memcmp(task) == 0)
+            return it->second;
+    return -1;
+}
+
+void MoleculeLayoutMacrocyclesCache::_add(long morgan_code, const Array<byte>& task, const Array<Vec2f>& positions)
+{
+    if (_find(morgan_code, task) >= 0)
+        return;
+
+    if (_templates.size() >= _capacity)
+        _clear();
+
+    ArenaAllocator::Suspend suspend;
+    _Template& tpl = _templates.push();
+    tpl.morgan_code = morgan_code;
+    tpl.task.copy(task);
+    tpl.positions.copy(positions);
+    _index.emplace(morgan_code, _templates.size() - 1);
+}
+
+bool MoleculeLayoutMacrocyclesCache::find(long morgan_code, MoleculeLayoutMacrocyclesLattice& layout)
+{
+    if (!_enabled)
+        return false;
+
+    QS_DEF(Array<byte>, task);
+    layout.getTask(task);
+
+    std::lock_guard<std::mutex> locker(_lock);
+    int idx = _find(morgan_code, task);
+    if (idx < 0)
+    {
+        _misses++;
+        profIncCounter("layout.macrocycle_cache_misses", 1);
+        return false;
+    }
+
+    _hits++;
+    profIncCounter("layout.macrocycle_cache_hits", 1);
+    layout.setPositions(_templates[idx].positions);
+    return true;
+}
+
+void MoleculeLayoutMacrocyclesCache::add(long morgan_code, const MoleculeLayoutMacrocyclesLattice& layout)
+{
+    if (!_enabled)
+        return;
+
+    QS_DEF(Array<byte>, task);
+    layout.getTask(task);
+
+    std::lock_guard<std::mutex> locker(_lock);
+    _add(morgan_code, task, layout.getPositions());
+}
+
+int MoleculeLayoutMacrocyclesCache::load(Scanner& scanner)
+{
+    char signature[sizeof(_SIGNATURE)];
+    scanner.readCharsFix(sizeof(signature), signature);
+    if (memcmp(signature, _SIGNATURE, sizeof(signature)) != 0)
+        throw Error("not a macrocycle layout cache");
+    int version = scanner.readBinaryInt();
+    if (version != _VERSION)
+        throw Error("unsupported version %d", version);
+
+    int count = scanner.readBinaryInt();
+    if (count < 0)
+        throw Error("invalid template count %d", count);
+
+    Array<byte> task;
+    Array<Vec2f> positions;
+    std::lock_guard<std::mutex> locker(_lock);
+    for (int i = 0; i < count; i++)
+    {
+        // The code is written as two halves, long is 32-bit on Windows
+        dword low = scanner.readBinaryInt();
+        dword high = scanner.readBinaryInt();
+        long morgan_code = (long)(((qword)high << 32) | low);
+
+        int task_size = scanner.readBinaryInt();
+        if (task_size < 0)
+            throw Error("invalid task size %d", task_size);
+        task.clear_resize(task_size);
+        scanner.read(task_size, task.ptr());
+
+        int positions_count = scanner.readBinaryInt();
+        if (positions_count < 0)
+            throw Error("invalid position count %d", positions_count);
+        // The lattice search of a cycle of the task length gives one more
+        // position, the closing one
+        int length;
+        if (task_size < (int)sizeof(length))
+            throw Error("template %d: task is too short", i);
+        memcpy(&length, task.ptr(), sizeof(length));
+        if (length < MIN_CYCLE_SIZE || positions_count != length + 1)
+            throw Error("template %d: %d positions for a cycle of length %d", i, positions_count, length);
+
+        positions.clear_resize(positions_count);
+        for (int j = 0; j < positions_count; j++)
+        {
+            positions[j].x = scanner.readBinaryFloat();
+            positions[j].y = scanner.readBinaryFloat();
+        }
+
+        _add(morgan_code, task, positions);
+    }
+    return count;
+}
+
+int MoleculeLayoutMacrocyclesCache::loadFromFile(const char* filename)
+{
+    FileScanner scanner("%s", filename);
+    return load(scanner);
+}
+
+int MoleculeLayoutMacrocyclesCache::save(Output& output)
+{
+    std::lock_guard<std::mutex> locker(_lock);
+    output.write(_SIGNATURE, sizeof(_SIGNATURE));
+    output.writeBinaryInt(_VERSION);
+    output.writeBinaryInt(_templates.size());
+    for (int i = 0; i < _templates.size(); i++)
+    {
+        const _Template& tpl = _templates[i];
+        qword code = (qword)tpl.morgan_code;
+        output.writeBinaryInt((int)(code & 0xFFFFFFFF));
+        output.writeBinaryInt((int)(code >> 32));
+        output.writeBinaryInt(tpl.task.size());
+        output.write(tpl.task.ptr(), tpl.task.size());
+        output.writeBinaryInt(tpl.positions.size());
+        for (int j = 0; j < tpl.positions.size(); j++)
+        {
+            output.writeBinaryFloat(tpl.positions[j].x);
+            output.writeBinaryFloat(tpl.positions[j].y);
+        }
+    }
+    return _templates.size();
+}
+
+int MoleculeLayoutMacrocyclesCache::saveToFile(const char* filename)
+{
+    FileOutput output(filename);
+    return save(output);
+}
+
+void MoleculeLayoutMacrocyclesCache::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+bool MoleculeLayoutMacrocyclesCache::isEnabled() const
+{
+    return _enabled;
+}
+
+void MoleculeLayoutMacrocyclesCache::setCapacity(int capacity)
+{
+    if (capacity < 1)
+        throw Error("capacity must be positive");
+    std::lock_guard<std::mutex> locker(_lock);
+    _capacity = capacity;
+    if (_templates.size() > _capacity)
+        _clear();
+}
+
+int MoleculeLayoutMacrocyclesCache::getCapacity() const
+{
+    std::lock_guard<std::mutex> locker(_lock);
+    return _capacity;
+}
+
+int MoleculeLayoutMacrocyclesCache::size() const
+{
+    std::lock_guard<std::mutex> locker(_lock);
+    return _templates.size();
+}
+
+void MoleculeLayoutMacrocyclesCache::clear()
+{
+    std::lock_guard<std::mutex> locker(_lock);
+    _clear();
+}
+
+void MoleculeLayoutMacrocyclesCache::_clear()
+{
+    _templates.clear();
+    _index.clear();
+}
+
+qword MoleculeLayoutMacrocyclesCache::getHits() const
+{
+    return _hits;
+}
+
+qword MoleculeLayoutMacrocyclesCache::getMisses() const
+{
+    return _misses;
+}
+
+void MoleculeLayoutMacrocyclesCache::resetCounters()
+{
+    _hits = 0;
+    _misses = 0;
+}
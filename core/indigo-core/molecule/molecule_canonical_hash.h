@@ -0,0 +1,81 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __molecule_canonical_hash__
+#define __molecule_canonical_hash__
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+#include "base_cpp/hash128.h"
+#include "molecule/molecule.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    // 128-bit hash of a molecule that does not depend on the atom order.
+    // Atoms are ordered by the canonical numbering of MoleculeAutomorphismSearch,
+    // the same as for canonical SMILES, and the labeled graph is hashed directly
+    // without building a string. Atom numbers, charges, isotopes, radicals,
+    // hydrogen counts, bond orders, cis-trans bonds and absolute stereocenters
+    // are taken into account. Hydrogens that can be implicit are folded into
+    // the hydrogen counts, and stereo that does not survive the symmetry check
+    // is dropped, so molecules with equal canonical SMILES have equal hashes.
+    class DLLEXPORT MoleculeCanonicalHash
+    {
+    public:
+        MoleculeCanonicalHash();
+
+        // The molecule is not changed
+        Hash128 calculate(Molecule& mol);
+
+        DECL_ERROR;
+
+    private:
+        struct _Bond
+        {
+            int rank1;
+            int rank2;
+            int order;
+            int parity;
+        };
+
+        static int _cmpBonds(const _Bond& b1, const _Bond& b2, void* context);
+
+        int _rank(int atom_idx) const;
+        void _put(int value);
+
+        Molecule _mol;
+        Array<int> _ignored;
+        Array<int> _order;
+        Array<int> _ranks;
+        Array<_Bond> _bonds;
+        Array<char> _data;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif
@@ -124,6 +124,8 @@ namespace indigo
         bool skip_any_bonds;       // don't build 'any bonds' part of the fingerprint
         bool skip_any_atoms_bonds; // don't build 'any atoms, any bonds' part of the fingerprint
 
+        bool use_fragment_cache; // reuse fragment hashes through MoleculeFragmentHashCache
+
         void process();
 
         const byte* get();
@@ -156,6 +158,8 @@ namespace indigo
 
         void _handleSubgraph(Graph& graph, const Array<int>& vertices, const Array<int>& edges);
 
+        int _findCachedFragment(BaseMolecule& mol, const Array<int>& vertices, const Array<int>& edges);
+
         dword _canonicalizeFragment(BaseMolecule& mol, const Array<int>& vertices, const Array<int>& edges, bool use_atoms, bool use_bonds,
                                     int* different_vertex_count);
 
@@ -181,6 +185,7 @@ namespace indigo
         // these parameters are indirectly passed to the callbacks
         TautomerSuperStructure* _tau_super_structure;
         bool _is_cycle;
+        int _fragment_cache_entry;
 
         struct HashBits
         {
@@ -210,6 +215,8 @@ namespace indigo
         TL_CP_DECL(Array<int>, _vertex_connectivity);
         TL_CP_DECL(Array<int>, _fragment_vertex_degree);
         TL_CP_DECL(Array<int>, _bond_orders);
+        TL_CP_DECL(Array<int>, _fragment_key);
+        TL_CP_DECL(Array<int>, _fragment_local_index);
 
         typedef std::unordered_map<HashBits, int, Hasher> HashesMap;
         TL_CP_DECL(HashesMap, _ord_hashes);
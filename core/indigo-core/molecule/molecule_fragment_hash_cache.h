@@ -0,0 +1,98 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __molecule_fragment_hash_cache__
+#define __molecule_fragment_hash_cache__
+
+#include "base_cpp/array.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace indigo
+{
+
+    // Memo of the SubgraphHash results that MoleculeFingerprintBuilder computes
+    // for every enumerated tree and cycle. A fragment is keyed by its vertex
+    // codes and by its edges with their codes, in enumeration order, so equal
+    // keys always have equal hashes and a lookup never returns a wrong value.
+    // Every entry holds the results for the four ways atom and bond codes are
+    // used or discarded. Each thread has its own cache, which is emptied when
+    // the number of entries reaches the capacity.
+    class DLLEXPORT MoleculeFragmentHashCache
+    {
+    public:
+        enum
+        {
+            VARIANTS = 4,
+            DEFAULT_CAPACITY = 1 << 15
+        };
+
+        MoleculeFragmentHashCache();
+
+        // Cache of the calling thread
+        static MoleculeFragmentHashCache& getThreadCache();
+
+        // Returns the entry of the key, adding an empty one if there is none
+        int findOrAdd(const Array<int>& key);
+
+        // Returns false and counts a miss if the variant has not been set yet
+        bool get(int entry, int variant, dword& hash, int& different_codes_count);
+        void set(int entry, int variant, dword hash, int different_codes_count);
+
+        void setCapacity(int capacity);
+        int getCapacity() const;
+        int size() const;
+        void clear();
+
+        qword getHits() const;
+        qword getMisses() const;
+        double getHitRate() const;
+        void resetCounters();
+
+    private:
+        struct _Entry
+        {
+            dword key_hash;
+            int key_offset;
+            int key_length;
+            int known_variants;
+            dword hashes[VARIANTS];
+            int different_codes_counts[VARIANTS];
+        };
+
+        static dword _hashKey(const Array<int>& key);
+
+        int _capacity;
+        Array<_Entry> _entries;
+        Array<int> _keys;
+        Array<int> _table;
+
+        qword _hits;
+        qword _misses;
+    };
+
+} // namespace indigo
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#endif // __molecule_fragment_hash_cache__
@@ -19,6 +19,9 @@
 #ifndef __molecule_ionize_h__
 #define __molecule_ionize_h__
 
+#include <atomic>
+#include <mutex>
+
 #include "base_cpp/obj_array.h"
 #include "base_cpp/red_black.h"
 #include "base_cpp/tlscont.h"
@@ -69,6 +72,7 @@ namespace indigo
     private:
         MoleculePkaModel();
         static MoleculePkaModel _model;
+        static std::mutex _model_lock;
 
         static void _loadSimplePkaModel();
         static void _loadAdvancedPkaModel();
@@ -86,13 +90,13 @@ namespace indigo
         ObjArray<QueryMolecule> basics;
         Array<float> a_pkas;
         Array<float> b_pkas;
-        bool simple_model_ready = false;
+        std::atomic<bool> simple_model_ready{false};
 
         RedBlackStringObjMap<Array<float>> adv_a_pkas;
         RedBlackStringObjMap<Array<float>> adv_b_pkas;
         int level;
         Array<float> max_deviations;
-        bool advanced_model_ready = false;
+        std::atomic<bool> advanced_model_ready{false};
     };
 
     class DLLEXPORT MoleculeIonizer
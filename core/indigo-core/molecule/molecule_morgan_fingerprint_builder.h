@@ -19,9 +19,6 @@
 #ifndef PROJECT_MOLECULE_MORGAN_FINGERPRINT_H
 #define PROJECT_MOLECULE_MORGAN_FINGERPRINT_H
 
-#include <set>
-#include <vector>
-
 #include "base_c/defs.h"
 #include "base_cpp/array.h"
 #include "base_molecule.h"
@@ -29,17 +26,29 @@
 namespace indigo
 {
 
+    // Extended connectivity (Morgan) fingerprints. All per-atom state lives in
+    // flat arrays that are kept between calls, so one builder reused over many
+    // molecules does not allocate once its buffers have grown to the largest
+    // molecule seen.
     class DLLEXPORT MoleculeMorganFingerprintBuilder : public NonCopyable
     {
     public:
+        MoleculeMorganFingerprintBuilder();
         explicit MoleculeMorganFingerprintBuilder(BaseMolecule& mol);
 
+        void setMolecule(BaseMolecule& mol);
+
         void calculateDescriptorsECFP(int fp_depth, Array<dword>& res);
         void calculateDescriptorsFCFP(int fp_depth, Array<dword>& res);
 
         void packFingerprintECFP(int fp_depth, Array<byte>& res);
         void packFingerprintFCFP(int fp_depth, Array<byte>& res);
 
+        // Fills res with molecules.size() fingerprints of fp_bytes each, the
+        // fingerprint of molecules[i] starting at i * fp_bytes. The builder is
+        // left pointing to the last molecule.
+        void packFingerprintsECFP(int fp_depth, const Array<BaseMolecule*>& molecules, int fp_bytes, Array<byte>& res);
+
     private:
         enum
         {
@@ -50,9 +59,11 @@ namespace indigo
 
         typedef dword (*InitialStateCallback)(BaseMolecule& mol, int idx);
 
-        void initDescriptors(MoleculeMorganFingerprintBuilder::InitialStateCallback initialStateCallback);
-        void buildDescriptors(int fp_depth);
-        void calculateNewAtomDescriptors(int iterationNumber);
+        void _initDescriptors(InitialStateCallback initialStateCallback);
+        void _buildDescriptors(int fp_depth);
+        void _calculateNewAtomDescriptors(int iterationNumber);
+        void _addFeature(int atom, int iterationNumber);
+        void _pack(int fp_depth, byte* fp, int size);
 
         /**
          * ECFP: (hash of 7 ints)
@@ -77,35 +88,41 @@ namespace indigo
          *  */
         static dword initialStateCallback_FCFP(BaseMolecule& mol, int idx);
 
-        struct BondDescriptor
-        {
-            int bond_type;
-            int vertex_idx;
-            int edge_idx;
-        };
-
-        struct FeatureDescriptor
-        {
-            uint32_t hash;
-            std::set<int> bond_set;
-
-            bool operator==(const FeatureDescriptor& rhs) const;
-
-            bool operator<(const FeatureDescriptor& rhs) const;
-        };
-
-        struct AtomDescriptor
-        {
-            FeatureDescriptor descr;
-            FeatureDescriptor new_descr;
-            std::vector<BondDescriptor> bond_descriptors;
-        };
-
-        int bondDescriptorCmp(const BondDescriptor& bd1, const BondDescriptor& bd2);
-
-        BaseMolecule& mol;
-        std::vector<FeatureDescriptor> features;
-        std::vector<AtomDescriptor> atom_descriptors;
+        qword* _bondSet(Array<qword>& sets, int idx);
+        dword _bondSetHash(const qword* set) const;
+
+        BaseMolecule* _mol;
+
+        // Atoms are numbered densely in vertex order. Neighbors of atom i are
+        // _nei_atoms[_nei_begin[i] .. _nei_begin[i + 1]), with their bonds.
+        Array<int> _atom_index;
+        Array<int> _nei_begin;
+        Array<int> _nei_atoms;
+        Array<int> _nei_edges;
+        Array<int> _nei_types;
+        Array<qword> _nei_keys;
+
+        // Current and next environment hash of every atom
+        Array<dword> _hashes;
+        Array<dword> _new_hashes;
+
+        // Bonds covered by the environment of every atom, as bitsets of
+        // _set_words words indexed by edge
+        int _set_words;
+        Array<qword> _bond_sets;
+        Array<qword> _new_bond_sets;
+
+        // Features found so far: their bond sets, the iteration that found
+        // them, and the least hash of an environment with that bond set.
+        // _feature_table is an open addressing hash set of feature indices.
+        Array<qword> _feature_sets;
+        Array<int> _feature_iterations;
+        Array<dword> _feature_hashes;
+        Array<int> _feature_table;
+        Array<int> _iteration_features;
+
+        // Resulting feature hashes in the order of iterations, then of hash
+        Array<dword> _features;
     };
 
 }; // namespace indigo
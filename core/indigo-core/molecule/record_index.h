@@ -0,0 +1,66 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#ifndef __record_index__
+#define __record_index__
+
+#include "base_cpp/array.h"
+#include "base_cpp/exception.h"
+
+namespace indigo
+{
+
+    // Record boundaries of a multi-record text file held in memory, found with
+    // memchr() line scanning instead of parsing every record:
+    //   FORMAT_SDF    - records end after each line starting with "$$$$",
+    //                   a trailing record without "$$$$" counts unless it is
+    //                   whitespace only. Offsets match SdfLoader offsets.
+    //   FORMAT_RDF    - records start at lines starting with "$MFMT" or
+    //                   "$RFMT" and last until the next record.
+    //   FORMAT_SMILES - every line is a record.
+    // Inputs of 8 MB or more are split into chunks that are scanned on worker
+    // threads.
+    class DLLEXPORT RecordIndex
+    {
+    public:
+        enum Format
+        {
+            FORMAT_SDF,
+            FORMAT_RDF,
+            FORMAT_SMILES
+        };
+
+        RecordIndex();
+
+        // thread_count 0 means one thread per hardware core
+        void build(const char* data, long long size, Format format, int thread_count = 1);
+
+        int count() const;
+        long long offset(int index) const;
+        long long length(int index) const;
+
+        DECL_ERROR;
+
+    private:
+        // Record starts, followed by the end of the last record
+        Array<long long> _bounds;
+    };
+
+} // namespace indigo
+
+#endif
@@ -58,6 +58,10 @@ namespace indigo
         DECL_ERROR;
 
     protected:
+        // Finds the records left after _max_offset with RecordIndex when the
+        // input is a MappedFileScanner, returns false for other scanners
+        bool _indexMappedFile();
+
         Scanner* _scanner;
         bool _own_scanner;
         TL_CP_DECL(Array<long long>, _offsets);
@@ -0,0 +1,186 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include <algorithm>
+#include <string.h>
+
+#include "molecule/molecule_canonical_hash.h"
+#include "molecule/molecule_automorphism_search.h"
+
+using namespace indigo;
+
+IMPL_ERROR(MoleculeCanonicalHash, "molecule canonical hash");
+
+MoleculeCanonicalHash::MoleculeCanonicalHash()
+{
+}
+
+Hash128 MoleculeCanonicalHash::calculate(Molecule& mol)
+{
+    int i;
+
+    _data.clear();
+
+    _mol.clone(mol, 0, 0);
+    _mol.restoreAromaticHydrogens();
+
+    _ignored.clear_resize(_mol.vertexEnd());
+    _ignored.zerofill();
+
+    for (i = _mol.vertexBegin(); i != _mol.vertexEnd(); i = _mol.vertexNext(i))
+        if (_mol.convertableToImplicitHydrogen(i))
+            _ignored[i] = 1;
+
+    _ranks.clear_resize(_mol.vertexEnd());
+    _ranks.fffill();
+    _order.clear();
+
+    if (_mol.vertexCount() > 0)
+    {
+        MoleculeAutomorphismSearch of;
+
+        of.detect_invalid_cistrans_bonds = true;
+        of.detect_invalid_stereocenters = true;
+        of.find_canonical_ordering = true;
+        of.allow_undefined = true;
+        of.ignored_vertices = _ignored.ptr();
+        of.process(_mol);
+        of.getCanonicalNumbering(_order);
+
+        for (i = _mol.edgeBegin(); i != _mol.edgeEnd(); i = _mol.edgeNext(i))
+            if (_mol.cis_trans.getParity(i) != 0 && of.invalidCisTransBond(i))
+                _mol.cis_trans.setParity(i, 0);
+
+        for (i = _mol.vertexBegin(); i != _mol.vertexEnd(); i = _mol.vertexNext(i))
+            if (_mol.stereocenters.getType(i) > MoleculeStereocenters::ATOM_ANY && of.invalidStereocenter(i))
+                _mol.stereocenters.remove(i);
+    }
+
+    for (i = 0; i < _order.size(); i++)
+        _ranks[_order[i]] = i;
+
+    _put(_order.size());
+
+    // Atoms in canonical order, hydrogens that can be implicit are counted on their neighbors
+    for (i = 0; i < _order.size(); i++)
+    {
+        int atom = _order[i];
+        const Vertex& vertex = _mol.getVertex(atom);
+
+        int hydrogens = _mol.getImplicitH_NoThrow(atom, -1);
+        if (hydrogens >= 0)
+            for (int j = vertex.neiBegin(); j != vertex.neiEnd(); j = vertex.neiNext(j))
+                if (_ignored[vertex.neiVertex(j)])
+                    hydrogens++;
+
+        _put(_mol.getAtomNumber(atom));
+        _put(_mol.getAtomCharge(atom));
+        _put(_mol.getAtomIsotope(atom));
+        _put(_mol.getAtomRadical_NoThrow(atom, 0));
+        _put(hydrogens);
+
+        if (_mol.isPseudoAtom(atom))
+        {
+            const char* pseudo = _mol.getPseudoAtom(atom);
+            _data.concat(pseudo, (int)strlen(pseudo) + 1);
+        }
+    }
+
+    // Bonds sorted by the ranks of their ends. Cis-trans parity is taken
+    // relative to the lowest ranked substituent on each side of the bond.
+    _bonds.clear();
+    for (i = _mol.edgeBegin(); i != _mol.edgeEnd(); i = _mol.edgeNext(i))
+    {
+        const Edge& edge = _mol.getEdge(i);
+
+        if (_ranks[edge.beg] < 0 || _ranks[edge.end] < 0)
+            continue;
+
+        _Bond& bond = _bonds.push();
+        bond.rank1 = std::min(_ranks[edge.beg], _ranks[edge.end]);
+        bond.rank2 = std::max(_ranks[edge.beg], _ranks[edge.end]);
+        bond.order = _mol.getBondOrder(i);
+        bond.parity = _mol.cis_trans.getParity(i);
+
+        if (bond.parity != 0)
+        {
+            const int* subst = _mol.cis_trans.getSubstituents(i);
+            bool flip = (_rank(subst[1]) < _rank(subst[0])) != (_rank(subst[3]) < _rank(subst[2]));
+            if (flip)
+                bond.parity = (bond.parity == MoleculeCisTrans::CIS ? MoleculeCisTrans::TRANS : MoleculeCisTrans::CIS);
+        }
+    }
+    _bonds.qsort(_cmpBonds, 0);
+
+    _put(_bonds.size());
+    for (i = 0; i < _bonds.size(); i++)
+    {
+        _put(_bonds[i].rank1);
+        _put(_bonds[i].rank2);
+        _put(_bonds[i].order);
+        _put(_bonds[i].parity);
+    }
+
+    // Absolute stereocenters with the parity of the pyramid permutation that
+    // sorts its atoms by rank. Stereo groups are left out, so relative
+    // configurations only differ in the exact match.
+    for (i = 0; i < _order.size(); i++)
+    {
+        int atom = _order[i];
+        if (_mol.stereocenters.getType(atom) != MoleculeStereocenters::ATOM_ABS)
+            continue;
+
+        const int* pyramid = _mol.stereocenters.getPyramid(atom);
+        int ranks[4], inversions = 0;
+
+        for (int j = 0; j < 4; j++)
+            ranks[j] = _rank(pyramid[j]);
+        for (int j = 0; j < 4; j++)
+            for (int k = j + 1; k < 4; k++)
+                if (ranks[j] > ranks[k])
+                    inversions++;
+
+        _put(i);
+        _put(inversions % 2);
+    }
+
+    return Hash128::get(_data.ptr(), _data.size());
+}
+
+int MoleculeCanonicalHash::_cmpBonds(const _Bond& b1, const _Bond& b2, void* context)
+{
+    if (b1.rank1 != b2.rank1)
+        return b1.rank1 - b2.rank1;
+    return b1.rank2 - b2.rank2;
+}
+
+// Implicit hydrogens, lone pairs and ignored hydrogens rank after all atoms
+int MoleculeCanonicalHash::_rank(int atom_idx) const
+{
+    if (atom_idx < 0 || _ranks[atom_idx] < 0)
+        return _ranks.size();
+    return _ranks[atom_idx];
+}
+
+void MoleculeCanonicalHash::_put(int value)
+{
+    dword v = (dword)value;
+
+    for (int i = 0; i < 4; i++)
+        _data.push((char)((v >> (8 * i)) & 0xFF));
+}
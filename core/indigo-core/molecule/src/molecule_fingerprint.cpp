@@ -20,12 +20,14 @@
 
 #include "base_c/bitarray.h"
 #include "base_cpp/output.h"
+#include "base_cpp/profiling.h"
 #include "graph/cycle_enumerator.h"
 #include "graph/graph_subtree_enumerator.h"
 #include "graph/subgraph_hash.h"
 #include "molecule/elements.h"
 #include "molecule/molecule.h"
 #include "molecule/molecule_fingerprint.h"
+#include "molecule/molecule_fragment_hash_cache.h"
 #include "molecule/molecule_morgan_fingerprint_builder.h"
 #include "molecule/molecule_tautomer.h"
 #include "molecule/query_molecule.h"
@@ -39,7 +41,7 @@ CP_DEF(MoleculeFingerprintBuilder);
 MoleculeFingerprintBuilder::MoleculeFingerprintBuilder(BaseMolecule& mol, const MoleculeFingerprintParameters& parameters)
     : cancellation(0), _mol(mol), _parameters(parameters), CP_INIT, TL_CP_GET(_total_fingerprint), TL_CP_GET(_atom_codes), TL_CP_GET(_bond_codes),
       TL_CP_GET(_atom_codes_empty), TL_CP_GET(_bond_codes_empty), TL_CP_GET(_atom_hydrogens), TL_CP_GET(_atom_charges), TL_CP_GET(_vertex_connectivity),
-      TL_CP_GET(_fragment_vertex_degree), TL_CP_GET(_bond_orders), TL_CP_GET(_ord_hashes)
+      TL_CP_GET(_fragment_vertex_degree), TL_CP_GET(_bond_orders), TL_CP_GET(_fragment_key), TL_CP_GET(_fragment_local_index), TL_CP_GET(_ord_hashes)
 {
     _total_fingerprint.resize(_parameters.fingerprintSize());
     cb_fragment = 0;
@@ -56,6 +58,9 @@ MoleculeFingerprintBuilder::MoleculeFingerprintBuilder(BaseMolecule& mol, const
     skip_any_bonds = false;
     skip_any_atoms_bonds = false;
 
+    use_fragment_cache = true;
+    _fragment_cache_entry = -1;
+
     _ord_hashes.clear();
 }
 
@@ -137,6 +142,7 @@ void MoleculeFingerprintBuilder::_initHashCalculations(BaseMolecule& mol, const
     }
 
     _fragment_vertex_degree.clear_resize(mol.vertexEnd());
+    _fragment_local_index.clear_resize(mol.vertexEnd());
 
     _bond_orders.clear_resize(mol.edgeEnd());
     _bond_orders.zerofill();
@@ -370,16 +376,58 @@ dword MoleculeFingerprintBuilder::_canonicalizeFragment(BaseMolecule& mol, const
     else
         subgraph_hash->vertex_codes = &_atom_codes_empty;
 
+    MoleculeFragmentHashCache& cache = MoleculeFragmentHashCache::getThreadCache();
+    int variant = (use_atoms ? 2 : 0) | (use_bonds ? 1 : 0);
+    dword ret;
+    int different_count;
+
+    if (_fragment_cache_entry >= 0 && cache.get(_fragment_cache_entry, variant, ret, different_count))
+    {
+        if (different_vertex_count != 0)
+            *different_vertex_count = different_count;
+        return ret;
+    }
+
     subgraph_hash->max_iterations = (edges.size() + 1) / 2;
     subgraph_hash->calc_different_codes_count = true;
 
-    dword ret = subgraph_hash->getHash(vertices, edges);
+    ret = subgraph_hash->getHash(vertices, edges);
+    different_count = subgraph_hash->getDifferentCodesCount();
     if (different_vertex_count != 0)
-        *different_vertex_count = subgraph_hash->getDifferentCodesCount();
+        *different_vertex_count = different_count;
+
+    if (_fragment_cache_entry >= 0)
+        cache.set(_fragment_cache_entry, variant, ret, different_count);
 
     return ret;
 }
 
+int MoleculeFingerprintBuilder::_findCachedFragment(BaseMolecule& mol, const Array<int>& vertices, const Array<int>& edges)
+{
+    if (!use_fragment_cache)
+        return -1;
+
+    // The key holds everything SubgraphHash looks at, the variants without
+    // atom or bond codes are derived from the same fragment
+    _fragment_key.clear();
+    _fragment_key.push(vertices.size());
+    _fragment_key.push(edges.size());
+    for (int i = 0; i < vertices.size(); i++)
+    {
+        _fragment_local_index[vertices[i]] = i;
+        _fragment_key.push(_atom_codes[vertices[i]]);
+    }
+    for (int i = 0; i < edges.size(); i++)
+    {
+        const Edge& edge = mol.getEdge(edges[i]);
+        _fragment_key.push(_fragment_local_index[edge.beg]);
+        _fragment_key.push(_fragment_local_index[edge.end]);
+        _fragment_key.push(_bond_codes[edges[i]]);
+    }
+
+    return MoleculeFragmentHashCache::getThreadCache().findOrAdd(_fragment_key);
+}
+
 void MoleculeFingerprintBuilder::_addOrdHashBits(dword hash, int bits_per_fragment)
 {
     HashBits hash_bits(hash, bits_per_fragment);
@@ -582,6 +630,8 @@ void MoleculeFingerprintBuilder::_handleSubgraph(Graph& graph, const Array<int>&
 
     bool has_query_bonds = (i != edges.size());
 
+    _fragment_cache_entry = _findCachedFragment(mol, vertices, edges);
+
     dword bits_set = 0;
     if (!has_query_atoms && !has_query_bonds)
         _canonicalizeFragmentAndSetBits(mol, vertices, edges, true, true, subgraph_type, bits_set);
@@ -680,6 +730,10 @@ void MoleculeFingerprintBuilder::_makeFingerprint_calcOrdSim(BaseMolecule& mol)
 
     _initHashCalculations(mol, vfilter);
 
+    MoleculeFragmentHashCache& fragment_cache = MoleculeFragmentHashCache::getThreadCache();
+    qword fragment_hits = fragment_cache.getHits();
+    qword fragment_misses = fragment_cache.getMisses();
+
     CycleEnumerator ce(mol);
     GraphSubtreeEnumerator se(mol);
 
@@ -703,6 +757,9 @@ void MoleculeFingerprintBuilder::_makeFingerprint_calcOrdSim(BaseMolecule& mol)
     se.callback = _handleTree;
     se.process();
 
+    profIncCounter("fingerprint_fragment_cache_hits", fragment_cache.getHits() - fragment_hits);
+    profIncCounter("fingerprint_fragment_cache_misses", fragment_cache.getMisses() - fragment_misses);
+
     // Set hash bits
     for (auto it : _ord_hashes)
     {
@@ -0,0 +1,156 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "molecule/molecule_fragment_hash_cache.h"
+
+#include <string.h>
+
+using namespace indigo;
+
+MoleculeFragmentHashCache::MoleculeFragmentHashCache() : _capacity(DEFAULT_CAPACITY), _hits(0), _misses(0)
+{
+}
+
+MoleculeFragmentHashCache& MoleculeFragmentHashCache::getThreadCache()
+{
+    // The cache outlives any arena scope of the first fingerprint
+    ArenaAllocator::Suspend suspend;
+    static thread_local MoleculeFragmentHashCache cache;
+    return cache;
+}
+
+dword MoleculeFragmentHashCache::_hashKey(const Array<int>& key)
+{
+    // FNV-1a over the key values
+    dword hash = 2166136261U;
+    for (int i = 0; i < key.size(); i++)
+        hash = (hash ^ (dword)key[i]) * 16777619U;
+    return hash;
+}
+
+int MoleculeFragmentHashCache::findOrAdd(const Array<int>& key)
+{
+    if (_entries.size() >= _capacity)
+        clear();
+
+    if (_table.size() == 0)
+    {
+        // Keep the table at most half full
+        int table_size = 16;
+        while (table_size < 2 * _capacity)
+            table_size *= 2;
+        _table.clear_resize(table_size);
+        _table.fffill();
+        _entries.reserve(_capacity);
+    }
+
+    dword key_hash = _hashKey(key);
+    int mask = _table.size() - 1;
+    int slot = key_hash & mask;
+
+    int idx;
+    while ((idx = _table[slot]) != -1)
+    {
+        const _Entry& entry = _entries[idx];
+        if (entry.key_hash == key_hash && entry.key_length == key.size() && memcmp(_keys.ptr() + entry.key_offset, key.ptr(), key.size() * sizeof(int)) == 0)
+            return idx;
+        slot = (slot + 1) & mask;
+    }
+
+    idx = _entries.size();
+    _Entry& entry = _entries.push();
+    entry.key_hash = key_hash;
+    entry.key_offset = _keys.size();
+    entry.key_length = key.size();
+    entry.known_variants = 0;
+    _keys.concat(key);
+    _table[slot] = idx;
+    return idx;
+}
+
+bool MoleculeFragmentHashCache::get(int entry, int variant, dword& hash, int& different_codes_count)
+{
+    const _Entry& e = _entries[entry];
+    if (!(e.known_variants & (1 << variant)))
+    {
+        _misses++;
+        return false;
+    }
+
+    _hits++;
+    hash = e.hashes[variant];
+    different_codes_count = e.different_codes_counts[variant];
+    return true;
+}
+
+void MoleculeFragmentHashCache::set(int entry, int variant, dword hash, int different_codes_count)
+{
+    _Entry& e = _entries[entry];
+    e.hashes[variant] = hash;
+    e.different_codes_counts[variant] = different_codes_count;
+    e.known_variants |= (1 << variant);
+}
+
+void MoleculeFragmentHashCache::setCapacity(int capacity)
+{
+    if (capacity < 1)
+        throw Exception("MoleculeFragmentHashCache: capacity must be positive");
+    _capacity = capacity;
+    clear();
+    _table.clear();
+}
+
+int MoleculeFragmentHashCache::getCapacity() const
+{
+    return _capacity;
+}
+
+int MoleculeFragmentHashCache::size() const
+{
+    return _entries.size();
+}
+
+void MoleculeFragmentHashCache::clear()
+{
+    _entries.clear();
+    _keys.clear();
+    _table.fffill();
+}
+
+qword MoleculeFragmentHashCache::getHits() const
+{
+    return _hits;
+}
+
+qword MoleculeFragmentHashCache::getMisses() const
+{
+    return _misses;
+}
+
+double MoleculeFragmentHashCache::getHitRate() const
+{
+    if (_hits + _misses == 0)
+        return 0;
+    return (double)_hits / (_hits + _misses);
+}
+
+void MoleculeFragmentHashCache::resetCounters()
+{
+    _hits = 0;
+    _misses = 0;
+}
@@ -34,6 +34,7 @@
 using namespace indigo;
 
 MoleculePkaModel MoleculePkaModel::_model;
+std::mutex MoleculePkaModel::_model_lock;
 
 IMPL_ERROR(MoleculePkaModel, "Molecule Pka Model");
 
@@ -49,13 +50,21 @@ void MoleculePkaModel::estimate_pKa(Molecule& mol, const IonizeOptions& options,
     if (options.model == IonizeOptions::PKA_MODEL_SIMPLE)
     {
         if (!_model.simple_model_ready)
-            _loadSimplePkaModel();
+        {
+            std::lock_guard<std::mutex> locker(_model_lock);
+            if (!_model.simple_model_ready)
+                _loadSimplePkaModel();
+        }
         _estimate_pKa_Simple(mol, options, acid_sites, basic_sites, acid_pkas, basic_pkas);
     }
     else if (options.model == IonizeOptions::PKA_MODEL_ADVANCED)
     {
         if (!_model.advanced_model_ready)
-            _loadAdvancedPkaModel();
+        {
+            std::lock_guard<std::mutex> locker(_model_lock);
+            if (!_model.advanced_model_ready)
+                _loadAdvancedPkaModel();
+        }
         _estimate_pKa_Advanced(mol, options, acid_sites, basic_sites, acid_pkas, basic_pkas);
     }
     else
@@ -64,6 +73,9 @@ void MoleculePkaModel::estimate_pKa(Molecule& mol, const IonizeOptions& options,
 
 int MoleculePkaModel::buildPkaModel(int max_level, float threshold, const char* filename)
 {
+    std::lock_guard<std::mutex> locker(_model_lock);
+    ArenaAllocator::Suspend suspend;
+
     //   QS_DEF(Array<int>, order);
     //   QS_DEF(Molecule, can_mol);
     QS_DEF(Array<char>, fp);
@@ -396,6 +408,9 @@ namespace // data of internal purpose
 
 void MoleculePkaModel::_loadSimplePkaModel()
 {
+    // The model is shared by all later ionizations
+    ArenaAllocator::Suspend suspend;
+
     _model.acids.clear();
     _model.basics.clear();
     _model.a_pkas.clear();
@@ -833,6 +848,7 @@ namespace // data of internal purpose
 
 void MoleculePkaModel::_loadAdvancedPkaModel()
 {
+    ArenaAllocator::Suspend suspend;
     LoadPkaDefToModel(_model.adv_a_pkas, advanced_pka_model_acid, advanced_pka_model_acid + NELEM(advanced_pka_model_acid));
     LoadPkaDefToModel(_model.adv_b_pkas, advanced_pka_model_basic, advanced_pka_model_basic + NELEM(advanced_pka_model_basic));
     _model.advanced_model_ready = true;
@@ -19,40 +19,38 @@
 #include "molecule/molecule_morgan_fingerprint_builder.h"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <molecule/elements.h>
-#include <set>
-#include <vector>
 
 using namespace indigo;
 
-MoleculeMorganFingerprintBuilder::MoleculeMorganFingerprintBuilder(BaseMolecule& mol) : mol(mol)
+MoleculeMorganFingerprintBuilder::MoleculeMorganFingerprintBuilder() : _mol(nullptr), _set_words(0)
 {
 }
 
-void MoleculeMorganFingerprintBuilder::calculateDescriptorsECFP(int fp_depth, Array<dword>& res)
+MoleculeMorganFingerprintBuilder::MoleculeMorganFingerprintBuilder(BaseMolecule& mol) : _mol(&mol), _set_words(0)
 {
-    initDescriptors(initialStateCallback_ECFP);
-    buildDescriptors(fp_depth);
+}
 
-    res.clear();
+void MoleculeMorganFingerprintBuilder::setMolecule(BaseMolecule& mol)
+{
+    _mol = &mol;
+}
 
-    for (auto& feature : features)
-    {
-        res.push(feature.hash);
-    }
+void MoleculeMorganFingerprintBuilder::calculateDescriptorsECFP(int fp_depth, Array<dword>& res)
+{
+    _initDescriptors(initialStateCallback_ECFP);
+    _buildDescriptors(fp_depth);
+
+    res.copy(_features);
 }
 
 void MoleculeMorganFingerprintBuilder::calculateDescriptorsFCFP(int fp_depth, Array<dword>& res)
 {
-    initDescriptors(initialStateCallback_FCFP);
-    buildDescriptors(fp_depth);
-
-    res.clear();
+    _initDescriptors(initialStateCallback_FCFP);
+    _buildDescriptors(fp_depth);
 
-    for (auto& feature : features)
-    {
-        res.push(feature.hash);
-    }
+    res.copy(_features);
 }
 
 void MoleculeMorganFingerprintBuilder::packFingerprintECFP(int fp_depth, Array<byte>& res)
@@ -62,15 +60,8 @@ void MoleculeMorganFingerprintBuilder::packFingerprintECFP(int fp_depth, Array<b
     if (0 == size)
         throw Exception("Resulting array [res] must not be empty");
 
-    initDescriptors(initialStateCallback_ECFP);
-    buildDescriptors(fp_depth);
-
-    res.zerofill();
-
-    for (auto& feature : features)
-    {
-        setBits(feature.hash, res.ptr(), size);
-    }
+    _initDescriptors(initialStateCallback_ECFP);
+    _pack(fp_depth, res.ptr(), size);
 }
 
 void MoleculeMorganFingerprintBuilder::packFingerprintFCFP(int fp_depth, Array<byte>& res)
@@ -80,17 +71,35 @@ void MoleculeMorganFingerprintBuilder::packFingerprintFCFP(int fp_depth, Array<b
     if (0 == size)
         throw Exception("Resulting array [res] must not be empty");
 
-    initDescriptors(initialStateCallback_FCFP);
-    buildDescriptors(fp_depth);
+    _initDescriptors(initialStateCallback_FCFP);
+    _pack(fp_depth, res.ptr(), size);
+}
+
+void MoleculeMorganFingerprintBuilder::packFingerprintsECFP(int fp_depth, const Array<BaseMolecule*>& molecules, int fp_bytes, Array<byte>& res)
+{
+    if (fp_bytes <= 0)
+        throw Exception("Fingerprint size must be positive");
 
-    res.zerofill();
+    res.clear_resize(molecules.size() * fp_bytes);
 
-    for (auto& feature : features)
+    for (int i = 0; i < molecules.size(); i++)
     {
-        setBits(feature.hash, res.ptr(), size);
+        setMolecule(*molecules[i]);
+        _initDescriptors(initialStateCallback_ECFP);
+        _pack(fp_depth, res.ptr() + (size_t)i * fp_bytes, fp_bytes);
     }
 }
 
+void MoleculeMorganFingerprintBuilder::_pack(int fp_depth, byte* fp, int size)
+{
+    _buildDescriptors(fp_depth);
+
+    memset(fp, 0, size);
+
+    for (int i = 0; i < _features.size(); i++)
+        setBits(_features[i], fp, size);
+}
+
 void MoleculeMorganFingerprintBuilder::setBits(dword hash, byte* fp, int size)
 {
     unsigned seed = hash;
@@ -107,91 +116,174 @@ void MoleculeMorganFingerprintBuilder::setBits(dword hash, byte* fp, int size)
     fp[nByte] = fp[nByte] | (byte)(1 << nBit);
 }
 
-void MoleculeMorganFingerprintBuilder::initDescriptors(InitialStateCallback initialStateCallback)
+void MoleculeMorganFingerprintBuilder::_initDescriptors(InitialStateCallback initialStateCallback)
 {
-    features.clear();
-    atom_descriptors.clear();
+    if (_mol == nullptr)
+        throw Exception("Molecule is not set");
 
+    BaseMolecule& mol = *_mol;
+    int atom_count = mol.vertexCount();
+
+    _atom_index.clear_resize(mol.vertexEnd());
+    _hashes.clear_resize(atom_count);
+    int k = 0;
     for (int idx : mol.vertices())
     {
-        AtomDescriptor atom_descriptor;
-        atom_descriptor.descr.hash = initialStateCallback(mol, idx);
+        _atom_index[idx] = k;
+        _hashes[k++] = initialStateCallback(mol, idx);
+    }
 
-        const Vertex& vertex = mol.getVertex(idx);
+    _nei_begin.clear_resize(atom_count + 1);
+    _nei_atoms.clear();
+    _nei_edges.clear();
+    _nei_types.clear();
+    k = 0;
+    for (int idx : mol.vertices())
+    {
+        _nei_begin[k++] = _nei_atoms.size();
 
+        const Vertex& vertex = mol.getVertex(idx);
         for (int nei_idx : vertex.neighbors())
         {
             int edge_idx = vertex.neiEdge(nei_idx);
-            int vertex_idx = vertex.neiVertex(nei_idx);
-
-            int bond_type = mol.getBondOrder(edge_idx);
-
-            atom_descriptor.bond_descriptors.push_back(BondDescriptor{bond_type, vertex_idx, edge_idx});
+            _nei_atoms.push(_atom_index[vertex.neiVertex(nei_idx)]);
+            _nei_edges.push(edge_idx);
+            _nei_types.push(mol.getBondOrder(edge_idx));
         }
-
-        atom_descriptors.push_back(atom_descriptor);
     }
+    _nei_begin[atom_count] = _nei_atoms.size();
+    _nei_keys.clear_resize(_nei_atoms.size());
+
+    _set_words = std::max((mol.edgeEnd() + 63) / 64, 1);
+    _bond_sets.clear_resize(atom_count * _set_words);
+    _bond_sets.zerofill();
+    _new_bond_sets.clear_resize(atom_count * _set_words);
+    _new_hashes.clear_resize(atom_count);
 }
 
-void MoleculeMorganFingerprintBuilder::buildDescriptors(int fp_depth)
+void MoleculeMorganFingerprintBuilder::_buildDescriptors(int fp_depth)
 {
+    int atom_count = _hashes.size();
+
+    _features.clear();
+    _feature_sets.clear();
+    _feature_iterations.clear();
+    _feature_hashes.clear();
+
+    // At most one feature per atom and iteration, keep the table at most half full
+    int table_size = 16;
+    while (table_size < 2 * atom_count * fp_depth)
+        table_size *= 2;
+    _feature_table.clear_resize(table_size);
+    _feature_table.fffill();
+
     for (int i = 0; i < fp_depth; i++)
     {
-        calculateNewAtomDescriptors(i);
+        _calculateNewAtomDescriptors(i);
 
         // Update all atom descriptors simultaneously
-        std::vector<FeatureDescriptor> new_features;
-        for (auto& atom : atom_descriptors)
-        {
-            atom.descr = atom.new_descr;
+        _hashes.swap(_new_hashes);
+        _bond_sets.swap(_new_bond_sets);
 
-            const auto& duplicate = std::find(new_features.begin(), new_features.end(), atom.descr);
-            if (duplicate == new_features.end())
-            {
-                new_features.push_back(atom.descr);
-            }
-            else if (atom.descr.hash < duplicate->hash)
-            { // the leaser hash is preferred
-                new_features.erase(duplicate);
-                new_features.push_back(atom.descr);
-            }
-        }
+        _iteration_features.clear();
+        for (int atom = 0; atom < atom_count; atom++)
+            _addFeature(atom, i);
 
         // Features are sorted by their iteration number, then by their hash
-        std::sort(new_features.begin(), new_features.end(), [](const FeatureDescriptor& fd1, const FeatureDescriptor& fd2) { return fd1.hash < fd2.hash; });
+        std::sort(_iteration_features.begin(), _iteration_features.end(), [this](int f1, int f2) {
+            if (_feature_hashes[f1] != _feature_hashes[f2])
+                return _feature_hashes[f1] < _feature_hashes[f2];
+            return f1 < f2;
+        });
+
+        for (int f : _iteration_features)
+            _features.push(_feature_hashes[f]);
+    }
+}
 
-        // Update features
-        for (auto& feature : new_features)
+void MoleculeMorganFingerprintBuilder::_calculateNewAtomDescriptors(int iterationNumber)
+{
+    int atom_count = _hashes.size();
+
+    for (int atom = 0; atom < atom_count; atom++)
+    {
+        int begin = _nei_begin[atom];
+        int end = _nei_begin[atom + 1];
+        qword* keys = _nei_keys.ptr();
+
+        // Neighbors are ordered by bond type, then by their hash. The sign bit
+        // of the type is flipped, so that negative (query) types come first.
+        for (int j = begin; j < end; j++)
         {
-            if (std::find(features.begin(), features.end(), feature) == features.end())
+            qword key = ((qword)((dword)_nei_types[j] ^ 0x80000000U) << 32) | _hashes[_nei_atoms[j]];
+            int pos = j;
+            while (pos > begin && keys[pos - 1] > key)
             {
-                features.push_back(feature); // add unique
+                keys[pos] = keys[pos - 1];
+                pos--;
             }
+            keys[pos] = key;
+        }
+
+        dword hash = (dword)iterationNumber * MAGIC_HASH_NUMBER + _hashes[atom];
+        for (int j = begin; j < end; j++)
+        {
+            hash = MAGIC_HASH_NUMBER * hash + ((dword)(keys[j] >> 32) ^ 0x80000000U);
+            hash = MAGIC_HASH_NUMBER * hash + (dword)keys[j];
+        }
+        _new_hashes[atom] = hash;
+
+        qword* new_set = _bondSet(_new_bond_sets, atom);
+        memset(new_set, 0, _set_words * sizeof(qword));
+        for (int j = begin; j < end; j++)
+        {
+            const qword* nei_set = _bondSet(_bond_sets, _nei_atoms[j]);
+            for (int w = 0; w < _set_words; w++)
+                new_set[w] |= nei_set[w];
+            new_set[_nei_edges[j] / 64] |= (qword)1 << (_nei_edges[j] % 64);
         }
     }
 }
 
-void MoleculeMorganFingerprintBuilder::calculateNewAtomDescriptors(int iterationNumber)
+void MoleculeMorganFingerprintBuilder::_addFeature(int atom, int iterationNumber)
 {
-    for (auto& atom : atom_descriptors)
-    {
-        std::sort(atom.bond_descriptors.begin(), atom.bond_descriptors.end(),
-                  [&](const BondDescriptor& bd1, const BondDescriptor& bd2) { return bondDescriptorCmp(bd1, bd2) < 0; });
-
-        atom.new_descr.hash = (dword)iterationNumber * MAGIC_HASH_NUMBER + atom.descr.hash;
-        atom.new_descr.bond_set.clear();
+    const qword* set = _bondSet(_bond_sets, atom);
+    int mask = _feature_table.size() - 1;
+    int slot = _bondSetHash(set) & mask;
 
-        for (auto& bond : atom.bond_descriptors)
+    int feature;
+    while ((feature = _feature_table[slot]) != -1)
+    {
+        if (memcmp(_feature_sets.ptr() + (size_t)feature * _set_words, set, _set_words * sizeof(qword)) == 0)
         {
-            FeatureDescriptor& descr = atom_descriptors[bond.vertex_idx].descr;
-
-            atom.new_descr.hash = MAGIC_HASH_NUMBER * atom.new_descr.hash + bond.bond_type;
-            atom.new_descr.hash = MAGIC_HASH_NUMBER * atom.new_descr.hash + descr.hash;
-
-            atom.new_descr.bond_set.insert(bond.edge_idx);
-            atom.new_descr.bond_set.insert(descr.bond_set.begin(), descr.bond_set.end());
+            // A bond set found at an earlier iteration is not a new feature,
+            // within one iteration the least hash is preferred
+            if (_feature_iterations[feature] == iterationNumber && _hashes[atom] < _feature_hashes[feature])
+                _feature_hashes[feature] = _hashes[atom];
+            return;
         }
+        slot = (slot + 1) & mask;
     }
+
+    feature = _feature_hashes.size();
+    _feature_sets.concat(set, _set_words);
+    _feature_iterations.push(iterationNumber);
+    _feature_hashes.push(_hashes[atom]);
+    _feature_table[slot] = feature;
+    _iteration_features.push(feature);
+}
+
+qword* MoleculeMorganFingerprintBuilder::_bondSet(Array<qword>& sets, int idx)
+{
+    return sets.ptr() + (size_t)idx * _set_words;
+}
+
+dword MoleculeMorganFingerprintBuilder::_bondSetHash(const qword* set) const
+{
+    qword hash = 0;
+    for (int w = 0; w < _set_words; w++)
+        hash = (hash ^ set[w]) * 0x9E3779B97F4A7C15ULL;
+    return (dword)(hash >> 32);
 }
 
 dword MoleculeMorganFingerprintBuilder::initialStateCallback_ECFP(BaseMolecule& mol, int idx)
@@ -230,24 +322,3 @@ dword MoleculeMorganFingerprintBuilder::initialStateCallback_FCFP(BaseMolecule&
 
     return key;
 }
-
-int MoleculeMorganFingerprintBuilder::bondDescriptorCmp(const BondDescriptor& bd1, const BondDescriptor& bd2)
-{
-    if (bd1.bond_type != bd2.bond_type)
-        return bd1.bond_type < bd2.bond_type ? -1 : 1;
-
-    AtomDescriptor& ad1 = atom_descriptors[bd1.vertex_idx];
-    AtomDescriptor& ad2 = atom_descriptors[bd2.vertex_idx];
-
-    return ad1.descr.hash < ad2.descr.hash ? -1 : 1;
-}
-
-bool MoleculeMorganFingerprintBuilder::FeatureDescriptor::operator==(const FeatureDescriptor& rhs) const
-{
-    return bond_set == rhs.bond_set;
-}
-
-bool MoleculeMorganFingerprintBuilder::FeatureDescriptor::operator<(const MoleculeMorganFingerprintBuilder::FeatureDescriptor& rhs) const
-{
-    return bond_set < rhs.bond_set;
-}
@@ -0,0 +1,202 @@
+/****************************************************************************
+ * Copyright (C) from 2009 to Present EPAM Systems.
+ *
+ * This file is part of Indigo toolkit.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ***************************************************************************/
+
+#include "molecule/record_index.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+#include <thread>
+
+#include "base_cpp/os_thread_wrapper.h"
+
+using namespace indigo;
+
+IMPL_ERROR(RecordIndex, "record index");
+
+// Inputs are split into chunks of 4 MB, and scanned in parallel from two
+// chunks (8 MB) on
+static const long long _CHUNK_SIZE = 4 << 20;
+
+// Appends the record boundaries of the lines starting in [from, to) of data[0, size)
+static void _scanLines(const char* data, long long size, long long from, long long to, RecordIndex::Format format, Array<long long>& bounds)
+{
+    long long pos = from;
+    if (pos > 0 && data[pos - 1] != '\n')
+    {
+        const char* nl = (const char*)memchr(data + pos, '\n', (size_t)(size - pos));
+        if (nl == nullptr)
+            return;
+        pos = nl - data + 1;
+    }
+
+    while (pos < to)
+    {
+        const char* line = data + pos;
+        long long left = size - pos;
+        const char* nl = (const char*)memchr(line, '\n', (size_t)left);
+        long long next = (nl != nullptr ? nl - data + 1 : size);
+
+        switch (format)
+        {
+        case RecordIndex::FORMAT_SDF:
+            if (left >= 4 && strncmp(line, "$$$$", 4) == 0)
+                bounds.push(next);
+            break;
+        case RecordIndex::FORMAT_RDF:
+            if (left >= 5 && (strncmp(line, "$MFMT", 5) == 0 || strncmp(line, "$RFMT", 5) == 0))
+                bounds.push(pos);
+            break;
+        case RecordIndex::FORMAT_SMILES:
+            bounds.push(pos);
+            break;
+        }
+        pos = next;
+    }
+}
+
+namespace
+{
+    class _ChunkDispatcher : public OsCommandDispatcher
+    {
+    public:
+        _ChunkDispatcher(const char* data, long long size, RecordIndex::Format format, Array<long long>& bounds)
+            : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _data(data), _size(size), _format(format), _bounds(bounds), _next(0)
+        {
+        }
+
+    private:
+        class _Result : public OsCommandResult
+        {
+        public:
+            void clear() override
+            {
+                bounds.clear();
+            }
+
+            Array<long long> bounds;
+        };
+
+        class _Command : public OsCommand
+        {
+        public:
+            void execute(OsCommandResult& result) override
+            {
+                _scanLines(data, size, from, to, format, static_cast<_Result&>(result).bounds);
+            }
+
+            const char* data;
+            long long size, from, to;
+            RecordIndex::Format format;
+        };
+
+        OsCommand* _allocateCommand() override
+        {
+            return new _Command();
+        }
+
+        OsCommandResult* _allocateResult() override
+        {
+            return new _Result();
+        }
+
+        bool _setupCommand(OsCommand& command) override
+        {
+            if (_next >= _size)
+                return false;
+
+            _Command& cmd = static_cast<_Command&>(command);
+            cmd.data = _data;
+            cmd.size = _size;
+            cmd.from = _next;
+            cmd.to = std::min(_next + _CHUNK_SIZE, _size);
+            cmd.format = _format;
+            _next = cmd.to;
+            return true;
+        }
+
+        void _handleResult(OsCommandResult& result) override
+        {
+            _bounds.concat(static_cast<_Result&>(result).bounds);
+        }
+
+        const char* _data;
+        long long _size;
+        RecordIndex::Format _format;
+        Array<long long>& _bounds;
+        long long _next;
+    };
+}
+
+RecordIndex::RecordIndex()
+{
+}
+
+void RecordIndex::build(const char* data, long long size, Format format, int thread_count)
+{
+    if (size < 0 || (size > 0 && data == nullptr))
+        throw Error("incorrect input");
+
+    if (thread_count == 0)
+        thread_count = (int)std::thread::hardware_concurrency();
+
+    Array<long long> found;
+    if (thread_count > 1 && size >= _CHUNK_SIZE * 2)
+    {
+        _ChunkDispatcher dispatcher(data, size, format, found);
+        dispatcher.run(thread_count);
+    }
+    else
+        _scanLines(data, size, 0, size, format, found);
+
+    _bounds.clear();
+    if (format == FORMAT_SDF)
+    {
+        // Found positions are record ends here
+        _bounds.push(0);
+        _bounds.concat(found);
+
+        long long tail = _bounds.top();
+        while (tail < size && isspace((unsigned char)data[tail]))
+            tail++;
+        if (tail < size)
+            _bounds.push(size);
+    }
+    else
+    {
+        _bounds.copy(found);
+        _bounds.push(size);
+    }
+}
+
+int RecordIndex::count() const
+{
+    return _bounds.size() > 0 ? _bounds.size() - 1 : 0;
+}
+
+long long RecordIndex::offset(int index) const
+{
+    if (index < 0 || index >= count())
+        throw Error("record index %d out of range [0, %d)", index, count());
+    return _bounds[index];
+}
+
+long long RecordIndex::length(int index) const
+{
+    return _bounds[index + 1] - offset(index);
+}
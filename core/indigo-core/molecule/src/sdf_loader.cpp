@@ -20,6 +20,7 @@
 #include "base_cpp/output.h"
 #include "base_cpp/scanner.h"
 #include "gzip/gzip_scanner.h"
+#include "molecule/record_index.h"
 
 using namespace indigo;
 
@@ -71,8 +72,29 @@ int SdfLoader::currentNumber()
     return _current_number;
 }
 
+bool SdfLoader::_indexMappedFile()
+{
+    MappedFileScanner* mapped = dynamic_cast<MappedFileScanner*>(_scanner);
+    if (mapped == nullptr)
+        return false;
+
+    long long size = mapped->length();
+    if (_max_offset < size)
+    {
+        RecordIndex index;
+        index.build(mapped->data() + _max_offset, size - _max_offset, RecordIndex::FORMAT_SDF, 0);
+        for (int i = 0; i < index.count(); i++)
+            _offsets.push(_max_offset + index.offset(i));
+        _max_offset = size;
+    }
+    return true;
+}
+
 int SdfLoader::count()
 {
+    if (_indexMappedFile())
+        return _offsets.size();
+
     long long offset = _scanner->tell();
     int cn = _current_number;
 
@@ -225,6 +247,9 @@ void SdfLoader::readNext()
 
 void SdfLoader::readAt(int index)
 {
+    if (index >= _offsets.size() && _indexMappedFile() && index >= _offsets.size())
+        throw Error("No such record index: %d", index);
+
     if (index < _offsets.size())
     {
         _scanner->seek(_offsets[index], SEEK_SET);
@@ -18,12 +18,36 @@
 
 #include <gtest/gtest.h>
 
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <base_c/bitarray.h>
+#include <base_cpp/arena_allocator.h>
+#include <base_cpp/fingerprint_matrix.h>
+#include <base_cpp/hash128.h>
+#include <base_cpp/os_thread_wrapper.h>
 #include <base_cpp/output.h>
+#include <base_cpp/popcount_kernels.h>
+#include <base_cpp/profiling.h>
 #include <base_cpp/scanner.h>
+#include <base_cpp/task_executor.h>
+#include <base_cpp/tlscont.h>
+#include <layout/molecule_layout.h>
+#include <molecule/canonical_smiles_saver.h>
 #include <molecule/cmf_loader.h>
 #include <molecule/cmf_saver.h>
 #include <molecule/cml_saver.h>
 #include <molecule/molecule_cdxml_saver.h>
+#include <molecule/molecule_ionize.h>
 #include <molecule/molecule_mass.h>
 #include <molecule/molecule_substructure_matcher.h>
 #include <molecule/molfile_loader.h>
@@ -94,3 +118,582 @@ TEST_F(IndigoCoreContainersTest, test_red_black_map)
     map.clear();
     ASSERT_EQ(map.size(), 0);
 }
+
+TEST_F(IndigoCoreContainersTest, test_arena_allocator)
+{
+    ArenaAllocator arena(4096);
+    Array<int> heap_array;
+    {
+        ArenaAllocator::Scope scope(arena);
+        ASSERT_EQ(ArenaAllocator::current(), &arena);
+
+        // The last block grows in place
+        Array<int> array;
+        array.push(1);
+        const int* first = array.ptr();
+        array.resize(100);
+        ASSERT_EQ(array.ptr(), first);
+        ASSERT_EQ(array[0], 1);
+        ASSERT_EQ(arena.allocationCount(), 1u);
+
+        // Arrays constructed before the scope stay on the heap
+        heap_array.push(1);
+        ASSERT_EQ(arena.allocationCount(), 1u);
+
+        // Pool based containers take chunks as they grow
+        RedBlackMap<int, int> map;
+        for (int i = 0; i < 1000; i++)
+            map.insert(i, i * i);
+        ASSERT_EQ(map.at(999), 999 * 999);
+        ASSERT_GT(arena.chunkAllocationCount(), 1u);
+
+        {
+            ArenaAllocator::Suspend suspend;
+            ASSERT_EQ(ArenaAllocator::current(), nullptr);
+            size_t count = arena.allocationCount();
+            Array<int> suspended;
+            suspended.push(1);
+            ASSERT_EQ(arena.allocationCount(), count);
+        }
+        ASSERT_EQ(ArenaAllocator::current(), &arena);
+    }
+    ASSERT_EQ(ArenaAllocator::current(), nullptr);
+    arena.reset();
+    ASSERT_EQ(arena.usedBytes(), 0u);
+
+    // Molecules built in the arena match the heap ones, and the chunks are reused after reset
+    const char* smiles = "CC(C)Cc1ccc(cc1)C(C)C(=O)O.N1C(C)C(=O)NC(CO)C(=O)NC(Cc2ccccc2)C1=O";
+    Array<char> expected;
+    {
+        Molecule mol;
+        loadMolecule(smiles, mol);
+        ArrayOutput output(expected);
+        CanonicalSmilesSaver saver(output);
+        saver.saveMolecule(mol);
+        expected.push(0);
+    }
+
+    size_t chunks = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        std::unique_ptr<Molecule> outliving;
+        {
+            ArenaAllocator::Scope scope(arena);
+            Molecule mol;
+            loadMolecule(smiles, mol);
+            Array<char> result;
+            ArrayOutput output(result);
+            CanonicalSmilesSaver saver(output);
+            saver.saveMolecule(mol);
+            result.push(0);
+            ASSERT_STREQ(result.ptr(), expected.ptr());
+
+            outliving.reset(new Molecule());
+            outliving->clone(mol);
+        }
+        if (i == 0)
+            chunks = arena.chunkAllocationCount();
+        ASSERT_EQ(arena.chunkAllocationCount(), chunks);
+        arena.reset();
+        // Destroying objects after the reset is allowed, their storage is already released
+        outliving.reset();
+    }
+}
+
+TEST_F(IndigoCoreContainersTest, test_arena_allocator_lazy_statics)
+{
+    // Layout patterns, the macrocycle cache and the pKa models are built by
+    // the first call and must not take their storage from its arena
+    const char* smiles = "OC(=O)CC1CCC2CC3CCCCC3CC2C1.C1CCCCCCCCCCCCC1";
+    auto process = [smiles](Array<char>& result) {
+        Molecule mol;
+        loadMolecule(smiles, mol);
+        MoleculeLayout simple(mol, false);
+        simple.make();
+        MoleculeLayout smart(mol, true);
+        smart.make();
+        mol.ionize(7.f, 0.f, IonizeOptions(IonizeOptions::PKA_MODEL_SIMPLE));
+        mol.ionize(7.f, 0.f, IonizeOptions(IonizeOptions::PKA_MODEL_ADVANCED));
+
+        ArrayOutput output(result);
+        CanonicalSmilesSaver saver(output);
+        saver.saveMolecule(mol);
+        for (int i = mol.vertexBegin(); i != mol.vertexEnd(); i = mol.vertexNext(i))
+            output.printf(" %.3f,%.3f", mol.getAtomXyz(i).x, mol.getAtomXyz(i).y);
+        result.push(0);
+    };
+
+    Array<char> expected;
+    {
+        ArenaAllocator arena;
+        ArenaAllocator::Scope scope(arena);
+        process(expected);
+        ASSERT_GT(arena.allocationCount(), 0u);
+    }
+
+    // The chunks of the first arena are released and overwritten by a later one
+    ArenaAllocator garbage;
+    for (int i = 0; i < 64; i++)
+        memset(garbage.allocate(ArenaAllocator::DEFAULT_CHUNK_SIZE / 2), 0xFF, ArenaAllocator::DEFAULT_CHUNK_SIZE / 2);
+
+    Array<char> result;
+    process(result);
+    ASSERT_STREQ(result.ptr(), expected.ptr());
+}
+
+TEST_F(IndigoCoreContainersTest, test_arena_allocator_threads)
+{
+    // Work handed to other threads from inside a scope keeps the arena to its
+    // own thread: arrays that grow on the workers move to the heap
+    ArenaAllocator arena;
+    ArenaAllocator::Scope scope(arena);
+    const int count = 32;
+    ObjArray<Array<int>> lists;
+    ObjArray<Molecule> molecules;
+    for (int i = 0; i < count; i++)
+    {
+        lists.push();
+        loadMolecule("OC(=O)CC1CCC2CC3CCCCC3CC2C1", molecules.push());
+    }
+    ASSERT_EQ(lists[0].arena(), &arena);
+    size_t allocations = arena.allocationCount();
+
+    std::atomic<int> scoped(0);
+    TaskExecutor executor(4);
+    TaskGroup group(executor);
+    for (int i = 0; i < count; i++)
+        group.run([&, i]() {
+            ArenaAllocator::Scope worker_scope(arena);
+            if (ArenaAllocator::current() != nullptr)
+                scoped++;
+            for (int k = 0; k < 1000; k++)
+                lists[i].push(k);
+            MoleculeLayout layout(molecules[i], false);
+            layout.make();
+        });
+    group.wait();
+
+    ASSERT_EQ(scoped, 0);
+    ASSERT_EQ(arena.allocationCount(), allocations);
+    for (int i = 0; i < count; i++)
+    {
+        ASSERT_EQ(lists[i].arena(), nullptr);
+        ASSERT_EQ(lists[i].size(), 1000);
+        ASSERT_EQ(lists[i][999], 999);
+        ASSERT_TRUE(molecules[i].have_xyz);
+    }
+}
+
+TEST_F(IndigoCoreContainersTest, test_popcount_kernels)
+{
+    const PopcountKernels::Isa detected = PopcountKernels::detectIsa();
+    const int fp_count = 17;
+
+    for (int fp_size : {1, 7, 8, 25, 32, 64, 100, 128, 200})
+    {
+        Array<byte> fingerprints;
+        fingerprints.clear_resize(fp_count * fp_size);
+        unsigned seed = 12345u + fp_size;
+        for (int i = 0; i < fingerprints.size(); i++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            fingerprints[i] = (byte)(seed >> 16);
+        }
+        const byte* query = fingerprints.ptr();
+
+        Array<int> indices;
+        for (int i = fp_count - 1; i >= 0; i -= 2)
+            indices.push(i);
+
+        for (int isa = PopcountKernels::ISA_SCALAR; isa <= detected; isa++)
+        {
+            PopcountKernels::setIsa((PopcountKernels::Isa)isa);
+
+            int ones[fp_count], common[fp_count];
+            PopcountKernels::onesCount(fingerprints.ptr(), nullptr, fp_count, fp_size, ones);
+            PopcountKernels::commonOnes(query, fingerprints.ptr(), nullptr, fp_count, fp_size, common);
+            for (int i = 0; i < fp_count; i++)
+            {
+                const byte* fp = fingerprints.ptr() + i * fp_size;
+                ASSERT_EQ(ones[i], bitGetOnesCount(fp, fp_size)) << PopcountKernels::isaName((PopcountKernels::Isa)isa) << ", fp_size " << fp_size;
+                ASSERT_EQ(common[i], bitCommonOnes(query, fp, fp_size)) << PopcountKernels::isaName((PopcountKernels::Isa)isa) << ", fp_size " << fp_size;
+            }
+
+            PopcountKernels::commonOnes(query, fingerprints.ptr(), indices.ptr(), indices.size(), fp_size, common);
+            for (int i = 0; i < indices.size(); i++)
+                ASSERT_EQ(common[i], bitCommonOnes(query, fingerprints.ptr() + indices[i] * fp_size, fp_size));
+
+            Array<byte> screened, expected;
+            screened.copy(fingerprints.ptr(), fp_size);
+            expected.copy(fingerprints.ptr(), fp_size);
+            bitAnd(expected.ptr(), fingerprints.ptr() + fp_size, fp_size);
+            ASSERT_EQ(PopcountKernels::andNonZero(screened.ptr(), fingerprints.ptr() + fp_size, fp_size), !bitIsAllZero(expected.ptr(), fp_size));
+            ASSERT_EQ(0, memcmp(screened.ptr(), expected.ptr(), fp_size)) << PopcountKernels::isaName((PopcountKernels::Isa)isa) << ", fp_size " << fp_size;
+
+            Array<byte> zeros;
+            zeros.clear_resize(fp_size);
+            zeros.zerofill();
+            ASSERT_FALSE(PopcountKernels::andNonZero(screened.ptr(), zeros.ptr(), fp_size));
+        }
+    }
+
+    PopcountKernels::setIsa(detected);
+    ASSERT_EQ(PopcountKernels::isa(), detected);
+}
+
+TEST_F(IndigoCoreContainersTest, test_fingerprint_matrix)
+{
+    // Row count spans several row blocks, 700 columns of 64 bytes span two column tiles
+    const int fp_size = 64, row_count = 150, column_count = 700;
+    FingerprintMatrix rows, columns;
+    rows.clear(fp_size);
+    columns.clear(fp_size);
+
+    unsigned seed = 777u;
+    Array<byte> fp;
+    fp.clear_resize(fp_size);
+    for (int i = 0; i < row_count + column_count; i++)
+    {
+        for (int j = 0; j < fp_size; j++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            // Sparse bits, and some repeated fingerprints for exact ties
+            fp[j] = (byte)((seed >> 16) & (seed >> 24) & (i % 7 == 0 ? 0 : 0xFF));
+        }
+        (i < row_count ? rows : columns).add(fp.ptr());
+    }
+
+    FingerprintMatrix::Metrics metrics;
+    Array<float> expected;
+    expected.clear_resize(row_count * column_count);
+    for (int i = 0; i < row_count; i++)
+        for (int j = 0; j < column_count; j++)
+            expected[i * column_count + j] =
+                metrics.similarity(rows.ones(i), columns.ones(j), bitCommonOnes(rows.row(i), columns.row(j), fp_size));
+
+    for (int threads : {1, 3})
+    {
+        Array<float> full;
+        full.clear_resize(row_count * column_count);
+        FingerprintMatrix::similarities(rows, columns, metrics, threads, full.ptr());
+        ASSERT_EQ(0, full.memcmp(expected));
+
+        const float threshold = 0.2f;
+        Array<int> pair_rows, pair_columns;
+        Array<float> pair_similarities;
+        FingerprintMatrix::thresholdPairs(rows, columns, metrics, threshold, threads, pair_rows, pair_columns, pair_similarities);
+        int pos = 0;
+        for (int i = 0; i < row_count; i++)
+            for (int j = 0; j < column_count; j++)
+                if (expected[i * column_count + j] >= threshold)
+                {
+                    ASSERT_LT(pos, pair_rows.size());
+                    EXPECT_EQ(i, pair_rows[pos]);
+                    EXPECT_EQ(j, pair_columns[pos]);
+                    EXPECT_EQ(expected[i * column_count + j], pair_similarities[pos]);
+                    pos++;
+                }
+        EXPECT_EQ(pos, pair_rows.size());
+
+        const int k = 5;
+        Array<int> neighbors;
+        Array<float> top_similarities;
+        neighbors.clear_resize(row_count * k);
+        top_similarities.clear_resize(row_count * k);
+        FingerprintMatrix::topK(rows, columns, metrics, k, threads, neighbors.ptr(), top_similarities.ptr());
+        for (int i = 0; i < row_count; i++)
+        {
+            Array<int> order;
+            for (int j = 0; j < column_count; j++)
+                order.push(j);
+            const float* sims = expected.ptr() + i * column_count;
+            std::stable_sort(order.ptr(), order.ptr() + order.size(), [sims](int a, int b) { return sims[a] > sims[b]; });
+            for (int j = 0; j < k; j++)
+            {
+                EXPECT_EQ(order[j], neighbors[i * k + j]);
+                EXPECT_EQ(sims[order[j]], top_similarities[i * k + j]);
+            }
+        }
+    }
+
+    // Missing neighbors are padded
+    FingerprintMatrix few;
+    few.clear(fp_size);
+    few.add(columns.row(0));
+    int neighbors[3];
+    float similarities[3];
+    FingerprintMatrix::topK(few, few, metrics, 3, 1, neighbors, similarities);
+    EXPECT_EQ(0, neighbors[0]);
+    EXPECT_EQ(-1, neighbors[1]);
+    EXPECT_EQ(-1, neighbors[2]);
+    EXPECT_EQ(0.f, similarities[2]);
+}
+
+TEST_F(IndigoCoreContainersTest, test_profiling_thread_shards)
+{
+    const int thread_count = 4;
+    const int adds = 10000;
+
+    profTimersResetSession();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++)
+        threads.emplace_back([]() {
+            for (int i = 0; i < adds; i++)
+                profIncCounter("test_profiling_thread_shards", 2);
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    {
+        auto inst = sf::xlock_safe_ptr(ProfilingSystem::getInstance());
+        ASSERT_EQ(inst->getLabelCallCount("test_profiling_thread_shards"), (qword)thread_count * adds);
+        ASSERT_EQ(inst->getLabelValue("test_profiling_thread_shards"), (qword)thread_count * adds * 2);
+    }
+
+    // Shards of finished threads are reused, session values restart from zero
+    profTimersReset();
+    std::thread([]() { profIncCounter("test_profiling_thread_shards", 5); }).join();
+
+    auto inst = sf::xlock_safe_ptr(ProfilingSystem::getInstance());
+    ASSERT_EQ(inst->getLabelValue("test_profiling_thread_shards"), 5);
+    ASSERT_EQ(inst->getLabelValue("test_profiling_thread_shards", true), (qword)thread_count * adds * 2 + 5);
+    ASSERT_EQ(inst->getLabelCallCount("test_profiling_thread_shards", true), (qword)thread_count * adds + 1);
+}
+
+namespace
+{
+    // Squares the numbers below count, results are collected in the handling order.
+    // Every 25th command is slow, so the later ones are finished before it.
+    class SquareDispatcher : public OsCommandDispatcher
+    {
+    public:
+        SquareDispatcher(int count, std::vector<int>& squares)
+            : OsCommandDispatcher(HANDLING_ORDER_SERIAL, true), _count(count), _next(0), _squares(squares), _fail_preparation(false), _nested(false)
+        {
+        }
+
+        void restart()
+        {
+            _next = 0;
+        }
+
+        void failPreparation()
+        {
+            _fail_preparation = true;
+        }
+
+        // Results are handled by a task group of the process-wide executor
+        void handleInGroup()
+        {
+            _nested = true;
+        }
+
+    protected:
+        class _Result : public OsCommandResult
+        {
+        public:
+            int square;
+        };
+
+        class _Command : public OsCommand
+        {
+        public:
+            void execute(OsCommandResult& result) override
+            {
+                if (value < 0)
+                    throw Exception("negative value");
+                if (value % 25 == 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                static_cast<_Result&>(result).square = value * value;
+            }
+
+            int value;
+        };
+
+        OsCommand* _allocateCommand() override
+        {
+            return new _Command();
+        }
+
+        OsCommandResult* _allocateResult() override
+        {
+            return new _Result();
+        }
+
+        bool _setupCommand(OsCommand& command) override
+        {
+            if (_next == _count)
+                return false;
+            static_cast<_Command&>(command).value = (_next == 50 && _count < 0) ? -1 : _next;
+            _next++;
+            return true;
+        }
+
+        void _handleResult(OsCommandResult& result) override
+        {
+            int square = static_cast<_Result&>(result).square;
+            if (!_nested)
+            {
+                _squares.push_back(square);
+                return;
+            }
+            TaskGroup group;
+            group.run([this, square]() { _squares.push_back(square); });
+            group.wait();
+        }
+
+        void _prepareThread() override
+        {
+            if (_fail_preparation)
+                throw Exception("preparation failed");
+        }
+
+    private:
+        int _count;
+        int _next;
+        std::vector<int>& _squares;
+        bool _fail_preparation;
+        bool _nested;
+    };
+}
+
+TEST_F(IndigoCoreContainersTest, test_task_executor)
+{
+    TaskExecutor executor(3);
+    ASSERT_EQ(executor.threadCount(), 3);
+    ASSERT_FALSE(executor.isWorkerThread());
+
+    // Tasks run with the session ID of the submitting thread, nested groups run on the worker
+    qword session_id = TL_GET_SESSION_ID();
+    TL_SET_SESSION_ID(session_id + 1000);
+    std::atomic<int> sum(0), sessions(0), nested(0);
+    {
+        TaskGroup group(executor);
+        for (int i = 1; i <= 100; i++)
+            group.run([&, i]() {
+                sum += i;
+                if (TL_GET_SESSION_ID() == session_id + 1000)
+                    sessions++;
+                TaskGroup inner(executor);
+                inner.run([&]() {
+                    if (executor.isWorkerThread())
+                        nested++;
+                });
+                inner.wait();
+            });
+        group.wait();
+    }
+    TL_SET_SESSION_ID(session_id);
+    ASSERT_EQ(sum, 5050);
+    ASSERT_EQ(sessions, 100);
+    ASSERT_EQ(nested, 100);
+
+    // The first exception is rethrown by wait()
+    TaskGroup failing(executor);
+    for (int i = 0; i < 10; i++)
+        failing.run([i]() {
+            if (i == 5)
+                throw Exception("task %d failed", i);
+        });
+    ASSERT_THROW(failing.wait(), Exception);
+    failing.wait();
+
+    // Dispatchers can be reused, and serial results keep their order
+    std::vector<int> squares;
+    SquareDispatcher dispatcher(200, squares);
+    for (int run = 0; run < 3; run++)
+    {
+        squares.clear();
+        dispatcher.restart();
+        dispatcher.run(4);
+        ASSERT_EQ(squares.size(), 200u);
+        for (int i = 0; i < 200; i++)
+            ASSERT_EQ(squares[i], i * i);
+    }
+
+    // A failed command terminates the run and its exception reaches the caller
+    SquareDispatcher failing_dispatcher(-1, squares);
+    squares.clear();
+    ASSERT_THROW(failing_dispatcher.run(4), Exception);
+    ASSERT_LE(squares.size(), 50u);
+
+    // A loop that fails to prepare terminates the run
+    SquareDispatcher unprepared_dispatcher(3, squares);
+    unprepared_dispatcher.failPreparation();
+    ASSERT_THROW(unprepared_dispatcher.run(4), Exception);
+    // Serial runs and runs without commands do not prepare threads
+    unprepared_dispatcher.restart();
+    unprepared_dispatcher.run(0);
+    SquareDispatcher idle_dispatcher(0, squares);
+    idle_dispatcher.failPreparation();
+    idle_dispatcher.run(4);
+
+    // Handlers may run parallel code of their own, and concurrent dispatchers
+    // share the workers: idle loops do not hold them
+    std::vector<int> nested_squares[2];
+    std::vector<std::thread> runs;
+    for (int d = 0; d < 2; d++)
+        runs.emplace_back([&nested_squares, d]() {
+            SquareDispatcher nested_dispatcher(200, nested_squares[d]);
+            nested_dispatcher.handleInGroup();
+            nested_dispatcher.run(4);
+        });
+    for (auto& run : runs)
+        run.join();
+    for (auto& nested : nested_squares)
+    {
+        ASSERT_EQ(nested.size(), 200u);
+        for (int i = 0; i < 200; i++)
+            ASSERT_EQ(nested[i], i * i);
+    }
+
+#ifndef _WIN32
+    // Workers block all signals, whatever the mask of the thread that created them
+    std::atomic<bool> blocked(false);
+    TaskExecutor signal_executor(2);
+    TaskGroup signal_group(signal_executor);
+    signal_group.run([&blocked]() {
+        sigset_t mask;
+        pthread_sigmask(SIG_SETMASK, nullptr, &mask);
+        blocked = sigismember(&mask, SIGINT) && sigismember(&mask, SIGTERM) && sigismember(&mask, SIGUSR1);
+    });
+    signal_group.wait();
+    ASSERT_TRUE(blocked);
+
+    sigset_t mask;
+    pthread_sigmask(SIG_SETMASK, nullptr, &mask);
+    ASSERT_FALSE(sigismember(&mask, SIGINT));
+#endif
+}
+
+TEST_F(IndigoCoreContainersTest, test_hash128)
+{
+    // Reference values of MurmurHash3 x64_128 with zero seed
+    Hash128 empty = Hash128::get("");
+    EXPECT_EQ(0ULL, empty.h1);
+    EXPECT_EQ(0ULL, empty.h2);
+
+    Hash128 hello = Hash128::get("hello");
+    EXPECT_EQ(0xcbd8a7b341bd9b02ULL, hello.h1);
+    EXPECT_EQ(0x5b1e906a48ae1d19ULL, hello.h2);
+
+    Array<char> hex;
+    Hash128::get("The quick brown fox jumps over the lazy dog").appendHex(hex);
+    hex.push(0);
+    EXPECT_STREQ("e34bbc7bbc071b6c7a433ca9c49a9347", hex.ptr());
+
+    hex.clear();
+    hello.appendHex(hex, 64);
+    hex.push(0);
+    EXPECT_STREQ("cbd8a7b341bd9b02", hex.ptr());
+
+    // Every tail length takes a different path
+    const char* text = "0123456789abcdefghijklmnopqrstuvwxyz";
+    for (int len = 0; len < 36; len++)
+    {
+        EXPECT_EQ(Hash128::get(text, len), Hash128::get(std::string(text, len).c_str()));
+        EXPECT_NE(Hash128::get(text, len), Hash128::get(text, len + 1));
+    }
+    EXPECT_NE(Hash128::get(text, 10, 0), Hash128::get(text, 10, 1));
+}
@@ -28,6 +28,7 @@
 #include <molecule/molecule_substructure_matcher.h>
 #include <molecule/molfile_loader.h>
 #include <molecule/query_molecule.h>
+#include <molecule/record_index.h>
 #include <molecule/sdf_loader.h>
 #include <molecule/smiles_loader.h>
 
@@ -112,3 +113,50 @@ TEST_F(IndigoCoreFormatsTest, save_cml)
 
     ASSERT_TRUE(out.size() > 1000);
 }
+
+TEST_F(IndigoCoreFormatsTest, mapped_sdf_scanner)
+{
+    std::string path = dataPath("molecules/resonance/resonance.sdf");
+
+    FileScanner sc(path.c_str());
+    SdfLoader sdf(sc);
+    ObjArray<Array<char>> records;
+    while (!sdf.isEOF())
+    {
+        sdf.readNext();
+        records.push().copy(sdf.data);
+    }
+
+    MappedFileScanner mapped_sc(ENCODING_ASCII, path.c_str());
+    SdfLoader mapped_sdf(mapped_sc);
+    ASSERT_EQ(records.size(), mapped_sdf.count());
+
+    // Random access goes through the record index before any record is read
+    for (int i = records.size() - 1; i >= 0; i -= 7)
+    {
+        mapped_sdf.readAt(i);
+        ASSERT_EQ(records[i].size(), mapped_sdf.data.size());
+        ASSERT_EQ(0, memcmp(records[i].ptr(), mapped_sdf.data.ptr(), records[i].size()));
+    }
+    ASSERT_THROW(mapped_sdf.readAt(records.size()), Exception);
+
+    // Chunks scanned in parallel give the same boundaries as one serial scan
+    Array<char> big;
+    while (big.size() < (9 << 20))
+        big.concat(mapped_sc.data(), (int)mapped_sc.length());
+
+    RecordIndex serial, parallel;
+    serial.build(big.ptr(), big.size(), RecordIndex::FORMAT_SDF, 1);
+    parallel.build(big.ptr(), big.size(), RecordIndex::FORMAT_SDF, 4);
+    ASSERT_EQ(serial.count(), parallel.count());
+    ASSERT_EQ(0, serial.count() % records.size());
+    for (int i = 0; i < serial.count(); i++)
+        ASSERT_EQ(serial.offset(i), parallel.offset(i));
+
+    RecordIndex smiles;
+    const char* lines = "CCO\n\nc1ccccc1\nC>>C";
+    smiles.build(lines, strlen(lines), RecordIndex::FORMAT_SMILES);
+    ASSERT_EQ(4, smiles.count());
+    ASSERT_EQ(5, smiles.offset(2));
+    ASSERT_EQ(4, smiles.length(3));
+}
@@ -188,4 +188,82 @@ TEST_F(IndigoCoreMcsTest, rings)
     flog.flush();
 
     ASSERT_EQ(18, mapSize(v_map));
-}
\ No newline at end of file
+}
+
+TEST_F(IndigoCoreMcsTest, parallel_matches_serial)
+{
+    resetCancellationHandler(nullptr);
+
+    const char* pairs[][2] = {{"C1C(=CC(=CC=1C1C=CC=CC=1)C1C=CC=CC=1)C1C=CC=CC=1", "C1C(=CC=CC=1C1C=CC=CC=1C1C=CC=CC=1)C1C=CC=CC=1"},
+                              {"CC(=O)Oc1ccccc1C(=O)O", "OC(=O)c1ccccc1O"},
+                              {"CN1C=NC2=C1C(=O)N(C(=O)N2C)C", "CN1C(=O)N(C)C2=C(C1=O)NC=N2"}};
+
+    for (auto& pair : pairs)
+    {
+        Molecule t_mol;
+        Molecule q_mol;
+        loadMolecule(pair[0], q_mol);
+        loadMolecule(pair[1], t_mol);
+
+        Array<int> v_map_serial, v_map_parallel;
+
+        MaxCommonSubmolecule mcs_serial(t_mol, q_mol);
+        mcs_serial.findExactMCS();
+        mcs_serial.getMaxSolutionMap(&v_map_serial, 0);
+
+        MaxCommonSubmolecule mcs_parallel(t_mol, q_mol);
+        mcs_parallel.parametersForExact.threadCount = 4;
+        mcs_parallel.findExactMCS();
+        mcs_parallel.getMaxSolutionMap(&v_map_parallel, 0);
+
+        // Smaller solutions can differ, as they depend on the order the branches are finished in
+        EXPECT_EQ(mapSize(v_map_serial), mapSize(v_map_parallel)) << pair[0];
+        EXPECT_FALSE(mcs_parallel.parametersForExact.isStopped);
+    }
+}
+
+TEST_F(IndigoCoreMcsTest, anytime_on_timeout)
+{
+    Molecule t_mol;
+    Molecule q_mol;
+
+    loadMolecule("CC1CC2CCC3CC4=CC=C5CCCC6=C/C=C7/C8CCCC9CC%10CCCC%11CC%12=C(C(C%10%11)C89)C7=CC(C2=C3CC4=C56)=C1%12", q_mol);
+    loadMolecule("C1CC2CC3CCCC4C3C3C2C(C1)C1CCC2CC5CCC6CC7=CC=C8CCCC9=C%10C=C4C4=C%11C(C5=C6C(C7=C89)=C%10%11)=C2C1=C34", t_mol);
+
+    for (int threads = 1; threads <= 2; threads++)
+    {
+        MaxCommonSubmolecule mcs(q_mol, t_mol);
+        mcs.parametersForExact.anytime = true;
+        mcs.parametersForExact.threadCount = threads;
+
+        resetCancellationHandler(new TimeoutCancellationHandler(500));
+        ASSERT_NO_THROW(mcs.findExactMCS());
+        resetCancellationHandler(nullptr);
+
+        // The best solution found before the timeout is returned
+        Array<int> v_map;
+        mcs.getMaxSolutionMap(&v_map, 0);
+        EXPECT_TRUE(mcs.parametersForExact.isStopped);
+        EXPECT_LT(0, mcs.parametersForExact.numberOfSolutions);
+        EXPECT_TRUE(hasSolution(v_map));
+    }
+}
+
+TEST_F(IndigoCoreMcsTest, parallel_max_iteration)
+{
+    resetCancellationHandler(nullptr);
+
+    Molecule t_mol;
+    Molecule q_mol;
+
+    loadMolecule("CC1CC2CCC3CC4=CC=C5CCCC6=C/C=C7/C8CCCC9CC%10CCCC%11CC%12=C(C(C%10%11)C89)C7=CC(C2=C3CC4=C56)=C1%12", q_mol);
+    loadMolecule("C1CC2CC3CCCC4C3C3C2C(C1)C1CCC2CC5CCC6CC7=CC=C8CCCC9=C%10C=C4C4=C%11C(C5=C6C(C7=C89)=C%10%11)=C2C1=C34", t_mol);
+
+    // The iteration limit is shared by all the threads, so the search stops as the serial one does
+    MaxCommonSubmolecule mcs(q_mol, t_mol);
+    mcs.parametersForExact.maxIteration = 1000;
+    mcs.parametersForExact.threadCount = 4;
+    ASSERT_NO_THROW(mcs.findExactMCS());
+    EXPECT_TRUE(mcs.parametersForExact.isStopped);
+    EXPECT_LT(0, mcs.parametersForExact.numberOfSolutions);
+}
@@ -16,15 +16,24 @@
  * limitations under the License.
  ***************************************************************************/
 
+#include <cstring>
+
 #include <gtest/gtest.h>
 
 #include <base_cpp/output.h>
 #include <base_cpp/scanner.h>
+#include <graph/graph_csr.h>
+#include <layout/molecule_layout.h>
+#include <layout/molecule_layout_macrocycles_cache.h>
 #include <molecule/cmf_loader.h>
 #include <molecule/cmf_saver.h>
 #include <molecule/cml_saver.h>
+#include <molecule/molecule_canonical_hash.h>
 #include <molecule/molecule_cdxml_saver.h>
+#include <molecule/molecule_fingerprint.h>
+#include <molecule/molecule_fragment_hash_cache.h>
 #include <molecule/molecule_mass.h>
+#include <molecule/molecule_morgan_fingerprint_builder.h>
 #include <molecule/molecule_substructure_matcher.h>
 #include <molecule/molfile_loader.h>
 #include <molecule/query_molecule.h>
@@ -47,3 +56,299 @@ TEST_F(IndigoCoreMoleculeTest, mass)
     const auto m = mm.monoisotopicMass(molecule);
     ASSERT_NEAR(80.9163, m, 0.01);
 }
+
+TEST_F(IndigoCoreMoleculeTest, csr_snapshot)
+{
+    Molecule molecule;
+    loadMolecule("C1CC(N)CCC1C(=O)O", molecule);
+    molecule.removeAtom(3);
+
+    const GraphCsr& csr = molecule.getCsr();
+    ASSERT_EQ(molecule.vertexEnd(), csr.vertexEnd());
+    ASSERT_EQ(molecule.vertexCount(), csr.vertexCount());
+    for (int v = molecule.vertexBegin(); v != molecule.vertexEnd(); v = molecule.vertexNext(v))
+    {
+        const Vertex& vertex = molecule.getVertex(v);
+        ASSERT_EQ(vertex.degree(), csr.degree(v));
+        int k = 0;
+        for (int i = vertex.neiBegin(); i != vertex.neiEnd(); i = vertex.neiNext(i), k++)
+        {
+            EXPECT_EQ(vertex.neiVertex(i), csr.getNeiVertices(v)[k]);
+            EXPECT_EQ(vertex.neiEdge(i), csr.getNeiEdges(v)[k]);
+            EXPECT_EQ(vertex.neiEdge(i), csr.findEdgeIndex(v, vertex.neiVertex(i)));
+        }
+    }
+    EXPECT_EQ(0, csr.degree(3));
+    EXPECT_EQ(-1, csr.findEdgeIndex(0, 4));
+
+    // The snapshot is rebuilt after the molecule is modified
+    int bond = molecule.addBond(0, 4, BOND_SINGLE);
+    EXPECT_EQ(bond, molecule.getCsr().findEdgeIndex(4, 0));
+    EXPECT_EQ(molecule.getVertex(0).degree(), molecule.getCsr().degree(0));
+}
+
+TEST_F(IndigoCoreMoleculeTest, canonical_hash)
+{
+    MoleculeCanonicalHash canonical_hash;
+    auto hash = [&](const char* smiles) {
+        Molecule molecule;
+        loadMolecule(smiles, molecule);
+        return canonical_hash.calculate(molecule);
+    };
+
+    // Atom order and explicit hydrogens do not matter
+    EXPECT_EQ(hash("OCC1=CC=CC=C1N"), hash("NC1=CC=CC=C1CO"));
+    EXPECT_EQ(hash("C[C@H](N)C(=O)O"), hash("OC(=O)[C@@H](N)C"));
+    EXPECT_EQ(hash("C[C@H](N)C(=O)O"), hash("[H][C@@](C)(N)C(=O)O"));
+    EXPECT_EQ(hash("F/C=C/Cl"), hash("Cl/C=C/F"));
+    EXPECT_EQ(hash("CC(C)C"), hash("[H]C([H])([H])C(C)C"));
+
+    // Stereo that does not survive the symmetry check is dropped
+    EXPECT_EQ(hash("C[C@H](C)N"), hash("CC(C)N"));
+
+    EXPECT_NE(hash("C[C@H](N)C(=O)O"), hash("C[C@@H](N)C(=O)O"));
+    EXPECT_NE(hash("C[C@H](N)C(=O)O"), hash("CC(N)C(=O)O"));
+    EXPECT_NE(hash("F/C=C/Cl"), hash("F/C=C\\Cl"));
+    EXPECT_NE(hash("CC(=O)[O-]"), hash("CC(=O)O"));
+    EXPECT_NE(hash("[13CH4]"), hash("C"));
+    EXPECT_NE(hash("[CH2]C"), hash("CC"));
+    EXPECT_NE(hash("CCO"), hash("COC"));
+    EXPECT_NE(hash("C=CC"), hash("CCC"));
+}
+
+TEST_F(IndigoCoreMoleculeTest, morgan_fingerprint)
+{
+    Molecule aspirin, butanol, gapped;
+    loadMolecule("CC(=O)Oc1ccccc1C(=O)O", aspirin);
+    loadMolecule("CCCCO", butanol);
+    loadMolecule("CC(C)CCO", gapped);
+    gapped.removeAtom(0);
+
+    MoleculeMorganFingerprintBuilder builder;
+    Array<dword> descriptors;
+    builder.setMolecule(aspirin);
+    builder.calculateDescriptorsECFP(1, descriptors);
+    const dword expected[] = {400012547,  400012547,  405332512,  405332512,  1327994823, 1724663674, 2059909514,
+                              2059909514, 2401230927, 2748881937, 3143993759, 4100772704, 4257753803};
+    ASSERT_EQ(13, descriptors.size());
+    for (int i = 0; i < descriptors.size(); i++)
+        EXPECT_EQ(expected[i], descriptors[i]);
+
+    // Atoms are numbered densely, so removed atoms leave no trace
+    Array<dword> gapped_descriptors;
+    builder.setMolecule(butanol);
+    builder.calculateDescriptorsECFP(2, descriptors);
+    builder.setMolecule(gapped);
+    builder.calculateDescriptorsECFP(2, gapped_descriptors);
+    ASSERT_EQ(descriptors.size(), gapped_descriptors.size());
+    EXPECT_EQ(0, descriptors.memcmp(gapped_descriptors));
+
+    // The batch is the concatenation of single fingerprints
+    const int fp_bytes = 64;
+    Array<BaseMolecule*> molecules;
+    molecules.push(&aspirin);
+    molecules.push(&butanol);
+    molecules.push(&gapped);
+    Array<byte> batch, fp;
+    builder.packFingerprintsECFP(2, molecules, fp_bytes, batch);
+    ASSERT_EQ(molecules.size() * fp_bytes, batch.size());
+    fp.resize(fp_bytes);
+    for (int i = 0; i < molecules.size(); i++)
+    {
+        MoleculeMorganFingerprintBuilder single(*molecules[i]);
+        single.packFingerprintECFP(2, fp);
+        EXPECT_EQ(0, memcmp(fp.ptr(), batch.ptr() + i * fp_bytes, fp_bytes));
+    }
+}
+
+TEST_F(IndigoCoreMoleculeTest, fingerprint_fragment_cache)
+{
+    MoleculeFingerprintParameters parameters;
+    parameters.ext = true;
+    parameters.similarity_type = SimilarityType::SIM;
+    parameters.ord_qwords = 25;
+    parameters.any_qwords = 15;
+    parameters.tau_qwords = 10;
+    parameters.sim_qwords = 8;
+    const int size = parameters.fingerprintSize();
+
+    auto fingerprint = [&](Molecule& molecule, bool use_cache, Array<byte>& fp) {
+        MoleculeFingerprintBuilder builder(molecule, parameters);
+        builder.use_fragment_cache = use_cache;
+        builder.process();
+        fp.copy(builder.get(), size);
+    };
+
+    MoleculeFragmentHashCache& cache = MoleculeFragmentHashCache::getThreadCache();
+    cache.clear();
+    cache.resetCounters();
+
+    const char* smiles[] = {"CC(=O)Oc1ccccc1C(=O)O", "OC(=O)c1ccccc1O", "CC(C)Cc1ccc(cc1)C(C)C(=O)O", "CC(=O)Oc1ccccc1C(=O)O"};
+    for (const char* s : smiles)
+    {
+        Molecule molecule;
+        loadMolecule(s, molecule);
+        Array<byte> expected, cached;
+        fingerprint(molecule, false, expected);
+        fingerprint(molecule, true, cached);
+        EXPECT_EQ(0, cached.memcmp(expected)) << s;
+    }
+
+    // Benzene rings and the repeated molecule are found in the cache
+    EXPECT_GT(cache.getHits(), 0);
+    EXPECT_GT(cache.getMisses(), 0);
+    EXPECT_GT(cache.getHitRate(), 0.3);
+
+    // The cache is emptied when it is full, results stay the same
+    cache.setCapacity(16);
+    Molecule molecule;
+    loadMolecule(smiles[2], molecule);
+    Array<byte> expected, cached;
+    fingerprint(molecule, false, expected);
+    fingerprint(molecule, true, cached);
+    EXPECT_EQ(0, cached.memcmp(expected));
+    EXPECT_LE(cache.size(), 16);
+    cache.setCapacity(MoleculeFragmentHashCache::DEFAULT_CAPACITY);
+}
+
+TEST_F(IndigoCoreMoleculeTest, layout_threads)
+{
+    const char* smiles[] = {"CCO.c1ccccc1.OC(=O)C1CCCCC1.CC(C)C=CC.C1CCC2CCCCC2C1", "C1CCCCCCCCCCCCCC1.c1ccc2ccccc2c1.CN.[Na+].[Cl-]",
+                            "CC(=O)Oc1ccccc1C(=O)O"};
+
+    auto coordinates = [](Molecule& molecule, Array<Vec2f>& xyz) {
+        xyz.clear();
+        for (int i = molecule.vertexBegin(); i != molecule.vertexEnd(); i = molecule.vertexNext(i))
+            xyz.push().set(molecule.getAtomXyz(i).x, molecule.getAtomXyz(i).y);
+    };
+
+    auto layout = [&](const char* s, bool smart, int threads, Array<Vec2f>& xyz) {
+        Molecule molecule;
+        loadMolecule(s, molecule);
+        MoleculeLayout ml(molecule, smart);
+        ml.thread_count = threads;
+        ml.make();
+        coordinates(molecule, xyz);
+    };
+
+    // Components laid out in worker threads get the coordinates of a serial layout
+    for (bool smart : {false, true})
+        for (const char* s : smiles)
+        {
+            Array<Vec2f> serial, parallel;
+            layout(s, smart, 1, serial);
+            layout(s, smart, 3, parallel);
+            ASSERT_EQ(serial.size(), parallel.size());
+            for (int i = 0; i < serial.size(); i++)
+            {
+                EXPECT_FLOAT_EQ(serial[i].x, parallel[i].x) << s;
+                EXPECT_FLOAT_EQ(serial[i].y, parallel[i].y) << s;
+            }
+        }
+
+    ObjArray<Molecule> molecules;
+    Array<BaseMolecule*> batch;
+    for (const char* s : smiles)
+    {
+        loadMolecule(s, molecules.push());
+        batch.push(&molecules.top());
+    }
+
+    MoleculeBatchLayout batch_layout;
+    batch_layout.thread_count = 2;
+    batch_layout.make(batch);
+    EXPECT_EQ(0, batch_layout.getFailedCount());
+
+    for (int i = 0; i < molecules.size(); i++)
+    {
+        EXPECT_EQ(nullptr, batch_layout.getError(i));
+        Array<Vec2f> expected, actual;
+        layout(smiles[i], false, 1, expected);
+        coordinates(molecules[i], actual);
+        ASSERT_EQ(expected.size(), actual.size());
+        for (int j = 0; j < expected.size(); j++)
+        {
+            EXPECT_FLOAT_EQ(expected[j].x, actual[j].x);
+            EXPECT_FLOAT_EQ(expected[j].y, actual[j].y);
+        }
+    }
+}
+
+TEST_F(IndigoCoreMoleculeTest, macrocycle_layout_cache)
+{
+    // Cyclic peptide with a 24-membered ring
+    const char* smiles = "N1C(C)C(=O)NC(CC(C)C)C(=O)NC(Cc2ccccc2)C(=O)NC(CO)C(=O)NC(C)C(=O)NC(CCSC)C(=O)NC(CC(N)=O)C(=O)NC(C)C1=O";
+
+    auto layout = [&](Array<Vec2f>& xyz) {
+        Molecule molecule;
+        loadMolecule(smiles, molecule);
+        MoleculeLayout ml(molecule, true);
+        ml.make();
+        xyz.clear();
+        for (int i = molecule.vertexBegin(); i != molecule.vertexEnd(); i = molecule.vertexNext(i))
+            xyz.push().set(molecule.getAtomXyz(i).x, molecule.getAtomXyz(i).y);
+    };
+
+    auto expectEqual = [](const Array<Vec2f>& expected, const Array<Vec2f>& actual) {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (int i = 0; i < expected.size(); i++)
+        {
+            EXPECT_FLOAT_EQ(expected[i].x, actual[i].x);
+            EXPECT_FLOAT_EQ(expected[i].y, actual[i].y);
+        }
+    };
+
+    MoleculeLayoutMacrocyclesCache& cache = MoleculeLayoutMacrocyclesCache::instance();
+    cache.setEnabled(false);
+    Array<Vec2f> expected;
+    layout(expected);
+
+    cache.setEnabled(true);
+    cache.clear();
+    cache.resetCounters();
+
+    Array<Vec2f> searched, cached;
+    layout(searched);
+    EXPECT_EQ(0, cache.getHits());
+    EXPECT_EQ(1, cache.size());
+    layout(cached);
+    EXPECT_EQ(1, cache.getHits());
+    expectEqual(expected, searched);
+    expectEqual(expected, cached);
+
+    // Templates survive a save and load round trip
+    Array<char> buf;
+    ArrayOutput output(buf);
+    EXPECT_EQ(1, cache.save(output));
+    cache.clear();
+    BufferScanner scanner(buf);
+    EXPECT_EQ(1, cache.load(scanner));
+    layout(cached);
+    EXPECT_EQ(2, cache.getHits());
+    expectEqual(expected, cached);
+
+    BufferScanner bad_scanner("not a cache");
+    EXPECT_THROW(cache.load(bad_scanner), Exception);
+
+    // A template is rejected if its positions do not cover the cycle
+    Array<char> corrupted;
+    ArrayOutput corrupted_output(corrupted);
+    corrupted_output.write("IMLC", 4);
+    corrupted_output.writeBinaryInt(1);
+    corrupted_output.writeBinaryInt(1);
+    corrupted_output.writeBinaryInt(0);
+    corrupted_output.writeBinaryInt(0);
+    corrupted_output.writeBinaryInt(sizeof(int));
+    corrupted_output.writeBinaryInt(12);
+    corrupted_output.writeBinaryInt(3);
+    for (int i = 0; i < 3; i++)
+    {
+        corrupted_output.writeBinaryFloat(0);
+        corrupted_output.writeBinaryFloat(0);
+    }
+    cache.clear();
+    BufferScanner corrupted_scanner(corrupted);
+    EXPECT_THROW(cache.load(corrupted_scanner), Exception);
+    EXPECT_EQ(0, cache.size());
+    cache.clear();
+}
@@ -35,6 +35,7 @@ namespace indigo
 
     protected:
         float _getObjScale(int item);
+        float _getObjScale(RenderItemBase& item);
         int _getMaxWidth();
         int _getMaxHeight();
         float _getScale(int w, int h);
@@ -48,13 +48,19 @@ namespace indigo
         void fillBackground();
         void initNullContext();
         void initContext(int width, int height);
+        // Context on an image surface of its own for a part of the picture
+        void initOffscreenContext(int width, int height);
         void closeContext(bool discard);
+        // Draws the surface of an offscreen context with its origin at x, y
+        void paintContext(const RenderContext& other, double x, double y);
         void translate(float dx, float dy);
         void scale(float s);
         void storeTransform();
         void restoreTransform();
         void resetTransform();
         void removeStoredTransform();
+        void getTransform(cairo_matrix_t& t);
+        void setTransform(const cairo_matrix_t& t);
         void drawRectangle(const Vec2f& v1, const Vec2f& sz);
         void drawEllipse(const Vec2f& v1, const Vec2f& v2);
         void drawItemBackground(const RenderItem& item);
@@ -162,8 +168,7 @@ namespace indigo
         Vec3f _baseColor;
         float _currentLineWidth;
         cairo_pattern_t* _pattern;
-
-        static std::mutex _cairo_mutex;
+        Output* _output;
 
         CP_DECL;
         TL_CP_DECL(Array<char>, _fontfamily);
@@ -24,6 +24,28 @@
 namespace indigo
 {
 
+    // Object with its title on a context of its own, so the cells of a grid
+    // can be measured and drawn on several threads
+    class RenderGridCell
+    {
+    public:
+        RenderGridCell(const RenderOptions& opt, float sf, float lwf);
+
+        RenderContext rc;
+        RenderItemFactory factory;
+        int obj;
+        int title;
+
+        // Set by RenderGrid: transforms of the object and the title in the
+        // grid, and the position of the cell surface in the grid
+        cairo_matrix_t objTransform;
+        cairo_matrix_t titleTransform;
+        double x, y;
+
+    private:
+        RenderGridCell(const RenderGridCell&); // no implicit copy
+    };
+
     class RenderGrid : Render
     {
     public:
@@ -41,8 +63,22 @@ namespace indigo
         int commentOffset;
         int comment;
 
+        // Used instead of objs and titles if not empty. The cells are measured
+        // and drawn on threadCount threads and composed in the grid at the end.
+        PtrArray<RenderGridCell> cells;
+        int threadCount;
+
     private:
         void _drawComment();
+        void _drawCells();
+        void _drawCellItem(RenderGridCell& cell, int item, const cairo_matrix_t& transform);
+        void _measureObj(int i, bool enableRefAtoms, bool enableTitles);
+
+        int _objCount();
+        bool _objIsMolecule(int i);
+        RenderItemBase& _objItem(int i);
+        RenderItemMolecule& _objMolecule(int i);
+        RenderItemBase& _titleItem(int i);
 
         int nRows;
         float scale;
@@ -30,6 +30,7 @@ namespace indigo
     class Scanner;
     class Output;
     class RenderItemFactory;
+    class RenderContext;
 
     enum RENDER_MODE
     {
@@ -50,6 +51,8 @@ namespace indigo
         float relativeThickness;
         float bondLineWidthFactor;
         bool smart_layout = false;
+        // Threads laying out and drawing the objects of a grid or a batch, 0 for one per core
+        int threadCount;
         RENDER_MODE rmode;
 
         std::unique_ptr<BaseMolecule> mol;
@@ -70,12 +73,18 @@ namespace indigo
     public:
         DECL_ERROR;
         static void render(RenderParams& params);
+        // Renders every object of params.mols or params.rxns into its own output
+        static void renderBatch(RenderParams& params, const Array<Output*>& outputs);
         static int multilineTextUnit(RenderItemFactory& factory, int type, const Array<char>& titleStr, const float spacing,
                                      const MultilineTextLayout::Alignment alignment);
 
     private:
         static void _prepareMolecule(RenderParams& params, BaseMolecule& bm);
         static void _prepareReaction(RenderParams& params, BaseReaction& rxn);
+        static void _prepareObjects(RenderParams& params);
+        static int _addObject(RenderParams& params, RenderItemFactory& factory, BaseMolecule* mol, BaseReaction* rxn);
+        static void _renderSingle(RenderParams& params, RenderContext& rc, BaseMolecule* mol, BaseReaction* rxn);
+        static void _renderGrid(RenderParams& params, RenderContext& rc);
         static bool needsLayoutSub(BaseMolecule& mol);
         static bool needsLayout(BaseMolecule& mol);
         RenderParamInterface();
@@ -44,17 +44,22 @@ Render::~Render()
 }
 
 float Render::_getObjScale(int item)
+{
+    return _getObjScale(_factory.getItem(item));
+}
+
+float Render::_getObjScale(RenderItemBase& item)
 {
     float avgBondLength = 1.0f;
-    int bondCount = _factory.getItem(item).getBondCount();
-    int atomCount = _factory.getItem(item).getAtomCount();
+    int bondCount = item.getBondCount();
+    int atomCount = item.getAtomCount();
     if (bondCount > 0)
     {
-        avgBondLength = _factory.getItem(item).getTotalBondLength() / bondCount;
+        avgBondLength = item.getTotalBondLength() / bondCount;
     }
     else
     {
-        avgBondLength = _factory.getItem(item).getTotalClosestAtomDistance() / atomCount;
+        avgBondLength = item.getTotalClosestAtomDistance() / atomCount;
     }
     if (avgBondLength < 1e-4)
     {
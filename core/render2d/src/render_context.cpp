@@ -23,8 +23,6 @@
 
 using namespace indigo;
 
-std::mutex RenderContext::_cairo_mutex;
-
 IMPL_ERROR(RenderContext, "render context");
 
 #ifdef _WIN32
@@ -104,7 +102,7 @@ void RenderContext::storeAndDestroyMetafile(bool discard)
         Array<char> buf;
         buf.resize(size);
         GetEnhMetaFileBits(hemf, size, (BYTE*)(buf.ptr()));
-        opt.output->writeArray(buf);
+        _output->writeArray(buf);
     }
     DeleteEnhMetaFile(hemf);
 }
@@ -122,6 +120,7 @@ RenderContext::RenderContext(const RenderOptions& ropt, float sf, float lwf)
     : CP_INIT, TL_CP_GET(_fontfamily), TL_CP_GET(transforms), metafileFontsToCurves(false), _cr(NULL), _surface(NULL), _meta_hdc(NULL), opt(ropt),
       _pattern(NULL)
 {
+    _output = ropt.output;
     _settings.init(sf, lwf);
     bprintf(_fontfamily, "Arial");
     bbmin.x = bbmin.y = 1;
@@ -185,6 +184,11 @@ void RenderContext::setDefaultScale(float scale)
     _defaultScale = scale;
 }
 
+void RenderContext::setOutput(Output* output)
+{
+    _output = output;
+}
+
 void RenderContext::setFontFamily(const char* ff)
 {
     bprintf(_fontfamily, "%s", ff);
@@ -219,17 +223,16 @@ void RenderContext::createSurface(cairo_write_func_t writer, Output* output, int
     }
 
     {
-        std::lock_guard<std::mutex> _lock(_cairo_mutex);
         switch (mode)
         {
         case MODE_NONE:
             throw Error("mode not set");
         case MODE_PDF:
-            _surface = cairo_pdf_surface_create_for_stream(writer, opt.output, _width, _height);
+            _surface = cairo_pdf_surface_create_for_stream(writer, output, _width, _height);
             cairoCheckSurfaceStatus();
             break;
         case MODE_SVG:
-            _surface = cairo_svg_surface_create_for_stream(writer, opt.output, _width, _height);
+            _surface = cairo_svg_surface_create_for_stream(writer, output, _width, _height);
             cairoCheckSurfaceStatus();
             break;
         case MODE_PNG:
@@ -279,15 +282,9 @@ void RenderContext::init()
     fontsInit();
     cairo_text_extents_t te;
 
-    {
-        std::lock_guard<std::mutex> _lock(_cairo_mutex);
-        cairo_select_font_face(_cr, _fontfamily.ptr(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-        cairoCheckStatus();
-        cairo_set_font_size(_cr, _settings.fzz[FONT_SIZE_ATTR]);
-        cairoCheckStatus();
-        cairo_text_extents(_cr, "N", &te);
-        cairoCheckStatus();
-    }
+    fontsSetFont(_cr, FONT_SIZE_ATTR, false);
+    cairo_text_extents(_cr, "N", &te);
+    cairoCheckStatus();
 
     cairo_set_antialias(_cr, CAIRO_ANTIALIAS_GRAY);
     cairoCheckStatus();
@@ -319,22 +316,43 @@ void RenderContext::initContext(int width, int height)
 {
     _width = width;
     _height = height;
-    if (opt.mode != MODE_HDC && opt.mode != MODE_PRN && opt.output == NULL)
+    if (opt.mode != MODE_HDC && opt.mode != MODE_PRN && _output == NULL)
         throw Error("output not set");
     if (_surface != NULL || _cr != NULL)
         throw Error("context is already open (or invalid)");
 
-    createSurface(writer, opt.output, _width, _height);
+    createSurface(writer, _output, _width, _height);
     _cr = cairo_create(_surface);
     if (opt.backgroundColor.x >= 0 && opt.backgroundColor.y >= 0 && opt.backgroundColor.z >= 0)
         fillBackground();
 }
 
+void RenderContext::initOffscreenContext(int width, int height)
+{
+    _width = width;
+    _height = height;
+    if (_surface != NULL || _cr != NULL)
+        throw Error("context is already open (or invalid)");
+
+    _surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, _width, _height);
+    cairoCheckSurfaceStatus();
+    _cr = cairo_create(_surface);
+}
+
+void RenderContext::paintContext(const RenderContext& other, double x, double y)
+{
+    cairo_save(_cr);
+    cairo_identity_matrix(_cr);
+    cairo_set_source_surface(_cr, other._surface, x, y);
+    cairo_paint(_cr);
+    cairo_restore(_cr);
+    cairoCheckStatus();
+}
+
 void RenderContext::closeContext(bool discard)
 {
     if (_cr != NULL)
     {
-        std::lock_guard<std::mutex> _lock(_cairo_mutex);
         cairo_destroy(_cr);
         _cr = NULL;
     }
@@ -345,7 +363,7 @@ void RenderContext::closeContext(bool discard)
         throw Error("mode not set");
     case MODE_PNG:
         if (!discard)
-            cairo_surface_write_to_png_stream(_surface, writer, opt.output);
+            cairo_surface_write_to_png_stream(_surface, writer, _output);
         break;
     case MODE_PDF:
     case MODE_SVG:
@@ -363,7 +381,6 @@ void RenderContext::closeContext(bool discard)
 
     if (_surface != NULL)
     {
-        std::lock_guard<std::mutex> _lock(_cairo_mutex);
         cairo_surface_destroy(_surface);
         _surface = NULL;
     }
@@ -395,7 +412,6 @@ void RenderContext::storeTransform()
 
 void RenderContext::restoreTransform()
 {
-    std::lock_guard<std::mutex> _lock(_cairo_mutex);
     cairo_matrix_t& t = transforms.top();
     cairo_set_matrix(_cr, &t);
     cairoCheckStatus();
@@ -406,6 +422,18 @@ void RenderContext::removeStoredTransform()
     transforms.pop();
 }
 
+void RenderContext::getTransform(cairo_matrix_t& t)
+{
+    cairo_get_matrix(_cr, &t);
+    cairoCheckStatus();
+}
+
+void RenderContext::setTransform(const cairo_matrix_t& t)
+{
+    cairo_set_matrix(_cr, &t);
+    cairoCheckStatus();
+}
+
 void RenderContext::resetTransform()
 {
     cairo_matrix_t t;
@@ -513,10 +541,7 @@ void RenderContext::drawLine(const Vec2f& v0, const Vec2f& v1)
     lineTo(v1);
     checkPathNonEmpty();
     bbIncludePath(true);
-    {
-        std::lock_guard<std::mutex> _lock(_cairo_mutex);
-        cairo_stroke(_cr);
-    }
+    cairo_stroke(_cr);
     cairoCheckStatus();
 }
 
@@ -17,15 +17,126 @@
  ***************************************************************************/
 
 #include "base_cpp/output.h"
+#include "base_cpp/profiling.h"
 #include "math/algebra.h"
 #include "render_context.h"
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
 using namespace indigo;
 
+namespace
+{
+    // Font faces of the calling thread. Text items set a face of their own
+    // instead of looking it up by the family name every time, and contexts
+    // on different threads do not share anything but the font backend.
+    class _ThreadFontFaces
+    {
+    public:
+        ~_ThreadFontFaces()
+        {
+            _reset();
+        }
+
+        cairo_font_face_t* get(const char* family, bool bold)
+        {
+            if (_family != family)
+            {
+                _reset();
+                _family = family;
+            }
+
+            cairo_font_face_t*& face = _faces[bold ? 1 : 0];
+            if (face == NULL)
+            {
+                // The font backend is initialized by the first lookup
+                static std::mutex lookup_lock;
+                std::lock_guard<std::mutex> locker(lookup_lock);
+                face = cairo_toy_font_face_create(family, CAIRO_FONT_SLANT_NORMAL, bold ? CAIRO_FONT_WEIGHT_BOLD : CAIRO_FONT_WEIGHT_NORMAL);
+            }
+            return face;
+        }
+
+    private:
+        void _reset()
+        {
+            for (cairo_font_face_t*& face : _faces)
+            {
+                if (face != NULL)
+                    cairo_font_face_destroy(face);
+                face = NULL;
+            }
+        }
+
+        std::string _family;
+        cairo_font_face_t* _faces[2] = {NULL, NULL};
+    };
+
+    thread_local _ThreadFontFaces _thread_font_faces;
+
+    // Text extents measured on the calling thread. Extents depend on the face,
+    // size, transform and font options only, and cairo combines all of them in
+    // the scaled font, so the scaled font is the key. The cache holds a
+    // reference to it, which keeps its glyph cache alive between renders too.
+    class _ThreadTextExtents
+    {
+    public:
+        enum
+        {
+            MAX_FONTS = 32,
+            MAX_TEXTS_PER_FONT = 4096
+        };
+
+        ~_ThreadTextExtents()
+        {
+            _clear();
+        }
+
+        const cairo_text_extents_t* find(cairo_scaled_font_t* font, const char* text)
+        {
+            auto font_it = _fonts.find(font);
+            if (font_it == _fonts.end())
+                return NULL;
+            auto text_it = font_it->second.find(text);
+            if (text_it == font_it->second.end())
+                return NULL;
+            return &text_it->second;
+        }
+
+        void add(cairo_scaled_font_t* font, const char* text, const cairo_text_extents_t& extents)
+        {
+            auto font_it = _fonts.find(font);
+            if (font_it == _fonts.end())
+            {
+                if (_fonts.size() >= MAX_FONTS)
+                    _clear();
+                font_it = _fonts.emplace(cairo_scaled_font_reference(font), std::unordered_map<std::string, cairo_text_extents_t>()).first;
+            }
+            if (font_it->second.size() >= MAX_TEXTS_PER_FONT)
+                font_it->second.clear();
+            font_it->second.emplace(text, extents);
+        }
+
+    private:
+        void _clear()
+        {
+            for (auto& font : _fonts)
+                cairo_scaled_font_destroy(font.first);
+            _fonts.clear();
+        }
+
+        std::unordered_map<cairo_scaled_font_t*, std::unordered_map<std::string, cairo_text_extents_t>> _fonts;
+    };
+
+    thread_local _ThreadTextExtents _thread_text_extents;
+}
+
 void RenderContext::cairoCheckStatus() const
 {
 #ifdef DEBUG
@@ -104,8 +215,7 @@ double RenderContext::fontGetSize(FONT_SIZE size)
 
 void RenderContext::fontsSetFont(cairo_t* cr, FONT_SIZE size, bool bold)
 {
-    std::lock_guard<std::mutex> _lock(_cairo_mutex);
-    cairo_select_font_face(cr, _fontfamily.ptr(), CAIRO_FONT_SLANT_NORMAL, bold ? CAIRO_FONT_WEIGHT_BOLD : CAIRO_FONT_WEIGHT_NORMAL);
+    cairo_set_font_face(cr, _thread_font_faces.get(_fontfamily.ptr(), bold));
     cairoCheckStatus();
     cairo_set_font_size(cr, fontGetSize(size));
     cairoCheckStatus();
@@ -113,10 +223,22 @@ void RenderContext::fontsSetFont(cairo_t* cr, FONT_SIZE size, bool bold)
 
 void RenderContext::fontsGetTextExtents(cairo_t* cr, const char* text, int size, float& dx, float& dy, float& rx, float& ry)
 {
-    std::lock_guard<std::mutex> _lock(_cairo_mutex);
     cairo_text_extents_t te;
-    cairo_text_extents(cr, text, &te);
-    cairoCheckStatus();
+    cairo_scaled_font_t* font = cairo_get_scaled_font(cr);
+    const cairo_text_extents_t* cached = _thread_text_extents.find(font, text);
+    if (cached != NULL)
+    {
+        te = *cached;
+        profIncCounter("render.text_extents_cache_hits", 1);
+    }
+    else
+    {
+        cairo_text_extents(cr, text, &te);
+        cairoCheckStatus();
+        if (cairo_scaled_font_status(font) == CAIRO_STATUS_SUCCESS)
+            _thread_text_extents.add(font, text, te);
+        profIncCounter("render.text_extents_cache_misses", 1);
+    }
 
     dx = (float)te.width;
     dy = (float)te.height;
@@ -165,10 +287,7 @@ void RenderContext::fontsDrawText(const TextItem& ti, const Vec3f& color, bool b
     }
     moveToRel(ti.relpos);
 
-    {
-        std::lock_guard<std::mutex> _lock(_cairo_mutex);
-        cairo_text_path(_cr, ti.text.ptr());
-    }
+    cairo_text_path(_cr, ti.text.ptr());
 
     bbIncludePath(false);
     cairo_new_path(_cr);
@@ -177,18 +296,13 @@ void RenderContext::fontsDrawText(const TextItem& ti, const Vec3f& color, bool b
 
     if (metafileFontsToCurves)
     { // TODO: remove
-        {
-            std::lock_guard<std::mutex> _lock(_cairo_mutex);
-            cairo_text_path(_cr, ti.text.ptr());
-        }
-
+        cairo_text_path(_cr, ti.text.ptr());
         cairoCheckStatus();
         cairo_fill(_cr);
         cairoCheckStatus();
     }
     else
     {
-        std::lock_guard<std::mutex> _lock(_cairo_mutex);
         cairo_show_text(_cr, ti.text.ptr());
         cairoCheckStatus();
     }
@@ -19,6 +19,7 @@
 #include "render_grid.h"
 #include "base_cpp/array.h"
 #include "base_cpp/output.h"
+#include "base_cpp/task_executor.h"
 #include "math/algebra.h"
 #include "molecule/molecule.h"
 #include "molecule/query_molecule.h"
@@ -29,10 +30,19 @@
 
 using namespace indigo;
 
+// Cells drawn before they are composed in the grid, it limits the memory
+// taken by the cell surfaces
+static const int _CELLS_PER_PASS = 64;
+
+RenderGridCell::RenderGridCell(const RenderOptions& opt, float sf, float lwf) : rc(opt, sf, lwf), factory(rc), obj(-1), title(-1), x(0), y(0)
+{
+    rc.fontsClear();
+}
+
 IMPL_ERROR(RenderGrid, "RenderGrid");
 
 RenderGrid::RenderGrid(RenderContext& rc, RenderItemFactory& factory, const CanvasOptions& cnvOpt, int bondLength, bool bondLengthSet)
-    : Render(rc, factory, cnvOpt, bondLength, bondLengthSet), nColumns(cnvOpt.gridColumnNumber), comment(-1)
+    : Render(rc, factory, cnvOpt, bondLength, bondLengthSet), nColumns(cnvOpt.gridColumnNumber), comment(-1), threadCount(1)
 {
 }
 
@@ -55,20 +65,107 @@ void RenderGrid::_drawComment()
     _rc.translate(0, commentSize.y);
 }
 
+int RenderGrid::_objCount()
+{
+    return cells.size() > 0 ? cells.size() : objs.size();
+}
+
+bool RenderGrid::_objIsMolecule(int i)
+{
+    if (cells.size() > 0)
+        return cells[i]->factory.isItemMolecule(cells[i]->obj);
+    return _factory.isItemMolecule(objs[i]);
+}
+
+RenderItemBase& RenderGrid::_objItem(int i)
+{
+    if (cells.size() > 0)
+        return cells[i]->factory.getItem(cells[i]->obj);
+    return _factory.getItem(objs[i]);
+}
+
+RenderItemMolecule& RenderGrid::_objMolecule(int i)
+{
+    if (cells.size() > 0)
+        return cells[i]->factory.getItemMolecule(cells[i]->obj);
+    return _factory.getItemMolecule(objs[i]);
+}
+
+RenderItemBase& RenderGrid::_titleItem(int i)
+{
+    if (cells.size() > 0)
+        return cells[i]->factory.getItem(cells[i]->title);
+    return _factory.getItem(titles[i]);
+}
+
+void RenderGrid::_measureObj(int i, bool enableRefAtoms, bool enableTitles)
+{
+    if (enableRefAtoms)
+        _objMolecule(i).refAtom = refAtoms[i];
+    RenderItemBase& item = _objItem(i);
+    item.init();
+    item.setObjScale(_getObjScale(item));
+    item.estimateSize();
+
+    if (enableTitles)
+    {
+        _titleItem(i).init();
+        _titleItem(i).estimateSize();
+    }
+}
+
+void RenderGrid::_drawCellItem(RenderGridCell& cell, int item, const cairo_matrix_t& transform)
+{
+    cairo_matrix_t t = transform;
+    t.x0 -= cell.x;
+    t.y0 -= cell.y;
+    cell.rc.setTransform(t);
+    cell.factory.getItem(item).render(false);
+}
+
+void RenderGrid::_drawCells()
+{
+    // Cells are drawn at the same subpixel offsets as in the grid, with room
+    // for the strokes and labels that reach past the cell
+    int pad = (int)ceil(std::max(cellsz.x, cellsz.y) * 0.1f) + 4;
+
+    for (int from = 0; from < cells.size(); from += _CELLS_PER_PASS)
+    {
+        int to = std::min(from + _CELLS_PER_PASS, cells.size());
+        TaskGroup::parallelFor(to - from, threadCount, [&](int k) {
+            RenderGridCell& cell = *cells[from + k];
+            cell.x = floor(cell.x) - pad;
+            cell.y = floor(cell.y) - pad;
+            cell.rc.initOffscreenContext((int)ceil(cellsz.x) + 2 * pad + 1, (int)ceil(cellsz.y) + 2 * pad + 1);
+            cell.rc.init();
+            _drawCellItem(cell, cell.obj, cell.objTransform);
+            if (cell.title >= 0)
+                _drawCellItem(cell, cell.title, cell.titleTransform);
+        });
+
+        for (int i = from; i < to; i++)
+        {
+            _rc.paintContext(cells[i]->rc, cells[i]->x, cells[i]->y);
+            cells[i]->rc.closeContext(true);
+        }
+    }
+}
+
 void RenderGrid::draw()
 {
     _width = _cnvOpt.width;
     _height = _cnvOpt.height;
     _rc.fontsClear();
 
-    bool enableRefAtoms = refAtoms.size() > 0 && _factory.isItemMolecule(objs[0]);
-    if (enableRefAtoms && refAtoms.size() != objs.size())
+    int count = _objCount();
+    bool enableRefAtoms = refAtoms.size() > 0 && _objIsMolecule(0);
+    if (enableRefAtoms && refAtoms.size() != count)
         throw Error("Number of reference atoms should be same as the number of objects");
-    bool enableTitles = titles.size() > 0;
-    if (enableTitles && titles.size() != objs.size())
+    bool enableTitles = cells.size() > 0 ? cells[0]->title >= 0 : titles.size() > 0;
+    if (enableTitles && cells.size() == 0 && titles.size() != count)
         throw Error("Number of titles should be same as the number of objects");
 
-    nRows = (objs.size() + nColumns - 1) / nColumns;
+    nRows = (count + nColumns - 1) / nColumns;
 
     commentSize.set(0, 0);
     commentOffset = 0;
@@ -91,18 +188,18 @@ void RenderGrid::draw()
     rowExtentBottom.clear_resize(nRows);
     rowExtentTop.fill(0);
     rowExtentBottom.fill(0);
-    for (int i = 0; i < objs.size(); ++i)
+    if (cells.size() > 0)
+        TaskGroup::parallelFor(count, threadCount, [&](int i) { _measureObj(i, enableRefAtoms, enableTitles); });
+    else
+        for (int i = 0; i < count; ++i)
+            _measureObj(i, enableRefAtoms, enableTitles);
+    for (int i = 0; i < count; ++i)
     {
-        if (enableRefAtoms)
-            _factory.getItemMolecule(objs[i]).refAtom = refAtoms[i];
-        _factory.getItem(objs[i]).init();
-        _factory.getItem(objs[i]).setObjScale(_getObjScale(objs[i]));
-        _factory.getItem(objs[i]).estimateSize();
         if (enableRefAtoms)
         {
-            const Vec2f& r = _factory.getItemMolecule(objs[i]).refAtomPos;
+            const Vec2f& r = _objMolecule(i).refAtomPos;
             Vec2f d;
-            d.diff(_factory.getItemMolecule(objs[i]).size, r);
+            d.diff(_objMolecule(i).size, r);
             refSizeLT.max(r);
             int col = i % nColumns;
             int row = i / nColumns;
@@ -114,7 +211,7 @@ void RenderGrid::draw()
         }
         else
         {
-            maxsz.max(_factory.getItem(objs[i]).size);
+            maxsz.max(_objItem(i).size);
         }
     }
     if (enableRefAtoms)
@@ -125,12 +222,8 @@ void RenderGrid::draw()
     if (enableTitles)
     {
         titleOffset = _cnvOpt.titleOffset;
-        for (int i = 0; i < titles.size(); ++i)
-        {
-            _factory.getItem(titles[i]).init();
-            _factory.getItem(titles[i]).estimateSize();
-            maxTitleSize.max(_factory.getItem(titles[i]).size);
-        }
+        for (int i = 0; i < count; ++i)
+            maxTitleSize.max(_titleItem(i).size);
     }
 
     outerMargin.x = (float)(minMarg + _cnvOpt.marginX);
@@ -159,22 +252,29 @@ void RenderGrid::draw()
     _rc.storeTransform();
     {
         _rc.translate((_width - clientArea.x) / 2 - outerMargin.x, (_height - commentSize.y - commentOffset - clientArea.y) / 2 - outerMargin.y);
-        for (int i = 0; i < objs.size(); ++i)
+        for (int i = 0; i < count; ++i)
         {
             _rc.storeTransform();
             {
                 int y = i / nColumns;
                 int x = i % nColumns;
-                Vec2f size(_factory.getItem(objs[i]).size);
+                Vec2f size(_objItem(i).size);
 
                 _rc.translate(x * (cellsz.x + _cnvOpt.gridMarginX), y * (cellsz.y + _cnvOpt.gridMarginY));
+                if (cells.size() > 0)
+                {
+                    cairo_matrix_t origin;
+                    _rc.getTransform(origin);
+                    cells[i]->x = origin.x0;
+                    cells[i]->y = origin.y0;
+                }
                 _rc.storeTransform();
                 {
                     if (enableRefAtoms)
                     {
                         _rc.translate(0.5f * (cellsz.x - (columnExtentRight[x] + columnExtentLeft[x]) * scale),
                                       0.5f * (maxsz.y - (rowExtentBottom[y] + rowExtentTop[y])) * scale);
-                        const Vec2f r = _factory.getItemMolecule(objs[i]).refAtomPos;
+                        const Vec2f r = _objMolecule(i).refAtomPos;
                         _rc.translate((columnExtentLeft[x] - r.x) * scale, (rowExtentTop[y] - r.y) * scale);
                     }
                     else
@@ -182,7 +282,10 @@ void RenderGrid::draw()
                         _rc.translate(0.5f * (cellsz.x - size.x * scale), 0.5f * (maxsz.y - size.y) * scale);
                     }
                     _rc.scale(scale);
-                    _factory.getItem(objs[i]).render(false);
+                    if (cells.size() > 0)
+                        _rc.getTransform(cells[i]->objTransform);
+                    else
+                        _factory.getItem(objs[i]).render(false);
                 }
                 _rc.restoreTransform();
                 _rc.removeStoredTransform();
@@ -190,14 +293,19 @@ void RenderGrid::draw()
 
                 if (enableTitles)
                 {
-                    Vec2f titleSize(_factory.getItem(titles[i]).size);
+                    Vec2f titleSize(_titleItem(i).size);
                     _rc.translate(_cnvOpt.titleAlign.getBboxRelativeOffset() * (cellsz.x - titleSize.x), 0.5f * (maxTitleSize.y - titleSize.y));
-                    _factory.getItem(titles[i]).render(false);
+                    if (cells.size() > 0)
+                        _rc.getTransform(cells[i]->titleTransform);
+                    else
+                        _factory.getItem(titles[i]).render(false);
                 }
             }
             _rc.restoreTransform();
             _rc.removeStoredTransform();
         }
+        if (cells.size() > 0)
+            _drawCells();
     }
     _rc.restoreTransform();
     _rc.removeStoredTransform();
@@ -19,6 +19,7 @@
 #include "base_cpp/array.h"
 #include "base_cpp/os_sync_wrapper.h"
 #include "base_cpp/output.h"
+#include "base_cpp/task_executor.h"
 #include "layout/metalayout.h"
 #include "layout/molecule_layout.h"
 #include "layout/reaction_layout.h"
@@ -68,6 +69,7 @@ void RenderParams::clear()
 {
     relativeThickness = 1.0f;
     bondLineWidthFactor = 1.0f;
+    threadCount = 1;
     rmode = RENDER_NONE;
     mol.reset(nullptr);
     rxn.reset(nullptr);
@@ -184,88 +186,136 @@ int RenderParamInterface::multilineTextUnit(RenderItemFactory& factory, int type
     return title;
 }
 
-void RenderParamInterface::render(RenderParams& params)
+void RenderParamInterface::_prepareObjects(RenderParams& params)
 {
-    if (params.rmode == RENDER_NONE)
-        throw Error("No object to render specified");
+    if (params.rmode == RENDER_MOL)
+    {
+        if (params.mols.size() == 0)
+            _prepareMolecule(params, *params.mol);
+        else
+            TaskGroup::parallelFor(params.mols.size(), params.threadCount, [&](int i) { _prepareMolecule(params, *params.mols[i]); });
+    }
+    else if (params.rmode == RENDER_RXN)
+    {
+        if (params.rxns.size() == 0)
+            _prepareReaction(params, *params.rxn);
+        else
+            TaskGroup::parallelFor(params.rxns.size(), params.threadCount, [&](int i) { _prepareReaction(params, *params.rxns[i]); });
+    }
+    else
+    {
+        throw Error("Invalid rendering mode: %i", params.rmode);
+    }
+}
 
-    RenderContext rc(params.rOpt, params.relativeThickness, params.bondLineWidthFactor);
+int RenderParamInterface::_addObject(RenderParams& params, RenderItemFactory& factory, BaseMolecule* mol, BaseReaction* rxn)
+{
+    int obj;
+    if (mol != nullptr)
+    {
+        obj = factory.addItemMolecule();
+        factory.getItemMolecule(obj).mol = mol;
+    }
+    else
+    {
+        obj = factory.addItemReaction();
+        factory.getItemReaction(obj).rxn = rxn;
+    }
+    return obj;
+}
 
+void RenderParamInterface::_renderSingle(RenderParams& params, RenderContext& rc, BaseMolecule* mol, BaseReaction* rxn)
+{
     bool bondLengthSet = params.cnvOpt.bondLength > 0;
     int bondLength = (int)(bondLengthSet ? params.cnvOpt.bondLength : 100);
     rc.setDefaultScale((float)bondLength); // TODO: fix bondLength type
 
     RenderItemFactory factory(rc);
-    int obj = -1;
-    Array<int> objs;
-    Array<int> titles;
-    if (params.rmode == RENDER_MOL)
+    int obj = _addObject(params, factory, mol, rxn);
+
+    int comment = -1;
+    if (params.cnvOpt.comment.size() > 0)
     {
-        if (params.mols.size() == 0)
+        comment = multilineTextUnit(factory, RenderItemAuxiliary::AUX_COMMENT, params.cnvOpt.comment,
+                                    params.rOpt.commentSpacing * params.rOpt.commentFontFactor, params.cnvOpt.commentAlign.inbox_alignment);
+    }
+
+    RenderSingle render(rc, factory, params.cnvOpt, bondLength, bondLengthSet);
+    render.obj = obj;
+    render.comment = comment;
+    render.draw();
+    rc.closeContext(false);
+}
+
+void RenderParamInterface::_renderGrid(RenderParams& params, RenderContext& rc)
+{
+    bool bondLengthSet = params.cnvOpt.bondLength > 0;
+    int bondLength = (int)(bondLengthSet ? params.cnvOpt.bondLength : 100);
+    rc.setDefaultScale((float)bondLength); // TODO: fix bondLength type
+
+    RenderItemFactory factory(rc);
+    int count = params.rmode == RENDER_MOL ? params.mols.size() : params.rxns.size();
+
+    RenderGrid render(rc, factory, params.cnvOpt, bondLength, bondLengthSet);
+    render.refAtoms.copy(params.refAtoms);
+    render.threadCount = params.threadCount;
+
+    // Cells are drawn apart on image surfaces only: vector surfaces would
+    // take them as embedded recordings and the output would differ from the
+    // serial one, so vector grids are drawn in place after the parallel layout
+    bool use_cells = params.threadCount != 1 && params.rOpt.mode == MODE_PNG;
+
+    for (int i = 0; i < count; ++i)
+    {
+        BaseMolecule* mol = params.rmode == RENDER_MOL ? params.mols[i] : nullptr;
+        BaseReaction* rxn = params.rmode == RENDER_RXN ? params.rxns[i] : nullptr;
+        RenderItemFactory* item_factory = &factory;
+        RenderGridCell* cell = nullptr;
+        if (use_cells)
         {
-            obj = factory.addItemMolecule();
-            BaseMolecule& bm = *params.mol;
-            _prepareMolecule(params, bm);
-            factory.getItemMolecule(obj).mol = &bm;
+            cell = &render.cells.add(new RenderGridCell(params.rOpt, params.relativeThickness, params.bondLineWidthFactor));
+            cell->rc.setDefaultScale((float)bondLength);
+            item_factory = &cell->factory;
         }
-        else
+
+        int obj = _addObject(params, *item_factory, mol, rxn);
+        int title = -1;
+        if (params.titles.size() > 0)
         {
-            for (int i = 0; i < params.mols.size(); ++i)
-            {
-                int mol = factory.addItemMolecule();
-                BaseMolecule& bm = *params.mols[i];
-                _prepareMolecule(params, bm);
-                factory.getItemMolecule(mol).mol = &bm;
-                objs.push(mol);
-
-                if (params.titles.size() > 0)
-                {
-                    titles.push(multilineTextUnit(factory, RenderItemAuxiliary::AUX_TITLE, params.titles[i],
-                                                  params.rOpt.titleSpacing * params.rOpt.titleFontFactor, params.cnvOpt.titleAlign.inbox_alignment));
-                }
-            }
+            title = multilineTextUnit(*item_factory, RenderItemAuxiliary::AUX_TITLE, params.titles[i], params.rOpt.titleSpacing * params.rOpt.titleFontFactor,
+                                      params.cnvOpt.titleAlign.inbox_alignment);
         }
-    }
-    else if (params.rmode == RENDER_RXN)
-    {
-        if (params.rxns.size() == 0)
+
+        if (cell != nullptr)
         {
-            obj = factory.addItemReaction();
-            factory.getItemReaction(obj);
-            BaseReaction& rxn = *params.rxn;
-            _prepareReaction(params, rxn);
-            factory.getItemReaction(obj).rxn = &rxn;
+            cell->obj = obj;
+            cell->title = title;
         }
         else
         {
-            for (int i = 0; i < params.rxns.size(); ++i)
-            {
-                int rxn = factory.addItemReaction();
-                BaseReaction& br = *params.rxns[i];
-                _prepareReaction(params, br);
-                factory.getItemReaction(rxn).rxn = &br;
-                objs.push(rxn);
-
-                if (params.titles.size() > 0)
-                {
-                    titles.push(multilineTextUnit(factory, RenderItemAuxiliary::AUX_TITLE, params.titles[i],
-                                                  params.rOpt.titleSpacing * params.rOpt.titleFontFactor, params.cnvOpt.titleAlign.inbox_alignment));
-                }
-            }
+            render.objs.push(obj);
+            if (title >= 0)
+                render.titles.push(title);
         }
     }
-    else
-    {
-        throw Error("Invalid rendering mode: %i", params.rmode);
-    }
 
-    int comment = -1;
     if (params.cnvOpt.comment.size() > 0)
     {
-        comment = multilineTextUnit(factory, RenderItemAuxiliary::AUX_COMMENT, params.cnvOpt.comment,
-                                    params.rOpt.commentSpacing * params.rOpt.commentFontFactor, params.cnvOpt.commentAlign.inbox_alignment);
+        render.comment = multilineTextUnit(factory, RenderItemAuxiliary::AUX_COMMENT, params.cnvOpt.comment,
+                                           params.rOpt.commentSpacing * params.rOpt.commentFontFactor, params.cnvOpt.commentAlign.inbox_alignment);
     }
 
+    render.draw();
+    rc.closeContext(false);
+}
+
+void RenderParamInterface::render(RenderParams& params)
+{
+    if (params.rmode == RENDER_NONE)
+        throw Error("No object to render specified");
+
+    _prepareObjects(params);
+
     // Render into other formats after objects has been prepared (layout, etc.)
     if (params.rOpt.mode == MODE_CDXML)
     {
@@ -274,21 +324,41 @@ void RenderParamInterface::render(RenderParams& params)
         return;
     }
 
-    if (obj >= 0)
-    {
-        RenderSingle render(rc, factory, params.cnvOpt, bondLength, bondLengthSet);
-        render.obj = obj;
-        render.comment = comment;
-        render.draw();
-    }
+    RenderContext rc(params.rOpt, params.relativeThickness, params.bondLineWidthFactor);
+    if (params.rmode == RENDER_MOL && params.mols.size() == 0)
+        _renderSingle(params, rc, params.mol.get(), nullptr);
+    else if (params.rmode == RENDER_RXN && params.rxns.size() == 0)
+        _renderSingle(params, rc, nullptr, params.rxn.get());
     else
-    {
-        RenderGrid render(rc, factory, params.cnvOpt, bondLength, bondLengthSet);
-        render.objs.copy(objs);
-        render.comment = comment;
-        render.titles.copy(titles);
-        render.refAtoms.copy(params.refAtoms);
-        render.draw();
-    }
-    rc.closeContext(false);
+        _renderGrid(params, rc);
+}
+
+void RenderParamInterface::renderBatch(RenderParams& params, const Array<Output*>& outputs)
+{
+    int mode = params.rOpt.mode;
+    if (mode != MODE_PNG && mode != MODE_SVG && mode != MODE_PDF)
+        throw Error("batch rendering supports PNG, SVG and PDF only");
+
+    int count;
+    if (params.rmode == RENDER_MOL)
+        count = params.mols.size();
+    else if (params.rmode == RENDER_RXN)
+        count = params.rxns.size();
+    else
+        throw Error("No object to render specified");
+    if (outputs.size() != count)
+        throw Error("Number of outputs should be same as the number of objects");
+
+    TaskGroup::parallelFor(count, params.threadCount, [&](int i) {
+        BaseMolecule* mol = params.rmode == RENDER_MOL ? params.mols[i] : nullptr;
+        BaseReaction* rxn = params.rmode == RENDER_RXN ? params.rxns[i] : nullptr;
+        if (mol != nullptr)
+            _prepareMolecule(params, *mol);
+        else
+            _prepareReaction(params, *rxn);
+
+        RenderContext rc(params.rOpt, params.relativeThickness, params.bondLineWidthFactor);
+        rc.setOutput(outputs[i]);
+        _renderSingle(params, rc, mol, rxn);
+    });
 }